@@ -1,20 +1,23 @@
+#include "../tests/helpers/test_helpers.h"
 #include "PluginEditor.h"
 #include "catch2/benchmark/catch_benchmark_all.hpp"
 #include "catch2/catch_test_macros.hpp"
+#include <array>
+#include <string>
 
 TEST_CASE ("Boot performance")
 {
     BENCHMARK_ADVANCED ("Processor constructor")
     (Catch::Benchmark::Chronometer meter)
     {
-        std::vector<Catch::Benchmark::storage_for<PluginProcessor>> storage (size_t (meter.runs()));
+        std::vector<Catch::Benchmark::storage_for<MetronomeAudioProcessor>> storage (size_t (meter.runs()));
         meter.measure ([&] (int i) { storage[(size_t) i].construct(); });
     };
 
     BENCHMARK_ADVANCED ("Processor destructor")
     (Catch::Benchmark::Chronometer meter)
     {
-        std::vector<Catch::Benchmark::destructable_object<PluginProcessor>> storage (size_t (meter.runs()));
+        std::vector<Catch::Benchmark::destructable_object<MetronomeAudioProcessor>> storage (size_t (meter.runs()));
         for (auto& s : storage)
             s.construct();
         meter.measure ([&] (int i) { storage[(size_t) i].destruct(); });
@@ -23,7 +26,7 @@ TEST_CASE ("Boot performance")
     BENCHMARK_ADVANCED ("Editor open and close")
     (Catch::Benchmark::Chronometer meter)
     {
-        PluginProcessor plugin;
+        MetronomeAudioProcessor plugin;
 
         // due to complex construction logic of the editor, let's measure open/close together
         meter.measure ([&] (int /* i */) {
@@ -34,3 +37,108 @@ TEST_CASE ("Boot performance")
         });
     };
 }
+
+/*
+ * Message thread cost of the editor: every host runs all plugin UIs on the same
+ * thread, so a slow paint or timer tick stalls every other plugin window.
+ *
+ * The editor is painted offscreen into an image reused across runs, so that
+ * only the drawing is measured, at the display scales hosts commonly use and
+ * with 1 to 16 beat visualizers.
+ */
+namespace
+{
+    constexpr std::array<float, 4> DISPLAY_SCALES { 1.0f, 1.5f, 2.0f, 3.0f };
+    constexpr std::array<int, 5> BEATS_PER_BAR { 1, 4, 7, 12, 16 };
+
+    /**
+     * Paints the whole editor, children included, at a display scale
+     */
+    void paintEditor (juce::Component& editor, juce::Image& image, float scale)
+    {
+        juce::Graphics g (image);
+        g.addTransform (juce::AffineTransform::scale (scale));
+        editor.paintEntireComponent (g, true);
+    }
+
+    juce::Image createImageFor (const juce::Component& editor, float scale)
+    {
+        return { juce::Image::ARGB,
+            juce::roundToInt (static_cast<float> (editor.getWidth()) * scale),
+            juce::roundToInt (static_cast<float> (editor.getHeight()) * scale),
+            true };
+    }
+}
+
+TEST_CASE ("Editor performance", "[editor]")
+{
+    MetronomeAudioProcessor plugin;
+    std::unique_ptr<juce::AudioProcessorEditor> editorOwner (plugin.createEditorIfNeeded());
+    auto& editor = dynamic_cast<MetronomeAudioProcessorEditor&> (*editorOwner);
+    setParameter (plugin, "play", 1.0f);
+
+    for (const auto scale : DISPLAY_SCALES)
+    {
+        auto image = createImageFor (editor, scale);
+
+        BENCHMARK ("Paint at scale " + juce::String (scale, 1).toStdString())
+        {
+            paintEditor (editor, image, scale);
+            return image.getWidth();
+        };
+    }
+
+    for (const auto beats : BEATS_PER_BAR)
+    {
+        setParameter (plugin, "beatsPerBar", static_cast<float> (beats - 1));
+        editor.timerCallback();
+
+        auto image = createImageFor (editor, 1.0f);
+        const auto label = std::to_string (beats) + (beats == 1 ? " beat" : " beats");
+
+        BENCHMARK ("Paint with " + label)
+        {
+            paintEditor (editor, image, 1.0f);
+            return image.getWidth();
+        };
+
+        // One display tick while playing: follow the processor, then draw the frame
+        BENCHMARK ("Timer tick and paint with " + label)
+        {
+            editor.timerCallback();
+            paintEditor (editor, image, 1.0f);
+            return image.getWidth();
+        };
+
+        // Points spread over the editor, most of them away from the beats, as a moving mouse would be
+        BENCHMARK ("Beat hit test with " + label)
+        {
+            size_t hits = 0;
+            for (int y = 0; y < editor.getHeight(); y += 8)
+            {
+                for (int x = 0; x < editor.getWidth(); x += 8)
+                {
+                    size_t index = 0;
+                    if (editor.isMouseOverBeatVisualizer ({ static_cast<float> (x), static_cast<float> (y) }, index))
+                        ++hits;
+                }
+            }
+            return hits;
+        };
+    }
+
+    plugin.editorBeingDeleted (editorOwner.get());
+    editorOwner.reset();
+
+    NotesComboBox subdivisions;
+    subdivisions.setProcessor (&plugin);
+
+    for (const auto denominator : { 1, 2, 4, 8 })
+    {
+        BENCHMARK ("Subdivision choices for x/" + std::to_string (denominator))
+        {
+            subdivisions.updateForDenominator (denominator);
+            return subdivisions.getNumItems();
+        };
+    }
+}
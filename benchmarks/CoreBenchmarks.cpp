@@ -0,0 +1,34 @@
+#include "ClickEngine.h"
+#include "catch2/benchmark/catch_benchmark_all.hpp"
+#include "catch2/catch_test_macros.hpp"
+#include <array>
+#include <string>
+
+/*
+ * The JUCE-free core renderer on its own, without host, parameters or editor:
+ * the floor of what the plugin's processBlock costs for the main click.
+ */
+TEST_CASE ("Core engine performance", "[core]")
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+
+    std::array<std::array<float, blockSize>, 2> storage {};
+    std::array<float*, 2> channels { storage[0].data(), storage[1].data() };
+
+    for (const auto subdivision : { Subdivision::NoSubdivision, Subdivision::Triplet, Subdivision::Quarter })
+    {
+        ClickEngine engine;
+        ClickEngine::Settings settings;
+        settings.subdivision = subdivision;
+        settings.bpm = 180.0;
+        engine.setSettings (settings);
+        engine.prepare (sampleRate);
+
+        BENCHMARK ("Core render, subdivision " + std::to_string (static_cast<int> (subdivision)))
+        {
+            engine.render (channels.data(), static_cast<int> (channels.size()), blockSize);
+            return storage[0][0];
+        };
+    }
+}
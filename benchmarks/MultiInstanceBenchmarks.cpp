@@ -0,0 +1,226 @@
+#include "../tests/helpers/test_helpers.h"
+#include "PluginProcessor.h"
+#include "catch2/catch_test_macros.hpp"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+/*
+ * Many instances rendered in parallel, the way a DAW runs a large session.
+ *
+ * Each instance plays its own tempo into its own buffer. Worker threads share
+ * the instances round-robin and meet at a barrier after every audio period,
+ * like the workers of a host's processing graph. Any state shared between
+ * instances, or false sharing between them, shows up as a per-instance cost
+ * growing with the number of threads; any interference shows up as clicks
+ * off their instance's grid.
+ *
+ * The matrix is hidden (run it with `./Benchmarks "[multiInstance]"`) and
+ * writes its results to multiInstance_benchmarks.json, or to the file named by
+ * BEATIT_MULTI_INSTANCE_JSON.
+ */
+namespace
+{
+    constexpr double SAMPLE_RATE = 48000.0;
+    constexpr int BLOCK_SIZE = 256;
+
+    /**
+     * Spinning barrier for the end of each audio period
+     */
+    class PeriodBarrier
+    {
+    public:
+        explicit PeriodBarrier (int numThreadsToWaitFor) : numThreads (numThreadsToWaitFor) {}
+
+        void arriveAndWait()
+        {
+            const auto currentGeneration = generation.load (std::memory_order_acquire);
+            if (numWaiting.fetch_add (1, std::memory_order_acq_rel) + 1 == numThreads)
+            {
+                numWaiting.store (0, std::memory_order_relaxed);
+                generation.store (currentGeneration + 1, std::memory_order_release);
+                return;
+            }
+
+            while (generation.load (std::memory_order_acquire) == currentGeneration)
+                std::this_thread::yield();
+        }
+
+    private:
+        const int numThreads;
+        std::atomic<int> numWaiting { 0 };
+        std::atomic<int> generation { 0 };
+    };
+
+    /**
+     * One instance with its own output and the onsets found in it
+     */
+    struct Instance
+    {
+        explicit Instance (int bpmToUse) : bpm (bpmToUse)
+        {
+            prepareProcessor (processor, SAMPLE_RATE, BLOCK_SIZE);
+
+            // Every beat clicks, so every beat is an onset
+            setParameter (processor, "bpm", static_cast<float> (bpm));
+            setParameter (processor, "firstBeatSound", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::ClickType::High)));
+            setParameter (processor, "otherBeatsSound", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::ClickType::High)));
+
+            // Let the stopped engine pick up the settings, then start on the next block
+            processor.processBlock (buffer, midi);
+            setParameter (processor, "play", 1.0f);
+        }
+
+        void processBlock()
+        {
+            processor.processBlock (buffer, midi);
+
+            const auto samplesPerBeat = SAMPLE_RATE * 60.0 / bpm;
+
+            onsetFinder.process (buffer.getReadPointer (0), BLOCK_SIZE, position, [this, samplesPerBeat] (int64_t onset) {
+                const auto ideal = static_cast<double> (numOnsets) * samplesPerBeat;
+                if (std::abs (static_cast<double> (onset) - ideal) > 0.5 + 1.0e-6)
+                    ++numTimingErrors;
+
+                ++numOnsets;
+            });
+
+            position += BLOCK_SIZE;
+        }
+
+        /** Beats that should have been heard but were not (an onset is seen one sample late) */
+        int64_t getNumMissedBeats() const
+        {
+            const auto samplesPerBeat = SAMPLE_RATE * 60.0 / bpm;
+            const auto numExpected = static_cast<int64_t> (std::ceil (static_cast<double> (position - 2) / samplesPerBeat));
+            return std::max<int64_t> (0, numExpected - numOnsets);
+        }
+
+        MetronomeAudioProcessor processor;
+        const int bpm;
+        juce::AudioBuffer<float> buffer { 1, BLOCK_SIZE };
+        juce::MidiBuffer midi;
+        int64_t position = 0;
+        int64_t numOnsets = 0;
+        int64_t numTimingErrors = 0;
+        OnsetFinder onsetFinder;
+    };
+
+    struct RunResult
+    {
+        double elapsedSeconds = 0.0;
+        int64_t numBlocks = 0; ///< Blocks rendered, all instances together
+        int64_t numTimingErrors = 0; ///< Onsets off their grid, all instances together
+        int64_t numMissedBeats = 0;
+    };
+
+    /**
+     * Renders the given duration of audio through every instance
+     */
+    RunResult run (int numInstances, int numThreads, double seconds)
+    {
+        std::vector<std::unique_ptr<Instance>> instances;
+        for (int i = 0; i < numInstances; ++i)
+            instances.push_back (std::make_unique<Instance> (40 + (i * 37) % 400));
+
+        const auto numPeriods = std::max (1, static_cast<int> (seconds * SAMPLE_RATE) / BLOCK_SIZE);
+        PeriodBarrier barrier (numThreads);
+
+        auto work = [&] (int thread) {
+            for (int period = 0; period < numPeriods; ++period)
+            {
+                for (auto i = static_cast<size_t> (thread); i < instances.size(); i += static_cast<size_t> (numThreads))
+                    instances[i]->processBlock();
+
+                barrier.arriveAndWait();
+            }
+        };
+
+        const auto start = std::chrono::steady_clock::now();
+        {
+            std::vector<std::thread> workers;
+            for (int thread = 0; thread < numThreads; ++thread)
+                workers.emplace_back (work, thread);
+
+            for (auto& worker : workers)
+                worker.join();
+        }
+
+        RunResult result;
+        result.elapsedSeconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+        result.numBlocks = static_cast<int64_t> (numPeriods) * numInstances;
+
+        for (const auto& instance : instances)
+        {
+            result.numTimingErrors += instance->numTimingErrors;
+            result.numMissedBeats += instance->getNumMissedBeats();
+        }
+
+        return result;
+    }
+
+    juce::var toRecord (int numInstances, int numThreads, double seconds, const RunResult& result)
+    {
+        const auto audioSeconds = static_cast<double> (result.numBlocks) * BLOCK_SIZE / SAMPLE_RATE;
+
+        auto* record = new juce::DynamicObject();
+        record->setProperty ("instances", numInstances);
+        record->setProperty ("threads", numThreads);
+        record->setProperty ("seconds", seconds);
+        record->setProperty ("nsPerInstanceBlock", result.elapsedSeconds * 1.0e9 / static_cast<double> (result.numBlocks));
+        record->setProperty ("aggregateRealTimeFactor", result.elapsedSeconds > 0.0 ? audioSeconds / result.elapsedSeconds : 0.0);
+        record->setProperty ("timingErrors", static_cast<juce::int64> (result.numTimingErrors));
+        record->setProperty ("missedBeats", static_cast<juce::int64> (result.numMissedBeats));
+        return juce::var (record);
+    }
+
+    juce::File getResultFile()
+    {
+        const auto path = juce::SystemStats::getEnvironmentVariable ("BEATIT_MULTI_INSTANCE_JSON", {});
+        if (path.isNotEmpty())
+            return juce::File::getCurrentWorkingDirectory().getChildFile (path);
+
+        return juce::File::getCurrentWorkingDirectory().getChildFile ("multiInstance_benchmarks.json");
+    }
+}
+
+TEST_CASE ("Parallel instances keep their own timing")
+{
+    const auto result = run (16, 4, 10.0);
+
+    CHECK (result.numTimingErrors == 0);
+    CHECK (result.numMissedBeats == 0);
+}
+
+TEST_CASE ("Multi-instance scaling matrix", "[.][multiInstance]")
+{
+    const auto numCores = std::max (1, juce::SystemStats::getNumCpus());
+    juce::Array<juce::var> results;
+
+    for (int numInstances = 1; numInstances <= 512; numInstances *= 2)
+    {
+        for (int numThreads = 1; numThreads <= numCores; numThreads *= 2)
+        {
+            if (numThreads > numInstances)
+                break;
+
+            // Roughly the same amount of work per configuration
+            const auto seconds = std::max (0.5, 64.0 / numInstances);
+            const auto result = run (numInstances, numThreads, seconds);
+
+            INFO (numInstances << " instances on " << numThreads << " threads");
+            CHECK (result.numTimingErrors == 0);
+            CHECK (result.numMissedBeats == 0);
+
+            results.add (toRecord (numInstances, numThreads, seconds, result));
+        }
+    }
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty ("benchmark", "multiInstance");
+    root->setProperty ("sampleRate", SAMPLE_RATE);
+    root->setProperty ("blockSize", BLOCK_SIZE);
+    root->setProperty ("results", results);
+
+    REQUIRE (getResultFile().replaceWithText (juce::JSON::toString (juce::var (root))));
+}
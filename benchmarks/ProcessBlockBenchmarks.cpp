@@ -0,0 +1,192 @@
+#include "../tests/helpers/test_helpers.h"
+#include "PluginProcessor.h"
+#include "catch2/benchmark/catch_benchmark_all.hpp"
+#include "catch2/catch_test_macros.hpp"
+#include <chrono>
+
+/*
+ * processBlock throughput across the configuration matrix.
+ *
+ * The matrix test is hidden (run it with `./Benchmarks "[processBlock]"`) and
+ * writes one JSON record per configuration to processBlock_benchmarks.json, or
+ * to the file named by BEATIT_BENCHMARK_JSON, so that releases can be compared.
+ */
+namespace
+{
+    constexpr double SECONDS_PER_CONFIGURATION = 2.0; // Simulated audio rendered per configuration
+
+    struct Configuration
+    {
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+        int numChannels = 2;
+        Subdivision subdivision = Subdivision::NoSubdivision;
+        int bpm = 120;
+        bool playing = true;
+    };
+
+    void prepare (MetronomeAudioProcessor& processor, const Configuration& configuration)
+    {
+        setParameter (processor, "bpm", static_cast<float> (configuration.bpm));
+        setParameter (processor, "subdivision", static_cast<float> (static_cast<int> (configuration.subdivision)));
+        setParameter (processor, "play", configuration.playing ? 1.0f : 0.0f);
+
+        prepareProcessor (processor,
+            configuration.sampleRate,
+            configuration.blockSize,
+            juce::AudioChannelSet::disabled(),
+            juce::AudioChannelSet::canonicalChannelSet (configuration.numChannels));
+    }
+
+    /**
+     * Renders SECONDS_PER_CONFIGURATION of audio and returns the figures of one configuration
+     */
+    juce::var measure (const Configuration& configuration)
+    {
+        MetronomeAudioProcessor processor;
+        prepare (processor, configuration);
+
+        juce::AudioBuffer<float> buffer (configuration.numChannels, configuration.blockSize);
+        juce::MidiBuffer midi;
+
+        // The first block picks up the parameter changes
+        processor.processBlock (buffer, midi);
+
+        const auto numBlocks = std::max (1, static_cast<int> (SECONDS_PER_CONFIGURATION * configuration.sampleRate) / configuration.blockSize);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int block = 0; block < numBlocks; ++block)
+            processor.processBlock (buffer, midi);
+        const auto elapsed = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+
+        const auto numSamples = static_cast<double> (numBlocks) * configuration.blockSize;
+        const auto audioSeconds = numSamples / configuration.sampleRate;
+
+        auto* record = new juce::DynamicObject();
+        record->setProperty ("sampleRate", configuration.sampleRate);
+        record->setProperty ("blockSize", configuration.blockSize);
+        record->setProperty ("channels", configuration.numChannels);
+        record->setProperty ("subdivision", static_cast<int> (configuration.subdivision));
+        record->setProperty ("bpm", configuration.bpm);
+        record->setProperty ("playing", configuration.playing);
+        record->setProperty ("nsPerSample", elapsed * 1.0e9 / numSamples);
+        record->setProperty ("realTimeFactor", elapsed > 0.0 ? audioSeconds / elapsed : 0.0);
+        return juce::var (record);
+    }
+
+    juce::File getResultFile()
+    {
+        const auto path = juce::SystemStats::getEnvironmentVariable ("BEATIT_BENCHMARK_JSON", {});
+        if (path.isNotEmpty())
+            return juce::File::getCurrentWorkingDirectory().getChildFile (path);
+
+        return juce::File::getCurrentWorkingDirectory().getChildFile ("processBlock_benchmarks.json");
+    }
+}
+
+TEST_CASE ("processBlock performance")
+{
+    BENCHMARK_ADVANCED ("processBlock 48kHz, 512 samples, stereo, playing")
+    (Catch::Benchmark::Chronometer meter)
+    {
+        MetronomeAudioProcessor processor;
+        prepare (processor, {});
+
+        juce::AudioBuffer<float> buffer (2, 512);
+        juce::MidiBuffer midi;
+        processor.processBlock (buffer, midi);
+
+        meter.measure ([&] { processor.processBlock (buffer, midi); });
+    };
+
+    BENCHMARK_ADVANCED ("processBlock 48kHz, 512 samples, stereo, playing, double precision")
+    (Catch::Benchmark::Chronometer meter)
+    {
+        MetronomeAudioProcessor processor;
+        processor.setProcessingPrecision (juce::AudioProcessor::doublePrecision);
+        prepare (processor, {});
+
+        juce::AudioBuffer<double> buffer (2, 512);
+        juce::MidiBuffer midi;
+        processor.processBlock (buffer, midi);
+
+        meter.measure ([&] { processor.processBlock (buffer, midi); });
+    };
+
+    BENCHMARK_ADVANCED ("processBlock 48kHz, 512 samples, stereo, playing, bar not cached")
+    (Catch::Benchmark::Chronometer meter)
+    {
+        // At 97 BPM a bar is not a whole number of samples: every sample is rendered
+        Configuration configuration;
+        configuration.bpm = 97;
+
+        MetronomeAudioProcessor processor;
+        prepare (processor, configuration);
+
+        juce::AudioBuffer<float> buffer (2, 512);
+        juce::MidiBuffer midi;
+        processor.processBlock (buffer, midi);
+
+        meter.measure ([&] { processor.processBlock (buffer, midi); });
+    };
+
+    BENCHMARK_ADVANCED ("processBlock 48kHz, 512 samples, stereo, stopped")
+    (Catch::Benchmark::Chronometer meter)
+    {
+        Configuration configuration;
+        configuration.playing = false;
+
+        MetronomeAudioProcessor processor;
+        prepare (processor, configuration);
+
+        juce::AudioBuffer<float> buffer (2, 512);
+        juce::MidiBuffer midi;
+        processor.processBlock (buffer, midi);
+
+        meter.measure ([&] { processor.processBlock (buffer, midi); });
+    };
+}
+
+TEST_CASE ("processBlock throughput matrix", "[.][processBlock]")
+{
+    juce::Array<juce::var> results;
+
+    // Host settings: every sample rate, block size and channel count
+    for (const auto sampleRate : { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 })
+    {
+        for (const auto blockSize : { 1, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192 })
+        {
+            for (const auto numChannels : { 1, 2 })
+            {
+                Configuration configuration;
+                configuration.sampleRate = sampleRate;
+                configuration.blockSize = blockSize;
+                configuration.numChannels = numChannels;
+                results.add (measure (configuration));
+            }
+        }
+    }
+
+    // Musical settings: every subdivision and a range of tempi, playing and stopped
+    for (int subdivision = 0; subdivision < SubdivisionCount; ++subdivision)
+    {
+        for (const auto bpm : { 1, 40, 120, 240, 500 })
+        {
+            for (const auto playing : { true, false })
+            {
+                Configuration configuration;
+                configuration.subdivision = static_cast<Subdivision> (subdivision);
+                configuration.bpm = bpm;
+                configuration.playing = playing;
+                results.add (measure (configuration));
+            }
+        }
+    }
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty ("benchmark", "processBlock");
+    root->setProperty ("secondsPerConfiguration", SECONDS_PER_CONFIGURATION);
+    root->setProperty ("results", results);
+
+    REQUIRE (getResultFile().replaceWithText (juce::JSON::toString (juce::var (root))));
+}
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <type_traits>
+
+/**
+ * @file BarCache.h
+ * @brief Rendered bars replayed while the configuration does not change
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ */
+
+/**
+ * @class BarCache
+ * @brief A loop of bars of engine output, played back by copying while nothing changes
+ *
+ * With the same tempo, meter, pattern, mutes, sounds, tracks and groove, the
+ * engine renders the same samples every time a whole number of samples has
+ * gone by since the start of a bar: every bar when bars last a whole number
+ * of samples, every few bars otherwise. The cache records such a loop of bars
+ * as the engine renders it, once a whole bar has been played with the same
+ * configuration (so that it also holds the tails of the clicks of the
+ * previous bar), and the following loops are copied from it.
+ *
+ * The clicks started in the recorded loop are kept, so that the engine can
+ * pick up the clicks in progress when the cache is dropped in the middle of
+ * a bar. Storage is allocated by prepare(); nothing else allocates.
+ */
+class BarCache
+{
+public:
+    /** @brief Voice of the main click; ensemble tracks are voices 0 and up */
+    static constexpr int mainVoice = -1;
+
+    /** @brief Most clicks recorded in a loop, beyond which the loop is not cached */
+    static constexpr int maxOnsets = 2048;
+
+    /**
+     * @brief A click started in the recorded loop
+     */
+    struct Onset
+    {
+        int sample = 0; ///< Position in the loop
+        int voice = mainVoice; ///< Main click or ensemble track
+        bool isRest = false; ///< Rest of the pattern
+        float level = 1.0f; ///< Accent level
+    };
+
+    /**
+     * @brief Allocates the storage and empties the cache (not on the audio thread)
+     * @param maxLength Longest loop to cache, in samples
+     * @param maxChannels Most channels to record
+     */
+    void prepare (int maxLength, int maxChannels)
+    {
+        storage.setSize (maxChannels, maxLength, false, false, false);
+        invalidate();
+    }
+
+    /**
+     * @brief Gets the longest loop of bars that can be cached
+     * @return Length in samples
+     */
+    int getMaxLength() const { return storage.getNumSamples(); }
+
+    /**
+     * @brief Gets the most channels that can be recorded
+     * @return Number of channels
+     */
+    int getMaxChannels() const { return storage.getNumChannels(); }
+
+    /**
+     * @brief Drops the cached loop
+     */
+    void invalidate()
+    {
+        state = State::Empty;
+        position = 0;
+        numOnsets = 0;
+    }
+
+    /**
+     * @brief Moves on at the start of a bar that can be cached
+     *
+     * The first such bar is played to fill the tails, the loop starting with
+     * the second one is recorded and the following loops are played from the
+     * cache.
+     *
+     * @param length Loop length in samples, a whole number of bars
+     * @param numChannels Distinct output channels; the first one is copied to the others
+     */
+    void startBar (int length, int numChannels)
+    {
+        switch (state)
+        {
+            case State::Empty:
+                state = State::Warming;
+                break;
+
+            case State::Warming:
+                state = State::Recording;
+                loopLength = length;
+                channels = numChannels;
+                position = 0;
+                numOnsets = 0;
+                break;
+
+            case State::Recording:
+                // A bar inside the loop goes on recording
+                if (position == loopLength)
+                {
+                    state = State::Ready;
+                    position = 0;
+                }
+                else if (length != loopLength)
+                {
+                    invalidate();
+                }
+                break;
+
+            case State::Ready:
+            default:
+                break;
+        }
+    }
+
+    /**
+     * @brief Checks if the current bar is being recorded
+     * @return true while recording
+     */
+    bool isRecording() const { return state == State::Recording; }
+
+    /**
+     * @brief Checks if the current loop is played from the cache
+     * @return true when ready
+     */
+    bool isReady() const { return state == State::Ready; }
+
+    /**
+     * @brief Records the sample the engine has just rendered
+     * @param buffer Output buffer
+     * @param sample Index of the sample in the buffer
+     */
+    template <typename SampleType>
+    void record (const juce::AudioBuffer<SampleType>& buffer, int sample)
+    {
+        // The loop runs longer than it should: it is not the loop the cache was told about
+        if (position >= loopLength)
+        {
+            invalidate();
+            return;
+        }
+
+        for (int channel = 0; channel < channels; ++channel)
+            storage.setSample (channel, position, static_cast<float> (buffer.getSample (channel, sample)));
+
+        ++position;
+    }
+
+    /**
+     * @brief Records a click starting at the sample being rendered
+     * @param voice Main click or ensemble track
+     * @param isRest Rest of the pattern
+     * @param level Accent level
+     */
+    void addOnset (int voice, bool isRest, float level)
+    {
+        if (numOnsets == maxOnsets)
+        {
+            invalidate();
+            return;
+        }
+
+        onsets[static_cast<size_t> (numOnsets++)] = { position, voice, isRest, level };
+    }
+
+    /**
+     * @brief Copies the cached loop into the output, up to the end of the loop
+     * @param buffer Output buffer
+     * @param startSample First sample to write
+     * @param numSamples Samples left in the block
+     * @param numOutputChannels Output channels to write
+     * @return Number of samples written
+     */
+    template <typename SampleType>
+    int play (juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, int numOutputChannels)
+    {
+        const auto count = std::min (numSamples, loopLength - position);
+
+        for (int channel = 0; channel < numOutputChannels; ++channel)
+        {
+            const auto* source = storage.getReadPointer (std::min (channel, channels - 1), position);
+            auto* destination = buffer.getWritePointer (channel, startSample);
+
+            if constexpr (std::is_same_v<SampleType, float>)
+            {
+                juce::FloatVectorOperations::copy (destination, source, count);
+            }
+            else
+            {
+                for (int i = 0; i < count; ++i)
+                    destination[i] = static_cast<SampleType> (source[i]);
+            }
+        }
+
+        position += count;
+        if (position == loopLength)
+            position = 0;
+
+        return count;
+    }
+
+    /**
+     * @brief Finds the last click of a voice started before the current position
+     *
+     * Clicks of the loop that have not been played yet belong to the previous
+     * loop, a loop length earlier.
+     *
+     * @param voice Main click or ensemble track
+     * @param age Samples played since the click started
+     * @return The click, or nullptr if the voice has none in the loop
+     */
+    const Onset* findLastOnset (int voice, int& age) const
+    {
+        const Onset* last = nullptr;
+
+        for (int i = 0; i < numOnsets; ++i)
+        {
+            const auto& onset = onsets[static_cast<size_t> (i)];
+            if (onset.voice != voice)
+                continue;
+
+            // Onsets are in playing order: the last one before the position, or failing that the last one
+            if (onset.sample < position || last == nullptr || last->sample >= position)
+                last = &onset;
+        }
+
+        if (last != nullptr)
+            age = last->sample < position ? position - last->sample : position + loopLength - last->sample;
+
+        return last;
+    }
+
+private:
+    /**
+     * @enum State
+     * @brief Progress from a configuration change to cached playback
+     */
+    enum class State {
+        Empty, /**< Nothing cached, waiting for a bar start */
+        Warming, /**< Playing a bar whose clicks will ring into the recorded one */
+        Recording, /**< Recording the bars the engine renders */
+        Ready /**< Playing from the cache */
+    };
+
+    juce::AudioBuffer<float> storage; ///< Recorded loop, one channel per distinct output channel
+    std::array<Onset, maxOnsets> onsets {}; ///< Clicks started in the recorded loop, in order
+    int numOnsets = 0;
+    State state = State::Empty;
+    int loopLength = 0; ///< Samples in the recorded loop
+    int channels = 1; ///< Channels recorded
+    int position = 0; ///< Position in the loop, while recording or playing
+};
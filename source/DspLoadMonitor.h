@@ -0,0 +1,225 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+/**
+ * @file DspLoadMonitor.h
+ * @brief Per-block DSP load statistics of the audio thread
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ */
+
+/**
+ * @brief DSP load figures, as seen from any thread
+ *
+ * The load of a block is the time spent rendering it divided by its deadline,
+ * the duration of the audio it holds: 1 means the block took as long to
+ * render as to play.
+ */
+struct DspLoadStatistics
+{
+    /** @brief Number of histogram bins: below 1/512, one per octave up to 1, then overruns */
+    static constexpr int numBins = 11;
+
+    int64_t numBlocks = 0; ///< Blocks measured since the last reset
+    int64_t numOverruns = 0; ///< Blocks that took longer than their deadline
+    float lastLoad = 0.0f; ///< Load of the most recent block
+    float averageLoad = 0.0f; ///< Total rendering time over total audio time
+    float peakLoad = 0.0f; ///< Highest load of a single block
+    double lastBlockMicroseconds = 0.0; ///< Rendering time of the most recent block
+    double peakBlockMicroseconds = 0.0; ///< Longest rendering time of a single block
+    std::array<int64_t, numBins> histogram {}; ///< Blocks per load octave
+
+    /**
+     * @brief Gets the histogram bin of a load
+     * @param load Rendering time over deadline
+     * @return 0 below 1/512, 1 to 9 for each octave up to 1, 10 from 1 (overrun)
+     */
+    static int getBin (float load)
+    {
+        if (!(load > 0.0f))
+            return 0;
+
+        return std::clamp (numBins - 1 + std::ilogb (load), 0, numBins - 1);
+    }
+
+    /**
+     * @brief Gets the lowest load of a histogram bin
+     * @param bin Histogram bin
+     * @return Lower bound of the bin (0 for the first one)
+     */
+    static float getBinLowerBound (int bin)
+    {
+        return bin == 0 ? 0.0f : std::ldexp (1.0f, bin - (numBins - 1));
+    }
+};
+
+/**
+ * @class DspLoadMonitor
+ * @brief Measures how long each block takes to render against its deadline
+ *
+ * The audio thread measures each block with the high-resolution tick counter
+ * and updates plain atomic counters, without locks, allocations or
+ * read-modify-write instructions: it is their only writer. Any thread can
+ * read the statistics at any time; the fields are individually consistent,
+ * which is all a monitoring display needs. Resets are requested by the
+ * reader and performed by the audio thread at its next block.
+ */
+class DspLoadMonitor
+{
+public:
+    /**
+     * @class ScopedBlock
+     * @brief Measures the rendering of one block for its lifetime (audio thread)
+     */
+    class ScopedBlock
+    {
+    public:
+        /**
+         * @brief Starts measuring a block
+         * @param monitorToUse Monitor receiving the measurement
+         * @param numSamplesInBlock Number of samples in the block
+         */
+        ScopedBlock (DspLoadMonitor& monitorToUse, int numSamplesInBlock)
+            : monitor (monitorToUse), numSamples (numSamplesInBlock), start (juce::Time::getHighResolutionTicks())
+        {
+        }
+
+        /**
+         * @brief Records the block
+         */
+        ~ScopedBlock()
+        {
+            monitor.addBlock (juce::Time::getHighResolutionTicks() - start, numSamples);
+        }
+
+    private:
+        DspLoadMonitor& monitor;
+        const int numSamples;
+        const int64_t start;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedBlock)
+    };
+
+    /**
+     * @brief Sets the sample rate the deadlines are computed from
+     * @param sampleRate Sample rate of the audio stream
+     */
+    void prepare (double sampleRate)
+    {
+        ticksPerSample = static_cast<double> (juce::Time::getHighResolutionTicksPerSecond()) / sampleRate;
+        microsecondsPerTick = 1.0e6 / static_cast<double> (juce::Time::getHighResolutionTicksPerSecond());
+    }
+
+    /**
+     * @brief Records a rendered block (audio thread)
+     * @param elapsedTicks Rendering time, in high-resolution ticks
+     * @param numSamples Number of samples in the block
+     */
+    void addBlock (int64_t elapsedTicks, int numSamples)
+    {
+        if (numSamples <= 0)
+            return;
+
+        if (resetRequested.load (std::memory_order_acquire))
+        {
+            resetRequested.store (false, std::memory_order_relaxed);
+            clear();
+        }
+
+        const auto deadlineTicks = ticksPerSample * numSamples;
+        const auto load = static_cast<float> (static_cast<double> (elapsedTicks) / deadlineTicks);
+        const auto microseconds = static_cast<double> (elapsedTicks) * microsecondsPerTick;
+
+        totalTicks += elapsedTicks;
+        totalDeadlineTicks += deadlineTicks;
+
+        increment (numBlocks);
+        if (load >= 1.0f)
+            increment (numOverruns);
+
+        increment (histogram[static_cast<size_t> (DspLoadStatistics::getBin (load))]);
+
+        lastLoad.store (load, std::memory_order_relaxed);
+        averageLoad.store (static_cast<float> (static_cast<double> (totalTicks) / totalDeadlineTicks), std::memory_order_relaxed);
+        lastBlockMicroseconds.store (microseconds, std::memory_order_relaxed);
+
+        if (load > peakLoad.load (std::memory_order_relaxed))
+            peakLoad.store (load, std::memory_order_relaxed);
+
+        if (microseconds > peakBlockMicroseconds.load (std::memory_order_relaxed))
+            peakBlockMicroseconds.store (microseconds, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Gets the current statistics (any thread)
+     * @return Copy of the counters
+     */
+    DspLoadStatistics getStatistics() const
+    {
+        DspLoadStatistics statistics;
+        statistics.numBlocks = numBlocks.load (std::memory_order_relaxed);
+        statistics.numOverruns = numOverruns.load (std::memory_order_relaxed);
+        statistics.lastLoad = lastLoad.load (std::memory_order_relaxed);
+        statistics.averageLoad = averageLoad.load (std::memory_order_relaxed);
+        statistics.peakLoad = peakLoad.load (std::memory_order_relaxed);
+        statistics.lastBlockMicroseconds = lastBlockMicroseconds.load (std::memory_order_relaxed);
+        statistics.peakBlockMicroseconds = peakBlockMicroseconds.load (std::memory_order_relaxed);
+
+        for (size_t bin = 0; bin < histogram.size(); ++bin)
+            statistics.histogram[bin] = histogram[bin].load (std::memory_order_relaxed);
+
+        return statistics;
+    }
+
+    /**
+     * @brief Asks the audio thread to clear the statistics before its next block (any thread)
+     */
+    void reset()
+    {
+        resetRequested.store (true, std::memory_order_release);
+    }
+
+private:
+    /** Single writer: a load and a store, no locked instruction */
+    static void increment (std::atomic<int64_t>& counter)
+    {
+        counter.store (counter.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void clear()
+    {
+        totalTicks = 0;
+        totalDeadlineTicks = 0.0;
+        numBlocks.store (0, std::memory_order_relaxed);
+        numOverruns.store (0, std::memory_order_relaxed);
+        lastLoad.store (0.0f, std::memory_order_relaxed);
+        averageLoad.store (0.0f, std::memory_order_relaxed);
+        peakLoad.store (0.0f, std::memory_order_relaxed);
+        lastBlockMicroseconds.store (0.0, std::memory_order_relaxed);
+        peakBlockMicroseconds.store (0.0, std::memory_order_relaxed);
+
+        for (auto& bin : histogram)
+            bin.store (0, std::memory_order_relaxed);
+    }
+
+    double ticksPerSample = 1.0;
+    double microsecondsPerTick = 1.0;
+    int64_t totalTicks = 0; ///< Rendering time since the last reset (audio thread)
+    double totalDeadlineTicks = 0.0; ///< Audio time since the last reset (audio thread)
+
+    std::atomic<int64_t> numBlocks { 0 };
+    std::atomic<int64_t> numOverruns { 0 };
+    std::atomic<float> lastLoad { 0.0f };
+    std::atomic<float> averageLoad { 0.0f };
+    std::atomic<float> peakLoad { 0.0f };
+    std::atomic<double> lastBlockMicroseconds { 0.0 };
+    std::atomic<double> peakBlockMicroseconds { 0.0 };
+    std::array<std::atomic<int64_t>, DspLoadStatistics::numBins> histogram {};
+    std::atomic<bool> resetRequested { false };
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "SubdivisionTypes.h"
+#include <algorithm>
+#include <array>
+#include <utility>
+
+/**
+ * @file EnsembleTracks.h
+ * @brief Extra click tracks sharing the timeline of the main click
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ */
+
+/**
+ * @brief State of the ensemble tracks, stored as one array per field
+ *
+ * Each track plays its own subdivision, accents and click sound with its own
+ * gain and pan, on the beat grid of the main click: tracks have no clock of
+ * their own. The audio thread refreshes the settings from the parameters at
+ * each block and renders the enabled tracks in the same pass over the block
+ * as the main click, walking only the arrays it needs for each sample.
+ */
+struct EnsembleTracks
+{
+    /** @brief Number of tracks besides the main click */
+    static constexpr int maxTracks = 4;
+
+    /**
+     * @enum Accent
+     * @brief Which clicks of a track play at full level; the others are softer
+     */
+    enum class Accent {
+        None, /**< Every click at full level */
+        Bar, /**< Only the first beat of the bar */
+        Beat /**< Beats, but not their subdivisions */
+    };
+
+    /** @brief Level of the clicks that are not accented */
+    static constexpr float unaccentedLevel = 0.5f;
+
+    /** @name Settings (audio thread, from the parameters) */
+    ///@{
+    std::array<Subdivision, maxTracks> subdivisions {}; ///< Subdivision pattern of each beat
+    std::array<int, maxTracks> sounds {}; ///< Click sound (a ClickType)
+    std::array<Accent, maxTracks> accents {}; ///< Accented clicks
+    std::array<float, maxTracks> gains {}; ///< Linear gain, for a mono output
+    std::array<float, maxTracks> leftGains {}; ///< Gain and balance of the left channel
+    std::array<float, maxTracks> rightGains {}; ///< Gain and balance of the right channel
+    std::array<int, maxTracks> activeTracks {}; ///< Indices of the enabled tracks
+    int numActiveTracks = 0; ///< Number of valid entries in activeTracks
+    ///@}
+
+    /** @name Playback (audio thread) */
+    ///@{
+    std::array<int, maxTracks> clickPositions {}; ///< Position in the current click sound, -1 when silent
+    std::array<float, maxTracks> clickLevels {}; ///< Accent level of the current click
+    ///@}
+
+    /**
+     * @brief Silences every track until its next click
+     */
+    void reset() { clickPositions.fill (-1); }
+
+    /**
+     * @brief Gets the level of a click starting on the grid
+     * @param accent Accent setting of the track
+     * @param beat Beat index in the bar
+     * @param onBeat true for a beat, false for a subdivision
+     * @return 1 for an accented click, unaccentedLevel otherwise
+     */
+    static float getClickLevel (Accent accent, int beat, bool onBeat)
+    {
+        switch (accent)
+        {
+            case Accent::Bar:
+                return (onBeat && beat == 0) ? 1.0f : unaccentedLevel;
+            case Accent::Beat:
+                return onBeat ? 1.0f : unaccentedLevel;
+            case Accent::None:
+            default:
+                return 1.0f;
+        }
+    }
+
+    /**
+     * @brief Gets the channel gains of a balance control, unity on both sides at the centre
+     * @param pan Position from -1 (left) to 1 (right)
+     * @return Left and right gain factors
+     */
+    static std::pair<float, float> getBalance (float pan)
+    {
+        return { std::min (1.0f, 1.0f - pan), std::min (1.0f, 1.0f + pan) };
+    }
+};
@@ -0,0 +1,128 @@
+#include "Groove.h"
+#include <cmath>
+
+namespace
+{
+    // A step cannot be moved half-way to its neighbour or beyond
+    constexpr float MAX_STEP_OFFSET = 0.49f;
+}
+
+//==============================================================================
+// GrooveTemplate
+//==============================================================================
+GrooveTemplate GrooveTemplate::swing (float percent, int stepsPerBeat)
+{
+    GrooveTemplate groove;
+    groove.stepsPerBeat = juce::jmax (2, stepsPerBeat);
+
+    // The second step of a pair sits at twice the swing ratio, in steps, from the pair's start
+    const auto ratio = juce::jlimit (minSwingPercent, maxSwingPercent, percent) / 100.0f;
+    if (ratio <= 0.5f)
+        return groove;
+
+    groove.numSteps = 2;
+    groove.offsets[1] = 2.0f * ratio - 1.0f;
+    return groove;
+}
+
+GrooveTemplate GrooveTemplate::fromMidiFile (const juce::MidiFile& midiFile, int stepsPerBeat, int numSteps)
+{
+    GrooveTemplate groove;
+    groove.stepsPerBeat = juce::jmax (1, stepsPerBeat);
+
+    // SMPTE time formats have no beats to match
+    const auto ticksPerQuarterNote = static_cast<int> (midiFile.getTimeFormat());
+    if (ticksPerQuarterNote <= 0)
+        return groove;
+
+    const auto length = juce::jlimit (1, maxSteps, numSteps);
+    std::array<double, maxSteps> sums {};
+    std::array<int, maxSteps> counts {};
+
+    for (int track = 0; track < midiFile.getNumTracks(); ++track)
+    {
+        for (const auto* event : *midiFile.getTrack (track))
+        {
+            if (!event->message.isNoteOn())
+                continue;
+
+            const auto position = event->message.getTimeStamp() / ticksPerQuarterNote * groove.stepsPerBeat;
+            const auto nearest = std::llround (position);
+            const auto index = static_cast<size_t> (nearest % length);
+
+            sums[index] += position - static_cast<double> (nearest);
+            ++counts[index];
+        }
+    }
+
+    for (size_t step = 0; step < static_cast<size_t> (length); ++step)
+        if (counts[step] > 0)
+            groove.offsets[step] = juce::jlimit (-MAX_STEP_OFFSET, MAX_STEP_OFFSET, static_cast<float> (sums[step] / counts[step]));
+
+    groove.numSteps = length;
+    return groove;
+}
+
+double GrooveTemplate::warp (int beat, double fraction, int beatDenominator) const
+{
+    if (numSteps <= 0 || beatDenominator <= 0)
+        return fraction;
+
+    // Piecewise linear between the steps, which are played at step + offset
+    auto played = [this] (double position) {
+        const auto step = static_cast<int> (std::floor (position));
+        const auto start = step + static_cast<double> (getOffset (step));
+        const auto end = step + 1 + static_cast<double> (getOffset (step + 1));
+        return start + (position - step) * (end - start);
+    };
+
+    // Steps are fractions of a quarter note: an eighth beat spans half as many. A beat may start
+    // on a moved step; it stays on the grid, and what the groove plays inside it is scaled to fit.
+    const auto stepsInBeat = stepsPerBeat * 4.0 / beatDenominator;
+    const auto beatStart = beat * stepsInBeat;
+    const auto first = played (beatStart);
+    const auto last = played (beatStart + stepsInBeat);
+
+    return (played (beatStart + fraction * stepsInBeat) - first) / (last - first);
+}
+
+void GrooveTemplate::writeTo (juce::OutputStream& stream) const
+{
+    stream.writeInt (stepsPerBeat);
+    stream.writeInt (numSteps);
+
+    for (int step = 0; step < numSteps; ++step)
+        stream.writeFloat (offsets[static_cast<size_t> (step)]);
+}
+
+void GrooveTemplate::readFrom (juce::InputStream& stream)
+{
+    *this = {};
+
+    stepsPerBeat = juce::jlimit (1, maxSteps, stream.readInt());
+    const auto length = juce::jlimit (0, maxSteps, stream.readInt());
+
+    for (int step = 0; step < length && !stream.isExhausted(); ++step)
+        offsets[static_cast<size_t> (step)] = juce::jlimit (-MAX_STEP_OFFSET, MAX_STEP_OFFSET, stream.readFloat());
+
+    numSteps = length;
+}
+
+//==============================================================================
+// GrooveTable
+//==============================================================================
+void GrooveTable::compile (const GrooveTemplate& groove, double samplesPerBeat, int beatDenominator)
+{
+    for (int beat = 0; beat < maxBeats; ++beat)
+    {
+        for (int parts = 2; parts <= maxParts; ++parts)
+        {
+            for (int part = 1; part < parts; ++part)
+            {
+                const auto straight = static_cast<double> (part) / parts;
+                const auto shift = (groove.warp (beat, straight, beatDenominator) - straight) * samplesPerBeat;
+                offsets[static_cast<size_t> (beat)][static_cast<size_t> (parts)][static_cast<size_t> (part)] = static_cast<int> (std::llround (shift));
+            }
+        }
+    }
+}
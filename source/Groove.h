@@ -0,0 +1,135 @@
+#pragma once
+
+#include "ClickEngine.h"
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <cstdint>
+
+/**
+ * @file Groove.h
+ * @brief Swing and groove templates, compiled into subdivision offset tables
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ */
+
+/**
+ * @brief Timing of a groove: how far each step of a grid is played from its straight position
+ *
+ * Steps divide the quarter note (2 for eighths, 4 for sixteenths), whatever
+ * the beat unit of the meter, and the template repeats every numSteps steps,
+ * from the first beat of the bar. A template with no steps is straight.
+ *
+ * The beats stay on the beat: they are the grid every other feature (tap,
+ * follow, practice, latency) agrees on. Between two steps, positions are
+ * moved in proportion, so a subdivision finer than the template (or a
+ * triplet) keeps its place relative to the steps around it.
+ */
+struct GrooveTemplate
+{
+    /** @brief Longest template: four bars of 4/4 in sixteenths */
+    static constexpr int maxSteps = 64;
+
+    /** @name Swing range, from straight to a dotted feel */
+    ///@{
+    static constexpr float minSwingPercent = 50.0f;
+    static constexpr float maxSwingPercent = 75.0f;
+    ///@}
+
+    int stepsPerBeat = 2; ///< Steps in a quarter note
+    int numSteps = 0; ///< Length of the template in steps, 0 for straight
+    std::array<float, maxSteps> offsets {}; ///< Shift of each step from its straight position, in steps
+
+    /**
+     * @brief Creates a swing template
+     *
+     * The second step of each pair is played at the given percentage of the
+     * pair: 50% is straight, 66.7% a triplet shuffle, 75% a dotted feel.
+     *
+     * @param percent Swing amount, from minSwingPercent to maxSwingPercent
+     * @param stepsPerBeat 2 to swing eighths, 4 to swing sixteenths
+     * @return The template
+     */
+    static GrooveTemplate swing (float percent, int stepsPerBeat);
+
+    /**
+     * @brief Extracts the groove of a MIDI file
+     *
+     * Every note-on is matched with the nearest step of the grid; the offset
+     * of a step is the average distance of its notes from it. Steps without
+     * notes stay straight.
+     *
+     * @param midiFile A file with a tempo in ticks per quarter note
+     * @param stepsPerBeat Steps in a quarter note
+     * @param numSteps Length of the template in steps
+     * @return The template, straight if the file holds no usable note
+     */
+    static GrooveTemplate fromMidiFile (const juce::MidiFile& midiFile, int stepsPerBeat = 4, int numSteps = 16);
+
+    /**
+     * @brief Gets the shift of a step
+     * @param step Step index from the start of the bar
+     * @return Shift in steps; 0 for the steps on a quarter note
+     */
+    float getOffset (int step) const
+    {
+        if (numSteps <= 0 || step % stepsPerBeat == 0)
+            return 0.0f;
+
+        return offsets[static_cast<size_t> (step % numSteps)];
+    }
+
+    /**
+     * @brief Moves a position of a beat to where the groove plays it
+     * @param beat Beat index in the bar
+     * @param fraction Straight position in the beat, from 0 to 1
+     * @param beatDenominator Beat unit of the meter (1, 2, 4 or 8)
+     * @return Grooved position in the beat
+     */
+    double warp (int beat, double fraction, int beatDenominator = 4) const;
+
+    /** @name Serialisation */
+    ///@{
+    void writeTo (juce::OutputStream& stream) const;
+    void readFrom (juce::InputStream& stream);
+    ///@}
+};
+
+/**
+ * @class GrooveTable
+ * @brief Sample offsets of every subdivision of a bar, compiled from a groove template
+ *
+ * Compiled when the tempo or the template changes, so that placing a
+ * subdivision on the audio thread is a lookup added to the straight grid of
+ * the click engine. Compiling neither allocates nor locks.
+ */
+class GrooveTable : public ClickEngine::GridShift
+{
+public:
+    /** @brief Longest bar */
+    static constexpr int maxBeats = 16;
+
+    /**
+     * @brief Computes the offsets of every subdivision of every beat of a bar
+     * @param groove The groove to apply
+     * @param samplesPerBeat Exact beat length in samples
+     * @param beatDenominator Beat unit of the meter (1, 2, 4 or 8)
+     */
+    void compile (const GrooveTemplate& groove, double samplesPerBeat, int beatDenominator = 4);
+
+    /**
+     * @brief Gets the shift of a subdivision
+     * @param beat Beat index in the bar
+     * @param numerator Subdivision index (1 to denominator - 1)
+     * @param denominator Number of equal parts of the beat (2, 3 or 4)
+     * @return Samples to add to the straight position
+     */
+    int getOffset (int beat, int numerator, int denominator) const override
+    {
+        return offsets[static_cast<size_t> (beat % maxBeats)][static_cast<size_t> (denominator)][static_cast<size_t> (numerator)];
+    }
+
+private:
+    static constexpr int maxParts = 4;
+
+    std::array<std::array<std::array<int, maxParts>, maxParts + 1>, maxBeats> offsets {};
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+/**
+ * @file LockFreeSnapshot.h
+ * @brief Wait-free publication of a value from the audio thread to a reader thread
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ */
+
+/**
+ * @class LockFreeSnapshot
+ * @brief Triple buffer handing the latest value from one writer to one reader
+ *
+ * The writer (typically the audio thread) publishes complete values, the
+ * reader (typically the message thread) always gets the most recent complete
+ * value. Neither side ever blocks, allocates or sees a torn value: each owns
+ * one of the three buffers and they exchange the third through an atomic.
+ *
+ * @tparam T A copyable value type
+ */
+template <typename T>
+class LockFreeSnapshot
+{
+public:
+    /**
+     * @brief Publishes a new value (writer thread only)
+     * @param value The value to publish
+     */
+    void publish (const T& value)
+    {
+        buffers[static_cast<size_t> (writeIndex)] = value;
+        writeIndex = middle.exchange (writeIndex | freshFlag, std::memory_order_acq_rel) & indexMask;
+    }
+
+    /**
+     * @brief Gets the most recently published value (reader thread only)
+     * @return Reference to the value, valid until the next call to read()
+     */
+    const T& read()
+    {
+        if ((middle.load (std::memory_order_relaxed) & freshFlag) != 0)
+            readIndex = middle.exchange (readIndex, std::memory_order_acq_rel) & indexMask;
+
+        return buffers[static_cast<size_t> (readIndex)];
+    }
+
+private:
+    static constexpr int indexMask = 3;
+    static constexpr int freshFlag = 4;
+
+    std::array<T, 3> buffers {};
+    std::atomic<int> middle { 1 }; ///< Buffer in transit, with a flag when it holds an unread value
+    int writeIndex = 0; ///< Owned by the writer
+    int readIndex = 2; ///< Owned by the reader
+};
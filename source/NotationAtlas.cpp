@@ -0,0 +1,207 @@
+#include "NotationAtlas.h"
+#include "BinaryData.h"
+#include "NotationManager.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    // Sizes kept before the atlases are dropped, enough for every size on a couple of displays
+    constexpr size_t MAX_ATLASES = 8;
+
+    // Room around each symbol, in font heights: music glyphs reach well beyond the ascent and descent
+    constexpr float VERTICAL_MARGIN = 0.5f;
+    constexpr float HORIZONTAL_PADDING = 0.25f;
+}
+
+//==============================================================================
+// NotationAtlas
+//==============================================================================
+NotationAtlas::NotationAtlas()
+    : typeface (juce::Typeface::createSystemTypefaceFor (BinaryData::Leland_otf,
+          static_cast<size_t> (BinaryData::Leland_otfSize)))
+{
+    jassert (typeface != nullptr);
+}
+
+bool NotationAtlas::isNotationSymbol (juce::juce_wchar character)
+{
+    const auto symbols = NotationManager::getSymbols();
+    return std::find (symbols.begin(), symbols.end(), character) != symbols.end();
+}
+
+bool NotationAtlas::startsWithNotation (const juce::String& text)
+{
+    return text.isNotEmpty() && isNotationSymbol (text[0]);
+}
+
+void NotationAtlas::draw (juce::Graphics& g, const juce::String& text, juce::Rectangle<float> area, float symbolHeight)
+{
+    const auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    const auto& atlas = getAtlas (juce::jmax (1, juce::roundToInt (symbolHeight * scale)));
+
+    // Work in physical pixels and snap each blit to the pixel grid, so that symbols are copied, not resampled
+    auto x = area.getX() * scale;
+    const auto top = std::round (area.getCentreY() * scale - static_cast<float> (atlas.image.getHeight()) * 0.5f);
+
+    auto character = text.getCharPointer();
+    for (; !character.isEmpty(); ++character)
+    {
+        if (*character == ' ')
+        {
+            x += atlas.spaceAdvance;
+            continue;
+        }
+
+        const auto glyph = atlas.glyphs.find (*character);
+        if (glyph == atlas.glyphs.end())
+            break;
+
+        const auto left = std::round (x) - static_cast<float> (atlas.padding);
+        g.drawImageTransformed (glyph->second.image,
+            juce::AffineTransform::translation (left, top).scaled (1.0f / scale),
+            true);
+
+        x += glyph->second.advance;
+    }
+
+    // The pattern name, in the font of the component
+    const juce::String name (character);
+    if (name.isNotEmpty())
+        g.drawText (name, area.withLeft (x / scale), juce::Justification::centredLeft, true);
+}
+
+const NotationAtlas::Atlas& NotationAtlas::getAtlas (int pixelHeight)
+{
+    if (const auto found = atlases.find (pixelHeight); found != atlases.end())
+        return found->second;
+
+    if (atlases.size() >= MAX_ATLASES)
+        atlases.clear();
+
+    return atlases.emplace (pixelHeight, rasterize (pixelHeight)).first->second;
+}
+
+NotationAtlas::Atlas NotationAtlas::rasterize (int pixelHeight) const
+{
+    Atlas atlas;
+
+    juce::Font font (typeface);
+    font.setHeight (static_cast<float> (pixelHeight));
+
+    const auto margin = juce::roundToInt (static_cast<float> (pixelHeight) * VERTICAL_MARGIN);
+    const auto cellHeight = pixelHeight + 2 * margin;
+    atlas.padding = juce::roundToInt (static_cast<float> (pixelHeight) * HORIZONTAL_PADDING);
+    atlas.spaceAdvance = font.getStringWidthFloat (" ");
+
+    // Lay the symbols out side by side, each in a cell wide enough for its overhang on both sides
+    const auto symbols = NotationManager::getSymbols();
+    std::vector<float> advances;
+    std::vector<int> cellWidths;
+    int width = 0;
+
+    for (const auto symbol : symbols)
+    {
+        advances.push_back (font.getStringWidthFloat (juce::String::charToString (symbol)));
+        cellWidths.push_back (static_cast<int> (std::ceil (advances.back())) + 2 * atlas.padding);
+        width += cellWidths.back();
+    }
+
+    atlas.image = juce::Image (juce::Image::SingleChannel, juce::jmax (1, width), cellHeight, true);
+
+    juce::Graphics g (atlas.image);
+    g.setColour (juce::Colours::white);
+    g.setFont (font);
+
+    const auto baseline = margin + juce::roundToInt (font.getAscent());
+    int x = 0;
+
+    for (size_t i = 0; i < symbols.size(); ++i)
+    {
+        const auto text = juce::String::charToString (symbols[i]);
+        g.drawSingleLineText (text, x + atlas.padding, baseline);
+
+        // Sub-images share the atlas pixels
+        atlas.glyphs[symbols[i]] = { atlas.image.getClippedImage ({ x, 0, cellWidths[i], cellHeight }), advances[i] };
+        x += cellWidths[i];
+    }
+
+    return atlas;
+}
+
+//==============================================================================
+// NotationLookAndFeel
+//==============================================================================
+void NotationLookAndFeel::drawLabel (juce::Graphics& g, juce::Label& label)
+{
+    if (label.isBeingEdited() || !NotationAtlas::startsWithNotation (label.getText()))
+    {
+        LookAndFeel_V4::drawLabel (g, label);
+        return;
+    }
+
+    g.fillAll (label.findColour (juce::Label::backgroundColourId));
+
+    const auto alpha = label.isEnabled() ? 1.0f : 0.5f;
+    const auto font = getLabelFont (label);
+    const auto textArea = getLabelBorderSize (label).subtractedFrom (label.getLocalBounds());
+
+    g.setColour (label.findColour (juce::Label::textColourId).withMultipliedAlpha (alpha));
+    g.setFont (font);
+    atlas->draw (g, label.getText(), textArea.toFloat(), font.getHeight());
+
+    g.setColour (label.findColour (juce::Label::outlineColourId).withMultipliedAlpha (alpha));
+    g.drawRect (label.getLocalBounds());
+}
+
+void NotationLookAndFeel::drawPopupMenuItem (juce::Graphics& g,
+    const juce::Rectangle<int>& area,
+    bool isSeparator,
+    bool isActive,
+    bool isHighlighted,
+    bool isTicked,
+    bool hasSubMenu,
+    const juce::String& text,
+    const juce::String& shortcutKeyText,
+    const juce::Drawable* icon,
+    const juce::Colour* textColour)
+{
+    // Pattern items have no icon, shortcut or sub-menu
+    if (isSeparator || hasSubMenu || icon != nullptr || !NotationAtlas::startsWithNotation (text))
+    {
+        LookAndFeel_V4::drawPopupMenuItem (g, area, isSeparator, isActive, isHighlighted, isTicked, hasSubMenu, text, shortcutKeyText, icon, textColour);
+        return;
+    }
+
+    if (isHighlighted && isActive)
+    {
+        g.setColour (findColour (juce::PopupMenu::highlightedBackgroundColourId));
+        g.fillRect (area);
+        g.setColour (findColour (juce::PopupMenu::highlightedTextColourId));
+    }
+    else
+    {
+        const auto colour = textColour != nullptr ? *textColour : findColour (juce::PopupMenu::textColourId);
+        g.setColour (colour.withMultipliedAlpha (isActive ? 1.0f : 0.5f));
+    }
+
+    auto r = area.reduced (juce::jmin (5, area.getWidth() / 20), 0);
+
+    auto font = getPopupMenuFont();
+    const auto maxFontHeight = static_cast<float> (r.getHeight()) / 1.3f;
+    if (font.getHeight() > maxFontHeight)
+        font.setHeight (maxFontHeight);
+
+    g.setFont (font);
+
+    const auto tickArea = r.removeFromLeft (juce::roundToInt (maxFontHeight)).toFloat();
+    if (isTicked)
+    {
+        const auto tick = getTickShape (1.0f);
+        g.fillPath (tick, tick.getTransformToScaleToFit (tickArea.reduced (tickArea.getWidth() / 5, 0), true));
+    }
+
+    r.removeFromRight (3);
+    atlas->draw (g, text, r.toFloat(), font.getHeight());
+}
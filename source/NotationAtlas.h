@@ -0,0 +1,114 @@
+#pragma once
+
+#include <juce_gui_basics/juce_gui_basics.h>
+#include <map>
+
+/**
+ * @file NotationAtlas.h
+ * @brief Notation glyphs rasterized once per pixel size, drawn by blitting
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ */
+
+/**
+ * @class NotationAtlas
+ * @brief Image atlas of the Leland glyphs used by the subdivision patterns
+ *
+ * Laying out and filling glyph outlines through juce::Font on every paint is
+ * the slowest part of drawing a pattern, above all with a software renderer.
+ * The atlas rasterizes every notation symbol once for a given size in
+ * physical pixels (so once per display scale) into a single-channel image,
+ * and drawing a pattern becomes a few image blits tinted with the current
+ * colour.
+ *
+ * Share it process-wide with juce::SharedResourcePointer<NotationAtlas>; it
+ * is used on the message thread only.
+ */
+class NotationAtlas
+{
+public:
+    NotationAtlas();
+
+    /**
+     * @brief Checks if a character is drawn from the atlas
+     * @param character Unicode code point
+     * @return true for the notation symbols of NotationManager
+     */
+    static bool isNotationSymbol (juce::juce_wchar character);
+
+    /**
+     * @brief Checks if a text starts with notation, as pattern labels do
+     * @param text Label text
+     * @return true if the first character is a notation symbol
+     */
+    static bool startsWithNotation (const juce::String& text);
+
+    /**
+     * @brief Draws a pattern label: its symbols from the atlas, the rest in the current font
+     *
+     * Symbols are tinted with the current colour and centred vertically in
+     * the area, from its left edge.
+     *
+     * @param g Graphics context
+     * @param text Label: notation symbols and spaces, then an optional name
+     * @param area Where to draw, in logical pixels
+     * @param symbolHeight Font height of the symbols, in logical pixels
+     */
+    void draw (juce::Graphics& g, const juce::String& text, juce::Rectangle<float> area, float symbolHeight);
+
+    /**
+     * @brief Gets the number of sizes rasterized so far
+     * @return Number of atlas images
+     */
+    int getNumAtlases() const { return static_cast<int> (atlases.size()); }
+
+private:
+    /** @brief A symbol within an atlas image */
+    struct Glyph
+    {
+        juce::Image image; ///< Sub-image of the atlas, sharing its pixels
+        float advance = 0.0f; ///< Horizontal advance, in physical pixels
+    };
+
+    /** @brief Every symbol at one size in physical pixels */
+    struct Atlas
+    {
+        juce::Image image; ///< Single-channel image holding every symbol side by side
+        std::map<juce::juce_wchar, Glyph> glyphs;
+        float spaceAdvance = 0.0f; ///< Advance of a space, in physical pixels
+        int padding = 0; ///< Room left of each symbol for overhanging strokes, in physical pixels
+    };
+
+    const Atlas& getAtlas (int pixelHeight);
+    Atlas rasterize (int pixelHeight) const;
+
+    juce::Typeface::Ptr typeface; ///< Leland, created once for the process
+    std::map<int, Atlas> atlases; ///< By font height in physical pixels
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NotationAtlas)
+};
+
+/**
+ * @class NotationLookAndFeel
+ * @brief Draws pattern labels in combo boxes and their popup menus from the shared atlas
+ */
+class NotationLookAndFeel : public juce::LookAndFeel_V4
+{
+public:
+    void drawLabel (juce::Graphics& g, juce::Label& label) override;
+
+    void drawPopupMenuItem (juce::Graphics& g,
+        const juce::Rectangle<int>& area,
+        bool isSeparator,
+        bool isActive,
+        bool isHighlighted,
+        bool isTicked,
+        bool hasSubMenu,
+        const juce::String& text,
+        const juce::String& shortcutKeyText,
+        const juce::Drawable* icon,
+        const juce::Colour* textColour) override;
+
+private:
+    juce::SharedResourcePointer<NotationAtlas> atlas;
+};
@@ -1,8 +1,56 @@
 #include "NotationManager.h"
+#include <array>
 
-std::vector<std::pair<juce::String, int>> NotationManager::getPatternsForDenominator (int denominator)
+std::span<const NotationManager::Pattern> NotationManager::getPatternsForDenominator (int denominator)
 {
-    std::vector<std::pair<juce::String, int>> patterns;
+    // One table per supported denominator (1, 2, 4, 8), built once and thread-safe by construction
+    static const std::array<std::vector<Pattern>, 4> tables {
+        buildPatternsForDenominator (1),
+        buildPatternsForDenominator (2),
+        buildPatternsForDenominator (4),
+        buildPatternsForDenominator (8)
+    };
+
+    switch (denominator)
+    {
+        case 1:
+            return tables[0];
+        case 2:
+            return tables[1];
+        case 4:
+            return tables[2];
+        case 8:
+            return tables[3];
+        default:
+            return {};
+    }
+}
+
+std::span<const juce::juce_wchar> NotationManager::getSymbols()
+{
+    static const std::array<juce::juce_wchar, 14> symbols {
+        getWholeNote()[0],
+        getHalfNote()[0],
+        getQuarterNote()[0],
+        getEighthNote()[0],
+        getTwoEighthNotes()[0],
+        getSixteenthNote()[0],
+        getTwoSixteenthNotes()[0],
+        getThirtySecondNote()[0],
+        getWholeRest()[0],
+        getHalfRest()[0],
+        getQuarterRest()[0],
+        getEighthRest()[0],
+        getSixteenthRest()[0],
+        getThirtySecondRest()[0]
+    };
+
+    return symbols;
+}
+
+std::vector<NotationManager::Pattern> NotationManager::buildPatternsForDenominator (int denominator)
+{
+    std::vector<Pattern> patterns;
 
     switch (denominator)
     {
@@ -1,6 +1,7 @@
 #pragma once
 #include "SubdivisionTypes.h"
 #include <juce_core/juce_core.h>
+#include <span>
 
 /**
  * @class NotationManager
@@ -12,14 +13,35 @@
 class NotationManager
 {
 public:
+    /** @brief A display string and its corresponding Subdivision ID */
+    using Pattern = std::pair<juce::String, int>;
+
     /**
      * @brief Get the pattern list for a given time signature denominator
+     *
+     * The tables for all denominators are composed once, on first use, and
+     * shared afterwards. The returned view stays valid for the lifetime of the
+     * process and copying its labels only bumps their reference counts.
+     *
      * @param denominator Time signature denominator (1, 2, 4, or 8)
-     * @return List of pairs containing the display string and corresponding Subdivision ID
+     * @return View over the patterns, empty for unsupported denominators
+     */
+    static std::span<const Pattern> getPatternsForDenominator (int denominator);
+
+    /**
+     * @brief Get every notation symbol the patterns are written with
+     * @return View over the code points, valid for the lifetime of the process
      */
-    static std::vector<std::pair<juce::String, int>> getPatternsForDenominator (int denominator);
+    static std::span<const juce::juce_wchar> getSymbols();
 
 private:
+    /**
+     * @brief Compose the pattern list for a given time signature denominator
+     * @param denominator Time signature denominator (1, 2, 4, or 8)
+     * @return List of pairs containing the display string and corresponding Subdivision ID
+     */
+    static std::vector<Pattern> buildPatternsForDenominator (int denominator);
+
     /**
      * @brief Get Unicode symbol for whole note
      * @return String containing the symbol
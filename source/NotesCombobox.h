@@ -5,14 +5,14 @@
  * 
  * A specialized ComboBox that displays rhythmic patterns using musical symbols
  * rendered with the Leland font. The patterns shown depend on the current time
- * signature denominator. Supports dynamic font size adjustment and includes
- * debug logging.
+ * signature denominator. The symbols, in the box and in its popup menu, are
+ * blitted from the shared NotationAtlas rather than laid out on each paint.
  */
 
 #include <juce_audio_formats/juce_audio_formats.h>
 #include <juce_audio_processors/juce_audio_processors.h>
 #include "PluginProcessor.h"
-#include "BinaryData.h"
+#include "NotationAtlas.h"
 #include "NotationManager.h"
 #include "Colors.h"
 
@@ -22,62 +22,29 @@
  * 
  * A specialized ComboBox that displays rhythmic patterns using musical symbols
  * rendered with the Leland font. The patterns shown depend on the current time
- * signature denominator. Supports dynamic font size adjustment and includes
- * debug logging.
+ * signature denominator. The symbols, in the box and in its popup menu, are
+ * blitted from the shared NotationAtlas rather than laid out on each paint.
  */
 class NotesComboBox : public juce::ComboBox
 {
 public:
     /**
-     * @brief Constructor initializes the font and appearance
+     * @brief Constructor sets the appearance and the notation look and feel
      */
-    // Dans NotesComboBox.h:
-
     NotesComboBox()
     {
-        DBG ("NotesComboBox: Starting font loading...");
-
-        try
-        {
-            if constexpr (BinaryData::Leland_otfSize == 0)
-            {
-                DBG ("Error: Font data size is 0");
-                jassertfalse;
-                return;
-            }
-
-            DBG ("Loading Leland font...");
-            DBG ("Font data size: " << BinaryData::Leland_otfSize);
-
-            auto lelandTypeface = juce::Typeface::createSystemTypefaceFor (
-                BinaryData::Leland_otf,
-                static_cast<size_t> (BinaryData::Leland_otfSize));
-
-            if (lelandTypeface == nullptr)
-            {
-                DBG ("Failed to create typeface from binary data");
-                jassertfalse;
-                return;
-            }
-
-            musicFont = juce::Font (lelandTypeface);
-            musicFont.setHeight (24.0f);
-
-            DBG ("Leland font created successfully");
-        } catch (const std::exception& e)
-        {
-            DBG ("Exception during font creation: " << e.what());
-            jassertfalse;
-            return;
-        }
-
-        // Configure appearance
+        setLookAndFeel (&notationLookAndFeel);
 
         setColour (juce::ComboBox::backgroundColourId, Colors::backgroundAlt);
         setColour (juce::ComboBox::textColourId, Colors::foreground);
         setColour (juce::ComboBox::outlineColourId, Colors::grey);
     }
 
+    ~NotesComboBox() override
+    {
+        setLookAndFeel (nullptr);
+    }
+
     /**
      * @brief Updates the available patterns based on time signature denominator
      * @param denominator The time signature denominator
@@ -85,7 +52,8 @@ public:
     void updateForDenominator (int denominator)
     {
         clear();
-        auto patterns = NotationManager::getPatternsForDenominator (denominator);
+        // Shared, precomposed table: the view is cheap to capture and never dangles
+        const auto patterns = NotationManager::getPatternsForDenominator (denominator);
 
         DBG ("Number of patterns for denominator " << denominator << ": " << patterns.size());
 
@@ -161,21 +129,8 @@ public:
         processorPtr = p;
     }
 
-    /**
-     * @brief Custom paint implementation
-     */
-    void paint (juce::Graphics& g) override
-    {
-        ComboBox::paint (g);
-
-        if (musicFont.getTypefaceName() != "<Sans-Serif>")
-        {
-            g.setFont (musicFont);
-        }
-    }
-
 private:
-    juce::Font musicFont;
+    NotationLookAndFeel notationLookAndFeel; ///< Draws the patterns from the shared glyph atlas
     MetronomeAudioProcessor* processorPtr = nullptr; // Renamed to avoid shadowing
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NotesComboBox)
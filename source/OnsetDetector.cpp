@@ -0,0 +1,121 @@
+#include "OnsetDetector.h"
+
+namespace
+{
+    constexpr double REFERENCE_SAMPLE_RATE = 48000.0;
+    constexpr int REFERENCE_FFT_ORDER = 10; // 1024 samples at 48 kHz
+    constexpr float LOG_COMPRESSION = 100.0f;
+}
+
+void OnsetDetector::prepare (double sampleRate)
+{
+    // Keep the frame duration roughly constant: 1024 samples up to 48 kHz, 2048 up to 96 kHz...
+    int fftOrder = REFERENCE_FFT_ORDER;
+    for (auto rate = REFERENCE_SAMPLE_RATE; rate < sampleRate && fftOrder < 14; rate *= 2.0)
+        ++fftOrder;
+
+    fft = std::make_unique<juce::dsp::FFT> (fftOrder);
+    frameSize = fft->getSize();
+    hopSize = frameSize / 4;
+    refractorySamples = static_cast<int64_t> (refractoryMs * sampleRate / 1000.0);
+    frameRate = sampleRate / hopSize;
+
+    history.assign (static_cast<size_t> (frameSize), 0.0f);
+    fftData.assign (static_cast<size_t> (frameSize * 2), 0.0f);
+    previousMagnitudes.assign (static_cast<size_t> (frameSize / 2 + 1), 0.0f);
+    fluxHistory.assign (static_cast<size_t> (fluxHistorySize), 0.0f);
+    sortedFlux.assign (static_cast<size_t> (fluxHistorySize), 0.0f);
+
+    window.resize (static_cast<size_t> (frameSize));
+    juce::dsp::WindowingFunction<float>::fillWindowingTables (window.data(),
+        window.size(),
+        juce::dsp::WindowingFunction<float>::hann,
+        false);
+
+    reset();
+}
+
+void OnsetDetector::reset()
+{
+    std::fill (history.begin(), history.end(), 0.0f);
+    std::fill (previousMagnitudes.begin(), previousMagnitudes.end(), 0.0f);
+    std::fill (fluxHistory.begin(), fluxHistory.end(), 0.0f);
+
+    writePosition = 0;
+    samplesUntilNextHop = 0;
+    fluxWritePosition = 0;
+    lastFlux = previousFlux = beforePreviousFlux = 0.0f;
+    lastOnset = -1;
+}
+
+int64_t OnsetDetector::analyseFrame (int64_t frameEndSample)
+{
+    // Unwrap the circular history (oldest sample first) into the FFT buffer and window it
+    const auto tail = frameSize - writePosition;
+    juce::FloatVectorOperations::copy (fftData.data(), history.data() + writePosition, tail);
+    juce::FloatVectorOperations::copy (fftData.data() + tail, history.data(), writePosition);
+    juce::FloatVectorOperations::multiply (fftData.data(), window.data(), frameSize);
+
+    fft->performFrequencyOnlyForwardTransform (fftData.data(), true);
+
+    // Log-compressed spectral flux, half-wave rectified
+    const auto numBins = static_cast<int> (previousMagnitudes.size());
+    float flux = 0.0f;
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        const auto magnitude = std::log1p (LOG_COMPRESSION * fftData[static_cast<size_t> (bin)]);
+        flux += std::max (0.0f, magnitude - previousMagnitudes[static_cast<size_t> (bin)]);
+        previousMagnitudes[static_cast<size_t> (bin)] = magnitude;
+    }
+
+    // Adaptive threshold from the median of the recent onset strength
+    std::copy (fluxHistory.begin(), fluxHistory.end(), sortedFlux.begin());
+    const auto middle = sortedFlux.begin() + fluxHistorySize / 2;
+    std::nth_element (sortedFlux.begin(), middle, sortedFlux.end());
+    const auto threshold = *middle * thresholdRatio + thresholdOffset;
+
+    fluxHistory[static_cast<size_t> (fluxWritePosition)] = flux;
+    fluxWritePosition = (fluxWritePosition + 1) % fluxHistorySize;
+
+    // The previous frame is an onset if it is a local maximum above the threshold
+    const auto isPeak = previousFlux > threshold && previousFlux >= beforePreviousFlux && previousFlux > flux;
+
+    beforePreviousFlux = previousFlux;
+    previousFlux = flux;
+    lastFlux = flux;
+
+    if (!isPeak)
+        return -1;
+
+    const auto onset = locateAttack (frameEndSample, frameEndSample - hopSize);
+    if (lastOnset >= 0 && onset - lastOnset < refractorySamples)
+        return -1;
+
+    lastOnset = onset;
+    return onset;
+}
+
+int64_t OnsetDetector::locateAttack (int64_t frameEndSample, int64_t peakFrameEndSample) const
+{
+    // The transient sits between the middle of the peak frame and its newest hop,
+    // which is still entirely in the history: search for where it reaches half its peak
+    const auto searchStart = peakFrameEndSample - frameSize / 2 - hopSize;
+    const auto searchLength = static_cast<int> (peakFrameEndSample - searchStart);
+    const auto firstIndex = frameSize - static_cast<int> (frameEndSample - searchStart);
+
+    auto sampleAt = [this, firstIndex] (int offset) {
+        return std::abs (history[static_cast<size_t> ((writePosition + firstIndex + offset) & (frameSize - 1))]);
+    };
+
+    float peak = 0.0f;
+    for (int i = 0; i < searchLength; ++i)
+        peak = std::max (peak, sampleAt (i));
+
+    for (int i = 0; i < searchLength; ++i)
+    {
+        if (sampleAt (i) >= 0.5f * peak)
+            return searchStart + i;
+    }
+
+    return peakFrameEndSample;
+}
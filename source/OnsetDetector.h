@@ -0,0 +1,154 @@
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * @file OnsetDetector.h
+ * @brief Real-time onset detection on a mono audio input
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ */
+
+/**
+ * @class OnsetDetector
+ * @brief Detects percussive onsets (drum hits, claps) in a mono signal
+ *
+ * The detector works on overlapping frames with a fixed hop size, independent
+ * of the host block size:
+ * - Each frame is windowed and transformed with a preallocated FFT
+ * - The onset strength is the log-compressed spectral flux (sum of positive
+ *   magnitude differences with the previous frame)
+ * - A frame is an onset when its flux is a local maximum above an adaptive
+ *   threshold (median of the recent flux history) and outside the refractory
+ *   period of the previous onset
+ * - The onset time is refined to the sample where the attack crosses half of
+ *   its peak amplitude, so it can be used as a sample-accurate timestamp
+ *
+ * All buffers are allocated in prepare(); process() never allocates and costs
+ * a constant amount of work per input sample.
+ */
+class OnsetDetector
+{
+public:
+    /**
+     * @brief Allocates the analysis buffers for a given sample rate
+     *
+     * The frame size scales with the sample rate so that the analysis
+     * resolution in time stays close to 21ms frames with 5ms hops.
+     *
+     * @param sampleRate The rate of the analysed signal
+     */
+    void prepare (double sampleRate);
+
+    /**
+     * @brief Clears the analysis history without reallocating
+     */
+    void reset();
+
+    /**
+     * @brief Analyses a block of samples
+     * @param samples Mono input samples
+     * @param numSamples Number of samples in the block
+     * @param blockStartSample Position of the first sample on the audio clock
+     * @param onOnset Called with the sample position of every detected onset
+     */
+    template <typename OnsetCallback>
+    void process (const float* samples, int numSamples, int64_t blockStartSample, OnsetCallback&& onOnset)
+    {
+        process (samples, numSamples, blockStartSample, std::forward<OnsetCallback> (onOnset), [] (float) {});
+    }
+
+    /**
+     * @brief Analyses a block of samples, also reporting the onset strength
+     * @param samples Mono input samples
+     * @param numSamples Number of samples in the block
+     * @param blockStartSample Position of the first sample on the audio clock
+     * @param onOnset Called with the sample position of every detected onset
+     * @param onFrame Called with the onset strength of every analysis frame
+     */
+    template <typename OnsetCallback, typename FrameCallback>
+    void process (const float* samples, int numSamples, int64_t blockStartSample, OnsetCallback&& onOnset, FrameCallback&& onFrame)
+    {
+        if (fft == nullptr)
+            return;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            history[static_cast<size_t> (writePosition)] = samples[i];
+            writePosition = (writePosition + 1) & (frameSize - 1);
+
+            if (++samplesUntilNextHop == hopSize)
+            {
+                samplesUntilNextHop = 0;
+
+                if (const auto onset = analyseFrame (blockStartSample + i + 1); onset >= 0)
+                    onOnset (onset);
+
+                onFrame (lastFlux);
+            }
+        }
+    }
+
+    /**
+     * @brief Gets the flux of the most recently analysed frame
+     * @return Onset strength of the last frame
+     */
+    float getLastFlux() const { return lastFlux; }
+
+    /**
+     * @brief Gets the analysis hop size
+     * @return Number of samples between two analysis frames
+     */
+    int getHopSize() const { return hopSize; }
+
+    /**
+     * @brief Gets the analysis frame rate
+     * @return Number of analysis frames per second
+     */
+    double getFrameRate() const { return frameRate; }
+
+private:
+    /**
+     * @brief Analyses the frame ending at the given position
+     * @param frameEndSample Position (exclusive) of the newest sample of the frame
+     * @return Position of the onset confirmed by this frame, or -1
+     */
+    int64_t analyseFrame (int64_t frameEndSample);
+
+    /**
+     * @brief Finds the attack of an onset in the sample history
+     * @param frameEndSample Position (exclusive) of the newest sample in history
+     * @param peakFrameEndSample End of the frame whose flux peaked
+     * @return Sample position of the attack
+     */
+    int64_t locateAttack (int64_t frameEndSample, int64_t peakFrameEndSample) const;
+
+    static constexpr int fluxHistorySize = 64; ///< About a third of a second of onset strength
+    static constexpr float thresholdRatio = 1.5f; ///< Onset flux relative to the median flux
+    static constexpr float thresholdOffset = 0.5f; ///< Minimum flux, rejects noise in quiet passages
+    static constexpr double refractoryMs = 80.0; ///< Minimum time between two onsets
+
+    std::unique_ptr<juce::dsp::FFT> fft;
+    int frameSize = 0;
+    int hopSize = 0;
+    int writePosition = 0;
+    int samplesUntilNextHop = 0;
+    int64_t refractorySamples = 0;
+    double frameRate = 0.0;
+
+    std::vector<float> history; ///< Circular buffer of the last frameSize samples
+    std::vector<float> window; ///< Hann window
+    std::vector<float> fftData; ///< FFT work buffer (2 * frameSize)
+    std::vector<float> previousMagnitudes; ///< Log magnitudes of the previous frame
+    std::vector<float> fluxHistory; ///< Circular buffer of recent flux values
+    std::vector<float> sortedFlux; ///< Scratch buffer for the median
+
+    int fluxWritePosition = 0;
+    float lastFlux = 0.0f;
+    float previousFlux = 0.0f;
+    float beforePreviousFlux = 0.0f;
+    int64_t lastOnset = -1;
+};
@@ -0,0 +1,236 @@
+#include "OscServer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr auto LOCALHOST = "127.0.0.1";
+
+    // The broadcast thread checks for new beats this often while someone listens, and sleeps otherwise
+    constexpr int BROADCAST_POLL_MS = 1;
+
+    // Seconds from the NTP epoch (1900) to the Unix epoch (1970), for OSC time tags
+    constexpr double NTP_UNIX_OFFSET_SECONDS = 2208988800.0;
+
+    /** @brief Reads a numeric argument sent as an int or a float */
+    bool getNumber (const juce::OSCMessage& message, int index, float& value)
+    {
+        if (index >= message.size())
+            return false;
+
+        const auto& argument = message[index];
+        if (argument.isFloat32())
+            value = argument.getFloat32();
+        else if (argument.isInt32())
+            value = static_cast<float> (argument.getInt32());
+        else
+            return false;
+
+        return std::isfinite (value);
+    }
+
+    juce::OSCTimeTag toTimeTag (double unixMs)
+    {
+        const auto seconds = unixMs / 1000.0 + NTP_UNIX_OFFSET_SECONDS;
+        const auto whole = std::floor (seconds);
+        const auto fraction = static_cast<juce::uint64> ((seconds - whole) * 4294967296.0);
+        return juce::OSCTimeTag ((static_cast<juce::uint64> (whole) << 32) | fraction);
+    }
+}
+
+OscServer::OscServer() : juce::Thread ("BeatIt OSC")
+{
+    receiver.addListener (this);
+}
+
+OscServer::~OscServer()
+{
+    stop();
+    receiver.removeListener (this);
+}
+
+bool OscServer::start (int port)
+{
+    stop();
+
+    socket = std::make_unique<juce::DatagramSocket> (false);
+    if (!socket->bindToPort (port, LOCALHOST) || !receiver.connectToSocket (*socket))
+    {
+        socket.reset();
+        return false;
+    }
+
+    epochOffsetMs = static_cast<double> (juce::Time::currentTimeMillis()) - juce::Time::getMillisecondCounterHiRes();
+    startThread();
+    return true;
+}
+
+void OscServer::stop()
+{
+    receiver.disconnect();
+    stopThread (1000);
+    socket.reset();
+
+    const juce::ScopedLock lock (subscriberLock);
+    subscribers.clear();
+    numSubscribers = 0;
+}
+
+//==============================================================================
+// Audio Thread
+//==============================================================================
+bool OscServer::popCommand (RemoteCommand& command)
+{
+    auto found = false;
+    commandFifo.read (1).forEach ([&] (int index) {
+        command = commands[static_cast<size_t> (index)];
+        found = true;
+    });
+
+    return found;
+}
+
+void OscServer::pushBeat (const BeatEvent& event)
+{
+    beatFifo.write (1).forEach ([&] (int index) {
+        beats[static_cast<size_t> (index)] = event;
+    });
+}
+
+//==============================================================================
+// Receiver Thread
+//==============================================================================
+void OscServer::oscMessageReceived (const juce::OSCMessage& message)
+{
+    const auto address = message.getAddressPattern().toString();
+
+    RemoteCommand command;
+    command.timeMs = juce::Time::getMillisecondCounterHiRes();
+
+    float value = 0.0f;
+    float argument = 0.0f;
+
+    if (address == "/beatit/tempo" && getNumber (message, 0, value))
+    {
+        command.type = RemoteCommand::Type::Tempo;
+        command.value = value;
+    }
+    else if (address == "/beatit/play")
+    {
+        command.type = RemoteCommand::Type::Play;
+        command.value = (!getNumber (message, 0, value) || value > 0.5f) ? 1.0f : 0.0f;
+    }
+    else if (address == "/beatit/stop")
+    {
+        command.type = RemoteCommand::Type::Play;
+        command.value = 0.0f;
+    }
+    else if (address == "/beatit/tap")
+    {
+        command.type = RemoteCommand::Type::Tap;
+    }
+    else if (address == "/beatit/meter" && getNumber (message, 0, value))
+    {
+        command.type = RemoteCommand::Type::Meter;
+        command.value = value;
+        command.argument = getNumber (message, 1, argument) ? juce::roundToInt (argument) : 0;
+    }
+    else if (address == "/beatit/subdivision" && getNumber (message, 0, value))
+    {
+        command.type = RemoteCommand::Type::Subdivision;
+        command.value = value;
+    }
+    else if (address == "/beatit/mute" && getNumber (message, 0, value))
+    {
+        command.type = RemoteCommand::Type::Mute;
+        command.value = value;
+        command.argument = getNumber (message, 1, argument) ? (argument > 0.5f ? 1 : 0) : -1;
+    }
+    else if ((address == "/beatit/subscribe" || address == "/beatit/unsubscribe") && getNumber (message, 0, value))
+    {
+        updateSubscription (juce::roundToInt (value), address == "/beatit/subscribe");
+        return;
+    }
+    else
+    {
+        return;
+    }
+
+    pushCommand (command);
+}
+
+void OscServer::oscBundleReceived (const juce::OSCBundle& bundle)
+{
+    // Commands in a bundle apply together, at the next block
+    for (const auto& element : bundle)
+    {
+        if (element.isMessage())
+            oscMessageReceived (element.getMessage());
+        else if (element.isBundle())
+            oscBundleReceived (element.getBundle());
+    }
+}
+
+void OscServer::pushCommand (const RemoteCommand& command)
+{
+    commandFifo.write (1).forEach ([&] (int index) {
+        commands[static_cast<size_t> (index)] = command;
+    });
+}
+
+void OscServer::updateSubscription (int port, bool subscribe)
+{
+    if (port <= 0 || port > 65535)
+        return;
+
+    const juce::ScopedLock lock (subscriberLock);
+
+    const auto existing = std::find_if (subscribers.begin(), subscribers.end(), [port] (const Subscriber& subscriber) {
+        return subscriber.port == port;
+    });
+
+    if (!subscribe)
+    {
+        if (existing != subscribers.end())
+            subscribers.erase (existing);
+    }
+    else if (existing == subscribers.end() && subscribers.size() < static_cast<size_t> (maxSubscribers))
+    {
+        Subscriber subscriber { port, std::make_unique<juce::OSCSender>() };
+        if (subscriber.sender->connect (LOCALHOST, port))
+            subscribers.push_back (std::move (subscriber));
+    }
+
+    const auto hadSubscribers = numSubscribers.exchange (static_cast<int> (subscribers.size())) > 0;
+
+    // Wake the broadcast thread for its first subscriber
+    if (!hadSubscribers && !subscribers.empty())
+        notify();
+}
+
+//==============================================================================
+// Broadcast Thread
+//==============================================================================
+void OscServer::run()
+{
+    while (!threadShouldExit())
+    {
+        beatFifo.read (beatFifo.getNumReady()).forEach ([this] (int index) {
+            broadcast (beats[static_cast<size_t> (index)]);
+        });
+
+        // Nobody listens: nothing will be queued until updateSubscription() wakes the thread
+        wait (hasSubscribers() ? BROADCAST_POLL_MS : -1);
+    }
+}
+
+void OscServer::broadcast (const BeatEvent& event)
+{
+    // The time tag tells when the beat is on the grid: followers schedule on it rather than on arrival
+    juce::OSCBundle bundle (toTimeTag (event.timeMs + epochOffsetMs));
+    bundle.addElement (juce::OSCMessage (juce::OSCAddressPattern ("/beatit/beat"), event.beat, event.beatsPerBar, event.bpm));
+
+    const juce::ScopedLock lock (subscriberLock);
+    for (auto& subscriber : subscribers)
+        subscriber.sender->send (bundle);
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <juce_osc/juce_osc.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @file OscServer.h
+ * @brief Local OSC control and beat broadcast over UDP
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ */
+
+/**
+ * @brief A command received over OSC, queued for the audio thread
+ */
+struct RemoteCommand
+{
+    /**
+     * @enum Type
+     * @brief What the command changes
+     */
+    enum class Type {
+        Tempo, /**< value: BPM */
+        Play, /**< value: 1 to play, 0 to stop */
+        Tap, /**< Tap tempo at timeMs */
+        Meter, /**< value: beats per bar, argument: beat unit (0 to keep the current one) */
+        Subdivision, /**< value: subdivision index */
+        Mute /**< value: beat index, argument: 1 to mute, 0 to unmute, -1 to toggle */
+    };
+
+    Type type = Type::Tempo;
+    float value = 0.0f;
+    int argument = 0;
+    double timeMs = 0.0; ///< Arrival time, on the juce::Time::getMillisecondCounterHiRes() clock
+};
+
+/**
+ * @brief A beat rendered by the audio thread, queued for the subscribers
+ */
+struct BeatEvent
+{
+    int beat = 0; ///< Beat index in the bar
+    int beatsPerBar = 4; ///< Time signature numerator
+    float bpm = 120.0f; ///< Tempo of the engine
+    double timeMs = 0.0; ///< Time of the beat on the grid, on the juce::Time::getMillisecondCounterHiRes() clock
+};
+
+/**
+ * @class OscServer
+ * @brief Receives OSC commands and broadcasts beats on localhost
+ *
+ * The server binds a UDP socket to 127.0.0.1 only and understands:
+ * - /beatit/tempo <bpm>
+ * - /beatit/play [1|0], /beatit/stop
+ * - /beatit/tap
+ * - /beatit/meter <beats per bar> [beat unit]
+ * - /beatit/subdivision <index>
+ * - /beatit/mute <beat> [1|0] (toggles without a state)
+ * - /beatit/subscribe <port>, /beatit/unsubscribe <port>
+ *
+ * Commands are decoded on the receiver thread and queued in a single
+ * producer, single consumer FIFO that the audio thread drains at the start
+ * of each block. The audio thread queues every beat it renders in a second
+ * FIFO; the broadcast thread sends each one to the subscribers as a
+ * /beatit/beat <beat> <beats per bar> <bpm> message, in a bundle whose time
+ * tag is the wall-clock time of the beat; without subscribers it sleeps
+ * until the first one registers. The audio thread never blocks,
+ * allocates or touches the network.
+ */
+class OscServer : private juce::Thread,
+                  private juce::OSCReceiver::Listener<juce::OSCReceiver::RealtimeCallback>
+{
+public:
+    /** @brief Largest number of subscribers to the beat broadcast */
+    static constexpr int maxSubscribers = 8;
+
+    OscServer();
+    ~OscServer() override;
+
+    /**
+     * @brief Starts listening on a localhost port (message thread)
+     * @param port UDP port, or 0 for any free port
+     * @return true if the port could be bound
+     */
+    bool start (int port);
+
+    /**
+     * @brief Stops listening and broadcasting
+     */
+    void stop();
+
+    /**
+     * @brief Gets the port the server listens on
+     * @return The bound port, -1 if not started
+     */
+    int getPort() const { return socket != nullptr ? socket->getBoundPort() : -1; }
+
+    /** @name Audio Thread */
+    ///@{
+
+    /**
+     * @brief Checks if commands are waiting for the audio thread
+     * @return true if popCommand() would succeed
+     */
+    bool hasPendingCommands() const { return commandFifo.getNumReady() > 0; }
+
+    /**
+     * @brief Takes the oldest queued command
+     * @param command Receives the command
+     * @return false if no command was queued
+     */
+    bool popCommand (RemoteCommand& command);
+
+    /**
+     * @brief Checks if anyone listens to the beats
+     * @return true if at least one subscriber is registered
+     */
+    bool hasSubscribers() const { return numSubscribers.load (std::memory_order_relaxed) > 0; }
+
+    /**
+     * @brief Queues a beat for the subscribers; dropped if the queue is full
+     * @param event The rendered beat
+     */
+    void pushBeat (const BeatEvent& event);
+    ///@}
+
+private:
+    /** @brief Queues recorded commands, in place of the receiver thread */
+    friend class SessionReplay;
+
+    void oscMessageReceived (const juce::OSCMessage& message) override;
+    void oscBundleReceived (const juce::OSCBundle& bundle) override;
+    void pushCommand (const RemoteCommand& command);
+    void updateSubscription (int port, bool subscribe);
+    void run() override;
+    void broadcast (const BeatEvent& event);
+
+    static constexpr int fifoSize = 256;
+
+    std::unique_ptr<juce::DatagramSocket> socket;
+    juce::OSCReceiver receiver;
+
+    juce::AbstractFifo commandFifo { fifoSize }; ///< Receiver thread to audio thread
+    std::array<RemoteCommand, fifoSize> commands {};
+    juce::AbstractFifo beatFifo { fifoSize }; ///< Audio thread to broadcast thread
+    std::array<BeatEvent, fifoSize> beats {};
+
+    /** @brief A registered listener of the beats, with its own sender */
+    struct Subscriber
+    {
+        int port = 0;
+        std::unique_ptr<juce::OSCSender> sender;
+    };
+
+    juce::CriticalSection subscriberLock; ///< Guards subscribers between the receiver and broadcast threads
+    std::vector<Subscriber> subscribers;
+    std::atomic<int> numSubscribers { 0 };
+
+    /** @brief Wall-clock milliseconds minus high-resolution counter milliseconds */
+    double epochOffsetMs = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OscServer)
+};
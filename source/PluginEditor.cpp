@@ -1,13 +1,18 @@
 ﻿#include "PluginEditor.h"
 #include "PluginProcessor.h"
 #include "Colors.h"
+#include "Tracing.h"
 
 namespace
 {
     // UI Constants
     constexpr int WINDOW_WIDTH = 300;
-    constexpr int WINDOW_HEIGHT = 600;
+    constexpr int WINDOW_HEIGHT = 960;
     constexpr int PADDING = 20;
+    constexpr int BPM_AREA_HEIGHT = 280;
+    constexpr int DSP_LOAD_HEIGHT = 80;
+    constexpr int DISPLAY_REFRESH_MS = 50; // 20 refreshes per second while playing
+    constexpr int IDLE_REFRESH_MS = 200; // Settings changes polled 5 times per second while stopped
     constexpr float ROTARY_START = juce::MathConstants<float>::pi * 1.2f;
     constexpr float ROTARY_END = juce::MathConstants<float>::pi * 2.8f;
 }
@@ -80,11 +85,133 @@ MetronomeAudioProcessorEditor::MetronomeAudioProcessorEditor (MetronomeAudioProc
     restSoundAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment> (
         audioProcessor.getState(), "restSound", restSoundComboBox);
 
+    // Input
+    setupComboBox (inputModeComboBox);
+    inputModeComboBox.addItemList (juce::StringArray { "Input: Off", "Input: Audio Tap", "Input: Follow", "Input: Practice" }, 1);
+
+    inputModeAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment> (
+        audioProcessor.getState(), "inputMode", inputModeComboBox);
+
+    // Latency compensation
+    setupComboBox (latencyModeComboBox);
+    latencyModeComboBox.addItemList (juce::StringArray { "Latency: Manual", "Latency: Device", "Latency: Host" }, 1);
+
+    latencyModeAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment> (
+        audioProcessor.getState(), "latencyMode", latencyModeComboBox);
+
+    addAndMakeVisible (clickOffsetSlider);
+    clickOffsetSlider.setSliderStyle (juce::Slider::LinearHorizontal);
+    clickOffsetSlider.setTextBoxStyle (juce::Slider::TextBoxRight, false, 70, 20);
+    clickOffsetSlider.setColour (juce::Slider::thumbColourId, Colors::cyan);
+    clickOffsetSlider.setColour (juce::Slider::trackColourId, Colors::blue);
+    clickOffsetSlider.setColour (juce::Slider::textBoxTextColourId, Colors::foreground);
+    clickOffsetSlider.setColour (juce::Slider::textBoxBackgroundColourId, Colors::backgroundAlt);
+    clickOffsetSlider.setColour (juce::Slider::textBoxOutlineColourId, Colors::grey);
+    clickOffsetSlider.setTextValueSuffix (" ms");
+    clickOffsetSlider.setDoubleClickReturnValue (true, 0.0);
+
+    clickOffsetAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment> (
+        audioProcessor.getState(), "clickOffset", clickOffsetSlider);
+
+    // Ensemble tracks, edited one at a time; the choices are those of the parameters
+    auto addChoices = [this] (juce::ComboBox& box, const juce::String& parameterID) {
+        if (auto* choice = dynamic_cast<juce::AudioParameterChoice*> (audioProcessor.getState().getParameter (parameterID)))
+            box.addItemList (choice->choices, 1);
+    };
+
+    auto setupLinearSlider = [this] (juce::Slider& slider, int textBoxWidth) {
+        addAndMakeVisible (slider);
+        slider.setSliderStyle (juce::Slider::LinearHorizontal);
+        slider.setTextBoxStyle (juce::Slider::TextBoxRight, false, textBoxWidth, 20);
+        slider.setColour (juce::Slider::thumbColourId, Colors::cyan);
+        slider.setColour (juce::Slider::trackColourId, Colors::blue);
+        slider.setColour (juce::Slider::textBoxTextColourId, Colors::foreground);
+        slider.setColour (juce::Slider::textBoxBackgroundColourId, Colors::backgroundAlt);
+        slider.setColour (juce::Slider::textBoxOutlineColourId, Colors::grey);
+    };
+
+    setupComboBox (trackComboBox);
+    for (int track = 1; track <= EnsembleTracks::maxTracks; ++track)
+        trackComboBox.addItem ("Track " + juce::String (track), track);
+    trackComboBox.onChange = [this] { attachTrack (trackComboBox.getSelectedId()); };
+
+    addAndMakeVisible (trackEnabledButton);
+    trackEnabledButton.setButtonText ("On");
+    trackEnabledButton.setColour (juce::ToggleButton::textColourId, Colors::foreground);
+    trackEnabledButton.setColour (juce::ToggleButton::tickColourId, Colors::cyan);
+
+    setupComboBox (trackSoundComboBox);
+    addChoices (trackSoundComboBox, "track1Sound");
+
+    setupComboBox (trackAccentComboBox);
+    addChoices (trackAccentComboBox, "track1Accent");
+
+    setupComboBox (trackSubdivisionComboBox);
+    addChoices (trackSubdivisionComboBox, "track1Subdivision");
+
+    setupLinearSlider (trackGainSlider, 70);
+    trackGainSlider.setTextValueSuffix (" dB");
+    trackGainSlider.setDoubleClickReturnValue (true, 0.0);
+
+    setupLinearSlider (trackPanSlider, 45);
+    trackPanSlider.setDoubleClickReturnValue (true, 0.0);
+
+    trackComboBox.setSelectedId (1, juce::dontSendNotification);
+    attachTrack (1);
+
+    // Groove
+    setupComboBox (grooveComboBox);
+    addChoices (grooveComboBox, "groove");
+    grooveAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment> (
+        audioProcessor.getState(), "groove", grooveComboBox);
+
+    setupLinearSlider (swingSlider, 55);
+    swingSlider.setTextValueSuffix (" %");
+    swingSlider.setDoubleClickReturnValue (true, 50.0);
+    swingAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment> (
+        audioProcessor.getState(), "swing", swingSlider);
+
+    addAndMakeVisible (importGrooveButton);
+    importGrooveButton.setColour (juce::TextButton::buttonColourId, Colors::backgroundAlt);
+    importGrooveButton.setColour (juce::TextButton::textColourOffId, Colors::foreground);
+    importGrooveButton.setButtonText ("Import");
+    importGrooveButton.onClick = [this] {
+        grooveFileChooser = std::make_unique<juce::FileChooser> ("Import a groove", juce::File(), "*.mid;*.midi");
+        grooveFileChooser->launchAsync (juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+            [this] (const juce::FileChooser& chooser) {
+                const auto file = chooser.getResult();
+                if (!file.existsAsFile() || !audioProcessor.importGroove (file))
+                    return;
+
+                // Play the groove just imported
+                auto* groove = audioProcessor.getState().getParameter ("groove");
+                groove->setValueNotifyingHost (groove->convertTo0to1 (static_cast<float> (static_cast<int> (MetronomeAudioProcessor::GrooveMode::Imported))));
+            });
+    };
+
+    // Presets
+    setupComboBox (presetComboBox);
+    updatePresetComboBox();
+    presetComboBox.onChange = [this] {
+        const auto index = presetComboBox.getSelectedItemIndex();
+        if (index >= 0 && index != audioProcessor.getCurrentProgram())
+            audioProcessor.setCurrentProgram (index);
+    };
+
+    addAndMakeVisible (storePresetButton);
+    storePresetButton.setColour (juce::TextButton::buttonColourId, Colors::backgroundAlt);
+    storePresetButton.setColour (juce::TextButton::textColourOffId, Colors::foreground);
+    storePresetButton.setButtonText ("Store");
+    storePresetButton.onClick = [this] {
+        audioProcessor.storePreset (juce::jmax (0, presetComboBox.getSelectedItemIndex()));
+        updatePresetComboBox();
+    };
 
     // Subdivision setup
     addAndMakeVisible (subdivisionComboBox);
     subdivisionComboBox.setProcessor (&audioProcessor);
-    subdivisionComboBox.updateForDenominator (audioProcessor.getBeatDenominator());
+    shownDenominator = audioProcessor.getBeatDenominator();
+    subdivisionComboBox.updateForDenominator (shownDenominator);
 
 
     // Tooltips
@@ -107,12 +234,53 @@ MetronomeAudioProcessorEditor::MetronomeAudioProcessorEditor (MetronomeAudioProc
         "Rest Sound: Low frequency sound (200 Hz) to help identify rests\n"
         "Mute: No sound during rests");
 
+    inputModeComboBox.setTooltip (
+        "Select how the audio input is used.\n"
+        "Off: Input ignored\n"
+        "Audio Tap: Hits on the input (e.g. a drum) tap the tempo\n"
+        "Follow: The click follows the tempo of the band on the input\n"
+        "Practice: Hits on the input are compared with the click");
+
+    latencyModeComboBox.setTooltip (
+        "Select how the click makes up for the output latency, so that it lands on the beat at your ears.\n"
+        "Manual: The click is played earlier by the offset\n"
+        "Device: The click is played earlier by the offset plus the audio device latency (Standalone)\n"
+        "Host: The offset is reported to the host, whose delay compensation moves the click");
+
+    clickOffsetSlider.setTooltip ("How much earlier than the beat the click is played");
+
+    presetComboBox.setTooltip (
+        "Select a preset (also with MIDI program changes).\n"
+        "While playing, the new preset starts at the next bar.");
+
+    storePresetButton.setTooltip ("Store the current settings in the selected preset");
+
+    trackComboBox.setTooltip ("Select the ensemble track to edit. Tracks play on the beats of the main click.");
+    trackEnabledButton.setTooltip ("Play this track");
+    trackSoundComboBox.setTooltip ("Click sound of this track");
+    trackAccentComboBox.setTooltip (
+        "Select which clicks of this track are accented; the others are played softer.\n"
+        "None: Every click at full level\n"
+        "Bar: The first beat of each bar\n"
+        "Beat: Beats, not their subdivisions");
+    trackSubdivisionComboBox.setTooltip ("Subdivision pattern of this track");
+    trackGainSlider.setTooltip ("Level of this track");
+    trackPanSlider.setTooltip ("Balance of this track, from left (-1) to right (1)");
+
+    grooveComboBox.setTooltip (
+        "Select what moves the subdivisions off the straight grid; beats stay on the grid.\n"
+        "Swing 8ths: The second eighth of each beat is played late by the swing amount\n"
+        "Swing 16ths: The second and fourth sixteenths are played late by the swing amount\n"
+        "Imported: The timing of the imported MIDI groove");
+    swingSlider.setTooltip ("Swing amount: 50% is straight, 66.7% a triplet shuffle, 75% a dotted feel");
+    importGrooveButton.setTooltip ("Import the groove of a MIDI file (one bar of 4/4, on a sixteenth-note grid)");
+
     // Add tooltips for other controls
     bpmSlider.setTooltip ("Adjust tempo (1-500 BPM)");
 
     playButton.setTooltip ("Start/Stop playback");
 
-    tapTempoButton.setTooltip ("Tap repeatedly to set tempo");
+    tapTempoButton.setTooltip ("Tap repeatedly to set tempo (or press T, or play MIDI notes)");
 
     beatsPerBarComboBox.setTooltip ("Set the number of beats per bar (time signature numerator)");
 
@@ -144,21 +312,25 @@ MetronomeAudioProcessorEditor::MetronomeAudioProcessorEditor (MetronomeAudioProc
     subdivisionAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment> (
         audioProcessor.getState(), "subdivision", subdivisionComboBox);
 
-    audioProcessor.getState().addParameterListener ("beatDenominator", this);
-
     // Set background color
     setColour (juce::DocumentWindow::backgroundColourId, Colors::background);
 
-    startTimer (50); // Update UI 20 times per second
+    // Tap tempo from the keyboard
+    setWantsKeyboardFocus (true);
+
+    // The display timer slows down while stopped, polling for changes
+    shownRevision = audioProcessor.getSettingsRevision();
+    updateTimerState();
 }
 
 MetronomeAudioProcessorEditor::~MetronomeAudioProcessorEditor() {
-    audioProcessor.getState().removeParameterListener ("beatDenominator", this);
+    stopTimer();
 }
 
 //==============================================================================
 void MetronomeAudioProcessorEditor::paint (juce::Graphics& g)
 {
+    BEATIT_TRACE_SCOPE ("editor paint");
     g.fillAll (getLookAndFeel().findColour (juce::DocumentWindow::backgroundColourId));
 
     if (!beatVisualizers.empty())
@@ -183,6 +355,104 @@ void MetronomeAudioProcessorEditor::paint (juce::Graphics& g)
             g.drawRect (beatVisualizers[i], 1.0f);
         }
     }
+
+    if (audioProcessor.getInputMode() == MetronomeAudioProcessor::InputMode::Practice)
+        paintTimingStatistics (g);
+}
+
+void MetronomeAudioProcessorEditor::paintTimingStatistics (juce::Graphics& g)
+{
+    const auto& statistics = audioProcessor.getTimingStatistics();
+    auto area = timingStatisticsArea;
+
+    // Summary: negative deviations mean the player is rushing, positive dragging
+    g.setColour (Colors::foreground);
+    g.setFont (13.0f);
+    g.drawText (juce::String::formatted ("Hits %d   Mean %+.1f ms   SD %.1f ms",
+                    statistics.numHits,
+                    static_cast<double> (statistics.meanMs),
+                    static_cast<double> (statistics.standardDeviationMs)),
+        area.removeFromTop (18),
+        juce::Justification::centred);
+
+    // Histogram from rushing (left) to dragging (right)
+    const auto maxCount = *std::max_element (statistics.histogram.begin(), statistics.histogram.end());
+    if (maxCount == 0)
+        return;
+
+    area.removeFromTop (4);
+    const auto barWidth = static_cast<float> (area.getWidth()) / static_cast<float> (TimingStatistics::numBins);
+    const auto centreBin = TimingStatistics::numBins / 2;
+
+    for (int bin = 0; bin < TimingStatistics::numBins; ++bin)
+    {
+        const auto ratio = static_cast<float> (statistics.histogram[static_cast<size_t> (bin)]) / static_cast<float> (maxCount);
+        const auto barHeight = ratio * static_cast<float> (area.getHeight());
+        const auto x = static_cast<float> (area.getX()) + static_cast<float> (bin) * barWidth;
+
+        g.setColour (bin == centreBin ? Colors::green : (bin < centreBin ? Colors::cyan : Colors::orange));
+        g.fillRect (x + 1.0f, static_cast<float> (area.getBottom()) - barHeight, barWidth - 2.0f, barHeight);
+    }
+}
+
+void MetronomeAudioProcessorEditor::paintOverChildren (juce::Graphics& g)
+{
+    if (showDspLoad)
+        paintDspLoad (g);
+}
+
+void MetronomeAudioProcessorEditor::paintDspLoad (juce::Graphics& g)
+{
+    const auto statistics = audioProcessor.getDspLoadStatistics();
+    auto area = juce::Rectangle<int> (PADDING / 2, PADDING / 2, getWidth() - PADDING, DSP_LOAD_HEIGHT);
+
+    g.setColour (Colors::background.withAlpha (0.85f));
+    g.fillRect (area);
+    g.setColour (Colors::grey);
+    g.drawRect (area, 1);
+
+    area.reduce (6, 4);
+
+    // Loads in percent of the block deadline
+    g.setColour (statistics.numOverruns > 0 ? Colors::red : Colors::foreground);
+    g.setFont (12.0f);
+    g.drawText (juce::String::formatted ("DSP %.1f%%   avg %.1f%%   peak %.1f%%",
+                    static_cast<double> (statistics.lastLoad) * 100.0,
+                    static_cast<double> (statistics.averageLoad) * 100.0,
+                    static_cast<double> (statistics.peakLoad) * 100.0),
+        area.removeFromTop (15),
+        juce::Justification::centredLeft);
+    g.drawText (juce::String::formatted ("Blocks %lld   overruns %lld   peak %.0f us%s",
+                    static_cast<long long> (statistics.numBlocks),
+                    static_cast<long long> (statistics.numOverruns),
+                    statistics.peakBlockMicroseconds,
+                    audioProcessor.isPlayingCachedBar() ? "   cached" : ""),
+        area.removeFromTop (15),
+        juce::Justification::centredLeft);
+
+    // Histogram, one bar per load octave; the rightmost bin holds the overruns
+    const auto maxCount = *std::max_element (statistics.histogram.begin(), statistics.histogram.end());
+    if (maxCount == 0)
+        return;
+
+    area.removeFromTop (4);
+    const auto barWidth = static_cast<float> (area.getWidth()) / static_cast<float> (DspLoadStatistics::numBins);
+
+    for (int bin = 0; bin < DspLoadStatistics::numBins; ++bin)
+    {
+        const auto count = statistics.histogram[static_cast<size_t> (bin)];
+        if (count == 0)
+            continue;
+
+        // Logarithmic height, so that rare slow blocks stay visible
+        const auto ratio = std::log1p (static_cast<float> (count)) / std::log1p (static_cast<float> (maxCount));
+        const auto barHeight = juce::jmax (1.0f, ratio * static_cast<float> (area.getHeight()));
+        const auto x = static_cast<float> (area.getX()) + static_cast<float> (bin) * barWidth;
+        const auto lowerBound = DspLoadStatistics::getBinLowerBound (bin);
+
+        g.setColour (lowerBound >= 1.0f ? Colors::red : (lowerBound >= 0.25f ? Colors::orange : Colors::green));
+        g.fillRect (x + 1.0f, static_cast<float> (area.getBottom()) - barHeight, barWidth - 2.0f, barHeight);
+    }
 }
 
 void MetronomeAudioProcessorEditor::resized()
@@ -190,7 +460,7 @@ void MetronomeAudioProcessorEditor::resized()
     auto area = getLocalBounds().reduced (PADDING);
 
     // BPM Slider area
-    auto bpmArea = area.removeFromTop (static_cast<int> (area.getHeight() * 0.5f));
+    auto bpmArea = area.removeFromTop (BPM_AREA_HEIGHT);
     bpmSlider.setBounds (bpmArea);
 
     area.removeFromTop (20); // Spacing
@@ -213,6 +483,16 @@ void MetronomeAudioProcessorEditor::resized()
     auto subdivisionArea = area.removeFromTop (40);
     subdivisionComboBox.setBounds (subdivisionArea.reduced (5));
 
+    area.removeFromTop (10); // Spacing
+
+    // Groove area
+    auto grooveArea = area.removeFromTop (30);
+    importGrooveButton.setBounds (grooveArea.removeFromRight (60));
+    grooveArea.removeFromRight (10);
+    grooveComboBox.setBounds (grooveArea.removeFromLeft ((grooveArea.getWidth() - 10) / 2));
+    grooveArea.removeFromLeft (10);
+    swingSlider.setBounds (grooveArea);
+
     area.removeFromTop (20); // Spacing
 
     // Sound selection area
@@ -234,9 +514,80 @@ void MetronomeAudioProcessorEditor::resized()
     // Rest sound combo box
     restSoundComboBox.setBounds (soundSelectionArea);
 
+    area.removeFromTop (20); // Spacing
+
+    // Input mode area
+    inputModeComboBox.setBounds (area.removeFromTop (30));
+
+    area.removeFromTop (10); // Spacing
+
+    // Latency compensation area
+    auto latencyArea = area.removeFromTop (30);
+    latencyModeComboBox.setBounds (latencyArea.removeFromLeft ((latencyArea.getWidth() - 10) / 2));
+    latencyArea.removeFromLeft (10);
+    clickOffsetSlider.setBounds (latencyArea);
+
+    area.removeFromTop (20); // Spacing
+
+    // Ensemble track area: track, on/off, sound and accent, then subdivision, then gain and pan
+    auto trackArea = area.removeFromTop (30);
+    trackComboBox.setBounds (trackArea.removeFromLeft (80));
+    trackArea.removeFromLeft (10);
+    trackEnabledButton.setBounds (trackArea.removeFromLeft (50));
+    trackArea.removeFromLeft (10);
+    trackSoundComboBox.setBounds (trackArea.removeFromLeft ((trackArea.getWidth() - 10) / 2));
+    trackArea.removeFromLeft (10);
+    trackAccentComboBox.setBounds (trackArea);
+
+    area.removeFromTop (10); // Spacing
+    trackSubdivisionComboBox.setBounds (area.removeFromTop (30));
+
+    area.removeFromTop (10); // Spacing
+    auto trackMixArea = area.removeFromTop (30);
+    trackGainSlider.setBounds (trackMixArea.removeFromLeft ((trackMixArea.getWidth() - 10) / 2));
+    trackMixArea.removeFromLeft (10);
+    trackPanSlider.setBounds (trackMixArea);
+
+    area.removeFromTop (20); // Spacing
+
+    // Preset area
+    auto presetArea = area.removeFromTop (30);
+    storePresetButton.setBounds (presetArea.removeFromRight (70));
+    presetArea.removeFromRight (10);
+    presetComboBox.setBounds (presetArea);
+
+    area.removeFromTop (10); // Spacing
+
+    // Practice mode statistics area
+    timingStatisticsArea = area.removeFromTop (50);
+
     updateBeatVisualizers();
 }
 
+void MetronomeAudioProcessorEditor::attachTrack (int track)
+{
+    if (track < 1 || track > EnsembleTracks::maxTracks)
+        return;
+
+    // The previous attachments must let go of the controls before new ones set them
+    trackEnabledAttachment.reset();
+    trackSoundAttachment.reset();
+    trackAccentAttachment.reset();
+    trackSubdivisionAttachment.reset();
+    trackGainAttachment.reset();
+    trackPanAttachment.reset();
+
+    auto& state = audioProcessor.getState();
+    const auto id = "track" + juce::String (track);
+
+    trackEnabledAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment> (state, id + "Enabled", trackEnabledButton);
+    trackSoundAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment> (state, id + "Sound", trackSoundComboBox);
+    trackAccentAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment> (state, id + "Accent", trackAccentComboBox);
+    trackSubdivisionAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment> (state, id + "Subdivision", trackSubdivisionComboBox);
+    trackGainAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment> (state, id + "Gain", trackGainSlider);
+    trackPanAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment> (state, id + "Pan", trackPanSlider);
+}
+
 void MetronomeAudioProcessorEditor::mouseDown (const juce::MouseEvent& e)
 {
     auto localPoint = e.position.toFloat();
@@ -263,6 +614,23 @@ bool MetronomeAudioProcessorEditor::isMouseOverBeatVisualizer (
     return false;
 }
 
+bool MetronomeAudioProcessorEditor::keyPressed (const juce::KeyPress& key)
+{
+    if (key.getTextCharacter() == 't' || key.getTextCharacter() == 'T')
+    {
+        audioProcessor.processTapTempo();
+        return true;
+    }
+    if (key.getTextCharacter() == 'l' || key.getTextCharacter() == 'L')
+    {
+        showDspLoad = !showDspLoad;
+        updateTimerState();
+        repaint();
+        return true;
+    }
+    return false;
+}
+
 void MetronomeAudioProcessorEditor::handleBeatVisualizerClick (int beatIndex)
 {
     audioProcessor.toggleBeatMute (beatIndex);
@@ -271,12 +639,45 @@ void MetronomeAudioProcessorEditor::handleBeatVisualizerClick (int beatIndex)
 
 //==============================================================================
 void MetronomeAudioProcessorEditor::timerCallback()
+{
+    // Stopped, only a change of the settings moves anything on screen
+    const auto revision = audioProcessor.getSettingsRevision();
+    if (revision != shownRevision || audioProcessor.getPlayState() || showDspLoad)
+    {
+        BEATIT_TRACE_SCOPE ("editor refresh");
+        shownRevision = revision;
+        refreshDisplay();
+    }
+
+    updateTimerState();
+}
+
+void MetronomeAudioProcessorEditor::refreshDisplay()
 {
     updatePlayButtonText();
     updateBeatVisualizers();
+
+    // The subdivisions on offer depend on the beat unit, which the host may automate
+    if (const auto denominator = audioProcessor.getBeatDenominator(); denominator != shownDenominator)
+    {
+        shownDenominator = denominator;
+        subdivisionComboBox.updateForDenominator (denominator);
+    }
+
+    // The program may also change from the host or a MIDI program change
+    if (presetComboBox.getSelectedItemIndex() != audioProcessor.getCurrentProgram())
+        updatePresetComboBox();
+
     repaint();
 }
 
+void MetronomeAudioProcessorEditor::updateTimerState()
+{
+    const auto interval = (audioProcessor.getPlayState() || showDspLoad) ? DISPLAY_REFRESH_MS : IDLE_REFRESH_MS;
+    if (getTimerInterval() != interval)
+        startTimer (interval);
+}
+
 void MetronomeAudioProcessorEditor::buttonClicked (juce::Button* button)
 {
     if (button == &tapTempoButton)
@@ -313,16 +714,6 @@ void MetronomeAudioProcessorEditor::sliderValueChanged (juce::Slider* slider)
     }
 }
 
-void MetronomeAudioProcessorEditor::parameterChanged (const juce::String& parameterID, float /*newValue*/)
-{
-    if (parameterID == "beatDenominator")
-    {
-        juce::MessageManager::callAsync ([this]() {
-            subdivisionComboBox.updateForDenominator (audioProcessor.getBeatDenominator());
-        });
-    }
-}
-
 void MetronomeAudioProcessorEditor::updatePlayButtonText()
 {
     if (audioProcessor.getPlayState())
@@ -365,4 +756,17 @@ void MetronomeAudioProcessorEditor::updateBeatVisualizers()
             beatVisualizers[i].setHeight (20.0f);
         }
     }
-}
\ No newline at end of file
+}
+
+void MetronomeAudioProcessorEditor::updatePresetComboBox()
+{
+    presetComboBox.clear (juce::dontSendNotification);
+
+    for (int i = 0; i < audioProcessor.getNumPrograms(); ++i)
+    {
+        const auto name = audioProcessor.hasPreset (i) ? audioProcessor.getProgramName (i) : juce::String ("(empty)");
+        presetComboBox.addItem (juce::String (i + 1) + ": " + name, i + 1);
+    }
+
+    presetComboBox.setSelectedItemIndex (audioProcessor.getCurrentProgram(), juce::dontSendNotification);
+}
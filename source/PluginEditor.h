@@ -29,13 +29,20 @@
  * - Visual beat display with muting options
  * - Time signature configuration
  * - Sound selection for different beat types
+ * - Swing amount and groove import
+ * - Ensemble track settings, one track at a time
+ * - Preset selection and storage
  * - State persistence
+ *
+ * The display refreshes at full rate while playing (or while the DSP load
+ * overlay is shown). When stopped, the timer slows down and only refreshes the
+ * display when the settings revision of the processor has moved: the editor
+ * never listens to the processor, which may notify from the audio thread.
  */
 class MetronomeAudioProcessorEditor : public juce::AudioProcessorEditor,
                                       public juce::Timer,
                                       public juce::Button::Listener,
-                                      public juce::Slider::Listener,
-                                      public juce::AudioProcessorValueTreeState::Listener
+                                      public juce::Slider::Listener
 {
 public:
     //==============================================================================
@@ -64,6 +71,12 @@ public:
      */
     void paint (juce::Graphics& g) override;
 
+    /**
+     * @brief Draws the DSP load overlay above the controls, when enabled
+     * @param g Graphics context used for drawing
+     */
+    void paintOverChildren (juce::Graphics& g) override;
+
     /**
      * @brief Handles component resizing
      */
@@ -75,7 +88,7 @@ public:
     ///@{
 
     /**
-     * @brief Handles timer callbacks for UI updates
+     * @brief Handles timer callbacks for UI updates, and slows the timer down once stopped
      */
     void timerCallback() override;
     ///@}
@@ -109,24 +122,35 @@ public:
     void sliderValueChanged (juce::Slider* slider) override;
     ///@}
 
-    void updateSubdivisionComboBox (int denominator)
-    {
-        DBG ("prout" << denominator);
-        subdivisionComboBox.updateForDenominator (denominator);
-    }
+    //==============================================================================
+    /** @name Hit Testing */
+    ///@{
 
     /**
-     * @brief Handles parameter changes from the processor
-     * @param parameterID The ID of the changed parameter
-     * @param newValue The new value
+     * @brief Checks if mouse is over a beat visualizer
+     * @param position Mouse position to check
+     * @param visualizerIndex Output parameter for the found visualizer index
+     * @return true if mouse is over a visualizer
      */
-    void parameterChanged (const juce::String& parameterID, float newValue) override;
+    bool isMouseOverBeatVisualizer (const juce::Point<float>& position,
+        size_t& visualizerIndex) const;
+    ///@}
 
 private:
     //==============================================================================
     /** @name UI Update Methods */
     ///@{
 
+    /**
+     * @brief Refreshes every display that follows the processor
+     */
+    void refreshDisplay();
+
+    /**
+     * @brief Runs the display timer at full rate while something moves on screen, slowly otherwise
+     */
+    void updateTimerState();
+
     /**
      * @brief Updates the play button text state
      */
@@ -138,25 +162,46 @@ private:
     void updateBeatVisualizers();
 
     /**
-     * @brief Handles clicks on beat visualizers
-     * @param beatIndex Index of the clicked beat
+     * @brief Rebuilds the preset list from the processor's programs
      */
-    void handleBeatVisualizerClick (int beatIndex);
+    void updatePresetComboBox();
 
     /**
-     * @brief Checks if mouse is over a beat visualizer
-     * @param position Mouse position to check
-     * @param visualizerIndex Output parameter for the found visualizer index
-     * @return true if mouse is over a visualizer
+     * @brief Connects the ensemble track controls to the parameters of a track
+     * @param track Track number, from 1
      */
-    bool isMouseOverBeatVisualizer (const juce::Point<float>& position,
-        size_t& visualizerIndex) const;
+    void attachTrack (int track);
+
+    /**
+     * @brief Draws the Practice mode timing statistics
+     * @param g Graphics context used for drawing
+     */
+    void paintTimingStatistics (juce::Graphics& g);
+
+    /**
+     * @brief Draws the DSP load statistics of the processor
+     * @param g Graphics context used for drawing
+     */
+    void paintDspLoad (juce::Graphics& g);
+
+    /**
+     * @brief Handles clicks on beat visualizers
+     * @param beatIndex Index of the clicked beat
+     */
+    void handleBeatVisualizerClick (int beatIndex);
 
     /**
      * @brief Handles mouse down events
      * @param e Mouse event details
      */
     void mouseDown (const juce::MouseEvent& e) override;
+
+    /**
+     * @brief Handles key presses ('T' taps the tempo, 'L' toggles the DSP load overlay)
+     * @param key The key that was pressed
+     * @return true if the key was consumed
+     */
+    bool keyPressed (const juce::KeyPress& key) override;
     ///@}
 
     //==============================================================================
@@ -177,6 +222,24 @@ private:
     juce::ComboBox otherBeatsSoundComboBox; /**< Other beats sound selector */
     juce::ComboBox restSoundComboBox; /**< Rest sound selector */
     NotesComboBox subdivisionComboBox; /**<  Combo box for subdivision pattern selection */
+    int shownDenominator = 0; /**< Beat unit the subdivision choices were built for */
+    uint32_t shownRevision = 0; /**< Settings revision of the processor the display was last refreshed for */
+    juce::ComboBox inputModeComboBox; /**< Audio input usage selector */
+    juce::ComboBox latencyModeComboBox; /**< Output latency compensation selector */
+    juce::Slider clickOffsetSlider; /**< Lead of the click over the grid */
+    juce::ComboBox presetComboBox; /**< Preset selector */
+    juce::TextButton storePresetButton; /**< Stores the current settings in the selected preset */
+    juce::ComboBox trackComboBox; /**< Ensemble track edited by the controls below */
+    juce::ToggleButton trackEnabledButton; /**< Ensemble track on/off */
+    juce::ComboBox trackSoundComboBox; /**< Ensemble track click sound */
+    juce::ComboBox trackAccentComboBox; /**< Ensemble track accented clicks */
+    juce::ComboBox trackSubdivisionComboBox; /**< Ensemble track subdivision pattern */
+    juce::Slider trackGainSlider; /**< Ensemble track gain */
+    juce::Slider trackPanSlider; /**< Ensemble track pan */
+    juce::ComboBox grooveComboBox; /**< Groove template selector */
+    juce::Slider swingSlider; /**< Swing amount */
+    juce::TextButton importGrooveButton; /**< Imports a groove from a MIDI file */
+    std::unique_ptr<juce::FileChooser> grooveFileChooser; /**< Open while choosing a groove file */
 
     ///@}
 
@@ -191,12 +254,25 @@ private:
     std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> otherBeatsSoundAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> subdivisionAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> restSoundAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> inputModeAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> latencyModeAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> clickOffsetAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> trackEnabledAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> trackSoundAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> trackAccentAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> trackSubdivisionAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> trackGainAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> trackPanAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> grooveAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> swingAttachment;
     ///@}
 
     //==============================================================================
     /** @name Visual Components */
     ///@{
     std::vector<juce::Rectangle<float>> beatVisualizers; /**< Beat display rectangles */
+    juce::Rectangle<int> timingStatisticsArea; /**< Practice mode statistics display */
+    bool showDspLoad = false; /**< DSP load overlay visibility */
     ///@}
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MetronomeAudioProcessorEditor)
@@ -1,8 +1,16 @@
 ﻿#include "PluginProcessor.h"
 #include "NotationManager.h"
 #include "PluginEditor.h"
+#include "RealtimeSafety.h"
+#include "StateFormat.h"
+#include "SubdivisionSchedule.h"
+#include "Tracing.h"
 #include <map>
 
+#if JucePlugin_Build_Standalone
+    #include <juce_audio_plugin_client/Standalone/juce_StandaloneFilterWindow.h>
+#endif
+
 namespace
 {
     // Audio Constants
@@ -11,43 +19,101 @@ namespace
     constexpr double MAX_BPM = 500.0f;
     constexpr double DEFAULT_BPM = 120.0f;
 
-    // Click Sound Parameters
-    namespace ClickParams
-    {
-        // High Click
-        constexpr float HIGH_FREQUENCY = 1500.0f;
-        constexpr float HIGH_DURATION_MS = 30.0f;
+    // Rate at which values pushed by the audio thread reach the parameters
+    constexpr int PARAMETER_UPDATE_RATE_HZ = 30;
+    // The same after a second stopped, with no input, remote control or device to follow. Only MIDI taps,
+    // program changes or host automation can still raise the flag, and the audio thread cannot start a timer.
+    constexpr int IDLE_PARAMETER_UPDATE_RATE_HZ = 2;
+
+    // Latency compensation
+    constexpr float MAX_CLICK_OFFSET_MS = 250.0f; // Largest lead of the click over the grid
+
+    // Bar cache: longest loop of bars kept, which bounds its memory (two bars of 4/4 down to 60 BPM)
+    constexpr double MAX_CACHED_LOOP_SECONDS = 8.0;
+    constexpr double WHOLE_LOOP_TOLERANCE = 1.0e-6; // Samples
 
-        // Low Click
-        constexpr float LOW_FREQUENCY = 800.0f;
-        constexpr float LOW_DURATION_MS = 20.0f;
+    // Groove
+    constexpr int IMPORTED_GROOVE_STEPS_PER_BEAT = 4; // Sixteenths
+    constexpr int IMPORTED_GROOVE_STEPS = 16; // One bar of 4/4
 
-        // Mute
-        constexpr float ATTACK_TIME_MS = 1.0f;
-        constexpr float DEFAULT_AMPLITUDE = 0.5f;
+    // Ensemble tracks
+    constexpr float MIN_TRACK_GAIN_DB = -60.0f; // Treated as silence
+    constexpr float MAX_TRACK_GAIN_DB = 6.0f;
 
-        // Rest sound
-        constexpr float REST_SOUND_FREQUENCY = 200.0f;
-        constexpr float REST_SOUND_DURATION_MS = 15.0f;
+    // Follow mode
+    constexpr double FOLLOW_SMOOTHING_SECONDS = 2.0; // Time constant of the tempo steering
+    constexpr double FOLLOW_MAX_DEVIATION_OCTAVES = 0.25; // Larger tempo jumps are ignored
+    constexpr double FOLLOW_PHASE_CORRECTION = 0.1; // Fraction of the phase error corrected per hit
+
+    // Fewest bars lasting a whole number of samples, within maxLength; 0 if there are none
+    int findBarsPerLoop (double barLength, int maxLength)
+    {
+        if (barLength <= 0.0)
+            return 0;
+
+        for (int bars = 1; bars * barLength <= maxLength; ++bars)
+        {
+            const auto length = bars * barLength;
+            if (std::abs (length - std::round (length)) < WHOLE_LOOP_TOLERANCE)
+                return bars;
+        }
+
+        return 0;
     }
+
+#if BEATIT_SESSION_LOG
+    // Processors that logged their session to BEATIT_SESSION_LOG, which hosts may create on any thread
+    std::atomic<int> numLoggedSessions { 0 };
+#endif
 }
 
 //==============================================================================
 // Constructor and Destructor
 //==============================================================================
 MetronomeAudioProcessor::MetronomeAudioProcessor()
-    : AudioProcessor (BusesProperties().withOutput ("Output", juce::AudioChannelSet::stereo(), true))
+    : AudioProcessor (BusesProperties()
+              .withInput ("Input", juce::AudioChannelSet::mono(), false)
+              .withOutput ("Output", juce::AudioChannelSet::stereo(), true))
 {
     initializeParameters();
     initializeAudioState();
     initializeSoundMaps();
-    mutedBeats.resize (static_cast<size_t> (getBeatsPerBar()), false);
+    updateMutedBeatsSize();
+    engineBpm = bpmParameter->load();
+    lastParameterBpm = bpmParameter->load();
+    activeSettings = captureSnapshot();
+    startTimerHz (PARAMETER_UPDATE_RATE_HZ);
+    BEATIT_TRACE_ATTACH (*this);
+
+#if BEATIT_SESSION_LOG
+    // A session to replay when a glitch shows up: logged from the start, one file per instance
+    if (const auto path = juce::SystemStats::getEnvironmentVariable ("BEATIT_SESSION_LOG", {}); path.isNotEmpty())
+    {
+        auto file = juce::File::getCurrentWorkingDirectory().getChildFile (path);
+        if (numLoggedSessions.fetch_add (1) > 0)
+            file = file.getNonexistentSibling();
+
+        startSessionRecording (file);
+    }
+#endif
+
+#if JucePlugin_Build_Standalone
+    // Stage and lighting software on the same machine can drive and follow the application
+    if (wrapperType == wrapperType_Standalone)
+        if (const auto port = juce::SystemStats::getEnvironmentVariable ("BEATIT_OSC_PORT", {}).getIntValue(); port > 0)
+            startRemoteControl (port);
+#endif
 }
 
 MetronomeAudioProcessor::~MetronomeAudioProcessor()
 {
-    state->removeParameterListener ("firstBeatSound", this);
-    state->removeParameterListener ("otherBeatsSound", this);
+    BEATIT_TRACE_DETACH (*this);
+    stopSessionRecording();
+    stopTimer();
+
+    for (auto* parameter : getParameters())
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*> (parameter))
+            state->removeParameterListener (ranged->getParameterID(), this);
 }
 
 //==============================================================================
@@ -55,44 +121,55 @@ MetronomeAudioProcessor::~MetronomeAudioProcessor()
 //==============================================================================
 void MetronomeAudioProcessor::initializeParameters()
 {
+    const juce::StringArray subdivisionNames {
+        "No Subdivision", // 0
+        "Half", // 1
+        "Half + Rest", // 2
+        "Rest + Half", // 3
+        "Triplet", // 4
+        "Rest + Half + Half Triplet", // 5
+        "Half + Rest + Half Triplet", // 6
+        "Half + Half + Rest Triplet", // 7
+        "Rest + Half + Rest Triplet", // 8
+        "Quarter", // 9
+        "Rest + Eighth Pattern", // 10
+        "Eighth + Eighth + Quarter", // 11
+        "Quarter + Eighth + Eighth", // 12
+        "Eighth + Quarter + Eighth" // 13
+    };
+
     // Create parameter layout
-    state = std::make_unique<juce::AudioProcessorValueTreeState> (*this, nullptr, "Parameters", juce::AudioProcessorValueTreeState::ParameterLayout {
-                                                                                                    std::make_unique<juce::AudioParameterInt> ("bpm", "BPM", static_cast<int> (MIN_BPM), static_cast<int> (MAX_BPM), static_cast<int> (DEFAULT_BPM)),
-
-                                                                                                    std::make_unique<juce::AudioParameterBool> ("play", "Play", false),
-
-                                                                                                    std::make_unique<juce::AudioParameterChoice> ("beatsPerBar", "Beats Per Bar", juce::StringArray { "1", "2", "3", "4", "5", "6", "7", "8", "9", "10", "11", "12", "13", "14", "15", "16" }, 3),
-
-                                                                                                    std::make_unique<juce::AudioParameterChoice> ("beatDenominator", "Beat Denominator", juce::StringArray { "1", "2", "4", "8" }, 2),
-
-                                                                                                    std::make_unique<juce::AudioParameterChoice> ("firstBeatSound", "First Beat Sound", juce::StringArray { "High Click", "Low Click", "Mute" }, 0),
-
-                                                                                                    std::make_unique<juce::AudioParameterChoice> ("otherBeatsSound", "Other Beats Sound", juce::StringArray { "High Click", "Low Click", "Mute" }, 1),
-
-                                                                                                    std::make_unique<juce::AudioParameterChoice> ("restSound", "Rest Sound", juce::StringArray { "Same as Beat", "Rest Sound", "Mute" }, 2),
-
-                                                                                                    std::make_unique<juce::AudioParameterChoice> ("subdivision", "Beat Subdivision",
-                                                                                                        juce::StringArray {
-                                                                                                            "No Subdivision", // 0
-                                                                                                            "Half", // 1
-                                                                                                            "Half + Rest", // 2
-                                                                                                            "Rest + Half", // 3
-                                                                                                            "Triplet", // 4
-                                                                                                            "Rest + Half + Half Triplet", // 5
-                                                                                                            "Half + Rest + Half Triplet", // 6
-                                                                                                            "Half + Half + Rest Triplet", // 7
-                                                                                                            "Rest + Half + Rest Triplet", // 8
-                                                                                                            "Quarter", // 9
-                                                                                                            "Rest + Eighth Pattern", // 10
-                                                                                                            "Eighth + Eighth + Quarter", // 11
-                                                                                                            "Quarter + Eighth + Eighth", // 12
-                                                                                                            "Eighth + Quarter + Eighth" // 13
-                                                                                                        },
-                                                                                                        0),
-        std::make_unique<juce::AudioParameterChoice>("restSound", "Rest Sound",
-                juce::StringArray{"Same as Beat", "Debug Sound", "Mute"},
-                0),
-                                                                                                });
+    juce::AudioProcessorValueTreeState::ParameterLayout layout {
+        std::make_unique<juce::AudioParameterInt> ("bpm", "BPM", static_cast<int> (MIN_BPM), static_cast<int> (MAX_BPM), static_cast<int> (DEFAULT_BPM)),
+        std::make_unique<juce::AudioParameterBool> ("play", "Play", false),
+        std::make_unique<juce::AudioParameterChoice> ("beatsPerBar", "Beats Per Bar", juce::StringArray { "1", "2", "3", "4", "5", "6", "7", "8", "9", "10", "11", "12", "13", "14", "15", "16" }, 3),
+        std::make_unique<juce::AudioParameterChoice> ("beatDenominator", "Beat Denominator", juce::StringArray { "1", "2", "4", "8" }, 2),
+        std::make_unique<juce::AudioParameterChoice> ("firstBeatSound", "First Beat Sound", juce::StringArray { "High Click", "Low Click", "Mute" }, 0),
+        std::make_unique<juce::AudioParameterChoice> ("otherBeatsSound", "Other Beats Sound", juce::StringArray { "High Click", "Low Click", "Mute" }, 1),
+        std::make_unique<juce::AudioParameterChoice> ("restSound", "Rest Sound", juce::StringArray { "Same as Beat", "Rest Sound", "Mute" }, 2),
+        std::make_unique<juce::AudioParameterChoice> ("subdivision", "Beat Subdivision", subdivisionNames, 0),
+        std::make_unique<juce::AudioParameterChoice> ("inputMode", "Input Mode", juce::StringArray { "Off", "Audio Tap", "Follow", "Practice" }, 0),
+        std::make_unique<juce::AudioParameterChoice> ("latencyMode", "Latency Mode", juce::StringArray { "Manual", "Device", "Host" }, 0),
+        std::make_unique<juce::AudioParameterFloat> ("clickOffset", "Click Offset", juce::NormalisableRange<float> (-MAX_CLICK_OFFSET_MS, 0.0f, 0.1f), 0.0f, juce::AudioParameterFloatAttributes().withLabel ("ms")),
+        std::make_unique<juce::AudioParameterChoice> ("groove", "Groove", juce::StringArray { "Swing 8ths", "Swing 16ths", "Imported" }, 0),
+        std::make_unique<juce::AudioParameterFloat> ("swing", "Swing", juce::NormalisableRange<float> (GrooveTemplate::minSwingPercent, GrooveTemplate::maxSwingPercent, 0.1f), GrooveTemplate::minSwingPercent, juce::AudioParameterFloatAttributes().withLabel ("%")),
+    };
+
+    // Ensemble tracks, off by default
+    for (int track = 1; track <= EnsembleTracks::maxTracks; ++track)
+    {
+        const auto id = "track" + juce::String (track);
+        const auto name = "Track " + juce::String (track) + " ";
+
+        layout.add (std::make_unique<juce::AudioParameterBool> (id + "Enabled", name + "Enabled", false),
+            std::make_unique<juce::AudioParameterChoice> (id + "Subdivision", name + "Subdivision", subdivisionNames, 0),
+            std::make_unique<juce::AudioParameterChoice> (id + "Sound", name + "Sound", juce::StringArray { "High Click", "Low Click" }, 1),
+            std::make_unique<juce::AudioParameterChoice> (id + "Accent", name + "Accent", juce::StringArray { "None", "Bar", "Beat" }, 0),
+            std::make_unique<juce::AudioParameterFloat> (id + "Gain", name + "Gain", juce::NormalisableRange<float> (MIN_TRACK_GAIN_DB, MAX_TRACK_GAIN_DB, 0.1f), 0.0f, juce::AudioParameterFloatAttributes().withLabel ("dB")),
+            std::make_unique<juce::AudioParameterFloat> (id + "Pan", name + "Pan", juce::NormalisableRange<float> (-1.0f, 1.0f, 0.01f), 0.0f));
+    }
+
+    state = std::make_unique<juce::AudioProcessorValueTreeState> (*this, nullptr, "Parameters", std::move (layout));
 
     // Get parameter pointers
     bpmParameter = state->getRawParameterValue ("bpm");
@@ -103,18 +180,40 @@ void MetronomeAudioProcessor::initializeParameters()
     otherBeatsSoundParameter = state->getRawParameterValue ("otherBeatsSound");
     restSoundParameter = state->getRawParameterValue ("restSound");
     subdivisionParameter = state->getRawParameterValue ("subdivision");
+    inputModeParameter = state->getRawParameterValue ("inputMode");
+    latencyModeParameter = state->getRawParameterValue ("latencyMode");
+    clickOffsetParameter = state->getRawParameterValue ("clickOffset");
+    grooveParameter = state->getRawParameterValue ("groove");
+    swingParameter = state->getRawParameterValue ("swing");
 
-    // Add parameter listeners
-    state->addParameterListener ("firstBeatSound", this);
-    state->addParameterListener ("otherBeatsSound", this);
+    for (size_t track = 0; track < trackParameters.size(); ++track)
+    {
+        const auto id = "track" + juce::String (static_cast<int> (track) + 1);
+        auto& parameters = trackParameters[track];
+        parameters.enabled = state->getRawParameterValue (id + "Enabled");
+        parameters.subdivision = state->getRawParameterValue (id + "Subdivision");
+        parameters.sound = state->getRawParameterValue (id + "Sound");
+        parameters.accent = state->getRawParameterValue (id + "Accent");
+        parameters.gain = state->getRawParameterValue (id + "Gain");
+        parameters.pan = state->getRawParameterValue (id + "Pan");
+    }
+
+    // The session log refers to the parameters by their position; every change counts in settingsRevision
+    for (auto* parameter : getParameters())
+    {
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*> (parameter))
+        {
+            sessionParameters.push_back (state->getRawParameterValue (ranged->getParameterID()));
+            state->addParameterListener (ranged->getParameterID(), this);
+        }
+    }
 }
 
 void MetronomeAudioProcessor::initializeAudioState()
 {
     currentSampleRate = DEFAULT_SAMPLE_RATE;
-    currentBeat = 0;
-    soundPosition = 0;
-    samplesPerBeat = 0;
+    clickEngine.setGridShift (&grooveTable);
+    ensembleTracks.reset();
 }
 
 void MetronomeAudioProcessor::initializeSoundMaps()
@@ -131,247 +230,728 @@ void MetronomeAudioProcessor::initializeSoundMaps()
 //==============================================================================
 // Audio Processing
 //==============================================================================
-void MetronomeAudioProcessor::prepareToPlay (double sampleRate, [[maybe_unused]] int samplesPerBlock)
+void MetronomeAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    sessionRecorder.recordPrepare (sampleRate, samplesPerBlock, getTotalNumInputChannels(), getTotalNumOutputChannels(), isUsingDoublePrecision());
+
     currentSampleRate = sampleRate;
+    tapTempoCalculator.setSampleRate (sampleRate);
+    onsetDetector.prepare (sampleRate);
+    tempoFollower.prepare (onsetDetector.getFrameRate());
+    timingAnalyzer.setSampleRate (sampleRate);
+    dspLoadMonitor.prepare (sampleRate);
+    barCache.prepare (static_cast<int> (MAX_CACHED_LOOP_SECONDS * sampleRate), juce::jlimit (1, 2, getTotalNumOutputChannels()));
+    barCacheKey = {}; // The loop that fits depends on the new storage
     initializeSounds();
     updateTimingInfo();
+
+    // Hosts read the latency after preparing the processor
+    updateReportedLatency();
 }
 
 void MetronomeAudioProcessor::releaseResources()
 {
-    // Nothing to release
+    // The audio thread is stopped: replaced presets are only still in use if a switch is waiting for them
+    presetBank.releaseRetiredSnapshots ({ pendingSnapshot.load (std::memory_order_acquire), appliedSnapshot.load (std::memory_order_acquire) });
 }
 
 void MetronomeAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
-    [[maybe_unused]] juce::MidiBuffer& midiMessages)
+    juce::MidiBuffer& midiMessages)
 {
+    renderBlock (buffer, midiMessages);
+}
+
+void MetronomeAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer,
+    juce::MidiBuffer& midiMessages)
+{
+    renderBlock (buffer, midiMessages);
+}
+
+template <typename SampleType>
+void MetronomeAudioProcessor::renderBlock (juce::AudioBuffer<SampleType>& buffer,
+    juce::MidiBuffer& midiMessages)
+{
+    BEATIT_REALTIME_SCOPE ("MetronomeAudioProcessor::processBlock");
+    BEATIT_TRACE_SCOPE ("processBlock");
+    presetBank.startBlock();
+    const DspLoadMonitor::ScopedBlock measuredBlock (dspLoadMonitor, buffer.getNumSamples());
     juce::ScopedNoDenormals noDenormals;
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
+    const auto blockStartSample = sampleClock;
+    const auto blockStartMs = replayBlockStartMs >= 0.0 ? std::exchange (replayBlockStartMs, -1.0)
+                                                        : juce::Time::getMillisecondCounterHiRes();
+    sampleClock += buffer.getNumSamples();
+    renderBlockStart = blockStartSample;
+    renderBlockStartMs = blockStartMs;
+
+    // Values set by other threads are logged where they are read below; these ones, now
+    const SessionRecorder::ScopedBlock<SampleType> recordedBlock (sessionRecorder, buffer, blockStartSample, blockStartMs);
+    if (recordedBlock.isRecording())
+    {
+        sessionRecorder.recordParameters (sessionParameters);
+        sessionRecorder.recordDeviceLatency (deviceOutputLatency.load (std::memory_order_relaxed));
+        sessionRecorder.recordPlayHead (getPlayHead());
+        sessionRecorder.recordMidi (midiMessages);
+
+        if (getTotalNumInputChannels() > 0 && getInputMode() != InputMode::Off)
+            sessionRecorder.recordInput (buffer);
+    }
+
+    // A play or stop sent over OSC holds until the message thread has set the parameter
+    if (remotePlayState >= 0 && getPlayState() == (remotePlayState > 0))
+        remotePlayState = -1;
+
+    // Parked: nothing to render, analyse or apply until playback starts, which takes the full path.
+    // Clearing the whole buffer flags it as silent (AudioBuffer::hasBeenCleared) for the wrapper.
+    if (isIdle (midiMessages))
+    {
+        buffer.clear();
+        return;
+    }
+
+    // The input shares channels with the output: analyse it before clearing
+    processInput (buffer, blockStartSample);
+
     // Clear output buffers
     for (auto i = 0; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    static float lastBpm = bpmParameter->load();
-    float currentBpm = bpmParameter->load();
+    // Read before the settings it stands for: a change made after this counts in the next block
+    const auto revision = settingsRevision.load (std::memory_order_acquire);
+
+    processPendingTaps (midiMessages, blockStartSample, blockStartMs);
+    processRemoteCommands (blockStartSample, blockStartMs);
+    processProgramChanges (midiMessages);
+
+    // Nothing is playing: no bar to wait for
+    if (!isEnginePlaying())
+        applyPendingProgram (0);
+
+    // Until the parameters reflect an adopted preset, they would only undo it
+    const float currentBpm = bpmParameter->load();
+
+    const auto settled = settledPrograms.load (std::memory_order_acquire);
+    sessionRecorder.recordSettledPrograms (settled);
+    const auto holdingProgram = adoptedPrograms.load (std::memory_order_relaxed) != settled;
+
+    if (!holdingProgram)
+        syncSettingsFromParameters();
+
+    if (meterChanged.exchange (false, std::memory_order_acq_rel))
+        applyMeterChange();
 
-    if (std::abs (lastBpm - currentBpm) > 0.01f && getPlayState())
+    syncEnsembleTracks();
+    updateGrooveTable();
+
+    if (!holdingProgram && std::abs (currentBpm - lastParameterBpm) > 0.01f)
     {
-        // Stop sound
-        clickPosition = -1; // Stop current click
-        soundPosition = 0; // Reset position
-        currentBeat = 0; // Reset beat
+        lastParameterBpm = currentBpm;
 
-        updateTimingInfo();
-        lastBpm = currentBpm;
+        if (std::abs (currentBpm - pushedBpm) < 0.01f)
+        {
+            // Echo of a tempo the engine pushed itself (tap, follow): already applied
+            pushedBpm = 0.0f;
+        }
+        else
+        {
+            engineBpm = currentBpm;
+            updateTimingInfo();
 
-        return;
+            if (isEnginePlaying() && wasPlaying)
+            {
+                invalidateBarCache();
+
+                // Stop the click in progress and restart the bar
+                clickEngine.reset();
+
+                return;
+            }
+        }
+    }
+
+    const auto playing = isEnginePlaying();
+    if (playing && !wasPlaying)
+    {
+        // Playback starts on a beat: anchor the grid there
+        clickEngine.restartGrid();
+        ensembleTracks.reset();
+        barCache.invalidate();
     }
+    updateTimelineLead (playing && wasPlaying);
+    wasPlaying = playing;
+    syncClickSettings();
 
-    if (getPlayState())
+    if (playing)
     {
-        for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+        updateBarCacheKey (revision, std::is_same_v<SampleType, float>, totalNumOutputChannels);
+
+        for (int sample = 0; sample < buffer.getNumSamples();)
         {
+            if (clickEngine.getBeatPosition() == 0 && clickEngine.getCurrentBeat() == 0)
+            {
+                armReplayedProgram (sample);
+                startCachedBar();
+            }
+
+            // A steady loop of bars: the rest of this bar is a copy
+            if (barCache.isReady())
+            {
+                sample += playCachedBar (buffer, sample, buffer.getNumSamples() - sample, totalNumOutputChannels);
+                continue;
+            }
+
             processSample (buffer, sample, totalNumOutputChannels);
+
+            if (barCache.isRecording())
+                barCache.record (buffer, sample);
+
+            ++sample;
         }
     }
+
+    playingCachedBar.store (playing && barCache.isReady(), std::memory_order_relaxed);
 }
 
-void MetronomeAudioProcessor::processSample (juce::AudioBuffer<float>& buffer,
-    int sample,
-    int totalNumOutputChannels)
+bool MetronomeAudioProcessor::isIdle (const juce::MidiBuffer& midiMessages) const
 {
-    bool startClick = false;
-    bool isRest = false;
+    // Stopped, and stopped in the previous block too: the stop itself takes the full path
+    if (wasPlaying || isEnginePlaying())
+        return false;
+
+    const auto* server = remoteControl.load (std::memory_order_acquire);
+
+    // Anything that could change the engine while stopped
+    return midiMessages.isEmpty()
+           && tapFifo.getNumReady() == 0
+           && (server == nullptr || !server->hasPendingCommands())
+           && pendingSnapshot.load (std::memory_order_relaxed) == nullptr
+           && (getTotalNumInputChannels() == 0 || getInputMode() == InputMode::Off);
+}
+
+bool MetronomeAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
+{
+    const auto output = layouts.getMainOutputChannelSet();
+    if (output != juce::AudioChannelSet::mono() && output != juce::AudioChannelSet::stereo())
+        return false;
+
+    const auto input = layouts.getMainInputChannelSet();
+    return input.isDisabled() || input == juce::AudioChannelSet::mono();
+}
+
+template <typename SampleType>
+void MetronomeAudioProcessor::processInput (const juce::AudioBuffer<SampleType>& buffer, int64_t blockStartSample)
+{
+    if (getTotalNumInputChannels() == 0)
+        return;
 
-    if (soundPosition == 0)
+    const auto inputMode = getInputMode();
+    if (inputMode != lastInputMode)
     {
-        startClick = true;
+        lastInputMode = inputMode;
+        onsetDetector.reset();
+
+        if (inputMode == InputMode::Practice)
+        {
+            timingAnalyzer.reset();
+            timingSnapshot.publish (timingAnalyzer.getStatistics());
+        }
     }
-    else if (getPlayState())
+
+    if (inputMode == InputMode::Off)
+        return;
+
+    const auto numHits = timingAnalyzer.getStatistics().numHits;
+
+    if constexpr (std::is_same_v<SampleType, float>)
     {
-        const auto subdivType = static_cast<Subdivision> (static_cast<int> (subdivisionParameter->load()));
-        startClick = processSubdivisionClick (subdivType, soundPosition, isRest);
+        analyseInput (inputMode, buffer.getReadPointer (0), buffer.getNumSamples(), blockStartSample, blockStartSample);
     }
-
-    // Generate click if needed and not muted
-    if (currentBeat >= 0 && currentBeat < getBeatsPerBar() && static_cast<size_t> (currentBeat) < mutedBeats.size() && !mutedBeats[currentBeat])
+    else
     {
-        if (startClick)
+        // The analysis runs in single precision: convert the input a chunk at a time
+        const auto* input = buffer.getReadPointer (0);
+        const auto chunkSize = static_cast<int> (inputConversionBuffer.size());
+
+        for (int start = 0; start < buffer.getNumSamples(); start += chunkSize)
         {
-            clickPosition = 0;
-            currentClickIsRest = isRest;
+            const auto numSamples = std::min (chunkSize, buffer.getNumSamples() - start);
+            for (int i = 0; i < numSamples; ++i)
+                inputConversionBuffer[static_cast<size_t> (i)] = static_cast<float> (input[start + i]);
+
+            analyseInput (inputMode, inputConversionBuffer.data(), numSamples, blockStartSample + start, blockStartSample);
         }
+    }
 
-        if (clickPosition >= 0)
-        {
-            const auto restType = static_cast<RestSoundType> (
-                static_cast<int> (restSoundParameter->load()));
+    if (inputMode == InputMode::Follow)
+        followTempo (buffer.getNumSamples());
+    else if (inputMode == InputMode::Practice && timingAnalyzer.getStatistics().numHits != numHits)
+        timingSnapshot.publish (timingAnalyzer.getStatistics());
+}
 
-            const auto& soundBuffer = [this, restType]() -> const juce::AudioBuffer<float>& {
-                if (currentClickIsRest)
-                {
-                    switch (restType)
-                    {
-                        case RestSoundType::SameAsBeat:
-                            return getSoundBufferForClickType (soundTypeMap[(currentBeat == 0) ? state->getParameter ("firstBeatSound")->getCurrentValueAsText() : state->getParameter ("otherBeatsSound")->getCurrentValueAsText()]);
+void MetronomeAudioProcessor::analyseInput (InputMode inputMode,
+    const float* samples,
+    int numSamples,
+    int64_t firstSample,
+    int64_t blockStartSample)
+{
+    if (inputMode == InputMode::AudioTap)
+    {
+        onsetDetector.process (samples,
+            numSamples,
+            firstSample,
+            [this, blockStartSample] (int64_t onset) { handleTap (onset, blockStartSample); });
+    }
+    else if (inputMode == InputMode::Follow)
+    {
+        onsetDetector.process (
+            samples,
+            numSamples,
+            firstSample,
+            [this, blockStartSample] (int64_t onset) { steerPhase (onset, blockStartSample); },
+            [this] (float onsetStrength) { tempoFollower.pushOnsetStrength (onsetStrength); });
+    }
+    else if (inputMode == InputMode::Practice)
+    {
+        onsetDetector.process (samples,
+            numSamples,
+            firstSample,
+            [this, blockStartSample] (int64_t onset) {
+                // The player hears the next click when its lead has been used up
+                if (isEnginePlaying() && clickEngine.getBeatLength() > 0)
+                    timingAnalyzer.addOnset (onset, getNextClickSample (blockStartSample) + clickEngine.getLead());
+            });
+    }
+}
 
-                        case RestSoundType::RestSound:
-                            return restSoundBuffer;
+void MetronomeAudioProcessor::followTempo (int numSamples)
+{
+    const auto current = static_cast<double> (engineBpm.load());
+    tempoFollower.setExpectedTempo (static_cast<float> (current));
 
-                        case RestSoundType::Mute:
-                            return muteBuffer;
+    const auto target = static_cast<double> (tempoFollower.getTempo());
+    if (target <= 0.0 || std::abs (std::log2 (target / current)) > FOLLOW_MAX_DEVIATION_OCTAVES)
+        return;
 
-                        default:
-                            return muteBuffer;
-                    }
-                }
-                else
-                {
-                    return getSoundBufferForClickType (soundTypeMap[(currentBeat == 0) ? state->getParameter ("firstBeatSound")->getCurrentValueAsText() : state->getParameter ("otherBeatsSound")->getCurrentValueAsText()]);
-                }
-            }();
+    // Exponential steering, independent of the block size
+    const auto amount = 1.0 - std::exp (-numSamples / (FOLLOW_SMOOTHING_SECONDS * currentSampleRate));
+    const auto newBpm = std::clamp (current + (target - current) * amount, MIN_BPM, MAX_BPM);
 
-            if (clickPosition < soundBuffer.getNumSamples())
-            {
-                float sampleValue = soundBuffer.getSample (0, clickPosition);
-                for (int channel = 0; channel < totalNumOutputChannels; ++channel)
-                {
-                    buffer.setSample (channel, sample, sampleValue);
-                }
-                clickPosition++;
-            }
-            else
-            {
-                clickPosition = -1;
-            }
-        }
+    engineBpm = static_cast<float> (newBpm);
+    updateTimingInfo();
+    pushTempoToParameter (static_cast<float> (newBpm));
+}
+
+void MetronomeAudioProcessor::steerPhase (int64_t onset, int64_t blockStartSample)
+{
+    const auto samplesPerBeat = clickEngine.getBeatLength();
+    if (!isEnginePlaying() || samplesPerBeat <= 0)
+        return;
+
+    // Distance from the hit to the nearest beat of the grid, in (-beat/2, beat/2];
+    // the grid is where the rendered click lands once its lead is used up
+    const auto soundPosition = clickEngine.getBeatPosition();
+    const auto beatStart = blockStartSample - soundPosition + clickEngine.getLead();
+    auto error = (onset - beatStart) % samplesPerBeat;
+    if (error < 0)
+        error += samplesPerBeat;
+    if (error > samplesPerBeat / 2)
+        error -= samplesPerBeat;
+
+    // Hits far from the grid are fills or off-beats, not beats
+    if (std::abs (error) > samplesPerBeat / 8)
+        return;
+
+    // A late band delays the click: move back in the beat, without crossing a beat boundary
+    const auto correction = static_cast<int> (static_cast<double> (error) * FOLLOW_PHASE_CORRECTION);
+    const auto newPosition = soundPosition - correction;
+    if (newPosition > 0 && newPosition < samplesPerBeat)
+        clickEngine.setBeatPosition (newPosition);
+}
+
+int64_t MetronomeAudioProcessor::getNextClickSample (int64_t blockStartSample) const
+{
+    // The block starts at soundPosition, which has not been rendered yet: a note there is still to come
+    const auto subdivision = activeSettings.subdivision;
+    const auto soundPosition = clickEngine.getBeatPosition();
+    if (const auto note = SubdivisionSchedule::findNextNote (subdivision, soundPosition, clickEngine.getGrid()); note >= 0)
+        return blockStartSample + note - soundPosition;
+
+    // The first note of the next beat, whose straight grid is within a sample of this one
+    const auto nextBeat = (clickEngine.getCurrentBeat() + 1) % activeSettings.beatsPerBar;
+    const auto note = std::max (0, SubdivisionSchedule::findNextNote (subdivision, 0, clickEngine.computeGrid (nextBeat)));
+    return blockStartSample + clickEngine.getBeatLength() - soundPosition + note;
+}
+
+//==============================================================================
+// Latency Compensation
+//==============================================================================
+int MetronomeAudioProcessor::computeTimelineLead() const
+{
+    const auto mode = getLatencyMode();
+
+    // In Host mode the host's delay compensation moves the output, not the engine
+    if (mode == LatencyMode::Host)
+        return 0;
+
+    auto lead = juce::roundToInt (-clickOffsetParameter->load() * currentSampleRate / 1000.0);
+    if (mode == LatencyMode::Device)
+        lead += deviceOutputLatency.load (std::memory_order_relaxed);
+
+    return lead;
+}
+
+void MetronomeAudioProcessor::updateTimelineLead (bool playing)
+{
+    clickEngine.setLead (computeTimelineLead(), playing);
+}
+
+void MetronomeAudioProcessor::updateReportedLatency()
+{
+    const auto latency = getLatencyMode() == LatencyMode::Host
+                             ? juce::roundToInt (-clickOffsetParameter->load() * getSampleRate() / 1000.0)
+                             : 0;
+
+    if (latency != getLatencySamples())
+        setLatencySamples (latency);
+}
+
+template <typename SampleType>
+void MetronomeAudioProcessor::processSample (juce::AudioBuffer<SampleType>& buffer,
+    int sample,
+    int totalNumOutputChannels)
+{
+    bool startClick = false;
+    bool isRest = false;
+
+    // Presets switch on bar boundaries
+    if (clickEngine.getBeatPosition() == 0 && clickEngine.getCurrentBeat() == 0)
+        applyPendingProgram (sample);
+
+    if (clickEngine.getBeatPosition() == 0)
+    {
+        broadcastBeat (sample);
+        BEATIT_TRACE_INSTANT ("beat", clickEngine.getCurrentBeat());
     }
 
-    soundPosition++;
-    if (soundPosition >= samplesPerBeat)
+    // The main click, on the timeline of the core engine
+    const auto sampleValue = static_cast<SampleType> (clickEngine.renderSample (startClick, isRest));
+    for (int channel = 0; channel < totalNumOutputChannels; ++channel)
+        buffer.setSample (channel, sample, sampleValue);
+
+    if (startClick)
     {
-        soundPosition = 0;
-        currentBeat = (currentBeat + 1) % getBeatsPerBar();
+        BEATIT_TRACE_INSTANT ("click", BarCache::mainVoice);
+
+        if (barCache.isRecording())
+            barCache.addOnset (BarCache::mainVoice, isRest, 1.0f);
+
+        if (!isRest)
+            timingAnalyzer.addClick (renderBlockStart + sample + clickEngine.getLead());
     }
+
+    if (ensembleTracks.numActiveTracks > 0)
+        renderEnsembleTracks (buffer, sample, totalNumOutputChannels);
+
+    clickEngine.advance (1);
+}
+
+void MetronomeAudioProcessor::applyMeterChange()
+{
+    // A shorter bar: the beat in progress starts it. A new denominator has already retimed the grid
+    // through syncSettingsFromParameters().
+    syncClickSettings();
+}
+
+void MetronomeAudioProcessor::broadcastBeat (int sample)
+{
+    // Subscribers get the time of the beat on the grid, where the rendered click lands once its lead is used up
+    if (auto* server = remoteControl.load (std::memory_order_relaxed); server != nullptr && server->hasSubscribers())
+        server->pushBeat ({ clickEngine.getCurrentBeat(),
+            activeSettings.beatsPerBar,
+            engineBpm.load(),
+            renderBlockStartMs + static_cast<double> (sample + clickEngine.getLead()) * 1000.0 / currentSampleRate });
 }
 
 //==============================================================================
-// Sound Generation
+// Bar Cache
 //==============================================================================
-void MetronomeAudioProcessor::generateClickSound (juce::AudioBuffer<float>& buffer, ClickType type)
+void MetronomeAudioProcessor::updateBarCacheKey (uint32_t revision, bool singlePrecision, int totalNumOutputChannels)
 {
-    const double sampleRate = getSampleRate();
+    BarCacheKey key;
+    key.revision = revision;
+    key.samplesPerBeat = clickEngine.getExactSamplesPerBeat();
+    key.timelineLead = clickEngine.getLead();
 
-    // Set parameters based on click type
-    float frequency = 0.0f;
-    float durationMs = 0.0f;
+    // The main click is the same on every channel: one channel is enough without the panned tracks
+    key.numChannels = (totalNumOutputChannels > 1 && ensembleTracks.numActiveTracks > 0) ? 2 : 1;
 
-    switch (type)
+    // Practice mode needs each click, the other input modes move the grid,
+    // and a double-precision mix of tracks does not fit in floats
+    key.eligible = getInputMode() == InputMode::Off
+                   && (singlePrecision || ensembleTracks.numActiveTracks == 0)
+                   && key.numChannels <= barCache.getMaxChannels();
+
+    if (key == barCacheKey)
+        return;
+
+    invalidateBarCache();
+    barCacheKey = key;
+
+    // The grid repeats once a whole number of samples has gone by: a bar of 82687.5 samples every two bars
+    const auto exactBarLength = key.samplesPerBeat * activeSettings.beatsPerBar;
+    const auto barsPerLoop = key.eligible ? findBarsPerLoop (exactBarLength, barCache.getMaxLength()) : 0;
+    cachedLoopLength = static_cast<int> (std::llround (barsPerLoop * exactBarLength));
+}
+
+void MetronomeAudioProcessor::startCachedBar()
+{
+    // A preset starting on this bar changes it, and one applied since the block started is not in the key yet
+    if (cachedLoopLength == 0 || pendingSnapshot.load (std::memory_order_relaxed) != nullptr
+        || settingsRevision.load (std::memory_order_relaxed) != barCacheKey.revision)
     {
-        case ClickType::High:
-            frequency = ClickParams::HIGH_FREQUENCY;
-            durationMs = ClickParams::HIGH_DURATION_MS;
-            break;
-        case ClickType::Low:
-            frequency = ClickParams::LOW_FREQUENCY;
-            durationMs = ClickParams::LOW_DURATION_MS;
-            break;
-        case ClickType::Mute:
-            durationMs = 1.0f; // Minimal buffer for mute
-            frequency = 0.0f;
-            break;
+        invalidateBarCache();
+        return;
     }
 
-    const int numSamples = static_cast<int> ((durationMs / 1000.0f) * sampleRate);
-    buffer.setSize (1, numSamples);
-    buffer.clear();
+    barCache.startBar (cachedLoopLength, barCacheKey.numChannels);
+}
 
-    if (type != ClickType::Mute)
+void MetronomeAudioProcessor::invalidateBarCache()
+{
+    // Pick up the clicks the cached bar was playing, where rendering them would have left them
+    if (barCache.isReady())
     {
-        generateClickWaveform (buffer, frequency, sampleRate, durationMs);
+        int age = 0;
+        if (const auto* onset = barCache.findLastOnset (BarCache::mainVoice, age))
+            clickEngine.resumeClick (age, onset->isRest);
+        else
+            clickEngine.stopClick();
+
+        for (int track = 0; track < EnsembleTracks::maxTracks; ++track)
+        {
+            const auto index = static_cast<size_t> (track);
+            const auto* onset = barCache.findLastOnset (track, age);
+
+            ensembleTracks.clickPositions[index] = (onset != nullptr && !onset->isRest) ? age : -1;
+            if (onset != nullptr)
+                ensembleTracks.clickLevels[index] = onset->level;
+        }
     }
+
+    barCache.invalidate();
 }
 
-void MetronomeAudioProcessor::generateClickWaveform (juce::AudioBuffer<float>& buffer,
-    float frequency,
-    double sampleRate,
-    float durationMs)
+template <typename SampleType>
+int MetronomeAudioProcessor::playCachedBar (juce::AudioBuffer<SampleType>& buffer,
+    int startSample,
+    int numSamples,
+    int totalNumOutputChannels)
 {
-    const auto attackTime = static_cast<float> (ClickParams::ATTACK_TIME_MS / 1000.0);
-    const auto decayTime = static_cast<float> ((durationMs / 1000.0) - attackTime);
-    const auto attackSamples = static_cast<float> (attackTime * sampleRate);
-    const auto decaySamples = static_cast<float> (decayTime * sampleRate);
+    BEATIT_TRACE_SCOPE ("playCachedBar");
 
-    for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+    // A beat at a time, the grid moving on as if the samples had been rendered, up to the next bar
+    int count = 0;
+    while (count < numSamples)
     {
-        const auto time = static_cast<float> (sample) / static_cast<float> (sampleRate);
-        auto signalValue = std::sin (2.0f * juce::MathConstants<float>::pi * frequency * time);
+        const auto soundPosition = clickEngine.getBeatPosition();
+        if (soundPosition == 0)
+        {
+            if (clickEngine.getCurrentBeat() == 0 && count > 0)
+                break;
 
-        float envelope;
-        if (static_cast<float> (sample) < attackSamples)
-            envelope = static_cast<float> (sample) / attackSamples;
-        else
-            envelope = 1.0f - ((static_cast<float> (sample) - attackSamples) / decaySamples);
+            broadcastBeat (startSample + count);
+        }
 
-        envelope = std::max (0.0f, std::min (1.0f, envelope));
-        buffer.setSample (0, sample, signalValue * envelope * ClickParams::DEFAULT_AMPLITUDE);
+        const auto step = barCache.play (buffer, startSample + count, std::min (numSamples - count, clickEngine.getBeatLength() - soundPosition), totalNumOutputChannels);
+        count += step;
+        clickEngine.advance (step);
     }
+
+    return count;
 }
 
-const juce::AudioBuffer<float>& MetronomeAudioProcessor::getSoundBufferForClickType (ClickType type) const
+//==============================================================================
+// Ensemble Tracks
+//==============================================================================
+void MetronomeAudioProcessor::syncEnsembleTracks()
 {
-    switch (type)
+    auto& tracks = ensembleTracks;
+    tracks.numActiveTracks = 0;
+
+    for (size_t track = 0; track < trackParameters.size(); ++track)
     {
-        case ClickType::High:
-            return highClickBuffer;
-        case ClickType::Low:
-            return lowClickBuffer;
-        default:
-            return muteBuffer;
+        const auto& parameters = trackParameters[track];
+        if (parameters.enabled->load() < 0.5f)
+        {
+            tracks.clickPositions[track] = -1;
+            continue;
+        }
+
+        const auto gain = juce::Decibels::decibelsToGain (parameters.gain->load(), MIN_TRACK_GAIN_DB);
+        const auto [left, right] = EnsembleTracks::getBalance (parameters.pan->load());
+
+        tracks.subdivisions[track] = static_cast<Subdivision> (static_cast<int> (parameters.subdivision->load()));
+        tracks.sounds[track] = static_cast<int> (parameters.sound->load());
+        tracks.accents[track] = static_cast<EnsembleTracks::Accent> (static_cast<int> (parameters.accent->load()));
+        tracks.gains[track] = gain;
+        tracks.leftGains[track] = gain * left;
+        tracks.rightGains[track] = gain * right;
+        tracks.activeTracks[static_cast<size_t> (tracks.numActiveTracks++)] = static_cast<int> (track);
     }
 }
 
-void MetronomeAudioProcessor::initializeSounds()
+template <typename SampleType>
+void MetronomeAudioProcessor::renderEnsembleTracks (juce::AudioBuffer<SampleType>& buffer,
+    int sample,
+    int totalNumOutputChannels)
 {
-    generateClickSound (highClickBuffer, ClickType::High);
-    generateClickSound (lowClickBuffer, ClickType::Low);
-    generateClickSound (muteBuffer, ClickType::Mute);
+    auto& tracks = ensembleTracks;
+    const auto soundPosition = clickEngine.getBeatPosition();
 
+    for (int i = 0; i < tracks.numActiveTracks; ++i)
+    {
+        const auto track = static_cast<size_t> (tracks.activeTracks[static_cast<size_t> (i)]);
 
-    // Rest Sound
-    juce::AudioBuffer<float> tempBuffer;
-    const double sampleRate = getSampleRate();
-    const int numSamples = static_cast<int> ((ClickParams::REST_SOUND_DURATION_MS / 1000.0f) * sampleRate);
-    restSoundBuffer.setSize (1, numSamples);
-    restSoundBuffer.clear();
+        // Same grid as the main click, but the tracks play their pattern as written: rests are silent, on the beat too
+        bool isRest = false;
+        const auto startClick = SubdivisionSchedule::isClickAt (tracks.subdivisions[track], soundPosition, clickEngine.getGrid(), isRest) || soundPosition == 0;
 
-    // Low frequency sinus
-    for (int sample = 0; sample < numSamples; ++sample)
-    {
-        const auto time = static_cast<float> (sample) / static_cast<float> (sampleRate);
-        auto signalValue = std::sin (2.0f * juce::MathConstants<float>::pi * ClickParams::REST_SOUND_FREQUENCY * time);
+        if (startClick)
+        {
+            tracks.clickPositions[track] = isRest ? -1 : 0;
+            tracks.clickLevels[track] = EnsembleTracks::getClickLevel (tracks.accents[track], clickEngine.getCurrentBeat(), soundPosition == 0);
+            BEATIT_TRACE_INSTANT ("click", static_cast<int64_t> (track));
+
+            if (barCache.isRecording())
+                barCache.addOnset (static_cast<int> (track), isRest, tracks.clickLevels[track]);
+        }
+
+        const auto position = tracks.clickPositions[track];
+        if (position < 0)
+            continue;
+
+        const auto& sound = clickEngine.getSound (static_cast<ClickSynth::Sound> (tracks.sounds[track]));
+        if (position >= static_cast<int> (sound.size()))
+        {
+            tracks.clickPositions[track] = -1;
+            continue;
+        }
 
-        float envelope = 1.0f - std::abs (2.0f * sample / numSamples - 1.0f);
-        restSoundBuffer.setSample (0, sample, signalValue * envelope * 0.3f);
+        const auto value = sound[static_cast<size_t> (position)] * tracks.clickLevels[track];
+        tracks.clickPositions[track] = position + 1;
+
+        // The main click has already written the sample: the tracks mix on top of it
+        if (totalNumOutputChannels == 1)
+        {
+            buffer.addSample (0, sample, static_cast<SampleType> (value * tracks.gains[track]));
+        }
+        else
+        {
+            buffer.addSample (0, sample, static_cast<SampleType> (value * tracks.leftGains[track]));
+            buffer.addSample (1, sample, static_cast<SampleType> (value * tracks.rightGains[track]));
+        }
     }
 }
 
+//==============================================================================
+// Groove
+//==============================================================================
+void MetronomeAudioProcessor::updateGrooveTable()
+{
+    const auto mode = static_cast<int> (grooveParameter->load());
+    const auto swing = swingParameter->load();
+    const auto revision = importedGrooveRevision.load (std::memory_order_acquire);
+    const auto exactSamplesPerBeat = clickEngine.getExactSamplesPerBeat();
+    const auto denominator = activeSettings.beatDenominator;
+
+    const CompiledGroove groove { mode, swing, revision, exactSamplesPerBeat, denominator };
+    if (groove == compiledGroove)
+        return;
+
+    compiledGroove = groove;
+
+    switch (static_cast<GrooveMode> (mode))
+    {
+        case GrooveMode::SwingSixteenths:
+            grooveTable.compile (GrooveTemplate::swing (swing, 4), exactSamplesPerBeat, denominator);
+            break;
+        case GrooveMode::Imported:
+            grooveTable.compile (importedGroove.read(), exactSamplesPerBeat, denominator);
+            break;
+        case GrooveMode::SwingEighths:
+        default:
+            grooveTable.compile (GrooveTemplate::swing (swing, 2), exactSamplesPerBeat, denominator);
+            break;
+    }
+
+    clickEngine.refreshGrid();
+}
+
+bool MetronomeAudioProcessor::importGroove (const juce::File& midiFile)
+{
+    juce::FileInputStream stream (midiFile);
+    juce::MidiFile file;
+    if (!stream.openedOk() || !file.readFrom (stream))
+        return false;
+
+    const auto groove = GrooveTemplate::fromMidiFile (file, IMPORTED_GROOVE_STEPS_PER_BEAT, IMPORTED_GROOVE_STEPS);
+    if (groove.numSteps == 0)
+        return false;
+
+    setImportedGroove (groove);
+    return true;
+}
+
+void MetronomeAudioProcessor::setImportedGroove (const GrooveTemplate& groove)
+{
+    importedGrooveTemplate = groove;
+    importedGroove.publish (groove);
+    importedGrooveRevision.fetch_add (1, std::memory_order_release);
+    settingsRevision.fetch_add (1, std::memory_order_release);
+    recordSessionState();
+}
+
+//==============================================================================
+// Sound Generation
+//==============================================================================
+void MetronomeAudioProcessor::initializeSounds()
+{
+    BEATIT_TRACE_SCOPE ("initializeSounds");
+    clickEngine.prepare (currentSampleRate);
+    syncClickSettings();
+}
+
+void MetronomeAudioProcessor::syncClickSettings()
+{
+    // Only what voices the click: the tempo and beat unit follow updateTimingInfo()
+    auto settings = clickEngine.getSettings();
+    settings.beatsPerBar = activeSettings.beatsPerBar;
+    settings.subdivision = activeSettings.subdivision;
+    settings.firstBeatSound = static_cast<ClickSynth::Sound> (activeSettings.firstBeatSound);
+    settings.otherBeatsSound = static_cast<ClickSynth::Sound> (activeSettings.otherBeatsSound);
+    settings.restSound = static_cast<ClickEngine::RestSound> (activeSettings.restSound);
+    settings.mutedBeats = activeSettings.mutedBeats;
+    clickEngine.setSettings (settings);
+}
+
 //==============================================================================
 // Timing and Beat Management
 //==============================================================================
 void MetronomeAudioProcessor::updateTimingInfo()
 {
-    int bpm = static_cast<int> (std::round (bpmParameter->load()));
-    int denominator = getBeatDenominator();
-
-    double adjustedBpm = static_cast<double> (bpm * (4.0 / denominator));
-    double beatsPerSecond = adjustedBpm / 60.0;
+    // The engine tempo may be fractional while following the input
+    const auto exactSamplesPerBeat = BeatClock::computeSamplesPerBeat (currentSampleRate,
+        static_cast<double> (engineBpm.load()),
+        activeSettings.beatDenominator);
 
-    if (currentSampleRate > 0 && beatsPerSecond > 0)
+    // Beat lengths alternate around the exact value instead of truncating it
+    if (exactSamplesPerBeat > 0.0)
     {
-        samplesPerBeat = static_cast<int> (currentSampleRate / beatsPerSecond);
+        auto settings = clickEngine.getSettings();
+        settings.bpm = static_cast<double> (engineBpm.load());
+        settings.beatDenominator = activeSettings.beatDenominator;
+        clickEngine.setSettings (settings);
     }
 }
 
@@ -381,24 +961,42 @@ void MetronomeAudioProcessor::updateTimingInfo()
 void MetronomeAudioProcessor::parameterChanged (const juce::String& parameterID,
     [[maybe_unused]] float newValue)
 {
-    if (parameterID == "bpm")
-    {
-        updateTimingInfo();
-    }
-    else if (parameterID == "beatDenominator" || parameterID == "beatsPerBar")
+    const auto onMessageThread = juce::Thread::getCurrentThreadId() == messageThreadId;
+
     {
-        updateTimingInfo();
-        updateMutedBeatsSize();
-        currentBeat = 0;
+        // Possibly on the audio thread: no timing, allocation, lock or editor call here
+        BEATIT_REALTIME_SCOPE ("MetronomeAudioProcessor::parameterChanged");
+        settingsRevision.fetch_add (1, std::memory_order_release);
 
-        if (parameterID == "beatDenominator")
+        if (parameterID == "beatsPerBar" || parameterID == "beatDenominator")
         {
-            if (auto* editor = dynamic_cast<MetronomeAudioProcessorEditor*> (getActiveEditor()))
-            {
-                editor->updateSubdivisionComboBox (getBeatDenominator());
-            }
+            meterChanged.store (true, std::memory_order_release);
+            mutedBeatsResizePending.store (true, std::memory_order_release);
+            parameterUpdatePending.store (true, std::memory_order_release);
         }
     }
+
+    // Changed from the editor or a host on the message thread: poll at full rate at once
+    if (onMessageThread)
+        updateTimerRate (true);
+}
+
+bool MetronomeAudioProcessor::isIdle() const
+{
+    return !getPlayState()
+           && getInputMode() == InputMode::Off
+           && getLatencyMode() != LatencyMode::Device
+           && remoteControl.load (std::memory_order_relaxed) == nullptr
+           && adoptedPrograms.load (std::memory_order_acquire) == settledPrograms.load (std::memory_order_relaxed);
+}
+
+void MetronomeAudioProcessor::updateTimerRate (bool active)
+{
+    numIdleTicks = active || !isIdle() ? 0 : numIdleTicks + 1;
+
+    const auto rate = numIdleTicks < PARAMETER_UPDATE_RATE_HZ ? PARAMETER_UPDATE_RATE_HZ : IDLE_PARAMETER_UPDATE_RATE_HZ;
+    if (getTimerInterval() != 1000 / rate)
+        startTimerHz (rate);
 }
 
 //==============================================================================
@@ -417,8 +1015,7 @@ void MetronomeAudioProcessor::togglePlayState()
     if (newState)
     {
         updateTimingInfo();
-        soundPosition = 0;
-        currentBeat = 0;
+        clickEngine.reset();
     }
 }
 
@@ -434,23 +1031,116 @@ int MetronomeAudioProcessor::getBeatDenominator() const
 
 void MetronomeAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    auto stateTree = state->copyState();
+    StateFormat::Writer writer (destData);
 
-    juce::String mutedBeatsStr;
-    for (size_t i = 0; i < mutedBeats.size(); ++i)
-    {
-        mutedBeatsStr += mutedBeats[i] ? "1" : "0";
-        if (i < mutedBeats.size() - 1)
-            mutedBeatsStr += ",";
-    }
+    writer.writeChunk (StateFormat::parametersTag, [this] (juce::MemoryOutputStream& stream) {
+        const auto& parameters = getParameters();
+        stream.writeInt (parameters.size());
 
-    stateTree.setProperty ("mutedBeats", mutedBeatsStr, nullptr);
+        for (auto* parameter : parameters)
+        {
+            auto* ranged = static_cast<juce::RangedAudioParameter*> (parameter);
+            stream.writeString (ranged->getParameterID());
+            stream.writeFloat (ranged->convertFrom0to1 (ranged->getValue()));
+        }
+    });
+
+    writer.writeChunk (StateFormat::mutedBeatsTag, [this] (juce::MemoryOutputStream& stream) {
+        uint32_t bits = 0;
+        for (size_t i = 0; i < mutedBeats.size() && i < 32; ++i)
+            bits |= (mutedBeats[i] ? 1u : 0u) << i;
+
+        stream.writeInt (static_cast<int> (mutedBeats.size()));
+        stream.writeInt (static_cast<int> (bits));
+    });
+
+    writer.writeChunk (StateFormat::presetsTag, [this] (juce::MemoryOutputStream& stream) {
+        stream.writeInt (currentProgram.load());
+        presetBank.writeTo (stream);
+    });
 
-    std::unique_ptr<juce::XmlElement> xml (stateTree.createXml());
-    copyXmlToBinary (*xml, destData);
+    writer.writeChunk (StateFormat::grooveTag, [this] (juce::MemoryOutputStream& stream) {
+        importedGrooveTemplate.writeTo (stream);
+    });
 }
 
 void MetronomeAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    // States loaded one after another while playing: free the presets of the previous ones
+    releaseStalePresets();
+
+    if (StateFormat::isBinaryState (data, sizeInBytes))
+        setBinaryState (data, sizeInBytes);
+    else
+        setLegacyXmlState (data, sizeInBytes);
+
+    recordSessionState();
+}
+
+void MetronomeAudioProcessor::setBinaryState (const void* data, int sizeInBytes)
+{
+    // Only parameters whose value actually changes notify their listeners
+    auto setParameter = [] (juce::RangedAudioParameter& parameter, float normalisedValue) {
+        if (std::abs (parameter.getValue() - normalisedValue) > 1.0e-6f)
+            parameter.setValueNotifyingHost (normalisedValue);
+    };
+
+    juce::StringArray restoredParameters;
+
+    // A state from a newer format version is not ours to read: keep the current one
+    const auto isReadable = StateFormat::readChunks (data, sizeInBytes, [&] (int tag, juce::MemoryInputStream& stream) {
+        if (tag == StateFormat::parametersTag)
+        {
+            const auto count = stream.readInt();
+            for (int i = 0; i < count && !stream.isExhausted(); ++i)
+            {
+                const auto parameterID = stream.readString();
+                const auto value = stream.readFloat();
+
+                if (auto* parameter = state->getParameter (parameterID))
+                {
+                    setParameter (*parameter, parameter->convertTo0to1 (value));
+                    restoredParameters.add (parameterID);
+                }
+            }
+        }
+        else if (tag == StateFormat::mutedBeatsTag)
+        {
+            const auto numBeats = juce::jlimit (0, 32, stream.readInt());
+            const auto bits = stream.readInt();
+
+            mutedBeats.assign (static_cast<size_t> (numBeats), false);
+            for (int i = 0; i < numBeats; ++i)
+                mutedBeats[static_cast<size_t> (i)] = ((bits >> i) & 1) != 0;
+
+            updateMutedBeatsSize();
+        }
+        else if (tag == StateFormat::presetsTag)
+        {
+            currentProgram = juce::jlimit (0, PresetBank::numPresets - 1, stream.readInt());
+            presetBank.readFrom (stream);
+        }
+        else if (tag == StateFormat::grooveTag)
+        {
+            GrooveTemplate groove;
+            groove.readFrom (stream);
+            setImportedGroove (groove);
+        }
+    });
+
+    if (!isReadable)
+        return;
+
+    // Parameters added after the state was saved start from their default
+    for (auto* parameter : getParameters())
+    {
+        auto* ranged = static_cast<juce::RangedAudioParameter*> (parameter);
+        if (!restoredParameters.contains (ranged->getParameterID()))
+            setParameter (*ranged, ranged->getDefaultValue());
+    }
+}
+
+void MetronomeAudioProcessor::setLegacyXmlState (const void* data, int sizeInBytes)
 {
     std::unique_ptr<juce::XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
 
@@ -483,6 +1173,7 @@ void MetronomeAudioProcessor::initializeMutedBeats()
 {
     mutedBeats.clear();
     mutedBeats.resize (static_cast<size_t> (getBeatsPerBar()), false);
+    publishMutedBeats();
 }
 
 void MetronomeAudioProcessor::updateMutedBeatsSize()
@@ -498,6 +1189,8 @@ void MetronomeAudioProcessor::updateMutedBeatsSize()
             mutedBeats[i] = oldStates[i];
         }
     }
+
+    publishMutedBeats();
 }
 
 void MetronomeAudioProcessor::toggleBeatMute (int beatIndex)
@@ -505,6 +1198,7 @@ void MetronomeAudioProcessor::toggleBeatMute (int beatIndex)
     if (beatIndex >= 0 && static_cast<size_t> (beatIndex) < mutedBeats.size())
     {
         mutedBeats[static_cast<size_t> (beatIndex)] = !mutedBeats[static_cast<size_t> (beatIndex)];
+        publishMutedBeats();
     }
 }
 
@@ -523,19 +1217,312 @@ void MetronomeAudioProcessor::setMutedBeats (const std::vector<bool>& newMutedBe
     updateMutedBeatsSize();
 }
 
+void MetronomeAudioProcessor::publishMutedBeats()
+{
+    uint32_t bits = 0;
+    for (size_t i = 0; i < mutedBeats.size() && i < 32; ++i)
+        bits |= (mutedBeats[i] ? 1u : 0u) << i;
+
+    mutedBeatMask.store (bits, std::memory_order_release);
+    settingsRevision.fetch_add (1, std::memory_order_release);
+}
+
 //==============================================================================
 // Plugin Information
 //==============================================================================
 const juce::String MetronomeAudioProcessor::getName() const { return JucePlugin_Name; }
-bool MetronomeAudioProcessor::acceptsMidi() const { return false; }
+bool MetronomeAudioProcessor::acceptsMidi() const { return true; }
 bool MetronomeAudioProcessor::producesMidi() const { return false; }
 bool MetronomeAudioProcessor::isMidiEffect() const { return false; }
 double MetronomeAudioProcessor::getTailLengthSeconds() const { return 0.0; }
-int MetronomeAudioProcessor::getNumPrograms() { return 1; }
-int MetronomeAudioProcessor::getCurrentProgram() { return 0; }
-void MetronomeAudioProcessor::setCurrentProgram ([[maybe_unused]] int index) {}
-const juce::String MetronomeAudioProcessor::getProgramName ([[maybe_unused]] int index) { return {}; }
-void MetronomeAudioProcessor::changeProgramName ([[maybe_unused]] int index, [[maybe_unused]] const juce::String& newName) {}
+
+//==============================================================================
+// Programs
+//==============================================================================
+int MetronomeAudioProcessor::getNumPrograms() { return PresetBank::numPresets; }
+int MetronomeAudioProcessor::getCurrentProgram() { return currentProgram.load(); }
+
+void MetronomeAudioProcessor::setCurrentProgram (int index)
+{
+    if (index < 0 || index >= PresetBank::numPresets)
+        return;
+
+    currentProgram = index;
+    settingsRevision.fetch_add (1, std::memory_order_release);
+
+    if (const auto* snapshot = presetBank.getSnapshot (index))
+    {
+        if (getPlayState())
+            pendingSnapshot.store (snapshot, std::memory_order_release);
+        else
+            applySnapshotToParameters (*snapshot);
+    }
+}
+
+const juce::String MetronomeAudioProcessor::getProgramName (int index)
+{
+    const auto name = presetBank.getName (index);
+    return name.isNotEmpty() ? name : "Preset " + juce::String (index + 1);
+}
+
+void MetronomeAudioProcessor::changeProgramName (int index, const juce::String& newName)
+{
+    presetBank.setName (index, newName);
+    recordSessionState();
+}
+
+void MetronomeAudioProcessor::storePreset (int index)
+{
+    if (index < 0 || index >= PresetBank::numPresets)
+        return;
+
+    presetBank.store (index, getProgramName (index), captureSnapshot());
+    currentProgram = index;
+    updateHostDisplay (ChangeDetails().withProgramChanged (true));
+    recordSessionState();
+}
+
+EngineSnapshot MetronomeAudioProcessor::captureSnapshot() const
+{
+    EngineSnapshot snapshot;
+    snapshot.bpm = bpmParameter->load();
+    snapshot.beatsPerBar = getBeatsPerBar();
+    snapshot.beatDenominator = getBeatDenominator();
+    snapshot.subdivision = static_cast<Subdivision> (static_cast<int> (subdivisionParameter->load()));
+    snapshot.firstBeatSound = static_cast<int> (firstBeatSoundParameter->load());
+    snapshot.otherBeatsSound = static_cast<int> (otherBeatsSoundParameter->load());
+    snapshot.restSound = static_cast<int> (restSoundParameter->load());
+    snapshot.mutedBeats = mutedBeatMask.load (std::memory_order_acquire);
+    return snapshot;
+}
+
+void MetronomeAudioProcessor::applySnapshotToParameters (const EngineSnapshot& snapshot)
+{
+    auto setParameter = [this] (const juce::String& parameterID, float value) {
+        if (auto* parameter = state->getParameter (parameterID))
+            parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+    };
+
+    setParameter ("bpm", snapshot.bpm);
+    setParameter ("beatsPerBar", static_cast<float> (snapshot.beatsPerBar - 1));
+    setParameter ("beatDenominator", static_cast<float> (juce::findHighestSetBit (static_cast<uint32_t> (snapshot.beatDenominator))));
+    setParameter ("subdivision", static_cast<float> (static_cast<int> (snapshot.subdivision)));
+    setParameter ("firstBeatSound", static_cast<float> (snapshot.firstBeatSound));
+    setParameter ("otherBeatsSound", static_cast<float> (snapshot.otherBeatsSound));
+    setParameter ("restSound", static_cast<float> (snapshot.restSound));
+
+    mutedBeats.assign (static_cast<size_t> (snapshot.beatsPerBar), false);
+    for (int beat = 0; beat < snapshot.beatsPerBar; ++beat)
+        mutedBeats[static_cast<size_t> (beat)] = snapshot.isBeatMuted (beat);
+
+    publishMutedBeats();
+}
+
+void MetronomeAudioProcessor::processProgramChanges (const juce::MidiBuffer& midiMessages)
+{
+    for (const auto metadata : midiMessages)
+    {
+        const auto message = metadata.getMessage();
+        if (!message.isProgramChange())
+            continue;
+
+        const auto index = message.getProgramChangeNumber();
+        if (const auto* snapshot = presetBank.getSnapshot (index))
+        {
+            currentProgram = index;
+            pendingSnapshot.store (snapshot, std::memory_order_release);
+            settingsRevision.fetch_add (1, std::memory_order_release);
+        }
+    }
+}
+
+void MetronomeAudioProcessor::armReplayedProgram (int sample)
+{
+    if (replayProgramSnapshot != nullptr && sample == replayProgramSample)
+        pendingSnapshot.store (std::exchange (replayProgramSnapshot, nullptr), std::memory_order_release);
+}
+
+void MetronomeAudioProcessor::applyPendingProgram (int sample)
+{
+    armReplayedProgram (sample);
+
+    // Left pending until handed over below, so that the message thread always sees it in use
+    auto* snapshot = pendingSnapshot.load (std::memory_order_acquire);
+    if (snapshot == nullptr)
+        return;
+
+    BEATIT_TRACE_INSTANT ("preset swap", currentProgram.load());
+    sessionRecorder.recordProgram (currentProgram.load(), sample);
+    activeSettings = *snapshot;
+    settingsRevision.fetch_add (1, std::memory_order_release);
+    syncClickSettings();
+
+    if (std::abs (snapshot->bpm - lastParameterBpm) > 0.01f)
+        pushedBpm = snapshot->bpm;
+
+    engineBpm = snapshot->bpm;
+    updateTimingInfo();
+
+    // The parameters follow on the message thread; hold them off until then
+    appliedSnapshot.store (snapshot, std::memory_order_release);
+    pendingSnapshot.compare_exchange_strong (snapshot, nullptr, std::memory_order_acq_rel);
+    adoptedPrograms.fetch_add (1, std::memory_order_release);
+    parameterUpdatePending.store (true, std::memory_order_release);
+}
+
+void MetronomeAudioProcessor::releaseStalePresets()
+{
+    // Pending first: the audio thread hands a preset over to appliedSnapshot before clearing it
+    presetBank.releaseStaleSnapshots ({ pendingSnapshot.load (std::memory_order_acquire), appliedSnapshot.load (std::memory_order_acquire) });
+}
+
+void MetronomeAudioProcessor::syncSettingsFromParameters()
+{
+    const auto denominator = getBeatDenominator();
+    const auto denominatorChanged = denominator != activeSettings.beatDenominator;
+
+    activeSettings.bpm = engineBpm.load();
+    activeSettings.beatsPerBar = getBeatsPerBar();
+    activeSettings.beatDenominator = denominator;
+    activeSettings.subdivision = static_cast<Subdivision> (static_cast<int> (subdivisionParameter->load()));
+    activeSettings.firstBeatSound = static_cast<int> (firstBeatSoundParameter->load());
+    activeSettings.otherBeatsSound = static_cast<int> (otherBeatsSoundParameter->load());
+    activeSettings.restSound = static_cast<int> (restSoundParameter->load());
+    activeSettings.mutedBeats = mutedBeatMask.load (std::memory_order_acquire);
+    sessionRecorder.recordMutedBeats (activeSettings.mutedBeats);
+
+    if (denominatorChanged)
+        updateTimingInfo();
+}
+
+//==============================================================================
+// Remote Control
+//==============================================================================
+bool MetronomeAudioProcessor::startRemoteControl (int port)
+{
+    if (oscServer == nullptr)
+        oscServer = std::make_unique<OscServer>();
+
+    if (!oscServer->start (port))
+        return false;
+
+    remoteControl.store (oscServer.get(), std::memory_order_release);
+    updateTimerRate (true);
+    return true;
+}
+
+void MetronomeAudioProcessor::processRemoteCommands (int64_t blockStartSample, double blockStartMs)
+{
+    auto* server = remoteControl.load (std::memory_order_acquire);
+    if (server == nullptr)
+        return;
+
+    auto settings = activeSettings;
+    auto settingsChanged = false;
+
+    RemoteCommand command;
+    while (server->popCommand (command))
+    {
+        sessionRecorder.recordRemoteCommand (command);
+
+        switch (command.type)
+        {
+            case RemoteCommand::Type::Tempo:
+            {
+                const auto bpm = static_cast<float> (std::clamp (std::round (static_cast<double> (command.value)), MIN_BPM, MAX_BPM));
+                engineBpm = bpm;
+                updateTimingInfo();
+                pushTempoToParameter (bpm);
+                break;
+            }
+
+            case RemoteCommand::Type::Play:
+                remotePlayState = command.value > 0.5f ? 1 : 0;
+                requestedPlayState.store (remotePlayState, std::memory_order_release);
+                parameterUpdatePending.store (true, std::memory_order_release);
+                break;
+
+            case RemoteCommand::Type::Tap:
+                handleTap (toSampleClock (command.timeMs, blockStartSample, blockStartMs), blockStartSample);
+                break;
+
+            case RemoteCommand::Type::Meter:
+                settings.beatsPerBar = juce::jlimit (1, 16, juce::roundToInt (command.value));
+                if (command.argument == 1 || command.argument == 2 || command.argument == 4 || command.argument == 8)
+                    settings.beatDenominator = command.argument;
+                settingsChanged = true;
+                break;
+
+            case RemoteCommand::Type::Subdivision:
+                settings.subdivision = static_cast<Subdivision> (juce::jlimit (0, static_cast<int> (Subdivision::Count) - 1, juce::roundToInt (command.value)));
+                settingsChanged = true;
+                break;
+
+            case RemoteCommand::Type::Mute:
+            {
+                const auto beat = juce::roundToInt (command.value);
+                if (beat < 0 || beat >= settings.beatsPerBar)
+                    break;
+
+                const auto bit = 1u << beat;
+                const auto muted = command.argument < 0 ? !settings.isBeatMuted (beat) : command.argument == 1;
+                settings.mutedBeats = muted ? (settings.mutedBeats | bit) : (settings.mutedBeats & ~bit);
+                settingsChanged = true;
+                break;
+            }
+        }
+    }
+
+    if (settingsChanged)
+        adoptRemoteSettings (settings);
+}
+
+void MetronomeAudioProcessor::adoptRemoteSettings (EngineSnapshot settings)
+{
+    // The BPM parameter is set along with the others: make it an echo of the engine tempo
+    settings.bpm = std::round (engineBpm.load());
+    if (std::abs (settings.bpm - lastParameterBpm) > 0.01f)
+        pushedBpm = settings.bpm;
+
+    const auto denominatorChanged = settings.beatDenominator != activeSettings.beatDenominator;
+    activeSettings = settings;
+    settingsRevision.fetch_add (1, std::memory_order_release);
+
+    if (denominatorChanged)
+        updateTimingInfo();
+
+    // Like an adopted preset: the parameters follow on the message thread and are held off until then
+    remoteSettings.publish (settings);
+    remoteSettingsPending.store (true, std::memory_order_release);
+    adoptedPrograms.fetch_add (1, std::memory_order_release);
+    parameterUpdatePending.store (true, std::memory_order_release);
+}
+
+//==============================================================================
+// Session Recording
+//==============================================================================
+bool MetronomeAudioProcessor::startSessionRecording (const juce::File& file)
+{
+    juce::MemoryBlock initialState;
+    getStateInformation (initialState);
+
+    if (!sessionRecorder.start (file, initialState))
+        return false;
+
+    juce::Logger::writeToLog ("BeatIt session log: " + file.getFullPathName());
+    return true;
+}
+
+void MetronomeAudioProcessor::recordSessionState()
+{
+    // Presets and the imported groove are only in the state
+    if (!sessionRecorder.isRecording())
+        return;
+
+    juce::MemoryBlock stateData;
+    getStateInformation (stateData);
+    sessionRecorder.recordState (std::move (stateData));
+}
 
 //==============================================================================
 // Editor
@@ -560,144 +1547,124 @@ juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 //==============================================================================
 void MetronomeAudioProcessor::processTapTempo()
 {
-    tapTempoCalculator.tap();
-    double newBpm = tapTempoCalculator.calculateBPM();
+    // Only the timestamp is taken here; the audio thread does the rest on its own clock
+    queueTap (juce::Time::getMillisecondCounterHiRes());
+    updateTimerRate (true);
+}
 
-    // Round to nearest integer BPM
-    newBpm = std::round (newBpm);
+void MetronomeAudioProcessor::queueTap (double timeMs)
+{
+    tapFifo.write (1).forEach ([this, timeMs] (int index) {
+        pendingTapTimes[static_cast<size_t> (index)] = timeMs;
+    });
+}
 
-    // Clamp BPM to valid range
-    newBpm = std::clamp (newBpm, MIN_BPM, MAX_BPM);
+void MetronomeAudioProcessor::processPendingTaps (const juce::MidiBuffer& midiMessages,
+    int64_t blockStartSample,
+    double blockStartMs)
+{
+    // Taps from the message thread happened before this block: map them onto the sample clock
+    tapFifo.read (tapFifo.getNumReady()).forEach ([&] (int index) {
+        const auto timeMs = pendingTapTimes[static_cast<size_t> (index)];
+        sessionRecorder.recordTap (timeMs);
+        handleTap (toSampleClock (timeMs, blockStartSample, blockStartMs), blockStartSample);
+    });
+
+    // MIDI note-ons are sample accurate
+    for (const auto metadata : midiMessages)
+    {
+        if (metadata.getMessage().isNoteOn())
+            handleTap (blockStartSample + metadata.samplePosition, blockStartSample);
+    }
+}
 
-    // Update BPM parameter
-    float normalizedBpm = static_cast<float> (state->getParameter ("bpm")->convertTo0to1 (newBpm));
-    state->getParameter ("bpm")->setValueNotifyingHost (normalizedBpm);
+int64_t MetronomeAudioProcessor::toSampleClock (double timeMs, int64_t blockStartSample, double blockStartMs) const
+{
+    return blockStartSample + static_cast<int64_t> (std::llround ((timeMs - blockStartMs) * currentSampleRate / 1000.0));
 }
 
-/**
- * Process click timing based on current subdivision
- * @param subdivision Current subdivision type
- * @param currentPosition Position in the current beat (in samples)
- * @param isRest Output parameter indicating if current position is a rest
- * @return true if a click should be triggered at this position
- */
-bool MetronomeAudioProcessor::processSubdivisionClick (Subdivision subdivision,
-    int currentPosition,
-    bool& isRest)
+void MetronomeAudioProcessor::handleTap (int64_t tapSample, int64_t blockStartSample)
 {
-    isRest = false; // By default, not a rest
+    if (!tapTempoCalculator.tap (tapSample))
+        return;
 
-    switch (subdivision)
-    {
-        case Subdivision::NoSubdivision:
-            return false;
+    // Round to nearest integer BPM and clamp to valid range
+    const auto newBpm = static_cast<float> (std::clamp (std::round (tapTempoCalculator.calculateBPM()), MIN_BPM, MAX_BPM));
 
-        case Subdivision::Half: // Two equal notes
-            return (currentPosition == samplesPerBeat / 2);
+    engineBpm = newBpm;
+    updateTimingInfo();
 
-        case Subdivision::HalfAndRest: // Note + Rest
-            if (currentPosition == samplesPerBeat / 2)
-            {
-                isRest = true; // This is the rest
-                return true; // Always return true, sound selection handled in processSample
-            }
-            return false;
+    // Phase-align: the last tapped beat is on the grid, so place the block start relative to it,
+    // rendering ahead by the lead
+    const auto samplesPerBeat = clickEngine.getBeatLength();
+    if (const auto lastBeat = tapTempoCalculator.getLastBeatPosition(); lastBeat.has_value() && samplesPerBeat > 0)
+    {
+        const auto elapsed = static_cast<int64_t> (std::llround (static_cast<double> (blockStartSample) - *lastBeat)) + clickEngine.getLead();
+        const auto position = elapsed % samplesPerBeat;
+        clickEngine.setBeatPosition (static_cast<int> (position < 0 ? position + samplesPerBeat : position));
+    }
 
-        case Subdivision::RestHalf: // Rest + Note
-            if (currentPosition == 0)
-            {
-                isRest = true;
-                return true;
-            }
-            return (currentPosition == samplesPerBeat / 2);
+    pushTempoToParameter (newBpm);
+}
 
-        case Subdivision::Triplet: // Three equal notes
-        {
-            int tripletInterval = samplesPerBeat / 3;
-            return (currentPosition == tripletInterval || currentPosition == tripletInterval * 2);
-        }
+void MetronomeAudioProcessor::pushTempoToParameter (float bpm)
+{
+    // The BPM parameter is an integer: only push when its value would change
+    const auto rounded = std::round (bpm);
+    if (std::abs (rounded - lastParameterBpm) < 0.01f || std::abs (rounded - pushedBpm) < 0.01f)
+        return;
 
-        case Subdivision::RestHalfHalfTriplet: // Rest + Two Notes (triplet)
-        {
-            int tripletInterval = samplesPerBeat / 3;
-            if (currentPosition == 0)
-            {
-                isRest = true;
-                return true;
-            }
-            return (currentPosition == tripletInterval || currentPosition == tripletInterval * 2);
-        }
+    // Update BPM parameter from the message thread
+    pushedBpm = rounded;
+    requestedBpm = rounded;
+    parameterUpdatePending.store (true, std::memory_order_release);
+}
 
-        case Subdivision::HalfRestHalfTriplet: // Note + Rest + Note (triplet)
-        {
-            int tripletInterval = samplesPerBeat / 3;
-            if (currentPosition == tripletInterval)
-            {
-                isRest = true;
-                return true;
-            }
-            return currentPosition == tripletInterval * 2;
-        }
+void MetronomeAudioProcessor::timerCallback()
+{
+#if JucePlugin_Build_Standalone
+    // Only the Standalone application knows the device it plays through
+    if (wrapperType == wrapperType_Standalone && getLatencyMode() == LatencyMode::Device)
+        if (auto* holder = juce::StandalonePluginHolder::getInstance())
+            if (auto* device = holder->deviceManager.getCurrentAudioDevice())
+                setDeviceOutputLatency (device->getOutputLatencyInSamples());
+#endif
+
+    updateReportedLatency();
+    updateTimerRate (parameterUpdatePending.load (std::memory_order_acquire));
+    releaseStalePresets();
+
+    if (!parameterUpdatePending.exchange (false, std::memory_order_acq_rel))
+        return;
 
-        case Subdivision::HalfHalfRestTriplet: // Two Notes + Rest (triplet)
-        {
-            int tripletInterval = samplesPerBeat / 3;
-            if (currentPosition == tripletInterval * 2)
-            {
-                isRest = true;
-                return true;
-            }
-            return currentPosition == tripletInterval;
-        }
+    BEATIT_TRACE_SCOPE ("applyParameterChanges");
 
-        case Subdivision::RestHalfRestTriplet: // Rest + Note + Rest (triplet)
-        {
-            int tripletInterval = samplesPerBeat / 3;
-            if (currentPosition == 0 || currentPosition == tripletInterval * 2)
-            {
-                isRest = true;
-                return true;
-            }
-            return currentPosition == tripletInterval;
-        }
+    if (mutedBeatsResizePending.exchange (false, std::memory_order_acq_rel))
+        updateMutedBeatsSize();
 
-        case Subdivision::Quarter: // Four equal notes
-        {
-            int quarterInterval = samplesPerBeat / 4;
-            return (currentPosition == quarterInterval || currentPosition == quarterInterval * 2 || currentPosition == quarterInterval * 3);
-        }
+    if (const auto bpm = requestedBpm.exchange (0.0f); bpm > 0.0f)
+    {
+        auto* bpmParam = state->getParameter ("bpm");
+        float normalizedBpm = static_cast<float> (bpmParam->convertTo0to1 (bpm));
+        bpmParam->setValueNotifyingHost (normalizedBpm);
+    }
 
-        case Subdivision::RestEighthPattern: // Rest + Note + Rest + Note
-        {
-            int quarterInterval = samplesPerBeat / 4;
-            if (currentPosition == 0 || currentPosition == quarterInterval * 2)
-            {
-                isRest = true;
-                return true;
-            }
-            return (currentPosition == quarterInterval || currentPosition == quarterInterval * 3);
-        }
+    if (const auto play = requestedPlayState.exchange (-1); play >= 0)
+        state->getParameter ("play")->setValueNotifyingHost (play > 0 ? 1.0f : 0.0f);
 
-        case Subdivision::EighthEighthQuarter: // Two short + long
-        {
-            int quarterInterval = samplesPerBeat / 4;
-            return (currentPosition == quarterInterval);
-        }
+    // A preset adopted by the engine: make the parameters match, then let them drive again.
+    // The count is read first: any preset it includes has already been handed over.
+    const auto adopted = adoptedPrograms.load (std::memory_order_acquire);
 
-        case Subdivision::QuarterEighthEighth: // Long + two short
-        {
-            int quarterInterval = samplesPerBeat / 4;
-            return (currentPosition == quarterInterval * 2 || currentPosition == quarterInterval * 3);
-        }
+    if (const auto* snapshot = appliedSnapshot.exchange (nullptr, std::memory_order_acq_rel))
+    {
+        applySnapshotToParameters (*snapshot);
+        updateHostDisplay (ChangeDetails().withProgramChanged (true));
+    }
 
-        case Subdivision::EighthQuarterEighth: // Short + long + short
-        {
-            int quarterInterval = samplesPerBeat / 4;
-            return (currentPosition == quarterInterval || currentPosition == quarterInterval * 3);
-        }
+    // Settings changed over OSC after any preset: the latest ones win
+    if (remoteSettingsPending.exchange (false, std::memory_order_acq_rel))
+        applySnapshotToParameters (remoteSettings.read());
 
-        case Subdivision::Count:
-        default:
-            return false;
-    }
-}
\ No newline at end of file
+    settledPrograms.store (adopted, std::memory_order_release);
+}
@@ -1,6 +1,21 @@
 #pragma once
 
+#include "BarCache.h"
+#include "BeatClock.h"
+#include "ClickEngine.h"
+#include "DspLoadMonitor.h"
+#include "EnsembleTracks.h"
+#include "Groove.h"
+#include "LockFreeSnapshot.h"
+#include "OnsetDetector.h"
+#include "OscServer.h"
+#include "PresetBank.h"
+#include "SessionRecorder.h"
+#include "SubdivisionSchedule.h"
 #include "SubdivisionTypes.h"
+#include "TapTempoCalculator.h"
+#include "TempoFollower.h"
+#include "TimingAnalyzer.h"
 #include <juce_audio_processors/juce_audio_processors.h>
 
 #if (MSVC)
@@ -14,105 +29,6 @@
  * @version 0.0.1
  */
 
-/**
- * @brief Calculator for tap tempo functionality
- * 
- * This class handles the tap tempo mechanism by:
- * - Recording intervals between taps
- * - Computing average BPM from these intervals
- * - Handling edge cases (too fast/slow taps)
- * - Auto-resetting after timeout
- */
-class TapTempoCalculator
-{
-public:
-    /**
-     * @brief Process a new tap event
-     * 
-     * Records the time of the tap and calculates the interval from the last tap.
-     * Implements the following rules:
-     * - Ignores intervals shorter than 120ms (> 500 BPM)
-     * - Ignores intervals longer than 2000ms (< 30 BPM)
-     * - Maintains a history of up to 4 intervals
-     * - Auto-resets if no tap received within 2 seconds
-     */
-    void tap()
-    {
-        auto currentTime = juce::Time::getMillisecondCounterHiRes();
-
-        if (!lastTapTime.has_value())
-        {
-            lastTapTime = currentTime;
-            return;
-        }
-
-        // Calculate interval since last tap
-        auto interval = currentTime - *lastTapTime;
-        lastTapTime = currentTime;
-
-        // Ignore taps that would result in BPM outside valid range (30-500 BPM)
-        if (interval < 120.0 || interval > 2000.0)
-        {
-            reset();
-            return;
-        }
-
-        // Add interval to history
-        intervals.push_back (interval);
-
-        // Keep only the last 4 intervals for average calculation
-        if (intervals.size() > 4)
-            intervals.erase (intervals.begin());
-
-        // Reset if no tap received within 2 seconds
-        if (currentTime - *lastTapTime > 2000.0)
-            reset();
-    }
-
-    /**
-     * @brief Calculate the current BPM based on recorded tap intervals
-     * 
-     * Computes the average interval from the recorded tap history and
-     * converts it to BPM (beats per minute).
-     * 
-     * @return double The calculated BPM, defaults to 120.0 if no intervals recorded
-     */
-    double calculateBPM() const
-    {
-        if (intervals.empty())
-            return 120.0;
-
-        // Calculate average interval
-        double averageInterval = 0.0;
-        for (const auto& interval : intervals)
-            averageInterval += interval;
-
-        averageInterval /= static_cast<double>(intervals.size());
-
-        // Convert average interval to BPM (60000ms = 1 minute)
-        return 60000.0 / averageInterval;
-    }
-
-    /**
-     * @brief Reset the tap tempo calculator
-     * 
-     * Clears all recorded intervals and last tap time.
-     * Called when:
-     * - A tap is too fast or too slow
-     * - No tap received within timeout period
-     * - Manual reset is needed
-     */
-    void reset()
-    {
-        intervals.clear();
-        lastTapTime.reset();
-    }
-
-private:
-    std::vector<double> intervals; ///< Storage for inter-tap intervals
-    std::optional<double> lastTapTime; ///< Timestamp of the last tap
-};
-
 /**
  * @class MetronomeAudioProcessor
  * @brief Main processor class for the BeatIt metronome plugin
@@ -122,10 +38,16 @@ private:
  * - Time signature handling and beat processing
  * - Sound generation and playback management
  * - Beat muting capabilities
+ * - Ensemble tracks with their own subdivision, accents, sound, gain and pan
+ * - Swing and groove templates shifting the subdivisions
+ * - Preset bank with program switching at bar boundaries
+ * - Optional OSC remote control and beat broadcast on localhost
+ * - Optional session log of every engine input, replayed bit for bit by SessionReplay
  * - State persistence and configuration management
  */
 class MetronomeAudioProcessor : public juce::AudioProcessor,
-                                public juce::AudioProcessorValueTreeState::Listener
+                                public juce::AudioProcessorValueTreeState::Listener,
+                                private juce::Timer
 {
 public:
     /**
@@ -144,6 +66,37 @@ public:
         Mute /**< Silent click (no sound output) */
     };
 
+    /**
+     * @enum InputMode
+     * @brief What the optional mono input is used for
+     */
+    enum class InputMode {
+        Off, /**< Input ignored */
+        AudioTap, /**< Detected onsets (drum hits) tap the tempo */
+        Follow, /**< The click continuously follows the tempo and phase of the input */
+        Practice /**< Hits on the input are compared with the click for timing feedback */
+    };
+
+    /**
+     * @enum LatencyMode
+     * @brief How the click is rendered ahead of the grid to make up for the output latency
+     */
+    enum class LatencyMode {
+        Manual, /**< Rendered ahead by the click offset only */
+        Device, /**< Rendered ahead by the click offset plus the output latency of the audio device */
+        Host /**< The click offset is reported to the host as latency, for its delay compensation */
+    };
+
+    /**
+     * @enum GrooveMode
+     * @brief Which template moves the subdivisions
+     */
+    enum class GrooveMode {
+        SwingEighths, /**< Swing amount applied to eighth-note pairs */
+        SwingSixteenths, /**< Swing amount applied to sixteenth-note pairs */
+        Imported /**< Groove imported from a MIDI file */
+    };
+
     //==============================================================================
     /** @name Construction and Destruction */
     ///@{
@@ -181,6 +134,26 @@ public:
      * @param midiMessages MIDI messages to process (unused)
      */
     void processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override;
+
+    /**
+     * @brief Processes an incoming audio block in double precision, with the same engine
+     * @param buffer Audio buffer to process
+     * @param midiMessages MIDI messages to process
+     */
+    void processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages) override;
+
+    /**
+     * @brief Tells the host that 64-bit buffers are rendered natively
+     * @return Always true
+     */
+    bool supportsDoublePrecisionProcessing() const override { return true; }
+
+    /**
+     * @brief Checks whether a bus layout is supported
+     * @param layouts The requested layout
+     * @return true for a mono or stereo output with an optional mono input
+     */
+    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
     ///@}
 
     //==============================================================================
@@ -234,9 +207,15 @@ public:
      */
     double getTailLengthSeconds() const override;
 
+    ///@}
+
+    //==============================================================================
+    /** @name Programs */
+    ///@{
+
     /**
      * @brief Gets total number of programs
-     * @return Number of available programs
+     * @return Number of preset slots
      */
     int getNumPrograms() override;
 
@@ -247,7 +226,13 @@ public:
     int getCurrentProgram() override;
 
     /**
-     * @brief Sets current program
+     * @brief Selects a preset
+     *
+     * While playing, the engine switches to the preset at the next bar with a
+     * single pointer exchange; the parameters follow on the message thread.
+     * When stopped, the parameters are updated right away. Selecting an empty
+     * slot only makes it the target of storePreset().
+     *
      * @param index Program index to set
      */
     void setCurrentProgram (int index) override;
@@ -265,6 +250,19 @@ public:
      * @param newName New name to set
      */
     void changeProgramName (int index, const juce::String& newName) override;
+
+    /**
+     * @brief Stores the current settings in a preset slot and selects it
+     * @param index Program index
+     */
+    void storePreset (int index);
+
+    /**
+     * @brief Checks if a preset slot holds settings
+     * @param index Program index
+     * @return true if a preset was stored in the slot
+     */
+    bool hasPreset (int index) const { return presetBank.getSnapshot (index) != nullptr; }
     ///@}
 
     //==============================================================================
@@ -304,16 +302,31 @@ public:
      * @brief Gets current beat position
      * @return Current beat index
      */
-    int getCurrentBeat() const { return currentBeat; }
+    int getCurrentBeat() const { return clickEngine.getCurrentBeat(); }
+
+    /**
+     * @brief Gets the count of settings changes, safe from any thread
+     *
+     * Editors poll it from their timer to refresh after a change, rather than
+     * listening to the processor, which may notify from the audio thread.
+     *
+     * @return A value that moves on with every change of a parameter, mute, program or groove
+     */
+    uint32_t getSettingsRevision() const { return settingsRevision.load (std::memory_order_acquire); }
 
     /**
-     * @brief Saves plugin state
+     * @brief Saves plugin state in the binary format described in StateFormat.h
      * @param destData Memory block for state data
      */
     void getStateInformation (juce::MemoryBlock& destData) override;
 
     /**
      * @brief Restores plugin state
+     *
+     * Binary states are read chunk by chunk, without parsing XML or replacing
+     * the whole parameter tree; states saved as XML by older versions are
+     * still accepted.
+     *
      * @param data Pointer to state data
      * @param sizeInBytes Size of state data
      */
@@ -336,7 +349,13 @@ public:
     ///@{
 
     /**
-     * @brief Handles parameter changes
+     * @brief Counts a change of the settings and flags a change of meter
+     *
+     * Hosts may call it from the audio thread while automating: it only
+     * raises flags, which the audio thread applies at the start of the next
+     * block and the message thread picks up from its timer. It is a real-time
+     * scope, checked like processBlock.
+     *
      * @param parameterID ID of changed parameter
      * @param newValue New parameter value
      */
@@ -412,15 +431,165 @@ public:
     /**
      * @brief Process a tap tempo event
      * 
-     * Handles a new tap tempo event by:
-     * 1. Recording the tap
-     * 2. Calculating new BPM
-     * 3. Updating the BPM parameter if valid
+     * Called from the message thread (Tap button, key press). The tap is
+     * timestamped and queued; the audio thread maps it onto the sample clock,
+     * feeds the tap tempo calculator and, when a new tempo is found, applies it
+     * phase-aligned to the last tap before pushing it to the BPM parameter.
+     * MIDI note-on events are handled the same way, at their sample position.
      */
     void processTapTempo();
     ///@}
 
+    //==============================================================================
+    /** @name Groove */
+    ///@{
+    /**
+     * @brief Imports the groove of a MIDI file (message thread)
+     *
+     * The timing of the notes on a sixteenth-note grid, over one bar of 4/4,
+     * becomes the Imported groove. See GrooveTemplate::fromMidiFile().
+     *
+     * @param midiFile Standard MIDI file
+     * @return false if the file could not be read or holds no notes
+     */
+    bool importGroove (const juce::File& midiFile);
+
+    /**
+     * @brief Sets the Imported groove (message thread)
+     * @param groove The template, handed to the audio thread without locking
+     */
+    void setImportedGroove (const GrooveTemplate& groove);
+
+    /**
+     * @brief Gets the Imported groove (message thread)
+     * @return The template saved with the state
+     */
+    const GrooveTemplate& getImportedGroove() const { return importedGrooveTemplate; }
+    ///@}
+
+    //==============================================================================
+    /** @name Input */
+    ///@{
+    /**
+     * @brief Gets what the audio input is currently used for
+     * @return The selected input mode
+     */
+    InputMode getInputMode() const { return static_cast<InputMode> (static_cast<int> (inputModeParameter->load())); }
+
+    /**
+     * @brief Gets how the output latency is compensated
+     * @return The selected latency mode
+     */
+    LatencyMode getLatencyMode() const { return static_cast<LatencyMode> (static_cast<int> (latencyModeParameter->load())); }
+
+    /**
+     * @brief Sets the output latency of the audio device, used by the Device latency mode
+     *
+     * The Standalone application sets it from its audio device; plugin hosts do
+     * not expose it. Safe from any thread.
+     *
+     * @param numSamples Output latency in samples
+     */
+    void setDeviceOutputLatency (int numSamples) { deviceOutputLatency.store (juce::jmax (0, numSamples)); }
+
+    /**
+     * @brief Gets how far ahead of the grid the click is rendered
+     * @return Lead of the rendered clicks over their nominal positions, in samples (audio thread)
+     */
+    int getTimelineLead() const { return clickEngine.getLead(); }
+
+    /**
+     * @brief Gets the latest timing statistics of the Practice mode
+     *
+     * Must be called from a single reader thread (the message thread).
+     *
+     * @return Statistics published by the audio thread
+     */
+    const TimingStatistics& getTimingStatistics() { return timingSnapshot.read(); }
+    ///@}
+
+    //==============================================================================
+    /** @name DSP Load */
+    ///@{
+    /**
+     * @brief Gets the DSP load statistics of processBlock
+     *
+     * Safe from any thread; the editor overlay and the tests read them.
+     *
+     * @return Load, peaks and load histogram since the last reset
+     */
+    DspLoadStatistics getDspLoadStatistics() const { return dspLoadMonitor.getStatistics(); }
+
+    /**
+     * @brief Clears the DSP load statistics at the next block
+     */
+    void resetDspLoadStatistics() { dspLoadMonitor.reset(); }
+
+    /**
+     * @brief Checks if the last block was copied from the bar cache
+     *
+     * Safe from any thread; the DSP load overlay shows it. See BarCache.
+     *
+     * @return true while the engine plays a cached bar
+     */
+    bool isPlayingCachedBar() const { return playingCachedBar.load (std::memory_order_relaxed); }
+    ///@}
+
+    //==============================================================================
+    /** @name Remote Control */
+    ///@{
+    /**
+     * @brief Starts the OSC server on a localhost UDP port (message thread)
+     *
+     * The Standalone application starts it when BEATIT_OSC_PORT is set. Commands
+     * reach the engine at the next block, through a lock-free queue; the
+     * parameters follow on the message thread. See OscServer for the
+     * addresses.
+     *
+     * @param port UDP port, or 0 for any free port
+     * @return true if the server listens
+     */
+    bool startRemoteControl (int port);
+
+    /**
+     * @brief Gets the port the OSC server listens on
+     * @return The port, -1 if remote control is off
+     */
+    int getRemoteControlPort() const { return oscServer != nullptr ? oscServer->getPort() : -1; }
+    ///@}
+
+    //==============================================================================
+    /** @name Session Recording */
+    ///@{
+    /**
+     * @brief Starts logging every input of the engine to a file (message thread)
+     *
+     * Built with -DBEATIT_SESSION_LOG=ON, the processor starts a session when
+     * the BEATIT_SESSION_LOG environment variable names a file.
+     * Start it before playback: a replay starts from a fresh processor with
+     * the current state. See SessionRecorder and SessionReplay.
+     *
+     * @param file Session log to write, replaced
+     * @return true if the file could be opened
+     */
+    bool startSessionRecording (const juce::File& file);
+
+    /**
+     * @brief Writes the rest of the session log and closes it (message thread)
+     */
+    void stopSessionRecording() { sessionRecorder.stop(); }
+
+    /**
+     * @brief Checks if a session is being logged
+     * @return true while the engine inputs are logged
+     */
+    bool isRecordingSession() const { return sessionRecorder.isRecording(); }
+    ///@}
+
 private:
+    /** @brief Drives the engine from a session log, in place of the host and the other threads */
+    friend class SessionReplay;
+
     //==============================================================================
     /** @name Initialization Methods */
     ///@{
@@ -431,12 +600,92 @@ private:
     void initializeMutedBeats();
     ///@}
 
+    /** @name State Restoration */
+    ///@{
+    void setBinaryState (const void* data, int sizeInBytes);
+    void setLegacyXmlState (const void* data, int sizeInBytes);
+    ///@}
+
+    /** @name Presets */
+    ///@{
+    EngineSnapshot captureSnapshot() const;
+    void applySnapshotToParameters (const EngineSnapshot& snapshot);
+    void processProgramChanges (const juce::MidiBuffer& midiMessages);
+    void armReplayedProgram (int sample);
+    void applyPendingProgram (int sample);
+    void releaseStalePresets();
+    void syncSettingsFromParameters();
+    void publishMutedBeats();
+    ///@}
+
     /** @name Audio Processing Methods */
     ///@{
-    void processSample (juce::AudioBuffer<float>& buffer, int sample, int totalNumOutputChannels);
-    void generateClickSound (juce::AudioBuffer<float>& buffer, ClickType type);
-    void generateClickWaveform (juce::AudioBuffer<float>& buffer, float frequency, double sampleRate, float durationMs);
-    const juce::AudioBuffer<float>& getSoundBufferForClickType (ClickType type) const;
+    bool isIdle (const juce::MidiBuffer& midiMessages) const;
+    template <typename SampleType>
+    void renderBlock (juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages);
+    template <typename SampleType>
+    void processSample (juce::AudioBuffer<SampleType>& buffer, int sample, int totalNumOutputChannels);
+    template <typename SampleType>
+    void renderEnsembleTracks (juce::AudioBuffer<SampleType>& buffer, int sample, int totalNumOutputChannels);
+    void syncEnsembleTracks();
+    void updateGrooveTable();
+    void applyMeterChange();
+    void broadcastBeat (int sample);
+    ///@}
+
+    /** @name Bar Cache */
+    ///@{
+    void updateBarCacheKey (uint32_t revision, bool singlePrecision, int totalNumOutputChannels);
+    void startCachedBar();
+    void invalidateBarCache();
+    template <typename SampleType>
+    int playCachedBar (juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, int totalNumOutputChannels);
+    ///@}
+
+    /** @name Sound Generation */
+    ///@{
+    void syncClickSettings();
+    ///@}
+
+    /** @name Tap Tempo Processing */
+    ///@{
+    void queueTap (double timeMs);
+    void processPendingTaps (const juce::MidiBuffer& midiMessages, int64_t blockStartSample, double blockStartMs);
+    int64_t toSampleClock (double timeMs, int64_t blockStartSample, double blockStartMs) const;
+    template <typename SampleType>
+    void processInput (const juce::AudioBuffer<SampleType>& buffer, int64_t blockStartSample);
+    void analyseInput (InputMode inputMode, const float* samples, int numSamples, int64_t firstSample, int64_t blockStartSample);
+    void handleTap (int64_t tapSample, int64_t blockStartSample);
+    void pushTempoToParameter (float bpm);
+    void timerCallback() override;
+    bool isIdle() const;
+    void updateTimerRate (bool active);
+    ///@}
+
+    /** @name Tempo Following */
+    ///@{
+    void followTempo (int numSamples);
+    void steerPhase (int64_t onset, int64_t blockStartSample);
+    int64_t getNextClickSample (int64_t blockStartSample) const;
+    ///@}
+
+    /** @name Remote Control */
+    ///@{
+    bool isEnginePlaying() const { return remotePlayState >= 0 ? remotePlayState > 0 : getPlayState(); }
+    void processRemoteCommands (int64_t blockStartSample, double blockStartMs);
+    void adoptRemoteSettings (EngineSnapshot settings);
+    ///@}
+
+    /** @name Session Recording */
+    ///@{
+    void recordSessionState();
+    ///@}
+
+    /** @name Latency Compensation */
+    ///@{
+    int computeTimelineLead() const;
+    void updateTimelineLead (bool playing);
+    void updateReportedLatency();
     ///@}
 
     //==============================================================================
@@ -449,33 +698,33 @@ private:
     std::atomic<float>* beatDenominatorParameter = nullptr;
     std::atomic<float>* firstBeatSoundParameter = nullptr;
     std::atomic<float>* otherBeatsSoundParameter = nullptr;
+    std::atomic<float>* inputModeParameter = nullptr;
+    std::atomic<float>* latencyModeParameter = nullptr;
+    std::atomic<float>* clickOffsetParameter = nullptr;
     ///@}
 
     //==============================================================================
-    /** @name Audio Buffers */
+    /** @name Click Sounds */
     ///@{
-    juce::AudioBuffer<float> highClickBuffer;
-    juce::AudioBuffer<float> lowClickBuffer;
-    juce::AudioBuffer<float> muteBuffer;
+    /** @brief Sounds, voice and beat timeline of the main click, moved by the groove and the lead (audio thread) */
+    ClickEngine clickEngine;
     std::map<juce::String, ClickType> soundTypeMap;
     ///@}
 
     //==============================================================================
     /** @name Playback State */
     ///@{
-    int currentBeat = 0;
-    int samplesPerBeat = 0;
+    /** @brief Play state of the previous block (audio thread) */
+    bool wasPlaying = false;
     double currentSampleRate = 44100.0;
-    /** @brief Position in the current beat */
-    int soundPosition = 0;
-    /** @brief Position in the current click sound */
-    int clickPosition = 0;
     ///@}
 
     //==============================================================================
     /** @name Beat Management */
     ///@{
-    std::vector<bool> mutedBeats;
+    std::vector<bool> mutedBeats; ///< Muted beats (message thread); the audio thread reads mutedBeatMask
+    std::atomic<bool> meterChanged { false }; ///< Meter parameter changed, not yet applied by the audio thread
+    std::atomic<bool> mutedBeatsResizePending { false }; ///< Meter parameter changed, mutedBeats not yet resized
     ///@}
 
     //==============================================================================
@@ -488,34 +737,163 @@ private:
     std::vector<float> currentSubdivisionTimings;
     ///@}
 
+    //==============================================================================
+    /** @name Ensemble Tracks */
+    ///@{
+    /** @brief Parameters of one ensemble track */
+    struct TrackParameters
+    {
+        std::atomic<float>* enabled = nullptr;
+        std::atomic<float>* subdivision = nullptr;
+        std::atomic<float>* sound = nullptr;
+        std::atomic<float>* accent = nullptr;
+        std::atomic<float>* gain = nullptr;
+        std::atomic<float>* pan = nullptr;
+    };
+
+    std::array<TrackParameters, EnsembleTracks::maxTracks> trackParameters {};
+    EnsembleTracks ensembleTracks; ///< Settings and playback state of the tracks (audio thread)
+    ///@}
+
+    //==============================================================================
+    /** @name Groove */
+    ///@{
+    std::atomic<float>* grooveParameter = nullptr;
+    std::atomic<float>* swingParameter = nullptr;
+    GrooveTable grooveTable; ///< Subdivision offsets of the current groove and tempo (audio thread)
+    GrooveTemplate importedGrooveTemplate; ///< Imported groove, as saved with the state (message thread)
+    LockFreeSnapshot<GrooveTemplate> importedGroove; ///< Imported groove handed to the audio thread
+    std::atomic<uint32_t> importedGrooveRevision { 0 }; ///< Incremented with every imported groove
+    /** @brief What the groove table was compiled from (audio thread) */
+    struct CompiledGroove
+    {
+        int mode = -1;
+        float swing = 0.0f;
+        uint32_t revision = 0;
+        double samplesPerBeat = 0.0;
+        int beatDenominator = 0; ///< Grooves are defined per quarter note
+
+        bool operator== (const CompiledGroove&) const = default;
+    };
+    CompiledGroove compiledGroove;
+    ///@}
+
     //==============================================================================
     /** @name Tap Tempo */
-    TapTempoCalculator tapTempoCalculator; ///< Calculator for tap tempo functionality
+    TapTempoCalculator tapTempoCalculator; ///< Calculator for tap tempo functionality (audio thread)
+    juce::AbstractFifo tapFifo { 32 }; ///< Taps queued by the message thread
+    std::array<double, 32> pendingTapTimes {}; ///< Millisecond timestamps of the queued taps
+    std::atomic<float> requestedBpm { 0.0f }; ///< Tempo found by the audio thread, pushed to the BPM parameter
+    /** @brief Set by the audio thread when values (tempo, play state, preset, remote settings) wait for the message thread */
+    std::atomic<bool> parameterUpdatePending { false };
+    int numIdleTicks = 0; ///< Timer ticks with nothing to do, the timer slows down after a second of them (message thread)
+    const juce::Thread::ThreadID messageThreadId = juce::Thread::getCurrentThreadId(); ///< Thread that created the processor
+    OnsetDetector onsetDetector; ///< Turns hits on the mono input into taps
+    TempoFollower tempoFollower; ///< Tracks the tempo of the input in Follow mode
+    TimingAnalyzer timingAnalyzer; ///< Compares hits on the input with the click in Practice mode
+    LockFreeSnapshot<TimingStatistics> timingSnapshot; ///< Practice statistics handed to the editor
+    InputMode lastInputMode = InputMode::Off; ///< Input mode of the previous block (audio thread)
+    std::array<float, 256> inputConversionBuffer {}; ///< Single-precision copy of a double-precision input, a chunk at a time
     ///@}
 
     //==============================================================================
-    /** @name Subdivision */
+    /** @name DSP Load */
+    ///@{
+    DspLoadMonitor dspLoadMonitor; ///< Rendering time of each block against its deadline
+    ///@}
 
-    /**
-     * @brief Process click timing based on current subdivision
-     * @param subdivision Current subdivision type
-     * @param samplesPerBeat Number of samples per beat
-     * @param soundPosition Current position in beat
-     * @return true if a click should be triggered
-     */
-    bool processSubdivisionClick(Subdivision subdivision,
-                               int soundPosition,
+    //==============================================================================
+    /** @name Bar Cache */
+    ///@{
+    /** @brief Everything rendered bars depend on; the cache is dropped when it changes */
+    struct BarCacheKey
+    {
+        uint32_t revision = 0; ///< settingsRevision the bars are rendered with
+        double samplesPerBeat = 0.0;
+        int timelineLead = 0;
+        int numChannels = 1; ///< Distinct output channels
+        bool eligible = false; ///< Nothing needs the clicks one by one
+
+        bool operator== (const BarCacheKey&) const = default;
+    };
 
-        bool& isRest);
+    BarCache barCache; ///< Last steady loop of bars, copied while the key does not change (audio thread)
+    BarCacheKey barCacheKey; ///< Configuration of the cached loop (audio thread)
+    int cachedLoopLength = 0; ///< Samples in the loop of bars for barCacheKey, 0 if it cannot be cached (audio thread)
+    std::atomic<bool> playingCachedBar { false }; ///< The last block was copied from the cache
+    ///@}
 
+    //==============================================================================
+    /** @name Engine Clock */
+    ///@{
+    /** @brief Samples processed since the processor was created (audio thread) */
+    int64_t sampleClock = 0;
+    /** @brief Position of the first sample of the block being rendered */
+    int64_t renderBlockStart = 0;
+    /** @brief Time at which the block being rendered started, on the high-resolution millisecond counter */
+    double renderBlockStartMs = 0.0;
+    /** @brief Output latency of the audio device, for the Device latency mode */
+    std::atomic<int> deviceOutputLatency { 0 };
+    /** @brief Tempo the engine runs at, which may lead the BPM parameter after a tap */
+    std::atomic<float> engineBpm { 120.0f };
+    /** @brief Last BPM parameter value seen by the audio thread */
+    float lastParameterBpm = 0.0f;
+    /** @brief Tempo pushed to the BPM parameter and not yet reflected by it, 0 if none */
+    float pushedBpm = 0.0f;
+    /** @brief Settings the engine renders with (audio thread); the tempo is engineBpm */
+    EngineSnapshot activeSettings;
+    ///@}
+
+    //==============================================================================
+    /** @name Presets */
+    ///@{
+    PresetBank presetBank;
+    std::atomic<int> currentProgram { 0 };
+    /** @brief Preset to switch to at the next bar, set by setCurrentProgram or a MIDI program change */
+    std::atomic<const EngineSnapshot*> pendingSnapshot { nullptr };
+    /** @brief Preset adopted by the engine, waiting to be copied to the parameters */
+    std::atomic<const EngineSnapshot*> appliedSnapshot { nullptr };
+    /** @brief Presets adopted by the engine; the parameters are held off while it differs from settledPrograms */
+    std::atomic<uint32_t> adoptedPrograms { 0 };
+    /** @brief Presets copied to the parameters by the message thread */
+    std::atomic<uint32_t> settledPrograms { 0 };
+    /** @brief Muted beats as a bitmask, readable by the audio thread */
+    std::atomic<uint32_t> mutedBeatMask { 0 };
+    /** @brief Incremented after every change of the settings: parameters, mutes, programs, grooves (any thread) */
+    std::atomic<uint32_t> settingsRevision { 0 };
+    ///@}
+
+    //==============================================================================
+    /** @name Remote Control */
+    ///@{
+    std::unique_ptr<OscServer> oscServer; ///< Created on the message thread, destroyed with the processor
+    std::atomic<OscServer*> remoteControl { nullptr }; ///< The server, once listening (audio thread)
+    /** @brief Play state set over OSC and not yet reflected by the play parameter, -1 if none (audio thread) */
+    int remotePlayState = -1;
+    /** @brief Play state to copy to the play parameter, -1 if none */
+    std::atomic<int> requestedPlayState { -1 };
+    /** @brief Settings changed over OSC and adopted by the engine, waiting to be copied to the parameters */
+    LockFreeSnapshot<EngineSnapshot> remoteSettings;
+    std::atomic<bool> remoteSettingsPending { false };
+    ///@}
+
+    //==============================================================================
+    /** @name Session Recording */
+    ///@{
+    SessionRecorder sessionRecorder;
+    /** @brief Every parameter value, in the order of getParameters(), as the session log refers to them */
+    std::vector<std::atomic<float>*> sessionParameters;
+    /** @brief Start time of the next block set by a replay, negative to read the clock */
+    double replayBlockStartMs = -1.0;
+    /** @brief Preset a replay adopts in the next block, on the sample where the session did */
+    const EngineSnapshot* replayProgramSnapshot = nullptr;
+    int replayProgramSample = -1; ///< Sample of the next block adopting replayProgramSnapshot
     ///@}
 
     
     //==============================================================================
     /** @name Rest Sound */
-    juce::AudioBuffer<float> restSoundBuffer;
     std::atomic<float>* restSoundParameter = nullptr;
-    bool currentClickIsRest = false;
     ///@}
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MetronomeAudioProcessor)
 };
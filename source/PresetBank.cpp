@@ -0,0 +1,133 @@
+#include "PresetBank.h"
+#include <algorithm>
+
+namespace
+{
+    // Ranges of the choice parameters a snapshot decodes
+    constexpr int MAX_BEATS_PER_BAR = 16;
+    constexpr int NUM_BEAT_SOUNDS = 3; // High, Low, Mute
+    constexpr int NUM_REST_SOUNDS = 3; // Same as beat, Rest sound, Mute
+
+    bool isBeatUnit (int denominator)
+    {
+        return denominator == 1 || denominator == 2 || denominator == 4 || denominator == 8;
+    }
+}
+
+void PresetBank::store (int index, const juce::String& name, const EngineSnapshot& snapshot)
+{
+    if (!isValidIndex (index))
+        return;
+
+    const auto slot = static_cast<size_t> (index);
+    auto newSnapshot = std::make_unique<const EngineSnapshot> (snapshot);
+
+    snapshots[slot].store (newSnapshot.get(), std::memory_order_release);
+    retire (slot);
+
+    ownedSnapshots[slot] = std::move (newSnapshot);
+    names[slot] = name;
+}
+
+const EngineSnapshot* PresetBank::getSnapshot (int index) const
+{
+    if (!isValidIndex (index))
+        return nullptr;
+
+    return snapshots[static_cast<size_t> (index)].load (std::memory_order_acquire);
+}
+
+void PresetBank::releaseRetiredSnapshots (std::initializer_list<const EngineSnapshot*> inUse)
+{
+    std::erase_if (retired, [inUse] (const auto& entry) {
+        return std::find (inUse.begin(), inUse.end(), entry.snapshot.get()) == inUse.end();
+    });
+}
+
+void PresetBank::releaseStaleSnapshots (std::initializer_list<const EngineSnapshot*> inUse)
+{
+    // A block started after the replacement has read the new slot; the one before it is over
+    const auto numBlocks = numStartedBlocks.load (std::memory_order_acquire);
+
+    std::erase_if (retired, [inUse, numBlocks] (const auto& entry) {
+        return entry.retiredAt < numBlocks && std::find (inUse.begin(), inUse.end(), entry.snapshot.get()) == inUse.end();
+    });
+}
+
+void PresetBank::retire (size_t slot)
+{
+    // Counted with a read-modify-write: the next block to start is ordered after the slot was replaced
+    if (ownedSnapshots[slot] != nullptr)
+        retired.push_back ({ std::move (ownedSnapshots[slot]), numStartedBlocks.fetch_add (0, std::memory_order_acq_rel) });
+}
+
+juce::String PresetBank::getName (int index) const
+{
+    return isValidIndex (index) ? names[static_cast<size_t> (index)] : juce::String();
+}
+
+void PresetBank::setName (int index, const juce::String& name)
+{
+    if (isValidIndex (index))
+        names[static_cast<size_t> (index)] = name;
+}
+
+void PresetBank::writeTo (juce::OutputStream& stream) const
+{
+    int numStored = 0;
+    for (const auto& snapshot : ownedSnapshots)
+        numStored += snapshot != nullptr ? 1 : 0;
+
+    stream.writeInt (numStored);
+
+    for (int index = 0; index < numPresets; ++index)
+    {
+        const auto* snapshot = ownedSnapshots[static_cast<size_t> (index)].get();
+        if (snapshot == nullptr)
+            continue;
+
+        stream.writeInt (index);
+        stream.writeString (names[static_cast<size_t> (index)]);
+        stream.writeFloat (snapshot->bpm);
+        stream.writeInt (snapshot->beatsPerBar);
+        stream.writeInt (snapshot->beatDenominator);
+        stream.writeInt (static_cast<int> (snapshot->subdivision));
+        stream.writeInt (snapshot->firstBeatSound);
+        stream.writeInt (snapshot->otherBeatsSound);
+        stream.writeInt (snapshot->restSound);
+        stream.writeInt (static_cast<int> (snapshot->mutedBeats));
+    }
+}
+
+void PresetBank::readFrom (juce::InputStream& stream)
+{
+    for (size_t slot = 0; slot < ownedSnapshots.size(); ++slot)
+    {
+        snapshots[slot].store (nullptr, std::memory_order_release);
+        retire (slot);
+        names[slot].clear();
+    }
+
+    const auto numStored = stream.readInt();
+    for (int i = 0; i < numStored && !stream.isExhausted(); ++i)
+    {
+        const auto index = stream.readInt();
+        const auto name = stream.readString();
+
+        EngineSnapshot snapshot;
+        snapshot.bpm = stream.readFloat();
+        snapshot.beatsPerBar = juce::jlimit (1, MAX_BEATS_PER_BAR, stream.readInt());
+
+        // A damaged or foreign state must not reach the beat grid or the synth
+        if (const auto denominator = stream.readInt(); isBeatUnit (denominator))
+            snapshot.beatDenominator = denominator;
+
+        snapshot.subdivision = static_cast<Subdivision> (juce::jlimit (0, SubdivisionCount - 1, stream.readInt()));
+        snapshot.firstBeatSound = juce::jlimit (0, NUM_BEAT_SOUNDS - 1, stream.readInt());
+        snapshot.otherBeatsSound = juce::jlimit (0, NUM_BEAT_SOUNDS - 1, stream.readInt());
+        snapshot.restSound = juce::jlimit (0, NUM_REST_SOUNDS - 1, stream.readInt());
+        snapshot.mutedBeats = static_cast<uint32_t> (stream.readInt());
+
+        store (index, name, snapshot);
+    }
+}
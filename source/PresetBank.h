@@ -0,0 +1,152 @@
+#pragma once
+
+#include "SubdivisionTypes.h"
+#include <array>
+#include <atomic>
+#include <initializer_list>
+#include <juce_core/juce_core.h>
+#include <memory>
+#include <vector>
+
+/**
+ * @file PresetBank.h
+ * @brief User presets compiled into immutable engine snapshots
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ */
+
+/**
+ * @brief Everything the engine needs to play one preset
+ *
+ * Values are already decoded from the parameters (beat count, beat unit,
+ * choice indices, mute bitmask) so the audio thread only copies a few words
+ * when it adopts a snapshot.
+ */
+struct EngineSnapshot
+{
+    float bpm = 120.0f; ///< Tempo in BPM
+    int beatsPerBar = 4; ///< Time signature numerator
+    int beatDenominator = 4; ///< Beat unit (1, 2, 4 or 8)
+    Subdivision subdivision = Subdivision::NoSubdivision; ///< Subdivision pattern of each beat
+    int firstBeatSound = 0; ///< Index of the first beat sound choice
+    int otherBeatsSound = 1; ///< Index of the other beats sound choice
+    int restSound = 0; ///< Index of the rest sound choice
+    uint32_t mutedBeats = 0; ///< One bit per muted beat
+
+    /**
+     * @brief Checks if a beat is muted
+     * @param beat Beat index in the bar
+     * @return true if the beat is muted
+     */
+    bool isBeatMuted (int beat) const { return beat >= 0 && beat < 32 && ((mutedBeats >> beat) & 1u) != 0; }
+
+    bool operator== (const EngineSnapshot&) const = default;
+};
+
+/**
+ * @class PresetBank
+ * @brief Fixed set of preset slots, each holding an immutable snapshot
+ *
+ * Slots are edited on the message thread only. The audio thread reads slot
+ * pointers at any time: a snapshot is never modified once published, and a
+ * replaced snapshot stays alive until the audio thread cannot hold it: once
+ * the block that may have read it is over (releaseStaleSnapshots()), or when
+ * resources are released (releaseRetiredSnapshots()).
+ */
+class PresetBank
+{
+public:
+    /** @brief Number of preset slots, also the number of host programs */
+    static constexpr int numPresets = 16;
+
+    /**
+     * @brief Stores a snapshot in a slot (message thread)
+     * @param index Slot index
+     * @param name Preset name
+     * @param snapshot Settings to store
+     */
+    void store (int index, const juce::String& name, const EngineSnapshot& snapshot);
+
+    /**
+     * @brief Gets the snapshot of a slot (any thread)
+     * @param index Slot index
+     * @return The snapshot, or nullptr for an empty or invalid slot
+     */
+    const EngineSnapshot* getSnapshot (int index) const;
+
+    /**
+     * @brief Gets the name of a slot
+     * @param index Slot index
+     * @return Preset name, empty for an unnamed slot
+     */
+    juce::String getName (int index) const;
+
+    /**
+     * @brief Renames a slot (message thread)
+     * @param index Slot index
+     * @param name New name
+     */
+    void setName (int index, const juce::String& name);
+
+    /**
+     * @brief Frees the snapshots replaced since the last call
+     *
+     * Only call this while the audio thread is not processing. Snapshots the
+     * caller still points to (a preset waiting for its bar, or one waiting
+     * to be copied to the parameters) are kept for a later call.
+     *
+     * @param inUse Snapshots that must stay alive
+     */
+    void releaseRetiredSnapshots (std::initializer_list<const EngineSnapshot*> inUse = {});
+
+    /**
+     * @brief Frees the replaced snapshots no audio block can still be reading (message thread)
+     *
+     * Safe while the audio thread is processing: a snapshot is freed once a
+     * block has started after it was replaced, unless the caller still points
+     * to it.
+     *
+     * @param inUse Snapshots that must stay alive
+     */
+    void releaseStaleSnapshots (std::initializer_list<const EngineSnapshot*> inUse);
+
+    /**
+     * @brief Marks the start of an audio block (audio thread)
+     */
+    void startBlock() noexcept { numStartedBlocks.fetch_add (1, std::memory_order_acq_rel); }
+
+    /**
+     * @brief Gets the number of replaced snapshots not freed yet
+     * @return Number of retired snapshots
+     */
+    size_t getNumRetiredSnapshots() const { return retired.size(); }
+
+    /**
+     * @brief Writes the stored presets
+     * @param stream Destination stream
+     */
+    void writeTo (juce::OutputStream& stream) const;
+
+    /**
+     * @brief Replaces every slot with presets read from a stream (message thread)
+     * @param stream Source stream, as written by writeTo()
+     */
+    void readFrom (juce::InputStream& stream);
+
+private:
+    /** @brief A replaced snapshot, with the number of blocks started when it was replaced */
+    struct RetiredSnapshot
+    {
+        std::unique_ptr<const EngineSnapshot> snapshot;
+        uint64_t retiredAt = 0;
+    };
+
+    static bool isValidIndex (int index) { return index >= 0 && index < numPresets; }
+    void retire (size_t slot);
+
+    std::array<std::atomic<const EngineSnapshot*>, numPresets> snapshots {}; ///< Published slots, read by the audio thread
+    std::array<std::unique_ptr<const EngineSnapshot>, numPresets> ownedSnapshots; ///< Owners of the published slots
+    std::array<juce::String, numPresets> names;
+    std::vector<RetiredSnapshot> retired; ///< Replaced snapshots the audio thread may still hold
+    std::atomic<uint64_t> numStartedBlocks { 0 };
+};
@@ -0,0 +1,197 @@
+#include "RealtimeSafety.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if BEATIT_REALTIME_CHECKS && (JUCE_LINUX || JUCE_BSD)
+    #include <dlfcn.h>
+    #include <pthread.h>
+#endif
+
+#if JUCE_MSVC
+    #include <intrin.h>
+    #define BEATIT_RETURN_ADDRESS() _ReturnAddress()
+#else
+    #define BEATIT_RETURN_ADDRESS() __builtin_return_address (0)
+#endif
+
+namespace
+{
+    thread_local const char* currentScope = nullptr; ///< Innermost real-time scope of this thread
+    thread_local bool isReporting = false; ///< Set while the handler runs, which may allocate
+
+    std::atomic<RealtimeSafety::ViolationHandler> violationHandler { nullptr };
+
+    const char* getTypeName (RealtimeSafety::ViolationType type)
+    {
+        switch (type)
+        {
+            case RealtimeSafety::ViolationType::Allocation:
+                return "allocation";
+            case RealtimeSafety::ViolationType::Deallocation:
+                return "deallocation";
+            case RealtimeSafety::ViolationType::Lock:
+                return "lock";
+        }
+
+        return "violation";
+    }
+
+    void logViolation (const RealtimeSafety::Violation& violation)
+    {
+        juce::Logger::writeToLog (juce::String ("Real-time ") + getTypeName (violation.type)
+                                  + " in " + violation.scope + ":\n" + violation.callStack);
+        jassertfalse;
+    }
+}
+
+namespace RealtimeSafety
+{
+    void setViolationHandler (ViolationHandler handler)
+    {
+        violationHandler = handler;
+    }
+
+    bool isInRealtimeScope()
+    {
+        return currentScope != nullptr;
+    }
+
+    void checkViolation (ViolationType type, const void* caller)
+    {
+        if (currentScope == nullptr || isReporting)
+            return;
+
+        isReporting = true;
+
+        // Scoped so that the call stack is freed before reporting is re-enabled
+        {
+            Violation violation;
+            violation.type = type;
+            violation.scope = currentScope;
+            violation.caller = caller;
+            violation.callStack = juce::SystemStats::getStackBacktrace();
+
+            const auto handler = violationHandler.load();
+            (handler != nullptr ? handler : logViolation) (violation);
+        }
+
+        isReporting = false;
+    }
+
+    ScopedRealtime::ScopedRealtime (const char* name)
+        : previousName (currentScope)
+    {
+        currentScope = name;
+    }
+
+    ScopedRealtime::~ScopedRealtime()
+    {
+        currentScope = previousName;
+    }
+}
+
+#if BEATIT_REALTIME_CHECKS
+
+//==============================================================================
+// Global allocation functions
+//==============================================================================
+namespace
+{
+    void* allocate (std::size_t size, const void* caller)
+    {
+        RealtimeSafety::checkViolation (RealtimeSafety::ViolationType::Allocation, caller);
+        return std::malloc (size == 0 ? 1 : size);
+    }
+
+    void* allocateAligned (std::size_t size, std::align_val_t alignment, const void* caller)
+    {
+        RealtimeSafety::checkViolation (RealtimeSafety::ViolationType::Allocation, caller);
+        const auto align = static_cast<std::size_t> (alignment);
+        const auto roundedSize = ((size == 0 ? 1 : size) + align - 1) / align * align;
+
+    #if JUCE_MSVC
+        return _aligned_malloc (roundedSize, align);
+    #else
+        return std::aligned_alloc (align, roundedSize);
+    #endif
+    }
+
+    void release (void* pointer, const void* caller)
+    {
+        if (pointer == nullptr)
+            return;
+
+        RealtimeSafety::checkViolation (RealtimeSafety::ViolationType::Deallocation, caller);
+        std::free (pointer);
+    }
+
+    void releaseAligned (void* pointer, const void* caller)
+    {
+        if (pointer == nullptr)
+            return;
+
+        RealtimeSafety::checkViolation (RealtimeSafety::ViolationType::Deallocation, caller);
+
+    #if JUCE_MSVC
+        _aligned_free (pointer);
+    #else
+        std::free (pointer);
+    #endif
+    }
+
+    template <typename Pointer>
+    Pointer throwIfNull (Pointer pointer)
+    {
+        if (pointer == nullptr)
+            throw std::bad_alloc();
+
+        return pointer;
+    }
+}
+
+void* operator new (std::size_t size) { return throwIfNull (allocate (size, BEATIT_RETURN_ADDRESS())); }
+void* operator new[] (std::size_t size) { return throwIfNull (allocate (size, BEATIT_RETURN_ADDRESS())); }
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept { return allocate (size, BEATIT_RETURN_ADDRESS()); }
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept { return allocate (size, BEATIT_RETURN_ADDRESS()); }
+void* operator new (std::size_t size, std::align_val_t alignment) { return throwIfNull (allocateAligned (size, alignment, BEATIT_RETURN_ADDRESS())); }
+void* operator new[] (std::size_t size, std::align_val_t alignment) { return throwIfNull (allocateAligned (size, alignment, BEATIT_RETURN_ADDRESS())); }
+void* operator new (std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocateAligned (size, alignment, BEATIT_RETURN_ADDRESS()); }
+void* operator new[] (std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocateAligned (size, alignment, BEATIT_RETURN_ADDRESS()); }
+
+void operator delete (void* pointer) noexcept { release (pointer, BEATIT_RETURN_ADDRESS()); }
+void operator delete[] (void* pointer) noexcept { release (pointer, BEATIT_RETURN_ADDRESS()); }
+void operator delete (void* pointer, std::size_t) noexcept { release (pointer, BEATIT_RETURN_ADDRESS()); }
+void operator delete[] (void* pointer, std::size_t) noexcept { release (pointer, BEATIT_RETURN_ADDRESS()); }
+void operator delete (void* pointer, const std::nothrow_t&) noexcept { release (pointer, BEATIT_RETURN_ADDRESS()); }
+void operator delete[] (void* pointer, const std::nothrow_t&) noexcept { release (pointer, BEATIT_RETURN_ADDRESS()); }
+void operator delete (void* pointer, std::align_val_t) noexcept { releaseAligned (pointer, BEATIT_RETURN_ADDRESS()); }
+void operator delete[] (void* pointer, std::align_val_t) noexcept { releaseAligned (pointer, BEATIT_RETURN_ADDRESS()); }
+void operator delete (void* pointer, std::size_t, std::align_val_t) noexcept { releaseAligned (pointer, BEATIT_RETURN_ADDRESS()); }
+void operator delete[] (void* pointer, std::size_t, std::align_val_t) noexcept { releaseAligned (pointer, BEATIT_RETURN_ADDRESS()); }
+void operator delete (void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { releaseAligned (pointer, BEATIT_RETURN_ADDRESS()); }
+void operator delete[] (void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { releaseAligned (pointer, BEATIT_RETURN_ADDRESS()); }
+
+//==============================================================================
+// Mutex acquisition (std::mutex, juce::CriticalSection... end up here on Linux and BSD)
+//==============================================================================
+    #if JUCE_LINUX || JUCE_BSD
+extern "C" int pthread_mutex_lock (pthread_mutex_t* mutex)
+{
+    using LockFunction = int (*) (pthread_mutex_t*);
+
+    // Constant-initialised: no static guard, which could itself take a mutex
+    static std::atomic<LockFunction> realLock { nullptr };
+    auto lock = realLock.load (std::memory_order_acquire);
+    if (lock == nullptr)
+    {
+        lock = reinterpret_cast<LockFunction> (dlsym (RTLD_NEXT, "pthread_mutex_lock"));
+        realLock.store (lock, std::memory_order_release);
+    }
+
+    RealtimeSafety::checkViolation (RealtimeSafety::ViolationType::Lock, BEATIT_RETURN_ADDRESS());
+    return lock (mutex);
+}
+    #endif
+
+#endif
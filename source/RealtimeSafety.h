@@ -0,0 +1,95 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+/**
+ * @file RealtimeSafety.h
+ * @brief Detection of allocations and locks on the audio thread
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ *
+ * When BEATIT_REALTIME_CHECKS is enabled (tests, or Debug builds configured
+ * with -DBEATIT_REALTIME_CHECKS=ON), BEATIT_REALTIME_SCOPE marks a function as
+ * real-time. Global operator new/delete and, on Linux and BSD,
+ * pthread_mutex_lock are intercepted; any call made inside a real-time scope
+ * is reported with its call site. Otherwise the macro expands to nothing and
+ * nothing is intercepted.
+ */
+namespace RealtimeSafety
+{
+    /**
+     * @enum ViolationType
+     * @brief What was done on the real-time thread
+     */
+    enum class ViolationType {
+        Allocation, /**< operator new */
+        Deallocation, /**< operator delete */
+        Lock /**< Blocking mutex acquisition */
+    };
+
+    /**
+     * @brief A forbidden call inside a real-time scope
+     */
+    struct Violation
+    {
+        ViolationType type = ViolationType::Allocation;
+        const char* scope = nullptr; ///< Name of the innermost real-time scope
+        const void* caller = nullptr; ///< Return address of the intercepted call
+        juce::String callStack; ///< Stack trace at the violation
+    };
+
+    /** @brief Receives violations; called outside of any real-time check */
+    using ViolationHandler = void (*) (const Violation&);
+
+    /**
+     * @brief Replaces the violation handler
+     *
+     * The default handler logs the violation and asserts.
+     *
+     * @param handler New handler, or nullptr to restore the default one
+     */
+    void setViolationHandler (ViolationHandler handler);
+
+    /**
+     * @brief Checks whether the calling thread is inside a real-time scope
+     * @return true inside a BEATIT_REALTIME_SCOPE
+     */
+    bool isInRealtimeScope();
+
+    /**
+     * @brief Reports a violation if the calling thread is inside a real-time scope
+     * @param type What was done
+     * @param caller Return address of the intercepted call
+     */
+    void checkViolation (ViolationType type, const void* caller);
+
+    /**
+     * @class ScopedRealtime
+     * @brief Marks the calling thread as real-time for its lifetime
+     */
+    class ScopedRealtime
+    {
+    public:
+        /**
+         * @brief Enters a real-time scope
+         * @param name Name reported with violations (a string literal)
+         */
+        explicit ScopedRealtime (const char* name);
+
+        /**
+         * @brief Leaves the real-time scope
+         */
+        ~ScopedRealtime();
+
+    private:
+        const char* previousName;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedRealtime)
+    };
+}
+
+#if BEATIT_REALTIME_CHECKS
+    #define BEATIT_REALTIME_SCOPE(name) const RealtimeSafety::ScopedRealtime beatItRealtimeScope (name)
+#else
+    #define BEATIT_REALTIME_SCOPE(name)
+#endif
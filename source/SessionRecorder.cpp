@@ -0,0 +1,335 @@
+#include "SessionRecorder.h"
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    // Room for a few seconds of records with the input logged, drained every FLUSH_INTERVAL_MS
+    constexpr int QUEUE_SIZE = 1 << 22;
+    constexpr int FLUSH_INTERVAL_MS = 20;
+
+    // Record type, then payload size
+    constexpr size_t HEADER_SIZE = sizeof (uint8_t) + sizeof (uint32_t);
+}
+
+SessionRecorder::SessionRecorder() : juce::Thread ("BeatIt session writer")
+{
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    stop();
+}
+
+//==============================================================================
+// Message Thread
+//==============================================================================
+bool SessionRecorder::start (const juce::File& file, const juce::MemoryBlock& initialState)
+{
+    stop();
+
+    file.deleteFile();
+    stream = std::make_unique<juce::FileOutputStream> (file);
+    if (!stream->openedOk())
+    {
+        stream.reset();
+        return false;
+    }
+
+    if (queueData == nullptr)
+    {
+        queueData.allocate (QUEUE_SIZE, false);
+        drained.allocate (QUEUE_SIZE, false);
+        queue.setTotalSize (QUEUE_SIZE);
+    }
+
+    // Whatever a previous session left in the queue belongs to it
+    queue.finishedRead (queue.getNumReady());
+
+    {
+        const juce::ScopedLock lock (stateLock);
+        states.clear();
+    }
+
+    stream->writeInt (magic);
+    stream->writeInt (version);
+    writeRecord (static_cast<uint8_t> (RecordType::State), initialState.getData(), initialState.getSize());
+
+    sessionStartState.store (latestState.load());
+    droppedRecords = 0;
+    overflowWritten = false;
+    session.fetch_add (1, std::memory_order_release);
+    recording.store (true, std::memory_order_release);
+    startThread();
+    return true;
+}
+
+void SessionRecorder::stop()
+{
+    recording.store (false, std::memory_order_release);
+    stopThread (1000);
+
+    if (stream != nullptr)
+    {
+        drain();
+        writeRecord (static_cast<uint8_t> (RecordType::End), nullptr, 0);
+        stream.reset();
+    }
+}
+
+void SessionRecorder::recordState (juce::MemoryBlock stateData)
+{
+    if (!isRecording())
+        return;
+
+    const juce::ScopedLock lock (stateLock);
+    states[++numStates] = std::move (stateData);
+    latestState.store (numStates, std::memory_order_release);
+}
+
+void SessionRecorder::recordPrepare (double sampleRate, int blockSize, int numInputChannels, int numOutputChannels, bool doublePrecision)
+{
+    if (!isRecording())
+        return;
+
+    pushValues (RecordType::Prepare,
+        sampleRate,
+        static_cast<int32_t> (blockSize),
+        static_cast<int32_t> (numInputChannels),
+        static_cast<int32_t> (numOutputChannels),
+        static_cast<uint8_t> (doublePrecision ? 1 : 0));
+}
+
+//==============================================================================
+// Audio Thread
+//==============================================================================
+bool SessionRecorder::beginBlock()
+{
+    blockRecording = recording.load (std::memory_order_acquire);
+    if (!blockRecording)
+        return false;
+
+    // First block of a session: every value is logged once
+    if (const auto current = session.load (std::memory_order_acquire); current != blockSession)
+    {
+        blockSession = current;
+        loggedState = sessionStartState.load (std::memory_order_relaxed);
+        lastParameters.fill (std::numeric_limits<float>::quiet_NaN());
+        lastMutedBeats = -1;
+        lastSettledPrograms = -1;
+        lastDeviceLatency = -1;
+    }
+
+    // The state itself stays with the writer thread, which logs it in place of its number
+    if (const auto state = latestState.load (std::memory_order_acquire); state != loggedState)
+    {
+        loggedState = state;
+        push (static_cast<RecordType> (stateMarker), &state, sizeof (state));
+    }
+
+    return true;
+}
+
+void SessionRecorder::recordParameters (std::span<std::atomic<float>* const> values)
+{
+    if (!isBlockRecorded())
+        return;
+
+    jassert (values.size() <= lastParameters.size());
+
+    for (size_t index = 0; index < values.size() && index < lastParameters.size(); ++index)
+    {
+        const auto value = values[index]->load (std::memory_order_relaxed);
+
+        // Bitwise, so that the first value (against NaN) and signed zeros are logged
+        if (std::memcmp (&value, &lastParameters[index], sizeof (value)) != 0)
+        {
+            lastParameters[index] = value;
+            pushValues (RecordType::Parameter, static_cast<int32_t> (index), value);
+        }
+    }
+}
+
+void SessionRecorder::recordMutedBeats (uint32_t mask)
+{
+    if (isBlockRecorded() && static_cast<int64_t> (mask) != lastMutedBeats)
+    {
+        lastMutedBeats = mask;
+        pushValues (RecordType::MutedBeats, mask);
+    }
+}
+
+void SessionRecorder::recordSettledPrograms (uint32_t count)
+{
+    if (isBlockRecorded() && static_cast<int64_t> (count) != lastSettledPrograms)
+    {
+        lastSettledPrograms = count;
+        pushValues (RecordType::SettledPrograms, count);
+    }
+}
+
+void SessionRecorder::recordDeviceLatency (int numSamples)
+{
+    if (isBlockRecorded() && numSamples != lastDeviceLatency)
+    {
+        lastDeviceLatency = numSamples;
+        pushValues (RecordType::DeviceLatency, static_cast<int32_t> (numSamples));
+    }
+}
+
+void SessionRecorder::recordTap (double timeMs)
+{
+    if (isBlockRecorded())
+        pushValues (RecordType::Tap, timeMs);
+}
+
+void SessionRecorder::recordProgram (int index, int sample)
+{
+    if (isBlockRecorded())
+        pushValues (RecordType::Program, static_cast<int32_t> (index), static_cast<int32_t> (sample));
+}
+
+void SessionRecorder::recordRemoteCommand (const RemoteCommand& command)
+{
+    if (isBlockRecorded())
+        pushValues (RecordType::RemoteCommand, static_cast<int32_t> (command.type), command.value, static_cast<int32_t> (command.argument), command.timeMs);
+}
+
+void SessionRecorder::recordMidi (const juce::MidiBuffer& midiMessages)
+{
+    if (!isBlockRecorded())
+        return;
+
+    for (const auto metadata : midiMessages)
+    {
+        const auto samplePosition = static_cast<int32_t> (metadata.samplePosition);
+        push (RecordType::Midi, &samplePosition, sizeof (samplePosition), metadata.data, static_cast<size_t> (metadata.numBytes));
+    }
+}
+
+void SessionRecorder::recordPlayHead (juce::AudioPlayHead* playHead)
+{
+    if (!isBlockRecorded() || playHead == nullptr)
+        return;
+
+    const auto position = playHead->getPosition();
+    if (!position.hasValue())
+        return;
+
+    const auto bpm = position->getBpm();
+    const auto ppq = position->getPpqPosition();
+    const auto time = position->getTimeInSamples();
+
+    const auto flags = static_cast<uint8_t> ((position->getIsPlaying() ? 1 : 0)
+                                             | (bpm.hasValue() ? 2 : 0)
+                                             | (ppq.hasValue() ? 4 : 0)
+                                             | (time.hasValue() ? 8 : 0));
+
+    pushValues (RecordType::PlayHead, flags, bpm.orFallback (0.0), ppq.orFallback (0.0), static_cast<int64_t> (time.orFallback (0)));
+}
+
+bool SessionRecorder::push (RecordType type, const void* payload, size_t size, const void* extra, size_t extraSize)
+{
+    // After a loss the log can no longer be replayed: it ends there
+    if (droppedRecords.load (std::memory_order_relaxed) > 0)
+        return false;
+
+    const auto recordSize = HEADER_SIZE + size + extraSize;
+
+    int start1, size1, start2, size2;
+    queue.prepareToWrite (static_cast<int> (recordSize), start1, size1, start2, size2);
+
+    if (static_cast<size_t> (size1 + size2) < recordSize)
+    {
+        droppedRecords.fetch_add (1, std::memory_order_relaxed);
+        return false;
+    }
+
+    const auto recordType = static_cast<uint8_t> (type);
+    const auto payloadSize = static_cast<uint32_t> (size + extraSize);
+
+    // Whole records only: the writer thread never sees a partial one
+    auto position = start1;
+    copyToQueue (position, &recordType, sizeof (recordType));
+    copyToQueue (position, &payloadSize, sizeof (payloadSize));
+    copyToQueue (position, payload, size);
+    copyToQueue (position, extra, extraSize);
+
+    queue.finishedWrite (static_cast<int> (recordSize));
+    return true;
+}
+
+void SessionRecorder::copyToQueue (int& position, const void* source, size_t size)
+{
+    if (size == 0)
+        return;
+
+    const auto first = std::min (size, static_cast<size_t> (QUEUE_SIZE - position));
+    std::memcpy (queueData + position, source, first);
+    std::memcpy (queueData.get(), static_cast<const uint8_t*> (source) + first, size - first);
+    position = static_cast<int> ((static_cast<size_t> (position) + size) % QUEUE_SIZE);
+}
+
+//==============================================================================
+// Writer Thread
+//==============================================================================
+void SessionRecorder::run()
+{
+    while (!threadShouldExit())
+    {
+        drain();
+        wait (FLUSH_INTERVAL_MS);
+    }
+}
+
+void SessionRecorder::drain()
+{
+    int start1, size1, start2, size2;
+    queue.prepareToRead (queue.getNumReady(), start1, size1, start2, size2);
+    std::memcpy (drained.get(), queueData + start1, static_cast<size_t> (size1));
+    std::memcpy (drained + size1, queueData.get(), static_cast<size_t> (size2));
+    queue.finishedRead (size1 + size2);
+
+    for (size_t position = 0; position < static_cast<size_t> (size1 + size2);)
+    {
+        const auto type = drained[position];
+        uint32_t size = 0;
+        std::memcpy (&size, drained + position + sizeof (type), sizeof (size));
+        const auto* payload = drained + position + HEADER_SIZE;
+        position += HEADER_SIZE + size;
+
+        if (type != stateMarker)
+        {
+            writeRecord (type, payload, size);
+            continue;
+        }
+
+        uint32_t state = 0;
+        std::memcpy (&state, payload, sizeof (state));
+
+        const juce::ScopedLock lock (stateLock);
+        if (const auto found = states.find (state); found != states.end())
+            writeRecord (static_cast<uint8_t> (RecordType::State), found->second.getData(), found->second.getSize());
+
+        // Older states were replaced before the audio thread saw them
+        states.erase (states.begin(), states.upper_bound (state));
+    }
+
+    if (const auto dropped = droppedRecords.load (std::memory_order_relaxed); dropped > 0 && !overflowWritten)
+    {
+        overflowWritten = true;
+        writeRecord (static_cast<uint8_t> (RecordType::Overflow), &dropped, sizeof (dropped));
+        recording.store (false, std::memory_order_release);
+    }
+
+    stream->flush();
+}
+
+void SessionRecorder::writeRecord (uint8_t type, const void* payload, size_t size)
+{
+    stream->writeByte (static_cast<char> (type));
+    stream->writeInt (static_cast<int> (size));
+
+    if (size > 0)
+        stream->write (payload, size);
+}
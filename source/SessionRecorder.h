@@ -0,0 +1,344 @@
+#pragma once
+
+#include "OscServer.h"
+#include "StateFormat.h"
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <map>
+#include <span>
+
+/**
+ * @file SessionRecorder.h
+ * @brief Compact binary log of every input of the engine, for an exact replay
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ *
+ * Layout (integers written by JUCE streams are little endian, payload values
+ * are in native byte order, little endian on every platform BeatIt builds
+ * for):
+ * - Header: magic "BISL", format version
+ * - Records: type (one byte), payload size in bytes (four bytes), payload
+ *
+ * The records of a block come first, then its Block record; a log that was
+ * stopped cleanly ends with an End record. SessionReplay reads it back into
+ * a fresh processor.
+ */
+
+/**
+ * @class SessionRecorder
+ * @brief Logs what the audio thread reads from the host, the UI and the other threads
+ *
+ * The state of the engine depends on when values set by other threads are
+ * seen by the audio thread: a tap, a beat mute, a preset picked in the
+ * editor, a parameter automated by the host or a tempo sent over OSC. Each
+ * input is therefore logged by the audio thread at the point where it reads
+ * it, with the block it was read in, rather than when it was set. Replaying
+ * the same inputs in the same blocks reproduces the output bit for bit,
+ * whatever the interleaving of the original session.
+ *
+ * Records go into a preallocated lock-free queue, drained into the file by a
+ * background thread every few milliseconds; the audio thread never blocks,
+ * allocates or touches the file. If the queue fills up, the session stops
+ * recording and the log ends with an Overflow record. State changes made on
+ * the message thread (presets stored, state restored, groove imported) are
+ * handed to the writer thread directly and logged in the block in which the
+ * audio thread first runs after them.
+ */
+class SessionRecorder : private juce::Thread
+{
+public:
+    /**
+     * @enum RecordType
+     * @brief Kind of a record, and layout of its payload
+     */
+    enum class RecordType : uint8_t {
+        Prepare = 1, /**< Sample rate (double), block size, input and output channels (int32), double precision (uint8) */
+        State, /**< Plugin state, as saved by getStateInformation() */
+        Parameter, /**< Index in the parameter list (int32), denormalised value (float) */
+        MutedBeats, /**< Beat mute bitmask (uint32) */
+        SettledPrograms, /**< Presets copied to the parameters by the message thread (uint32) */
+        DeviceLatency, /**< Output latency of the audio device, in samples (int32) */
+        Tap, /**< Tap from the message thread, on the millisecond counter (double) */
+        Program, /**< Preset selected by the editor or the host: program index, sample of the block that adopted it (int32) */
+        RemoteCommand, /**< OSC command: type (int32), value (float), argument (int32), arrival time (double) */
+        Midi, /**< Sample position (int32), message bytes */
+        Input, /**< First input channel, in the precision of the block */
+        PlayHead, /**< Flags (uint8: playing, has BPM, has PPQ, has time), BPM, PPQ position (double), time in samples (int64) */
+        Block, /**< Samples, channels (int32), double precision (uint8), first sample (int64), start time (double), output hash (uint64) */
+        Overflow, /**< Records lost to a full queue, after which nothing was recorded (uint64) */
+        End /**< Session stopped: the log is complete (no payload) */
+    };
+
+    static constexpr int magic = StateFormat::makeTag ("BISL");
+    static constexpr int version = 2;
+
+    /** @brief Largest number of parameters whose changes are logged */
+    static constexpr int maxParameters = 128;
+
+    SessionRecorder();
+    ~SessionRecorder() override;
+
+    /** @name Message Thread */
+    ///@{
+
+    /**
+     * @brief Starts a session, replacing the file
+     * @param file Log to write
+     * @param initialState State of the processor, from which the session is replayed
+     * @return true if the file could be opened
+     */
+    bool start (const juce::File& file, const juce::MemoryBlock& initialState);
+
+    /**
+     * @brief Writes the remaining records and closes the file
+     */
+    void stop();
+
+    /**
+     * @brief Checks if a session is recording
+     * @return true between start() and stop(), unless the queue overflowed
+     */
+    bool isRecording() const { return recording.load (std::memory_order_acquire); }
+
+    /**
+     * @brief Logs a new state of the processor, replacing any not yet seen by the audio thread
+     * @param stateData State, as saved by getStateInformation()
+     */
+    void recordState (juce::MemoryBlock stateData);
+
+    /**
+     * @brief Logs a sample rate or layout change, while no block is being processed
+     * @param sampleRate Sample rate in Hz
+     * @param blockSize Largest block size announced by the host
+     * @param numInputChannels Input channels of the processor
+     * @param numOutputChannels Output channels of the processor
+     * @param doublePrecision true if blocks are processed in double precision
+     */
+    void recordPrepare (double sampleRate, int blockSize, int numInputChannels, int numOutputChannels, bool doublePrecision);
+    ///@}
+
+    /** @name Audio Thread */
+    ///@{
+
+    /**
+     * @brief Starts logging a block; the other calls do nothing outside a logged block
+     * @return true if the block is logged
+     */
+    bool beginBlock();
+
+    /**
+     * @brief Logs the parameters that changed since the previous block
+     * @param values Denormalised values, in the order of the parameter list
+     */
+    void recordParameters (std::span<std::atomic<float>* const> values);
+
+    /**
+     * @brief Logs the beat mutes read by the engine, if they changed
+     * @param mask Beat mute bitmask
+     */
+    void recordMutedBeats (uint32_t mask);
+
+    /**
+     * @brief Logs the number of presets settled by the message thread, if it changed
+     * @param count Presets copied to the parameters so far
+     */
+    void recordSettledPrograms (uint32_t count);
+
+    /**
+     * @brief Logs the output latency of the device, if it changed
+     * @param numSamples Latency in samples
+     */
+    void recordDeviceLatency (int numSamples);
+
+    /**
+     * @brief Logs a tap from the message thread, as it is taken from the queue
+     * @param timeMs Time of the tap, on the millisecond counter
+     */
+    void recordTap (double timeMs);
+
+    /**
+     * @brief Logs a preset adopted by the engine
+     * @param index Program index
+     * @param sample Sample of the block on which the engine adopted it
+     */
+    void recordProgram (int index, int sample);
+
+    /**
+     * @brief Logs an OSC command, as it is taken from the queue
+     * @param command The command
+     */
+    void recordRemoteCommand (const RemoteCommand& command);
+
+    /**
+     * @brief Logs the MIDI events of the block
+     * @param midiMessages Events sent by the host
+     */
+    void recordMidi (const juce::MidiBuffer& midiMessages);
+
+    /**
+     * @brief Logs the position reported by the host, if it reports one
+     * @param playHead Play head of the processor, may be null
+     */
+    void recordPlayHead (juce::AudioPlayHead* playHead);
+
+    /**
+     * @brief Logs the first input channel, before the block is processed
+     * @param buffer Buffer passed by the host
+     */
+    template <typename SampleType>
+    void recordInput (const juce::AudioBuffer<SampleType>& buffer)
+    {
+        if (isBlockRecorded() && buffer.getNumChannels() > 0)
+            push (RecordType::Input, buffer.getReadPointer (0), sizeof (SampleType) * static_cast<size_t> (buffer.getNumSamples()));
+    }
+
+    /**
+     * @brief Ends the block with its size, timestamps and output hash
+     * @param buffer Processed buffer
+     * @param blockStartSample Engine clock at the first sample of the block
+     * @param blockStartMs Millisecond counter when the block started
+     */
+    template <typename SampleType>
+    void endBlock (const juce::AudioBuffer<SampleType>& buffer, int64_t blockStartSample, double blockStartMs)
+    {
+        if (!isBlockRecorded())
+            return;
+
+        pushValues (RecordType::Block,
+            static_cast<int32_t> (buffer.getNumSamples()),
+            static_cast<int32_t> (buffer.getNumChannels()),
+            static_cast<uint8_t> (std::is_same_v<SampleType, double> ? 1 : 0),
+            blockStartSample,
+            blockStartMs,
+            hashOutput (buffer));
+
+        blockRecording = false;
+    }
+    ///@}
+
+    /**
+     * @brief Hashes the samples of a buffer (64-bit FNV-1a of their bytes)
+     * @param buffer Buffer to hash
+     * @return Hash of every channel, equal only for bit-identical buffers (barring collisions)
+     */
+    template <typename SampleType>
+    static uint64_t hashOutput (const juce::AudioBuffer<SampleType>& buffer)
+    {
+        auto hash = fnvOffsetBasis;
+
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        {
+            const auto* bytes = reinterpret_cast<const uint8_t*> (buffer.getReadPointer (channel));
+            const auto numBytes = sizeof (SampleType) * static_cast<size_t> (buffer.getNumSamples());
+
+            for (size_t i = 0; i < numBytes; ++i)
+                hash = (hash ^ bytes[i]) * fnvPrime;
+        }
+
+        return hash;
+    }
+
+    /**
+     * @class ScopedBlock
+     * @brief Logs a block for its lifetime, ending it on every return path (audio thread)
+     */
+    template <typename SampleType>
+    class ScopedBlock
+    {
+    public:
+        ScopedBlock (SessionRecorder& recorderToUse, const juce::AudioBuffer<SampleType>& blockBuffer, int64_t startSample, double startMs)
+            : recorder (recorderToUse), buffer (blockBuffer), blockStartSample (startSample), blockStartMs (startMs), recording (recorder.beginBlock())
+        {
+        }
+
+        ~ScopedBlock()
+        {
+            if (recording)
+                recorder.endBlock (buffer, blockStartSample, blockStartMs);
+        }
+
+        /**
+         * @brief Checks if the block is logged
+         * @return true while a session records
+         */
+        bool isRecording() const { return recording; }
+
+    private:
+        SessionRecorder& recorder;
+        const juce::AudioBuffer<SampleType>& buffer;
+        const int64_t blockStartSample;
+        const double blockStartMs;
+        const bool recording;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedBlock)
+    };
+
+private:
+    static constexpr uint64_t fnvOffsetBasis = 14695981039346656037ull;
+    static constexpr uint64_t fnvPrime = 1099511628211ull;
+
+    /** @brief Logged in place of a state, which the writer thread substitutes */
+    static constexpr uint8_t stateMarker = 0xff;
+
+    bool isBlockRecorded() const
+    {
+        // A session stopped or restarted during the block: the rest of it belongs to no log
+        return blockRecording && recording.load (std::memory_order_relaxed) && session.load (std::memory_order_relaxed) == blockSession;
+    }
+
+    void run() override;
+    void drain();
+    void writeRecord (uint8_t type, const void* payload, size_t size);
+    bool push (RecordType type, const void* payload, size_t size, const void* extra = nullptr, size_t extraSize = 0);
+    void copyToQueue (int& position, const void* source, size_t size);
+
+    template <typename... Values>
+    void pushValues (RecordType type, const Values&... values)
+    {
+        std::array<uint8_t, (sizeof (Values) + ...)> payload;
+        size_t offset = 0;
+        ((std::memcpy (payload.data() + offset, &values, sizeof (Values)), offset += sizeof (Values)), ...);
+        push (type, payload.data(), payload.size());
+    }
+
+    /** @name Writer Thread */
+    ///@{
+    std::unique_ptr<juce::FileOutputStream> stream;
+    juce::HeapBlock<uint8_t> drained; ///< Records taken from the queue
+    bool overflowWritten = false;
+    ///@}
+
+    /** @name Queue */
+    ///@{
+    juce::AbstractFifo queue { 1 }; ///< Audio thread to writer thread, sized on the first start()
+    juce::HeapBlock<uint8_t> queueData; ///< Allocated once, kept for the life of the recorder
+    std::atomic<bool> recording { false };
+    std::atomic<uint32_t> session { 0 }; ///< Incremented by every start()
+    std::atomic<uint64_t> droppedRecords { 0 };
+    ///@}
+
+    /** @name States */
+    ///@{
+    juce::CriticalSection stateLock; ///< Message thread and writer thread only
+    std::map<uint32_t, juce::MemoryBlock> states; ///< States not yet written, by number
+    uint32_t numStates = 0; ///< States recorded so far (message thread)
+    std::atomic<uint32_t> latestState { 0 }; ///< Number of the latest state
+    std::atomic<uint32_t> sessionStartState { 0 }; ///< Latest state when the session started, in the log header
+    ///@}
+
+    /** @name Audio Thread */
+    ///@{
+    bool blockRecording = false;
+    uint32_t blockSession = 0; ///< Session of the logged block
+    uint32_t loggedState = 0; ///< Number of the latest state logged
+    /** @brief Last values logged in the session; NaN or -1 until the first one */
+    std::array<float, maxParameters> lastParameters {};
+    int64_t lastMutedBeats = -1;
+    int64_t lastSettledPrograms = -1;
+    int64_t lastDeviceLatency = -1;
+    ///@}
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SessionRecorder)
+};
@@ -0,0 +1,285 @@
+#include "SessionReplay.h"
+#include "PluginProcessor.h"
+#include "SessionRecorder.h"
+#include <cstring>
+
+namespace
+{
+    using RecordType = SessionRecorder::RecordType;
+
+    /**
+     * Reads the values of a record payload in order
+     */
+    class PayloadReader
+    {
+    public:
+        explicit PayloadReader (const juce::MemoryBlock& payload)
+            : data (static_cast<const uint8_t*> (payload.getData())), size (payload.getSize())
+        {
+        }
+
+        template <typename T>
+        T read()
+        {
+            T value {};
+            if (position + sizeof (T) <= size)
+                std::memcpy (&value, data + position, sizeof (T));
+
+            position += sizeof (T);
+            return value;
+        }
+
+        const uint8_t* getRemainingData() const { return data + position; }
+        size_t getNumRemainingBytes() const { return position < size ? size - position : 0; }
+
+    private:
+        const uint8_t* data;
+        size_t size;
+        size_t position = 0;
+    };
+}
+
+SessionReplay::SessionReplay (MetronomeAudioProcessor& processorToDrive)
+    : processor (processorToDrive)
+{
+}
+
+SessionReplay::~SessionReplay()
+{
+    if (drivesRemoteControl)
+        processor.remoteControl.store (previousRemoteControl, std::memory_order_release);
+}
+
+SessionReplay::Result SessionReplay::replay (juce::InputStream& log)
+{
+    Result result;
+
+    if (log.readInt() != SessionRecorder::magic || log.readInt() != SessionRecorder::version)
+    {
+        result.error = "Not a BeatIt session log, or from another version";
+        return result;
+    }
+
+    BlockInputs inputs;
+    juce::MemoryBlock payload;
+
+    while (!log.isExhausted())
+    {
+        const auto type = static_cast<RecordType> (static_cast<uint8_t> (log.readByte()));
+        const auto size = log.readInt();
+
+        // Cut short: the recording was interrupted
+        if (size < 0)
+            return result;
+
+        payload.setSize (static_cast<size_t> (size));
+        if (size > 0 && log.read (payload.getData(), size) != size)
+            return result;
+
+        PayloadReader reader (payload);
+
+        switch (type)
+        {
+            case RecordType::Prepare:
+            {
+                const auto sampleRate = reader.read<double>();
+                const auto blockSize = reader.read<int32_t>();
+                const auto numInputChannels = reader.read<int32_t>();
+                const auto numOutputChannels = reader.read<int32_t>();
+                prepare (sampleRate, blockSize, numInputChannels, numOutputChannels, reader.read<uint8_t>() != 0);
+                break;
+            }
+
+            case RecordType::State:
+                processor.setStateInformation (payload.getData(), static_cast<int> (payload.getSize()));
+                break;
+
+            case RecordType::Parameter:
+            {
+                const auto index = reader.read<int32_t>();
+                inputs.parameters.emplace_back (index, reader.read<float>());
+                break;
+            }
+
+            case RecordType::MutedBeats:
+                inputs.mutedBeats = reader.read<uint32_t>();
+                break;
+
+            case RecordType::SettledPrograms:
+                inputs.settledPrograms = reader.read<uint32_t>();
+                break;
+
+            case RecordType::DeviceLatency:
+                inputs.deviceLatency = reader.read<int32_t>();
+                break;
+
+            case RecordType::Tap:
+                inputs.taps.push_back (reader.read<double>());
+                break;
+
+            case RecordType::Program:
+            {
+                const auto index = reader.read<int32_t>();
+                inputs.programs.emplace_back (index, reader.read<int32_t>());
+                break;
+            }
+
+            case RecordType::RemoteCommand:
+            {
+                RemoteCommand command;
+                command.type = static_cast<RemoteCommand::Type> (reader.read<int32_t>());
+                command.value = reader.read<float>();
+                command.argument = reader.read<int32_t>();
+                command.timeMs = reader.read<double>();
+                inputs.remoteCommands.push_back (command);
+                break;
+            }
+
+            case RecordType::Midi:
+            {
+                const auto samplePosition = reader.read<int32_t>();
+                inputs.midi.addEvent (reader.getRemainingData(), static_cast<int> (reader.getNumRemainingBytes()), samplePosition);
+                break;
+            }
+
+            case RecordType::Input:
+                inputs.input = payload;
+                break;
+
+            case RecordType::Block:
+            {
+                BlockInfo block;
+                block.numSamples = reader.read<int32_t>();
+                block.numChannels = reader.read<int32_t>();
+                block.doublePrecision = reader.read<uint8_t>() != 0;
+                reader.read<int64_t>(); // Engine clock, for reading the log
+                block.startMs = reader.read<double>();
+                block.outputHash = reader.read<uint64_t>();
+
+                applyInputs (inputs, block);
+                const auto hash = block.doublePrecision ? processBlock<double> (inputs, block)
+                                                        : processBlock<float> (inputs, block);
+
+                if (hash != block.outputHash)
+                {
+                    if (result.numMismatches++ == 0)
+                        result.firstMismatch = result.numBlocks;
+                }
+
+                ++result.numBlocks;
+                inputs = {};
+                break;
+            }
+
+            case RecordType::Overflow:
+                // Nothing was recorded after the loss
+                return result;
+
+            case RecordType::End:
+                result.complete = true;
+                return result;
+
+            case RecordType::PlayHead:
+            default:
+                // The engine does not read the play head; later versions may add records
+                break;
+        }
+    }
+
+    // No End record: the recording was interrupted
+    return result;
+}
+
+void SessionReplay::prepare (double sampleRate, int blockSize, int numInputChannels, int numOutputChannels, bool doublePrecision)
+{
+    processor.setProcessingPrecision (doublePrecision ? juce::AudioProcessor::doublePrecision
+                                                     : juce::AudioProcessor::singlePrecision);
+
+    auto layout = processor.getBusesLayout();
+    layout.getChannelSet (true, 0) = numInputChannels > 0 ? juce::AudioChannelSet::canonicalChannelSet (numInputChannels)
+                                                          : juce::AudioChannelSet::disabled();
+    layout.getChannelSet (false, 0) = juce::AudioChannelSet::canonicalChannelSet (numOutputChannels);
+    processor.setBusesLayout (layout);
+
+    processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+    processor.prepareToPlay (sampleRate, blockSize);
+}
+
+void SessionReplay::applyInputs (const BlockInputs& inputs, const BlockInfo& block)
+{
+    const auto& parameters = processor.getParameters();
+
+    for (const auto& [index, value] : inputs.parameters)
+    {
+        if (index < 0 || index >= parameters.size() || static_cast<size_t> (index) >= processor.sessionParameters.size())
+            continue;
+
+        // Listeners react as they did to the host; the engine then reads the exact value recorded
+        if (auto* parameter = dynamic_cast<juce::RangedAudioParameter*> (parameters[index]))
+            parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+
+        processor.sessionParameters[static_cast<size_t> (index)]->store (value);
+    }
+
+    if (inputs.mutedBeats.has_value())
+    {
+        processor.mutedBeatMask.store (*inputs.mutedBeats, std::memory_order_release);
+        processor.settingsRevision.fetch_add (1, std::memory_order_release);
+    }
+
+    if (inputs.settledPrograms.has_value())
+        processor.settledPrograms.store (*inputs.settledPrograms, std::memory_order_release);
+
+    if (inputs.deviceLatency.has_value())
+        processor.setDeviceOutputLatency (*inputs.deviceLatency);
+
+    for (const auto timeMs : inputs.taps)
+        processor.queueTap (timeMs);
+
+    // A preset is adopted on the sample the session adopted it, whenever it was picked. Bars are
+    // longer than blocks, so a block adopts one at most.
+    processor.replayProgramSnapshot = nullptr;
+    processor.replayProgramSample = -1;
+
+    if (!inputs.programs.empty())
+    {
+        const auto [index, sample] = inputs.programs.back();
+        if (const auto* snapshot = processor.presetBank.getSnapshot (index))
+        {
+            processor.currentProgram = index;
+            processor.replayProgramSnapshot = snapshot;
+            processor.replayProgramSample = sample;
+        }
+    }
+
+    if (!inputs.remoteCommands.empty())
+    {
+        if (!drivesRemoteControl)
+        {
+            previousRemoteControl = processor.remoteControl.exchange (&commandSource, std::memory_order_acq_rel);
+            drivesRemoteControl = true;
+        }
+
+        for (const auto& command : inputs.remoteCommands)
+            commandSource.pushCommand (command);
+    }
+
+    processor.replayBlockStartMs = block.startMs;
+}
+
+template <typename SampleType>
+uint64_t SessionReplay::processBlock (const BlockInputs& inputs, const BlockInfo& block)
+{
+    juce::AudioBuffer<SampleType> buffer (block.numChannels, block.numSamples);
+    buffer.clear();
+
+    // Logged only when the engine reads the input
+    const auto numInputSamples = juce::jmin (block.numSamples, static_cast<int> (inputs.input.getSize() / sizeof (SampleType)));
+    if (numInputSamples > 0 && block.numChannels > 0)
+        buffer.copyFrom (0, 0, static_cast<const SampleType*> (inputs.input.getData()), numInputSamples);
+
+    auto midi = inputs.midi;
+    processor.processBlock (buffer, midi);
+
+    return SessionRecorder::hashOutput (buffer);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "OscServer.h"
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <optional>
+#include <vector>
+
+class MetronomeAudioProcessor;
+
+/**
+ * @file SessionReplay.h
+ * @brief Replays a session log into a processor, checking its output block by block
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ */
+
+/**
+ * @class SessionReplay
+ * @brief Feeds the inputs of a recorded session to a fresh processor, in the blocks that saw them
+ *
+ * Before each block, the replay hands the engine what the audio thread read
+ * in the original block: parameter values, beat mutes, taps and OSC commands
+ * with their original timestamps, presets adopted, the time the block
+ * started and its input. It then processes the block with its MIDI events
+ * and compares the hash of the output with the recorded one. A block that
+ * differs points to the first input the engine does not handle
+ * deterministically.
+ *
+ * The processor must be freshly constructed and is driven from the calling
+ * thread, as if it were the audio thread; its own timer must not run in the
+ * meantime (do not dispatch messages). The host play head is logged for
+ * reference only: the engine does not read it.
+ */
+class SessionReplay
+{
+public:
+    /**
+     * @struct Result
+     * @brief Outcome of a replay
+     */
+    struct Result
+    {
+        int numBlocks = 0; ///< Blocks replayed
+        int numMismatches = 0; ///< Blocks whose output differs from the recorded one
+        int firstMismatch = -1; ///< Index of the first of them, -1 if none
+        bool complete = false; ///< The session was stopped cleanly, without records lost while recording
+        juce::String error; ///< Why the log could not be read, empty if it could
+
+        /**
+         * @brief Checks if the whole session was reproduced
+         * @return true if the log was complete and every block matched
+         */
+        bool reproduced() const { return complete && error.isEmpty() && numMismatches == 0; }
+    };
+
+    /**
+     * @brief Prepares to drive a processor
+     * @param processorToDrive A freshly constructed processor, outliving the replay
+     */
+    explicit SessionReplay (MetronomeAudioProcessor& processorToDrive);
+    ~SessionReplay();
+
+    /**
+     * @brief Replays a session log
+     * @param log Stream positioned at the start of the log
+     * @return What was replayed, and where the output first differed
+     */
+    Result replay (juce::InputStream& log);
+
+private:
+    /** @brief What the audio thread read during a block, applied before replaying it */
+    struct BlockInputs
+    {
+        std::vector<std::pair<int, float>> parameters;
+        std::optional<uint32_t> mutedBeats;
+        std::optional<uint32_t> settledPrograms;
+        std::optional<int> deviceLatency;
+        std::vector<double> taps;
+        std::vector<std::pair<int, int>> programs; ///< Program index, sample adopting it
+        std::vector<RemoteCommand> remoteCommands;
+        juce::MidiBuffer midi;
+        juce::MemoryBlock input;
+    };
+
+    /** @brief Size and timing of a recorded block */
+    struct BlockInfo
+    {
+        int numSamples = 0;
+        int numChannels = 0;
+        bool doublePrecision = false;
+        double startMs = 0.0;
+        uint64_t outputHash = 0;
+    };
+
+    void prepare (double sampleRate, int blockSize, int numInputChannels, int numOutputChannels, bool doublePrecision);
+    void applyInputs (const BlockInputs& inputs, const BlockInfo& block);
+    template <typename SampleType>
+    uint64_t processBlock (const BlockInputs& inputs, const BlockInfo& block);
+
+    MetronomeAudioProcessor& processor;
+    OscServer commandSource; ///< Never started: only queues the recorded commands for the engine
+    OscServer* previousRemoteControl = nullptr; ///< Server the processor had before the first replayed command
+    bool drivesRemoteControl = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SessionReplay)
+};
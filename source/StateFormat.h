@@ -0,0 +1,130 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+/**
+ * @file StateFormat.h
+ * @brief Compact, versioned binary format of the plugin state
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ *
+ * Layout (little endian):
+ * - Header: magic "BITS", format version
+ * - Chunks: four-character tag, payload size in bytes, payload
+ *
+ * Readers skip chunks they do not know, so new data (step grids, accents,
+ * timelines...) can be added as new chunks without breaking older builds,
+ * and older states simply lack the newer chunks.
+ */
+namespace StateFormat
+{
+    /**
+     * @brief Builds a chunk tag from four characters
+     * @param name Four-character name
+     * @return Tag value as stored in the stream
+     */
+    constexpr int makeTag (const char (&name)[5])
+    {
+        return static_cast<int> (static_cast<uint32_t> (static_cast<uint8_t> (name[0]))
+                                 | (static_cast<uint32_t> (static_cast<uint8_t> (name[1])) << 8)
+                                 | (static_cast<uint32_t> (static_cast<uint8_t> (name[2])) << 16)
+                                 | (static_cast<uint32_t> (static_cast<uint8_t> (name[3])) << 24));
+    }
+
+    constexpr int magic = makeTag ("BITS");
+    constexpr int version = 1;
+
+    /** @brief Parameter values: count, then (ID string, denormalised float) pairs */
+    constexpr int parametersTag = makeTag ("PARM");
+    /** @brief Beat mutes: number of beats, then one bit per beat */
+    constexpr int mutedBeatsTag = makeTag ("MUTE");
+    /** @brief Preset bank: current program, then the stored presets (see PresetBank::writeTo) */
+    constexpr int presetsTag = makeTag ("PRST");
+    /** @brief Imported groove template (see GrooveTemplate::writeTo) */
+    constexpr int grooveTag = makeTag ("GROV");
+
+    /**
+     * @brief Writes a binary state, one chunk at a time
+     */
+    class Writer
+    {
+    public:
+        /**
+         * @brief Starts a state in the given block
+         * @param destination Block receiving the state (replaced)
+         */
+        explicit Writer (juce::MemoryBlock& destination)
+            : stream (destination, false)
+        {
+            stream.writeInt (magic);
+            stream.writeInt (version);
+        }
+
+        /**
+         * @brief Appends a chunk
+         * @param tag Chunk tag
+         * @param writePayload Called with a stream receiving the chunk payload
+         */
+        template <typename PayloadWriter>
+        void writeChunk (int tag, PayloadWriter&& writePayload)
+        {
+            juce::MemoryOutputStream payload;
+            writePayload (payload);
+
+            stream.writeInt (tag);
+            stream.writeInt (static_cast<int> (payload.getDataSize()));
+            stream.write (payload.getData(), payload.getDataSize());
+        }
+
+    private:
+        juce::MemoryOutputStream stream;
+    };
+
+    /**
+     * @brief Checks whether a block holds a binary state
+     * @param data Pointer to the state data
+     * @param sizeInBytes Size of the state data
+     * @return true if the data starts with the binary state header
+     */
+    inline bool isBinaryState (const void* data, int sizeInBytes)
+    {
+        return sizeInBytes >= 8 && juce::ByteOrder::littleEndianInt (data) == static_cast<juce::uint32> (magic);
+    }
+
+    /**
+     * @brief Visits every chunk of a binary state
+     * @param data Pointer to the state data
+     * @param sizeInBytes Size of the state data
+     * @param readChunk Called with the tag and a stream over the payload of each chunk
+     * @return false if the data is not a binary state of a supported version
+     */
+    template <typename ChunkReader>
+    bool readChunks (const void* data, int sizeInBytes, ChunkReader&& readChunk)
+    {
+        if (!isBinaryState (data, sizeInBytes))
+            return false;
+
+        juce::MemoryInputStream stream (data, static_cast<size_t> (sizeInBytes), false);
+        stream.readInt(); // magic
+
+        if (stream.readInt() > version)
+            return false;
+
+        while (stream.getNumBytesRemaining() >= 8)
+        {
+            const auto tag = stream.readInt();
+            const auto size = stream.readInt();
+
+            if (size < 0 || size > stream.getNumBytesRemaining())
+                break;
+
+            const auto start = stream.getPosition();
+            juce::MemoryInputStream payload (static_cast<const char*> (data) + start, static_cast<size_t> (size), false);
+            readChunk (tag, payload);
+
+            stream.setPosition (start + size);
+        }
+
+        return true;
+    }
+}
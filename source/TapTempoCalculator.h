@@ -0,0 +1,308 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+/**
+ * @file TapTempoCalculator.h
+ * @brief Tap tempo estimation on the audio sample clock
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ */
+
+/**
+ * @brief Calculator for tap tempo functionality
+ *
+ * This class handles the tap tempo mechanism by:
+ * - Recording tap timestamps, expressed in samples of the audio clock
+ * - Rejecting bounces and taps that do not fit the current pulse
+ * - Fitting a tempo and a beat phase to the accepted taps (least squares)
+ * - Auto-resetting after timeout
+ *
+ * Taps are kept in a fixed-size ring buffer, so tapping never allocates and
+ * the calculator can be driven from the audio thread.
+ */
+class TapTempoCalculator
+{
+public:
+    /** @brief Number of taps kept for the tempo fit */
+    static constexpr size_t maxTaps = 8;
+
+    /**
+     * @brief Sets the sample rate used to interpret tap timestamps
+     * @param newSampleRate Sample rate of the audio clock
+     */
+    void setSampleRate (double newSampleRate)
+    {
+        if (newSampleRate > 0.0 && newSampleRate != sampleRate)
+        {
+            sampleRate = newSampleRate;
+            reset();
+        }
+    }
+
+    /**
+     * @brief Process a new tap event
+     *
+     * Implements the following rules:
+     * - Ignores intervals shorter than 120ms (bounces, > 500 BPM)
+     * - Starts a new sequence after 2000ms without a tap (< 30 BPM)
+     * - Once a pulse is established, accepts taps landing close to one or two
+     *   periods after the previous one (a missed tap does not break the fit)
+     * - Rejects other taps as outliers; two consecutive outliers that agree
+     *   with each other start a new sequence (deliberate tempo change)
+     * - Restarts from the faster pulse when outliers split two consecutive
+     *   intervals evenly (tapping twice as fast lands every other tap on the
+     *   old pulse, so the outliers never come in a row)
+     *
+     * @param samplePosition Timestamp of the tap on the audio sample clock
+     * @return true if the tap was accepted and a new tempo estimate is available
+     */
+    bool tap (int64_t samplePosition)
+    {
+        if (numTaps == 0)
+        {
+            push (samplePosition, 0);
+            return false;
+        }
+
+        const auto& last = getTap (numTaps - 1);
+        const auto intervalMs = toMilliseconds (samplePosition - last.position);
+
+        if (intervalMs < minIntervalMs)
+            return false;
+
+        if (intervalMs > maxIntervalMs)
+        {
+            reset();
+            push (samplePosition, 0);
+            return false;
+        }
+
+        // Not enough history for a reliable pulse yet: take the tap as the next beat
+        if (numTaps < 3)
+        {
+            push (samplePosition, last.beat + 1);
+            return true;
+        }
+
+        const auto period = getMedianPeriod();
+        const auto ratio = static_cast<double> (samplePosition - last.position) / period;
+        const auto beats = static_cast<int> (std::round (ratio));
+
+        if ((beats == 1 || beats == 2) && std::abs (ratio - beats) <= outlierTolerance)
+        {
+            // Outliers splitting consecutive intervals evenly: the player taps twice as fast
+            if (beats == 1 && isEvenSplit (last.position, samplePosition))
+            {
+                const auto middle = *rejectedTap;
+
+                if (splitTap.has_value() && *splitTap < last.position && numTaps >= 2)
+                {
+                    const auto start = getTap (numTaps - 2).position;
+                    const auto firstMiddle = *splitTap;
+                    const auto previous = last.position;
+                    reset();
+                    push (start, 0);
+                    push (firstMiddle, 1);
+                    push (previous, 2);
+                    push (middle, 3);
+                    push (samplePosition, 4);
+                    return true;
+                }
+
+                splitTap = middle;
+            }
+            else
+            {
+                splitTap.reset();
+            }
+
+            rejectedTap.reset();
+            push (samplePosition, last.beat + beats);
+            return true;
+        }
+
+        // Two consecutive outliers at a plausible interval: the player changed tempo
+        if (rejectedTap.has_value())
+        {
+            const auto rejectedIntervalMs = toMilliseconds (samplePosition - *rejectedTap);
+            if (rejectedIntervalMs >= minIntervalMs && rejectedIntervalMs <= maxIntervalMs)
+            {
+                const auto previous = *rejectedTap;
+                reset();
+                push (previous, 0);
+                push (samplePosition, 1);
+                return true;
+            }
+        }
+
+        rejectedTap = samplePosition;
+        return false;
+    }
+
+    /**
+     * @brief Calculate the current BPM based on recorded taps
+     *
+     * Fits a line through the (beat index, timestamp) pairs of the accepted
+     * taps and converts its slope to BPM (beats per minute).
+     *
+     * @return double The calculated BPM, defaults to 120.0 if fewer than two taps recorded
+     */
+    double calculateBPM() const
+    {
+        const auto period = getFittedPeriod();
+        if (period <= 0.0)
+            return 120.0;
+
+        return 60.0 * sampleRate / period;
+    }
+
+    /**
+     * @brief Gets the fitted position of the most recent beat
+     *
+     * This is the position of the last accepted tap corrected by the tempo
+     * fit, which is a better phase anchor than the raw (jittery) tap.
+     *
+     * @return Sample position of the last tapped beat, if any
+     */
+    std::optional<double> getLastBeatPosition() const
+    {
+        if (numTaps == 0)
+            return std::nullopt;
+
+        const auto& last = getTap (numTaps - 1);
+        if (numTaps < 2)
+            return static_cast<double> (last.position);
+
+        double meanBeat = 0.0, meanPosition = 0.0;
+        computeMeans (meanBeat, meanPosition);
+        return meanPosition + getFittedPeriod() * (static_cast<double> (last.beat) - meanBeat);
+    }
+
+    /**
+     * @brief Reset the tap tempo calculator
+     *
+     * Clears all recorded taps.
+     * Called when:
+     * - No tap received within timeout period
+     * - The player deliberately changes tempo
+     * - Manual reset is needed
+     */
+    void reset()
+    {
+        numTaps = 0;
+        firstTap = 0;
+        rejectedTap.reset();
+        splitTap.reset();
+    }
+
+private:
+    /** @brief An accepted tap and the beat it was assigned to */
+    struct Tap
+    {
+        int64_t position = 0;
+        int beat = 0;
+    };
+
+    static constexpr double minIntervalMs = 120.0;
+    static constexpr double maxIntervalMs = 2000.0;
+    static constexpr double outlierTolerance = 0.2; ///< Allowed deviation, as a fraction of the period
+
+    const Tap& getTap (size_t index) const { return taps[(firstTap + index) % maxTaps]; }
+
+    void push (int64_t position, int beat)
+    {
+        if (numTaps == maxTaps)
+        {
+            firstTap = (firstTap + 1) % maxTaps;
+            --numTaps;
+        }
+
+        taps[(firstTap + numTaps) % maxTaps] = { position, beat };
+        ++numTaps;
+    }
+
+    /** @brief Checks if the pending outlier falls half-way between two taps */
+    bool isEvenSplit (int64_t start, int64_t end) const
+    {
+        if (!rejectedTap.has_value() || *rejectedTap <= start || *rejectedTap >= end)
+            return false;
+
+        const auto firstHalf = static_cast<double> (*rejectedTap - start);
+        const auto secondHalf = static_cast<double> (end - *rejectedTap);
+        return std::abs (firstHalf - secondHalf) <= outlierTolerance * std::max (firstHalf, secondHalf);
+    }
+
+    double toMilliseconds (int64_t samples) const
+    {
+        return static_cast<double> (samples) * 1000.0 / sampleRate;
+    }
+
+    /** @brief Median of the per-beat intervals, robust to a single mistimed tap */
+    double getMedianPeriod() const
+    {
+        std::array<double, maxTaps> periods {};
+        size_t count = 0;
+
+        for (size_t i = 1; i < numTaps; ++i)
+        {
+            const auto& previous = getTap (i - 1);
+            const auto& current = getTap (i);
+            periods[count++] = static_cast<double> (current.position - previous.position)
+                               / static_cast<double> (current.beat - previous.beat);
+        }
+
+        const auto middle = periods.begin() + static_cast<std::ptrdiff_t> (count / 2);
+        std::nth_element (periods.begin(), middle, periods.begin() + static_cast<std::ptrdiff_t> (count));
+        return *middle;
+    }
+
+    void computeMeans (double& meanBeat, double& meanPosition) const
+    {
+        // Positions are taken relative to the first tap to keep precision on long sessions
+        const auto origin = getTap (0).position;
+        meanBeat = 0.0;
+        meanPosition = 0.0;
+
+        for (size_t i = 0; i < numTaps; ++i)
+        {
+            meanBeat += static_cast<double> (getTap (i).beat);
+            meanPosition += static_cast<double> (getTap (i).position - origin);
+        }
+
+        meanBeat /= static_cast<double> (numTaps);
+        meanPosition = meanPosition / static_cast<double> (numTaps) + static_cast<double> (origin);
+    }
+
+    /** @brief Least-squares slope of tap position against beat index, in samples per beat */
+    double getFittedPeriod() const
+    {
+        if (numTaps < 2)
+            return 0.0;
+
+        double meanBeat = 0.0, meanPosition = 0.0;
+        computeMeans (meanBeat, meanPosition);
+
+        double covariance = 0.0, variance = 0.0;
+        for (size_t i = 0; i < numTaps; ++i)
+        {
+            const auto beatOffset = static_cast<double> (getTap (i).beat) - meanBeat;
+            covariance += beatOffset * (static_cast<double> (getTap (i).position) - meanPosition);
+            variance += beatOffset * beatOffset;
+        }
+
+        return variance > 0.0 ? covariance / variance : 0.0;
+    }
+
+    std::array<Tap, maxTaps> taps {}; ///< Ring buffer of accepted taps
+    size_t firstTap = 0; ///< Index of the oldest tap in the ring
+    size_t numTaps = 0; ///< Number of taps currently stored
+    std::optional<int64_t> rejectedTap; ///< Last tap rejected as an outlier
+    std::optional<int64_t> splitTap; ///< Outlier that split the previous interval evenly
+    double sampleRate = 44100.0; ///< Rate of the clock the taps are measured on
+};
@@ -0,0 +1,156 @@
+#include "TempoFollower.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr double PRIOR_WIDTH_OCTAVES = 0.5;
+}
+
+void TempoFollower::prepare (double newFrameRate)
+{
+    frameRate = newFrameRate;
+    minLag = std::max (3, static_cast<int> (std::floor (frameRate * 60.0 / maxBpm)));
+    maxLag = static_cast<int> (std::ceil (frameRate * 60.0 / minBpm));
+
+    // Lags up to twice the longest period (plus interpolation and smoothing margin) feed the comb
+    historySize = 2 * maxLag + 5;
+    history.assign (static_cast<size_t> (historySize), 0.0f);
+    autocorrelation.assign (static_cast<size_t> (historySize), 0.0f);
+    tempoWeights.assign (static_cast<size_t> (maxLag + 2), 0.0f);
+    updateTempoWeights();
+
+    decay = static_cast<float> (std::exp (-1.0 / (memorySeconds * frameRate)));
+    meanDecay = static_cast<float> (std::exp (-1.0 / (meanSeconds * frameRate)));
+    updateInterval = std::max (1, static_cast<int> (updateSeconds * frameRate));
+
+    reset();
+}
+
+void TempoFollower::setExpectedTempo (float bpm)
+{
+    if (bpm > 0.0f && std::abs (bpm - expectedTempo) >= 1.0f)
+    {
+        expectedTempo = bpm;
+        updateTempoWeights();
+    }
+}
+
+void TempoFollower::updateTempoWeights()
+{
+    // Log-Gaussian prior around the expected tempo, which resolves octave ambiguities
+    for (size_t lag = 1; lag < tempoWeights.size(); ++lag)
+    {
+        const auto bpm = 60.0 * frameRate / static_cast<double> (lag);
+        const auto octaves = std::log2 (bpm / static_cast<double> (expectedTempo)) / PRIOR_WIDTH_OCTAVES;
+        tempoWeights[lag] = static_cast<float> (std::exp (-0.5 * octaves * octaves));
+    }
+}
+
+void TempoFollower::reset()
+{
+    std::fill (history.begin(), history.end(), 0.0f);
+    std::fill (autocorrelation.begin(), autocorrelation.end(), 0.0f);
+
+    writePosition = 0;
+    framesUntilUpdate = updateInterval;
+    runningMean = 0.0f;
+    primed = false;
+    energy = 0.0f;
+    tempo = 0.0f;
+}
+
+void TempoFollower::pushOnsetStrength (float onsetStrength)
+{
+    if (historySize == 0)
+        return;
+
+    // The mean starts at the first value, or the level itself would read as a slow onset
+    if (!primed)
+    {
+        runningMean = onsetStrength;
+        primed = true;
+    }
+
+    // High-pass: only what rises above the recent average is rhythmic information
+    runningMean = meanDecay * runningMean + (1.0f - meanDecay) * onsetStrength;
+    const auto value = std::max (0.0f, onsetStrength - runningMean);
+
+    history[static_cast<size_t> (writePosition)] = value;
+    energy = decay * energy + value * value;
+
+    // Incremental autocorrelation: the two loops avoid a modulo per lag
+    const auto lastLag = historySize - 1;
+    const auto unwrappedLags = std::min (writePosition, lastLag);
+
+    for (int lag = 1; lag <= unwrappedLags; ++lag)
+    {
+        auto& accumulator = autocorrelation[static_cast<size_t> (lag)];
+        accumulator = decay * accumulator + value * history[static_cast<size_t> (writePosition - lag)];
+    }
+
+    for (int lag = unwrappedLags + 1; lag <= lastLag; ++lag)
+    {
+        auto& accumulator = autocorrelation[static_cast<size_t> (lag)];
+        accumulator = decay * accumulator + value * history[static_cast<size_t> (writePosition - lag + historySize)];
+    }
+
+    writePosition = (writePosition + 1) % historySize;
+
+    if (--framesUntilUpdate <= 0)
+    {
+        framesUntilUpdate = updateInterval;
+        updateTempo();
+    }
+}
+
+void TempoFollower::updateTempo()
+{
+    if (energy <= 0.0f)
+    {
+        tempo = 0.0f;
+        return;
+    }
+
+    // Periods rarely fall on a whole number of frames: spread each lag over its neighbours
+    auto smoothed = [this] (int lag) {
+        return 0.5f * autocorrelation[static_cast<size_t> (lag)]
+               + 0.25f * (autocorrelation[static_cast<size_t> (lag - 1)] + autocorrelation[static_cast<size_t> (lag + 1)]);
+    };
+
+    // Comb: a true beat period also correlates at twice its length
+    auto comb = [&smoothed] (int lag) {
+        return smoothed (lag) + 0.5f * smoothed (2 * lag);
+    };
+
+    auto score = [this, &comb] (int lag) {
+        return comb (lag) * tempoWeights[static_cast<size_t> (lag)];
+    };
+
+    int bestLag = 0;
+    float bestScore = 0.0f;
+    for (int lag = minLag; lag <= maxLag; ++lag)
+    {
+        if (const auto s = score (lag); s > bestScore)
+        {
+            bestScore = s;
+            bestLag = lag;
+        }
+    }
+
+    // A band playing half time only correlates at twice the period of the click it follows
+    if (bestLag == 0 || comb (bestLag) < minimumConfidence * energy)
+    {
+        tempo = 0.0f;
+        return;
+    }
+
+    // Parabolic interpolation for sub-frame period resolution
+    const auto previous = score (bestLag - 1);
+    const auto next = score (bestLag + 1);
+    const auto curvature = previous - 2.0f * bestScore + next;
+    const auto offset = curvature < 0.0f ? 0.5f * (previous - next) / curvature : 0.0f;
+
+    const auto period = (static_cast<double> (bestLag) + std::clamp (static_cast<double> (offset), -0.5, 0.5)) / frameRate;
+    tempo = static_cast<float> (60.0 / period);
+}
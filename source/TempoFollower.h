@@ -0,0 +1,93 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * @file TempoFollower.h
+ * @brief Continuous tempo tracking from an onset strength signal
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ */
+
+/**
+ * @class TempoFollower
+ * @brief Tracks the tempo of a live performance
+ *
+ * The follower is fed one onset strength value per analysis frame (the
+ * spectral flux of the OnsetDetector) and maintains a leaky autocorrelation
+ * of that signal, updated incrementally with a constant cost per frame:
+ * - The onset strength is high-passed against its running mean
+ * - For each lag, the autocorrelation accumulates the product of the newest
+ *   value with the value one lag ago, with an exponential forgetting factor
+ * - The tempo is the lag maximising a comb (lag + double lag) score weighted
+ *   by a tempo prior centred on the expected tempo (the click), refined by
+ *   parabolic interpolation
+ *
+ * Memory is allocated once in prepare() and bounded by the longest lag.
+ */
+class TempoFollower
+{
+public:
+    /**
+     * @brief Allocates the tempogram for a given analysis frame rate
+     * @param newFrameRate Number of onset strength values per second
+     */
+    void prepare (double newFrameRate);
+
+    /**
+     * @brief Forgets the tracked tempo without reallocating
+     */
+    void reset();
+
+    /**
+     * @brief Adds the onset strength of a new analysis frame
+     * @param onsetStrength Onset strength (spectral flux) of the frame
+     */
+    void pushOnsetStrength (float onsetStrength);
+
+    /**
+     * @brief Centres the tempo prior, typically on the current click tempo
+     *
+     * The prior is only recomputed when the tempo moves by at least 1 BPM.
+     *
+     * @param bpm Tempo the performance is expected to be close to
+     */
+    void setExpectedTempo (float bpm);
+
+    /**
+     * @brief Gets the tracked tempo
+     * @return Tempo in BPM, or 0 when no steady pulse is found
+     */
+    float getTempo() const { return tempo; }
+
+private:
+    void updateTempo();
+    void updateTempoWeights();
+
+    static constexpr double minBpm = 40.0;
+    static constexpr double maxBpm = 240.0;
+    static constexpr double memorySeconds = 8.0; ///< Time constant of the autocorrelation
+    static constexpr double meanSeconds = 1.0; ///< Time constant of the high-pass
+    static constexpr double updateSeconds = 0.25; ///< Interval between two tempo estimates
+    static constexpr float minimumConfidence = 0.1f; ///< Comb autocorrelation at the peak, relative to energy
+
+    double frameRate = 0.0;
+    int minLag = 0;
+    int maxLag = 0; ///< Longest beat period, in frames
+    int historySize = 0; ///< Longest lag used by the comb (two beat periods) plus one
+
+    std::vector<float> history; ///< Circular buffer of high-passed onset strength
+    std::vector<float> autocorrelation; ///< Leaky autocorrelation, indexed by lag
+    std::vector<float> tempoWeights; ///< Tempo prior, indexed by lag
+
+    int writePosition = 0;
+    int framesUntilUpdate = 0;
+    int updateInterval = 0;
+    float decay = 0.0f;
+    float meanDecay = 0.0f;
+    float runningMean = 0.0f;
+    bool primed = false; ///< The running mean has seen a value since the last reset
+    float energy = 0.0f;
+    float tempo = 0.0f;
+    float expectedTempo = 120.0f;
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+/**
+ * @file TimingAnalyzer.h
+ * @brief Timing analysis of a player against the click
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ */
+
+/**
+ * @brief Timing statistics published to the editor
+ */
+struct TimingStatistics
+{
+    /** @brief Number of histogram bins, 10ms wide and centred on 0 */
+    static constexpr int numBins = 9;
+    /** @brief Width of one histogram bin, in milliseconds */
+    static constexpr float binWidthMs = 10.0f;
+
+    int numHits = 0; ///< Hits matched since the last reset
+    float lastDeviationMs = 0.0f; ///< Deviation of the most recent hit (negative: rushing)
+    float meanMs = 0.0f; ///< Mean deviation over the rolling window
+    float standardDeviationMs = 0.0f; ///< Standard deviation over the rolling window
+    std::array<int, numBins> histogram {}; ///< Hits per deviation bin, outer bins include outliers
+};
+
+/**
+ * @class TimingAnalyzer
+ * @brief Compares the player's onsets with the click onsets
+ *
+ * The audio thread reports every click it starts and every onset detected on
+ * the player's input. Each onset is matched, in constant time, with the
+ * nearest of the last click and the next scheduled one (a beat or a note of
+ * the subdivision, where the groove plays it), and its deviation is
+ * added to a rolling window (running sums) and to a rush/drag histogram.
+ * Nothing here allocates.
+ */
+class TimingAnalyzer
+{
+public:
+    /** @brief Number of hits in the rolling window */
+    static constexpr int windowSize = 32;
+
+    /**
+     * @brief Sets the sample rate used to convert deviations to milliseconds
+     * @param newSampleRate Sample rate of the audio clock
+     */
+    void setSampleRate (double newSampleRate) { sampleRate = newSampleRate; }
+
+    /**
+     * @brief Forgets all hits and clicks
+     */
+    void reset()
+    {
+        statistics = {};
+        deviations = {};
+        writePosition = 0;
+        sum = sumOfSquares = 0.0;
+        lastClick = -1;
+    }
+
+    /**
+     * @brief Records the start of an audible click
+     * @param clickSample Position of the click on the audio clock
+     */
+    void addClick (int64_t clickSample) { lastClick = clickSample; }
+
+    /**
+     * @brief Matches an onset of the player with the click
+     * @param onsetSample Position of the onset on the audio clock
+     * @param nextClickSample Position of the next click of the grid, subdivisions and groove included
+     */
+    void addOnset (int64_t onsetSample, int64_t nextClickSample)
+    {
+        auto deviation = onsetSample - nextClickSample;
+        if (lastClick >= 0 && std::abs (onsetSample - lastClick) < std::abs (deviation))
+            deviation = onsetSample - lastClick;
+
+        const auto deviationMs = static_cast<double> (deviation) * 1000.0 / sampleRate;
+
+        // Rolling window: replace the oldest deviation in the running sums
+        const auto count = std::min (statistics.numHits, windowSize);
+        if (count == windowSize)
+        {
+            const auto oldest = deviations[static_cast<size_t> (writePosition)];
+            sum -= oldest;
+            sumOfSquares -= oldest * oldest;
+        }
+
+        deviations[static_cast<size_t> (writePosition)] = deviationMs;
+        writePosition = (writePosition + 1) % windowSize;
+        sum += deviationMs;
+        sumOfSquares += deviationMs * deviationMs;
+
+        const auto numInWindow = static_cast<double> (std::min (count + 1, windowSize));
+        const auto mean = sum / numInWindow;
+        const auto variance = std::max (0.0, sumOfSquares / numInWindow - mean * mean);
+
+        const auto bin = static_cast<int> (std::floor (deviationMs / TimingStatistics::binWidthMs + 0.5)) + TimingStatistics::numBins / 2;
+
+        statistics.numHits++;
+        statistics.lastDeviationMs = static_cast<float> (deviationMs);
+        statistics.meanMs = static_cast<float> (mean);
+        statistics.standardDeviationMs = static_cast<float> (std::sqrt (variance));
+        statistics.histogram[static_cast<size_t> (std::clamp (bin, 0, TimingStatistics::numBins - 1))]++;
+    }
+
+    /**
+     * @brief Gets the current statistics
+     * @return Statistics of the matched hits
+     */
+    const TimingStatistics& getStatistics() const { return statistics; }
+
+private:
+    TimingStatistics statistics;
+    std::array<double, windowSize> deviations {}; ///< Rolling window of deviations, in milliseconds
+    int writePosition = 0;
+    double sum = 0.0;
+    double sumOfSquares = 0.0;
+    int64_t lastClick = -1;
+    double sampleRate = 44100.0;
+};
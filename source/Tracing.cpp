@@ -0,0 +1,330 @@
+#include "Tracing.h"
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+
+namespace
+{
+    // Threads that can record; later ones are ignored
+    constexpr int MAX_THREADS = 32;
+
+    // Events per thread between two flushes (a power of two)
+    constexpr uint64_t EVENTS_PER_THREAD = 8192;
+
+    constexpr int FLUSH_INTERVAL_MS = 50;
+
+    // Duration of an instant
+    constexpr int64_t INSTANT = -1;
+
+    struct Event
+    {
+        const char* name = nullptr;
+        int64_t startTicks = 0;
+        int64_t durationTicks = INSTANT;
+        int64_t value = 0;
+    };
+
+    /**
+     * Events of one thread: written by it, read by the trace writer
+     */
+    struct ThreadRing
+    {
+        std::atomic<uint64_t> written { 0 };
+        std::atomic<uint64_t> read { 0 };
+        std::atomic<uint64_t> dropped { 0 }; ///< Events lost to a full ring
+        std::atomic<bool> claimed { false }; ///< Set once the thread name is filled in
+        char threadName[64] {};
+        std::array<Event, EVENTS_PER_THREAD> events {};
+
+        void push (const Event& event)
+        {
+            const auto position = written.load (std::memory_order_relaxed);
+            if (position - read.load (std::memory_order_acquire) >= EVENTS_PER_THREAD)
+            {
+                dropped.fetch_add (1, std::memory_order_relaxed);
+                return;
+            }
+
+            events[static_cast<size_t> (position % EVENTS_PER_THREAD)] = event;
+            written.store (position + 1, std::memory_order_release);
+        }
+    };
+
+    std::atomic<bool> recording { false };
+    std::atomic<int64_t> sessionStartTicks { 0 };
+    std::atomic<ThreadRing*> rings { nullptr }; ///< Allocated by the first session, kept for the process
+    std::atomic<int> numClaimedRings { 0 };
+
+    thread_local ThreadRing* threadRing = nullptr;
+    thread_local bool hasNoRing = false;
+
+    void copyThreadName (ThreadRing& ring, int index)
+    {
+        // Reading names does not allocate; host threads have none
+        const char* name = nullptr;
+        if (juce::MessageManager::existsAndIsCurrentThread())
+            name = "Message thread";
+        else if (const auto* thread = juce::Thread::getCurrentThread())
+            name = thread->getThreadName().toRawUTF8();
+
+        if (name != nullptr)
+            juce::CharPointer_UTF8 (ring.threadName).writeWithDestByteLimit (juce::CharPointer_UTF8 (name), sizeof (ring.threadName));
+        else
+            std::snprintf (ring.threadName, sizeof (ring.threadName), "Host thread %d", index + 1);
+    }
+
+    ThreadRing* getThreadRing()
+    {
+        if (threadRing != nullptr || hasNoRing)
+            return threadRing;
+
+        auto* pool = rings.load (std::memory_order_acquire);
+        if (pool == nullptr)
+            return nullptr;
+
+        const auto index = numClaimedRings.fetch_add (1, std::memory_order_relaxed);
+        if (index >= MAX_THREADS)
+        {
+            hasNoRing = true;
+            return nullptr;
+        }
+
+        auto& ring = pool[index];
+        copyThreadName (ring, index);
+        ring.claimed.store (true, std::memory_order_release);
+
+        threadRing = &ring;
+        return threadRing;
+    }
+
+    void record (const Event& event)
+    {
+        if (!recording.load (std::memory_order_acquire))
+            return;
+
+        if (auto* ring = getThreadRing())
+            ring->push (event);
+    }
+
+    /**
+     * Drains the rings into a Chrome trace JSON file (array format, which Perfetto reads even if unterminated)
+     */
+    class TraceWriter : private juce::Thread
+    {
+    public:
+        explicit TraceWriter (std::unique_ptr<juce::FileOutputStream> output)
+            : juce::Thread ("BeatIt trace writer"),
+              stream (std::move (output)),
+              microsecondsPerTick (1.0e6 / static_cast<double> (juce::Time::getHighResolutionTicksPerSecond()))
+        {
+            *stream << "[\n";
+            writeEvent (R"({"name":"process_name","ph":"M","pid":1,"tid":0,"args":{"name":"BeatIt"}})");
+            startThread();
+        }
+
+        ~TraceWriter() override
+        {
+            stopThread (1000);
+            drain();
+            *stream << "\n]\n";
+            stream->flush();
+        }
+
+    private:
+        void run() override
+        {
+            while (!threadShouldExit())
+            {
+                drain();
+                wait (FLUSH_INTERVAL_MS);
+            }
+        }
+
+        void drain()
+        {
+            auto* pool = rings.load (std::memory_order_acquire);
+            const auto numRings = juce::jmin (MAX_THREADS, numClaimedRings.load (std::memory_order_relaxed));
+
+            for (int index = 0; index < numRings; ++index)
+            {
+                auto& ring = pool[index];
+                if (!ring.claimed.load (std::memory_order_acquire))
+                    continue;
+
+                const auto tid = juce::String (index + 1);
+                const auto i = static_cast<size_t> (index);
+
+                if (!namedThreads[i])
+                {
+                    namedThreads[i] = true;
+                    writeEvent (R"({"name":"thread_name","ph":"M","pid":1,"tid":)" + tid
+                                + R"(,"args":{"name":")" + escape (ring.threadName) + "\"}}");
+                }
+
+                const auto written = ring.written.load (std::memory_order_acquire);
+                for (auto position = ring.read.load (std::memory_order_relaxed); position < written; ++position)
+                    writeEvent (format (ring.events[static_cast<size_t> (position % EVENTS_PER_THREAD)], tid));
+
+                ring.read.store (written, std::memory_order_release);
+
+                if (const auto dropped = ring.dropped.load (std::memory_order_relaxed); dropped != reportedDrops[i])
+                {
+                    reportedDrops[i] = dropped;
+                    writeEvent (format ({ "dropped events", juce::Time::getHighResolutionTicks(), INSTANT, static_cast<int64_t> (dropped) }, tid));
+                }
+            }
+
+            stream->flush();
+        }
+
+        juce::String format (const Event& event, const juce::String& tid) const
+        {
+            const auto start = static_cast<double> (event.startTicks - sessionStartTicks.load()) * microsecondsPerTick;
+            auto json = R"({"name":")" + escape (event.name) + R"(","pid":1,"tid":)" + tid
+                        + R"(,"ts":)" + juce::String (start, 3);
+
+            if (event.durationTicks == INSTANT)
+                return json + R"(,"ph":"i","s":"t","args":{"value":)" + juce::String (event.value) + "}}";
+
+            return json + R"(,"ph":"X","dur":)" + juce::String (static_cast<double> (event.durationTicks) * microsecondsPerTick, 3) + "}";
+        }
+
+        static juce::String escape (const char* text)
+        {
+            return juce::String (juce::CharPointer_UTF8 (text)).replace ("\\", "\\\\").replace ("\"", "\\\"");
+        }
+
+        void writeEvent (const juce::String& json)
+        {
+            if (!isFirstEvent)
+                *stream << ",\n";
+
+            *stream << json;
+            isFirstEvent = false;
+        }
+
+        std::unique_ptr<juce::FileOutputStream> stream;
+        const double microsecondsPerTick;
+        std::array<bool, MAX_THREADS> namedThreads {};
+        std::array<uint64_t, MAX_THREADS> reportedDrops {};
+        bool isFirstEvent = true;
+    };
+
+    /**
+     * Records the parameter and program changes of the attached processors, on the thread making them
+     */
+    class ProcessorTracer : public juce::AudioProcessorListener
+    {
+    public:
+        void audioProcessorParameterChanged (juce::AudioProcessor*, int parameterIndex, float) override
+        {
+            Tracing::instant ("parameter change", parameterIndex);
+        }
+
+        void audioProcessorChanged (juce::AudioProcessor* processor, const ChangeDetails& details) override
+        {
+            if (details.programChanged)
+                Tracing::instant ("program change", processor->getCurrentProgram());
+        }
+    };
+
+    // Message thread only
+    std::unique_ptr<TraceWriter> writer;
+    ProcessorTracer processorTracer;
+    int numAttachedProcessors = 0;
+    bool isSessionOfProcessors = false;
+
+    juce::File getDefaultTraceFile()
+    {
+        const auto path = juce::SystemStats::getEnvironmentVariable ("BEATIT_TRACE_JSON", {});
+        if (path.isNotEmpty())
+            return juce::File::getCurrentWorkingDirectory().getChildFile (path);
+
+        return juce::File::getSpecialLocation (juce::File::tempDirectory).getNonexistentChildFile ("BeatIt-trace", ".json");
+    }
+}
+
+namespace Tracing
+{
+    bool start (const juce::File& file)
+    {
+        if (writer != nullptr)
+            return true;
+
+        file.deleteFile();
+        auto stream = std::make_unique<juce::FileOutputStream> (file);
+        if (!stream->openedOk())
+            return false;
+
+        if (rings.load() == nullptr)
+        {
+            static const auto pool = std::make_unique<ThreadRing[]> (MAX_THREADS);
+            rings.store (pool.get(), std::memory_order_release);
+        }
+
+        // Whatever a previous session left unwritten belongs to it
+        for (int index = 0; index < MAX_THREADS; ++index)
+        {
+            auto& ring = rings.load()[index];
+            ring.read.store (ring.written.load (std::memory_order_acquire), std::memory_order_release);
+        }
+
+        sessionStartTicks = juce::Time::getHighResolutionTicks();
+        writer = std::make_unique<TraceWriter> (std::move (stream));
+        recording.store (true, std::memory_order_release);
+        return true;
+    }
+
+    void stop()
+    {
+        recording.store (false, std::memory_order_release);
+        writer.reset();
+    }
+
+    bool isRecording()
+    {
+        return recording.load (std::memory_order_acquire);
+    }
+
+    void instant (const char* name, int64_t value)
+    {
+        record ({ name, juce::Time::getHighResolutionTicks(), INSTANT, value });
+    }
+
+    void attach (juce::AudioProcessor& processor)
+    {
+        processor.addListener (&processorTracer);
+
+        if (numAttachedProcessors++ == 0 && !isRecording())
+        {
+            const auto file = getDefaultTraceFile();
+            isSessionOfProcessors = start (file);
+
+            if (isSessionOfProcessors)
+                juce::Logger::writeToLog ("BeatIt trace: " + file.getFullPathName());
+        }
+    }
+
+    void detach (juce::AudioProcessor& processor)
+    {
+        processor.removeListener (&processorTracer);
+
+        if (--numAttachedProcessors == 0 && isSessionOfProcessors)
+        {
+            isSessionOfProcessors = false;
+            stop();
+        }
+    }
+
+    ScopedSpan::ScopedSpan (const char* spanName)
+        : name (spanName),
+          startTicks (juce::Time::getHighResolutionTicks())
+    {
+    }
+
+    ScopedSpan::~ScopedSpan()
+    {
+        record ({ name, startTicks, juce::Time::getHighResolutionTicks() - startTicks, 0 });
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+
+/**
+ * @file Tracing.h
+ * @brief Chrome trace recording of audio-thread and UI events
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ *
+ * When BEATIT_TRACING is enabled (configure with -DBEATIT_TRACING=ON), the
+ * BEATIT_TRACE_* macros record timestamped spans and instants: blocks, beats,
+ * clicks, preset swaps, sound generation, parameter changes and editor
+ * paints. Each thread writes into its own lock-free ring, preallocated when
+ * the session starts; a background thread drains the rings into a Chrome
+ * trace JSON file, which opens in Perfetto (ui.perfetto.dev) or
+ * chrome://tracing.
+ *
+ * A session starts with the first processor and ends with the last one. It
+ * writes to the file named by BEATIT_TRACE_JSON, or to a new BeatIt-trace
+ * file in the temporary directory. Otherwise the macros expand to nothing.
+ */
+namespace Tracing
+{
+    /**
+     * @brief Starts recording into a file, replacing it
+     *
+     * Call it from the message thread. Events recorded before are dropped.
+     *
+     * @param file Chrome trace JSON file to write
+     * @return true if the file could be opened, or a session was already recording
+     */
+    bool start (const juce::File& file);
+
+    /**
+     * @brief Writes the remaining events, closes the file and stops recording
+     */
+    void stop();
+
+    /**
+     * @brief Checks if a session is recording
+     * @return true between start() and stop()
+     */
+    bool isRecording();
+
+    /**
+     * @brief Records an instant on the calling thread (real-time safe)
+     * @param name Event name (a string literal)
+     * @param value Value shown with the event
+     */
+    void instant (const char* name, int64_t value = 0);
+
+    /**
+     * @brief Follows the parameter and program changes of a processor, starting a session with the first one
+     * @param processor Processor to follow
+     */
+    void attach (juce::AudioProcessor& processor);
+
+    /**
+     * @brief Stops following a processor, ending the session started with the first one after the last one
+     * @param processor Processor attached before
+     */
+    void detach (juce::AudioProcessor& processor);
+
+    /**
+     * @class ScopedSpan
+     * @brief Records a span on the calling thread for its lifetime (real-time safe)
+     */
+    class ScopedSpan
+    {
+    public:
+        /**
+         * @brief Starts the span
+         * @param name Event name (a string literal)
+         */
+        explicit ScopedSpan (const char* name);
+
+        /**
+         * @brief Ends the span and records it
+         */
+        ~ScopedSpan();
+
+    private:
+        const char* name;
+        int64_t startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedSpan)
+    };
+}
+
+#if BEATIT_TRACING
+    #define BEATIT_TRACE_SCOPE(name) const Tracing::ScopedSpan beatItTraceSpan (name)
+    #define BEATIT_TRACE_INSTANT(name, value) Tracing::instant (name, value)
+    #define BEATIT_TRACE_ATTACH(processor) Tracing::attach (processor)
+    #define BEATIT_TRACE_DETACH(processor) Tracing::detach (processor)
+#else
+    #define BEATIT_TRACE_SCOPE(name)
+    #define BEATIT_TRACE_INSTANT(name, value)
+    #define BEATIT_TRACE_ATTACH(processor)
+    #define BEATIT_TRACE_DETACH(processor)
+#endif
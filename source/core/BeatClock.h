@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+/**
+ * @file BeatClock.h
+ * @brief Sample-exact beat and subdivision grid for fractional beat lengths
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ */
+
+/**
+ * @class BeatClock
+ * @brief Rounds every beat and subdivision from the exact grid, so timing never drifts
+ *
+ * A beat rarely lasts a whole number of samples (120 BPM at 44.1 kHz is
+ * 22050 samples, 97 BPM is 27278.35...). Truncating the beat length once
+ * loses up to a sample per beat, which accumulates into audible drift over a
+ * long session.
+ *
+ * Instead, beat k after the anchor (the beat at which the tempo was last set)
+ * starts at round(k * samplesPerBeat) and a subdivision at fraction f of that
+ * beat at round((k + f) * samplesPerBeat). Every position is rounded from the
+ * exact grid rather than accumulated, so the error stays below half a sample
+ * however long the clock runs. The positions of the current beat are
+ * computed once per beat; nothing is computed per sample.
+ */
+class BeatClock
+{
+public:
+    /**
+     * @brief Computes the exact beat length of a tempo
+     * @param sampleRate Sample rate in Hz
+     * @param bpm Tempo in quarter notes per minute
+     * @param beatDenominator Beat unit (1, 2, 4 or 8)
+     * @return Beat length in samples, or 0 if the tempo or sample rate is not positive
+     */
+    static double computeSamplesPerBeat (double sampleRate, double bpm, int beatDenominator)
+    {
+        const auto beatsPerSecond = bpm * (4.0 / beatDenominator) / 60.0;
+        return (sampleRate > 0.0 && beatsPerSecond > 0.0) ? sampleRate / beatsPerSecond : 0.0;
+    }
+
+    /**
+     * @brief Sets the exact beat length, anchoring the grid at the current beat
+     * @param newSamplesPerBeat Beat length in samples, may be fractional
+     */
+    void setSamplesPerBeat (double newSamplesPerBeat)
+    {
+        if (newSamplesPerBeat == samplesPerBeat)
+            return;
+
+        samplesPerBeat = newSamplesPerBeat;
+        beatIndex = 0;
+        computeBeat();
+    }
+
+    /**
+     * @brief Anchors the grid at the current beat, keeping the beat length
+     */
+    void restart()
+    {
+        beatIndex = 0;
+        computeBeat();
+    }
+
+    /**
+     * @brief Moves to the next beat of the grid
+     */
+    void nextBeat()
+    {
+        ++beatIndex;
+        computeBeat();
+    }
+
+    /**
+     * @brief Gets the exact beat length
+     * @return Beat length in samples
+     */
+    double getSamplesPerBeat() const { return samplesPerBeat; }
+
+    /**
+     * @brief Gets the length of the current beat
+     * @return Number of samples from the start of the current beat to the next one
+     */
+    int getBeatLength() const { return beatLength; }
+
+    /**
+     * @brief Gets the position of a subdivision within the current beat
+     * @param numerator Subdivision index (1 to denominator - 1)
+     * @param denominator Number of equal parts of the beat (2, 3 or 4)
+     * @return Offset of the subdivision from the start of the current beat, in samples
+     */
+    int getPosition (int numerator, int denominator) const
+    {
+        return offsets[static_cast<size_t> (denominator)][static_cast<size_t> (numerator)];
+    }
+
+private:
+    static constexpr int maxParts = 4;
+
+    void computeBeat()
+    {
+        const auto beat = static_cast<double> (beatIndex);
+        const auto start = std::llround (beat * samplesPerBeat);
+        beatLength = static_cast<int> (std::llround ((beat + 1.0) * samplesPerBeat) - start);
+
+        for (int parts = 2; parts <= maxParts; ++parts)
+        {
+            for (int part = 1; part < parts; ++part)
+            {
+                const auto position = (beat + static_cast<double> (part) / parts) * samplesPerBeat;
+                offsets[static_cast<size_t> (parts)][static_cast<size_t> (part)] = static_cast<int> (std::llround (position) - start);
+            }
+        }
+    }
+
+    double samplesPerBeat = 0.0;
+    int64_t beatIndex = 0; ///< Beats since the anchor
+    int beatLength = 0;
+    std::array<std::array<int, maxParts>, maxParts + 1> offsets {}; ///< Subdivision offsets of the current beat, by number of parts
+};
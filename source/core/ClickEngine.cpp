@@ -0,0 +1,193 @@
+#include "ClickEngine.h"
+#include "SubdivisionSchedule.h"
+#include <algorithm>
+
+void ClickEngine::prepare (double newSampleRate)
+{
+    sampleRate = newSampleRate;
+
+    auto generate = [this] (std::vector<float>& sound, ClickSynth::Sound type) {
+        sound.assign (static_cast<size_t> (std::max (0, ClickSynth::getLength (type, sampleRate))), 0.0f);
+        ClickSynth::generate (type, sampleRate, sound.data(), static_cast<int> (sound.size()));
+    };
+
+    generate (highClick, ClickSynth::Sound::High);
+    generate (lowClick, ClickSynth::Sound::Low);
+    generate (restSound, ClickSynth::Sound::Rest);
+    generate (silence, ClickSynth::Sound::Mute);
+
+    updateTiming();
+    reset();
+}
+
+void ClickEngine::setSettings (const Settings& newSettings)
+{
+    const auto timingChanged = newSettings.bpm != settings.bpm || newSettings.beatDenominator != settings.beatDenominator;
+    settings = newSettings;
+    settings.beatsPerBar = std::max (1, settings.beatsPerBar);
+
+    if (timingChanged)
+        updateTiming();
+
+    if (currentBeat >= settings.beatsPerBar)
+    {
+        currentBeat = 0;
+        refreshGrid();
+    }
+}
+
+void ClickEngine::reset()
+{
+    currentBeat = 0;
+    soundPosition = 0;
+    clickPosition = -1;
+    currentClickIsRest = false;
+    restartGrid();
+}
+
+void ClickEngine::render (float* const* channels, int numChannels, int numSamples)
+{
+    for (int channel = 0; channel < numChannels; ++channel)
+        std::fill (channels[channel], channels[channel] + numSamples, 0.0f);
+
+    if (samplesPerBeat <= 0)
+        return;
+
+    for (int sample = 0; sample < numSamples; ++sample)
+    {
+        bool startsClick = false;
+        bool isRest = false;
+        const auto value = renderSample (startsClick, isRest);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            channels[channel][sample] = value;
+
+        advance (1);
+    }
+}
+
+float ClickEngine::renderSample (bool& startsClick, bool& isRest)
+{
+    // The beat always starts a click with the beat sound, even for patterns starting with a rest
+    isRest = false;
+    startsClick = soundPosition == 0 || SubdivisionSchedule::isClickAt (settings.subdivision, soundPosition, grid, isRest);
+
+    if (currentBeat < 0 || currentBeat >= settings.beatsPerBar || settings.isBeatMuted (currentBeat))
+    {
+        startsClick = false;
+        return 0.0f;
+    }
+
+    if (startsClick)
+    {
+        clickPosition = 0;
+        currentClickIsRest = isRest;
+    }
+
+    if (clickPosition < 0)
+        return 0.0f;
+
+    const auto& sound = getClickSound (currentBeat);
+    if (clickPosition >= static_cast<int> (sound.size()))
+    {
+        clickPosition = -1;
+        return 0.0f;
+    }
+
+    return sound[static_cast<size_t> (clickPosition++)];
+}
+
+void ClickEngine::nextBeat()
+{
+    soundPosition = 0;
+    currentBeat = (currentBeat + 1) % settings.beatsPerBar;
+    beatClock.nextBeat();
+    samplesPerBeat = beatClock.getBeatLength();
+    refreshGrid();
+}
+
+void ClickEngine::restartGrid()
+{
+    beatClock.restart();
+    samplesPerBeat = beatClock.getBeatLength();
+    refreshGrid();
+}
+
+void ClickEngine::setBeatPosition (int position)
+{
+    soundPosition = std::clamp (position, 0, std::max (0, samplesPerBeat - 1));
+}
+
+SubdivisionSchedule::Grid ClickEngine::computeGrid (int beat) const
+{
+    auto position = [this, beat] (int numerator, int denominator) {
+        const auto shift = gridShift != nullptr ? gridShift->getOffset (beat, numerator, denominator) : 0;
+        return beatClock.getPosition (numerator, denominator) + shift;
+    };
+
+    return { position (1, 2), position (1, 3), position (2, 3), position (1, 4), position (3, 4) };
+}
+
+void ClickEngine::setGridShift (const GridShift* newShift)
+{
+    gridShift = newShift;
+    refreshGrid();
+}
+
+void ClickEngine::setLead (int newLead, bool playing)
+{
+    if (newLead == lead)
+        return;
+
+    // Move the clicks still to come in this beat; the beat start stays put so
+    // that no beat is skipped or played twice
+    if (playing && soundPosition > 0 && samplesPerBeat > 1)
+        soundPosition = std::clamp (soundPosition + newLead - lead, 1, samplesPerBeat - 1);
+
+    lead = newLead;
+}
+
+const std::vector<float>& ClickEngine::getSound (ClickSynth::Sound sound) const
+{
+    switch (sound)
+    {
+        case ClickSynth::Sound::High:
+            return highClick;
+        case ClickSynth::Sound::Low:
+            return lowClick;
+        case ClickSynth::Sound::Rest:
+            return restSound;
+        case ClickSynth::Sound::Mute:
+        default:
+            return silence;
+    }
+}
+
+const std::vector<float>& ClickEngine::getClickSound (int beat) const
+{
+    const auto& beatSound = getSound (beat == 0 ? settings.firstBeatSound : settings.otherBeatsSound);
+    if (!currentClickIsRest)
+        return beatSound;
+
+    switch (settings.restSound)
+    {
+        case RestSound::SameAsBeat:
+            return beatSound;
+        case RestSound::Rest:
+            return restSound;
+        case RestSound::Mute:
+        default:
+            return silence;
+    }
+}
+
+void ClickEngine::updateTiming()
+{
+    const auto exactSamplesPerBeat = BeatClock::computeSamplesPerBeat (sampleRate, settings.bpm, settings.beatDenominator);
+    if (exactSamplesPerBeat <= 0.0)
+        return;
+
+    beatClock.setSamplesPerBeat (exactSamplesPerBeat);
+    samplesPerBeat = beatClock.getBeatLength();
+    refreshGrid();
+}
@@ -0,0 +1,276 @@
+#pragma once
+
+#include "BeatClock.h"
+#include "ClickSynth.h"
+#include "SubdivisionSchedule.h"
+#include "SubdivisionTypes.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @file ClickEngine.h
+ * @brief Metronome renderer over raw float buffers, without JUCE
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ */
+
+/**
+ * @class ClickEngine
+ * @brief Keeps the beat timeline and renders the main click into plain float channels
+ *
+ * The beat grid (BeatClock), subdivision patterns (SubdivisionSchedule) and
+ * sounds (ClickSynth) of the plugin, for code that only needs clicks:
+ * benchmarks, offline rendering and other playback engines. The plugin drives
+ * the same timeline a sample at a time (renderSample(), advance()) and adds
+ * what depends on the host and the UI (presets, ensemble tracks, input
+ * analysis, bar cache). Two hooks move the timeline off the straight grid: a
+ * GridShift places the subdivisions of each beat (a groove), and the lead
+ * renders the clicks ahead of the grid (latency compensation).
+ *
+ * The subdivision grid of the current beat is computed once per beat, when
+ * the beat starts or the timing changes. prepare() allocates the sounds; the
+ * other methods do not allocate, lock or block.
+ */
+class ClickEngine
+{
+public:
+    /**
+     * @enum RestSound
+     * @brief What is heard on the rests of a pattern
+     */
+    enum class RestSound {
+        SameAsBeat, /**< Same sound as the beat */
+        Rest, /**< The rest sound */
+        Mute /**< Nothing */
+    };
+
+    /**
+     * @class GridShift
+     * @brief Moves the subdivisions of each beat away from the straight grid
+     */
+    class GridShift
+    {
+    public:
+        virtual ~GridShift() = default;
+
+        /**
+         * @brief Gets the shift of a subdivision
+         * @param beat Beat index in the bar
+         * @param numerator Subdivision index (1 to denominator - 1)
+         * @param denominator Number of equal parts of the beat (2, 3 or 4)
+         * @return Samples to add to the straight position
+         */
+        virtual int getOffset (int beat, int numerator, int denominator) const = 0;
+    };
+
+    /**
+     * @brief What the metronome plays
+     */
+    struct Settings
+    {
+        double bpm = 120.0; ///< Tempo in quarter notes per minute
+        int beatsPerBar = 4;
+        int beatDenominator = 4; ///< Beat unit (1, 2, 4 or 8)
+        Subdivision subdivision = Subdivision::NoSubdivision;
+        ClickSynth::Sound firstBeatSound = ClickSynth::Sound::High;
+        ClickSynth::Sound otherBeatsSound = ClickSynth::Sound::Low;
+        RestSound restSound = RestSound::SameAsBeat;
+        uint32_t mutedBeats = 0; ///< One bit per muted beat
+
+        bool isBeatMuted (int beat) const { return beat >= 0 && beat < 32 && ((mutedBeats >> beat) & 1u) != 0; }
+
+        bool operator== (const Settings&) const = default;
+    };
+
+    /**
+     * @brief Renders the sounds for a sample rate and restarts at the first beat
+     * @param sampleRate Sample rate in Hz
+     */
+    void prepare (double sampleRate);
+
+    /**
+     * @brief Changes what is played, from the next sample
+     *
+     * A new tempo or beat unit anchors the grid at the current beat; a
+     * shorter bar restarts at its first beat if the current one is past it.
+     *
+     * @param newSettings Settings to play
+     */
+    void setSettings (const Settings& newSettings);
+
+    /**
+     * @brief Gets the settings being played
+     * @return Current settings
+     */
+    const Settings& getSettings() const { return settings; }
+
+    /**
+     * @brief Restarts at the first beat of a bar, silencing the click in progress
+     */
+    void reset();
+
+    /**
+     * @brief Renders clicks, overwriting the channels
+     * @param channels One pointer per channel; every channel gets the same signal
+     * @param numChannels Number of channels
+     * @param numSamples Samples to render in each channel
+     */
+    void render (float* const* channels, int numChannels, int numSamples);
+
+    /**
+     * @brief Renders the sample of the click at the current position, without moving on
+     * @param startsClick Set to true if a click starts on this sample
+     * @param isRest Set to true if that click is a rest
+     * @return Sample value, 0 between clicks and on muted beats
+     */
+    float renderSample (bool& startsClick, bool& isRest);
+
+    /**
+     * @brief Silences the click in progress
+     */
+    void stopClick() { clickPosition = -1; }
+
+    /**
+     * @brief Carries on with a click whose start was rendered elsewhere
+     * @param position Samples of the click already played
+     * @param isRest Whether the click is a rest
+     */
+    void resumeClick (int position, bool isRest)
+    {
+        clickPosition = position;
+        currentClickIsRest = isRest;
+    }
+
+    /**
+     * @brief Gets a sound, as rendered for the sample rate
+     * @param sound Sound to get
+     * @return Its samples
+     */
+    const std::vector<float>& getSound (ClickSynth::Sound sound) const;
+
+    //==============================================================================
+    /** @name Timeline */
+    ///@{
+
+    /**
+     * @brief Moves on along the current beat, to the next beat at its end
+     * @param numSamples Samples played, at most the rest of the current beat
+     */
+    void advance (int numSamples)
+    {
+        soundPosition += numSamples;
+        if (soundPosition >= samplesPerBeat)
+            nextBeat();
+    }
+
+    /**
+     * @brief Moves to the start of the next beat
+     */
+    void nextBeat();
+
+    /**
+     * @brief Anchors the grid at the current beat, keeping the beat length
+     */
+    void restartGrid();
+
+    /**
+     * @brief Moves within the current beat, without crossing a beat boundary
+     * @param position New position in the beat, in samples
+     */
+    void setBeatPosition (int position);
+
+    /**
+     * @brief Gets the beat being played
+     * @return Beat index in the bar, from 0
+     */
+    int getCurrentBeat() const { return currentBeat; }
+
+    /**
+     * @brief Gets the position in the current beat
+     * @return Samples played since the beat started
+     */
+    int getBeatPosition() const { return soundPosition; }
+
+    /**
+     * @brief Gets the length of the current beat, which may differ from the next by a sample
+     * @return Length in samples, 0 before the engine is prepared
+     */
+    int getBeatLength() const { return samplesPerBeat; }
+
+    /**
+     * @brief Gets the exact beat length of the tempo
+     * @return Beat length in samples, may be fractional
+     */
+    double getExactSamplesPerBeat() const { return beatClock.getSamplesPerBeat(); }
+
+    /**
+     * @brief Gets the subdivision positions of the current beat, shift included
+     * @return The grid, computed when the beat started
+     */
+    const SubdivisionSchedule::Grid& getGrid() const { return grid; }
+
+    /**
+     * @brief Computes the subdivision positions of a beat, on the straight grid of the current one
+     * @param beat Beat index in the bar
+     * @return The grid, with the shift of that beat
+     */
+    SubdivisionSchedule::Grid computeGrid (int beat) const;
+    ///@}
+
+    //==============================================================================
+    /** @name Groove and Latency */
+    ///@{
+
+    /**
+     * @brief Sets what moves the subdivisions off the straight grid
+     * @param newShift Shift to apply, kept by the caller; nullptr for the straight grid
+     */
+    void setGridShift (const GridShift* newShift);
+
+    /**
+     * @brief Recomputes the grid of the current beat after the shift has changed
+     */
+    void refreshGrid() { grid = computeGrid (currentBeat); }
+
+    /**
+     * @brief Sets how far ahead of the grid the clicks are rendered
+     *
+     * While playing, the clicks to come move along the grid: a larger lead
+     * brings them forward, within the current beat so that no beat is
+     * skipped or repeated. Before playback starts the grid simply begins
+     * later.
+     *
+     * @param newLead Lead over the nominal grid, in samples
+     * @param playing Whether the timeline is running
+     */
+    void setLead (int newLead, bool playing);
+
+    /**
+     * @brief Gets how far ahead of the grid the clicks are rendered
+     * @return Lead over the nominal grid, in samples
+     */
+    int getLead() const { return lead; }
+    ///@}
+
+private:
+    const std::vector<float>& getClickSound (int beat) const;
+    void updateTiming();
+
+    Settings settings;
+    double sampleRate = 0.0;
+    BeatClock beatClock;
+    const GridShift* gridShift = nullptr;
+    SubdivisionSchedule::Grid grid {}; ///< Subdivision positions of the current beat
+    int lead = 0; ///< Samples by which the clicks lead the nominal grid
+
+    std::vector<float> highClick;
+    std::vector<float> lowClick;
+    std::vector<float> restSound;
+    std::vector<float> silence;
+
+    int currentBeat = 0;
+    int soundPosition = 0; ///< Position in the current beat, in samples
+    int samplesPerBeat = 0; ///< Length of the current beat
+    int clickPosition = -1; ///< Position in the click being played, -1 for none
+    bool currentClickIsRest = false;
+};
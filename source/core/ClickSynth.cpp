@@ -0,0 +1,104 @@
+#include "ClickSynth.h"
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace
+{
+    // High Click
+    constexpr float HIGH_FREQUENCY = 1500.0f;
+    constexpr float HIGH_DURATION_MS = 30.0f;
+
+    // Low Click
+    constexpr float LOW_FREQUENCY = 800.0f;
+    constexpr float LOW_DURATION_MS = 20.0f;
+
+    // Mute
+    constexpr float MUTE_DURATION_MS = 1.0f;
+
+    // Envelope
+    constexpr float ATTACK_TIME_MS = 1.0f;
+    constexpr float DEFAULT_AMPLITUDE = 0.5f;
+
+    // Rest sound
+    constexpr float REST_SOUND_FREQUENCY = 200.0f;
+    constexpr float REST_SOUND_DURATION_MS = 15.0f;
+    constexpr float REST_SOUND_AMPLITUDE = 0.3f;
+
+    float getDurationMs (ClickSynth::Sound sound)
+    {
+        switch (sound)
+        {
+            case ClickSynth::Sound::High:
+                return HIGH_DURATION_MS;
+            case ClickSynth::Sound::Low:
+                return LOW_DURATION_MS;
+            case ClickSynth::Sound::Rest:
+                return REST_SOUND_DURATION_MS;
+            case ClickSynth::Sound::Mute:
+            default:
+                return MUTE_DURATION_MS;
+        }
+    }
+
+    void generateClick (float* output, int numSamples, float frequency, double sampleRate, float durationMs)
+    {
+        const auto attackTime = static_cast<float> (ATTACK_TIME_MS / 1000.0);
+        const auto decayTime = static_cast<float> ((durationMs / 1000.0) - attackTime);
+        const auto attackSamples = static_cast<float> (attackTime * sampleRate);
+        const auto decaySamples = static_cast<float> (decayTime * sampleRate);
+
+        for (int sample = 0; sample < numSamples; ++sample)
+        {
+            const auto time = static_cast<float> (sample) / static_cast<float> (sampleRate);
+            const auto signalValue = std::sin (2.0f * std::numbers::pi_v<float> * frequency * time);
+
+            float envelope;
+            if (static_cast<float> (sample) < attackSamples)
+                envelope = static_cast<float> (sample) / attackSamples;
+            else
+                envelope = 1.0f - ((static_cast<float> (sample) - attackSamples) / decaySamples);
+
+            envelope = std::max (0.0f, std::min (1.0f, envelope));
+            output[sample] = signalValue * envelope * DEFAULT_AMPLITUDE;
+        }
+    }
+
+    void generateRest (float* output, int numSamples, double sampleRate)
+    {
+        // Low frequency sine with a triangular envelope
+        for (int sample = 0; sample < numSamples; ++sample)
+        {
+            const auto time = static_cast<float> (sample) / static_cast<float> (sampleRate);
+            const auto signalValue = std::sin (2.0f * std::numbers::pi_v<float> * REST_SOUND_FREQUENCY * time);
+
+            const float envelope = 1.0f - std::abs (2.0f * static_cast<float> (sample) / static_cast<float> (numSamples) - 1.0f);
+            output[sample] = signalValue * envelope * REST_SOUND_AMPLITUDE;
+        }
+    }
+}
+
+int ClickSynth::getLength (Sound sound, double sampleRate)
+{
+    return static_cast<int> ((getDurationMs (sound) / 1000.0f) * sampleRate);
+}
+
+void ClickSynth::generate (Sound sound, double sampleRate, float* output, int numSamples)
+{
+    switch (sound)
+    {
+        case Sound::High:
+            generateClick (output, numSamples, HIGH_FREQUENCY, sampleRate, HIGH_DURATION_MS);
+            break;
+        case Sound::Low:
+            generateClick (output, numSamples, LOW_FREQUENCY, sampleRate, LOW_DURATION_MS);
+            break;
+        case Sound::Rest:
+            generateRest (output, numSamples, sampleRate);
+            break;
+        case Sound::Mute:
+        default:
+            std::fill (output, output + numSamples, 0.0f);
+            break;
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+/**
+ * @file ClickSynth.h
+ * @brief Synthesis of the click and rest sounds
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ */
+
+/**
+ * @class ClickSynth
+ * @brief Renders the metronome sounds into plain float buffers
+ *
+ * Clicks are sine bursts with a short linear attack and a linear decay; the
+ * rest sound is a softer, lower burst with a triangular envelope.
+ */
+class ClickSynth
+{
+public:
+    /**
+     * @enum Sound
+     * @brief Sounds of the metronome, clicks in the order of the sound choices
+     */
+    enum class Sound {
+        High, /**< High-pitched click (1500 Hz, 30ms) */
+        Low, /**< Low-pitched click (800 Hz, 20ms) */
+        Mute, /**< Silence, one millisecond long */
+        Rest /**< Rest marker (200 Hz, 15ms) */
+    };
+
+    /**
+     * @brief Gets the length of a sound
+     * @param sound Sound to render
+     * @param sampleRate Sample rate in Hz
+     * @return Length in samples
+     */
+    static int getLength (Sound sound, double sampleRate);
+
+    /**
+     * @brief Renders a sound from its start
+     * @param sound Sound to render
+     * @param sampleRate Sample rate in Hz
+     * @param output Destination, overwritten
+     * @param numSamples Samples to write, normally getLength()
+     */
+    static void generate (Sound sound, double sampleRate, float* output, int numSamples);
+};
@@ -0,0 +1,111 @@
+#include "SubdivisionSchedule.h"
+#include <initializer_list>
+
+bool SubdivisionSchedule::isClickAt (Subdivision subdivision, int position, const Grid& grid, bool& isRest)
+{
+    isRest = false; // By default, not a rest
+
+    switch (subdivision)
+    {
+        case Subdivision::NoSubdivision:
+            return false;
+
+        case Subdivision::Half: // Two equal notes
+            return (position == grid.half);
+
+        case Subdivision::HalfAndRest: // Note + Rest
+            if (position == grid.half)
+            {
+                isRest = true; // This is the rest
+                return true;
+            }
+            return false;
+
+        case Subdivision::RestHalf: // Rest + Note
+            if (position == 0)
+            {
+                isRest = true;
+                return true;
+            }
+            return (position == grid.half);
+
+        case Subdivision::Triplet: // Three equal notes
+            return (position == grid.oneThird || position == grid.twoThirds);
+
+        case Subdivision::RestHalfHalfTriplet: // Rest + Two Notes (triplet)
+            if (position == 0)
+            {
+                isRest = true;
+                return true;
+            }
+            return (position == grid.oneThird || position == grid.twoThirds);
+
+        case Subdivision::HalfRestHalfTriplet: // Note + Rest + Note (triplet)
+            if (position == grid.oneThird)
+            {
+                isRest = true;
+                return true;
+            }
+            return position == grid.twoThirds;
+
+        case Subdivision::HalfHalfRestTriplet: // Two Notes + Rest (triplet)
+            if (position == grid.twoThirds)
+            {
+                isRest = true;
+                return true;
+            }
+            return position == grid.oneThird;
+
+        case Subdivision::RestHalfRestTriplet: // Rest + Note + Rest (triplet)
+            if (position == 0 || position == grid.twoThirds)
+            {
+                isRest = true;
+                return true;
+            }
+            return position == grid.oneThird;
+
+        case Subdivision::Quarter: // Four equal notes
+            return (position == grid.oneQuarter || position == grid.half || position == grid.threeQuarters);
+
+        case Subdivision::RestEighthPattern: // Rest + Note + Rest + Note
+            if (position == 0 || position == grid.half)
+            {
+                isRest = true;
+                return true;
+            }
+            return (position == grid.oneQuarter || position == grid.threeQuarters);
+
+        case Subdivision::EighthEighthQuarter: // Two short + long
+            return (position == grid.oneQuarter);
+
+        case Subdivision::QuarterEighthEighth: // Long + two short
+            return (position == grid.half || position == grid.threeQuarters);
+
+        case Subdivision::EighthQuarterEighth: // Short + long + short
+            return (position == grid.oneQuarter || position == grid.threeQuarters);
+
+        case Subdivision::Count:
+        default:
+            return false;
+    }
+}
+
+int SubdivisionSchedule::findNextNote (Subdivision subdivision, int position, const Grid& grid)
+{
+    // The beat always starts a note, unless the pattern starts with a rest
+    bool isRest = false;
+    if (position <= 0 && !(isClickAt (subdivision, 0, grid, isRest) && isRest))
+        return 0;
+
+    int next = -1;
+    for (const auto candidate : { grid.oneQuarter, grid.oneThird, grid.half, grid.twoThirds, grid.threeQuarters })
+    {
+        if (candidate <= 0 || candidate < position || (next >= 0 && candidate >= next))
+            continue;
+
+        if (isClickAt (subdivision, candidate, grid, isRest) && !isRest)
+            next = candidate;
+    }
+
+    return next;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "SubdivisionTypes.h"
+
+/**
+ * @file SubdivisionSchedule.h
+ * @brief Clicks and rests of the subdivision patterns within a beat
+ * @author Lituus (Loïc Bartoletti)
+ * @version 0.0.1
+ */
+
+/**
+ * @class SubdivisionSchedule
+ * @brief Tells which positions of a beat start a click or a rest, for each pattern
+ *
+ * Positions come from the beat grid (BeatClock, possibly moved by a groove),
+ * so the schedule itself knows nothing about tempo or sample rate.
+ */
+class SubdivisionSchedule
+{
+public:
+    /**
+     * @brief Subdivision offsets of the current beat, in samples from its start
+     */
+    struct Grid
+    {
+        int half = 0;
+        int oneThird = 0;
+        int twoThirds = 0;
+        int oneQuarter = 0;
+        int threeQuarters = 0;
+    };
+
+    /**
+     * @brief Checks whether a position of the beat starts a note or a rest of the pattern
+     *
+     * The beat itself (position 0) only reports patterns starting with a rest:
+     * the caller always starts a click there.
+     *
+     * @param subdivision Pattern played on the beat
+     * @param position Position in the current beat, in samples
+     * @param grid Subdivision offsets of the current beat
+     * @param isRest Set to true if the position starts a rest
+     * @return true if a note or a rest starts at this position
+     */
+    static bool isClickAt (Subdivision subdivision, int position, const Grid& grid, bool& isRest);
+
+    /**
+     * @brief Finds the first note (not a rest) of the pattern at or after a position of the beat
+     * @param subdivision Pattern played on the beat
+     * @param position Position in the current beat, in samples
+     * @param grid Subdivision offsets of the current beat
+     * @return Position of the note in the beat, or -1 if none is left in it
+     */
+    static int findNextNote (Subdivision subdivision, int position, const Grid& grid);
+};
@@ -0,0 +1,137 @@
+#include "helpers/test_helpers.h"
+#include <PluginProcessor.h>
+#include <catch2/catch_test_macros.hpp>
+#include <functional>
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 480;
+    constexpr int blocksPerBar = 200; // 4/4 at 120 BPM and 48 kHz
+
+    /**
+     * Half notes with swing and a panned track of sixteenths: clicks ring across beats and bars
+     */
+    void configure (MetronomeAudioProcessor& processor, float bpm, double rate = sampleRate)
+    {
+        processor.setRateAndBufferSizeDetails (rate, blockSize);
+        processor.prepareToPlay (rate, blockSize);
+        setParameter (processor, "bpm", bpm);
+        setParameter (processor, "subdivision", static_cast<float> (static_cast<int> (Subdivision::Half)));
+        setParameter (processor, "swing", 60.0f);
+        setParameter (processor, "track1Enabled", 1.0f);
+        setParameter (processor, "track1Subdivision", static_cast<float> (static_cast<int> (Subdivision::Quarter)));
+        setParameter (processor, "track1Pan", -0.5f);
+        setParameter (processor, "play", 1.0f);
+    }
+
+    /**
+     * Practice mode needs every click: the engine renders each sample and never plays from the cache
+     */
+    void disableCache (MetronomeAudioProcessor& processor)
+    {
+        setParameter (processor, "inputMode", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::InputMode::Practice)));
+    }
+
+    std::array<std::vector<float>, 2> render (MetronomeAudioProcessor& processor,
+        int numBlocks,
+        const std::function<void (MetronomeAudioProcessor&, int)>& beforeBlock = {})
+    {
+        juce::AudioBuffer<float> buffer (2, blockSize);
+        juce::MidiBuffer midi;
+        std::array<std::vector<float>, 2> output;
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            if (beforeBlock)
+                beforeBlock (processor, block);
+
+            processor.processBlock (buffer, midi);
+
+            for (int channel = 0; channel < 2; ++channel)
+                output[static_cast<size_t> (channel)].insert (output[static_cast<size_t> (channel)].end(),
+                    buffer.getReadPointer (channel),
+                    buffer.getReadPointer (channel) + blockSize);
+        }
+
+        return output;
+    }
+}
+
+TEST_CASE ("Cached bars are the bars the engine renders", "[barCache]")
+{
+    MetronomeAudioProcessor cached;
+    configure (cached, 120.0f);
+    const auto output = render (cached, 6 * blocksPerBar);
+    CHECK (cached.isPlayingCachedBar());
+
+    MetronomeAudioProcessor rendered;
+    configure (rendered, 120.0f);
+    disableCache (rendered);
+    const auto expected = render (rendered, 6 * blocksPerBar);
+    CHECK_FALSE (rendered.isPlayingCachedBar());
+
+    CHECK (output[0] == expected[0]);
+    CHECK (output[1] == expected[1]);
+}
+
+TEST_CASE ("A change in the middle of a cached bar picks up the clicks in progress", "[barCache]")
+{
+    // One block after the second beat of bar 5 starts, while its clicks ring; then a mute in the middle of a beat
+    constexpr int changeBlock = 4 * blocksPerBar + 51;
+
+    auto change = [] (MetronomeAudioProcessor& processor, int block) {
+        if (block == changeBlock)
+        {
+            setParameter (processor, "track1Gain", -12.0f);
+            setParameter (processor, "otherBeatsSound", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::ClickType::Low)));
+        }
+        else if (block == changeBlock + 3 * blocksPerBar / 2)
+        {
+            processor.toggleBeatMute (3);
+        }
+    };
+
+    MetronomeAudioProcessor cached;
+    configure (cached, 120.0f);
+    const auto output = render (cached, 10 * blocksPerBar, change);
+    CHECK (cached.isPlayingCachedBar());
+
+    MetronomeAudioProcessor rendered;
+    configure (rendered, 120.0f);
+    disableCache (rendered);
+    const auto expected = render (rendered, 10 * blocksPerBar, change);
+
+    CHECK (output[0] == expected[0]);
+    CHECK (output[1] == expected[1]);
+}
+
+TEST_CASE ("Bars that are not a whole number of samples are cached as a loop of bars", "[barCache]")
+{
+    // 128 BPM at 44.1 kHz: 82687.5 samples per bar, 165375 every two bars
+    constexpr double rate = 44100.0;
+    constexpr int numBlocks = 12 * 82688 / blockSize;
+
+    MetronomeAudioProcessor cached;
+    configure (cached, 128.0f, rate);
+    const auto output = render (cached, numBlocks);
+    CHECK (cached.isPlayingCachedBar());
+
+    MetronomeAudioProcessor rendered;
+    configure (rendered, 128.0f, rate);
+    disableCache (rendered);
+    const auto expected = render (rendered, numBlocks);
+
+    CHECK (output[0] == expected[0]);
+    CHECK (output[1] == expected[1]);
+}
+
+TEST_CASE ("Bars that only repeat after too long are rendered", "[barCache]")
+{
+    // 97 BPM: 118762.9 samples per bar, a whole number only every 97 bars
+    MetronomeAudioProcessor processor;
+    configure (processor, 97.0f);
+    render (processor, 10 * blocksPerBar);
+
+    CHECK_FALSE (processor.isPlayingCachedBar());
+}
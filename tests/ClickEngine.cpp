@@ -0,0 +1,124 @@
+#include "helpers/test_helpers.h"
+#include <BeatClock.h>
+#include <ClickEngine.h>
+#include <Groove.h>
+#include <PluginProcessor.h>
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 480;
+}
+
+TEST_CASE ("The core engine renders the clicks of the plugin", "[core]")
+{
+    // A fractional beat length, a pattern with rests and a muted beat
+    ClickEngine::Settings settings;
+    settings.bpm = 97.0;
+    settings.beatsPerBar = 7;
+    settings.beatDenominator = 8;
+    settings.subdivision = Subdivision::RestHalfHalfTriplet;
+    settings.restSound = ClickEngine::RestSound::Rest;
+    settings.mutedBeats = 1u << 3;
+
+    ClickEngine engine;
+    engine.setSettings (settings);
+    engine.prepare (sampleRate);
+
+    MetronomeAudioProcessor processor;
+    processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+    processor.prepareToPlay (sampleRate, blockSize);
+    setParameter (processor, "bpm", 97.0f);
+    setParameter (processor, "beatsPerBar", 6.0f); // 7 beats
+    setParameter (processor, "beatDenominator", 3.0f); // Eighth notes
+    setParameter (processor, "subdivision", static_cast<float> (static_cast<int> (Subdivision::RestHalfHalfTriplet)));
+    setParameter (processor, "restSound", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::RestSoundType::RestSound)));
+    processor.toggleBeatMute (3);
+    setParameter (processor, "play", 1.0f);
+
+    juce::AudioBuffer<float> expected (2, blockSize);
+    juce::AudioBuffer<float> output (2, blockSize);
+    juce::MidiBuffer midi;
+
+    // Two bars and a half
+    for (int block = 0; block < 500; ++block)
+    {
+        INFO ("block " << block);
+
+        processor.processBlock (expected, midi);
+        engine.render (output.getArrayOfWritePointers(), output.getNumChannels(), blockSize);
+
+        for (int channel = 0; channel < 2; ++channel)
+            REQUIRE (std::equal (output.getReadPointer (channel), output.getReadPointer (channel) + blockSize, expected.getReadPointer (channel)));
+    }
+}
+
+TEST_CASE ("The core engine plays the groove and latency lead of the plugin", "[core]")
+{
+    // Swung sixteenths on a fractional beat length
+    ClickEngine::Settings settings;
+    settings.bpm = 97.0;
+    settings.subdivision = Subdivision::Quarter;
+
+    ClickEngine engine;
+    engine.setSettings (settings);
+    engine.prepare (sampleRate);
+
+    MetronomeAudioProcessor processor;
+    processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+    processor.prepareToPlay (sampleRate, blockSize);
+    setParameter (processor, "bpm", 97.0f);
+    setParameter (processor, "subdivision", static_cast<float> (static_cast<int> (Subdivision::Quarter)));
+    setParameter (processor, "groove", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::GrooveMode::SwingEighths)));
+    setParameter (processor, "swing", 66.0f);
+    setParameter (processor, "play", 1.0f);
+
+    // The same swing, as the plugin stores it
+    GrooveTable groove;
+    groove.compile (GrooveTemplate::swing (processor.getState().getRawParameterValue ("swing")->load(), 2),
+        BeatClock::computeSamplesPerBeat (sampleRate, settings.bpm, settings.beatDenominator),
+        settings.beatDenominator);
+    engine.setGridShift (&groove);
+
+    juce::AudioBuffer<float> expected (2, blockSize);
+    juce::AudioBuffer<float> output (2, blockSize);
+    juce::MidiBuffer midi;
+
+    for (int block = 0; block < 500; ++block)
+    {
+        INFO ("block " << block);
+
+        // Halfway, the clicks move 10 ms ahead of the grid while playing
+        if (block == 250)
+            setParameter (processor, "clickOffset", -10.0f);
+
+        processor.processBlock (expected, midi);
+        engine.setLead (processor.getTimelineLead(), block > 0);
+        engine.render (output.getArrayOfWritePointers(), output.getNumChannels(), blockSize);
+
+        for (int channel = 0; channel < 2; ++channel)
+            REQUIRE (std::equal (output.getReadPointer (channel), output.getReadPointer (channel) + blockSize, expected.getReadPointer (channel)));
+    }
+
+    CHECK (engine.getLead() == 480);
+}
+
+TEST_CASE ("A shorter bar in the core engine restarts past its end", "[core]")
+{
+    ClickEngine engine;
+    engine.prepare (sampleRate);
+
+    std::vector<float> samples (static_cast<size_t> (sampleRate * 2.0));
+    auto* channel = samples.data();
+
+    // Four beats of half a second: the last one is playing
+    engine.render (&channel, 1, static_cast<int> (samples.size()) - 1000);
+    REQUIRE (engine.getCurrentBeat() == 3);
+
+    auto settings = engine.getSettings();
+    settings.beatsPerBar = 3;
+    engine.setSettings (settings);
+    CHECK (engine.getCurrentBeat() == 0);
+}
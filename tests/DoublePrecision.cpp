@@ -0,0 +1,68 @@
+#include "helpers/test_helpers.h"
+#include <PluginProcessor.h>
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    /**
+     * Renders a few seconds of a busy pattern, with a hit on the input every 10000 samples
+     */
+    template <typename SampleType>
+    std::vector<SampleType> render (MetronomeAudioProcessor::InputMode inputMode)
+    {
+        constexpr int blockSize = 480;
+
+        MetronomeAudioProcessor processor;
+        processor.setProcessingPrecision (std::is_same_v<SampleType, double> ? juce::AudioProcessor::doublePrecision
+                                                                            : juce::AudioProcessor::singlePrecision);
+
+        prepareProcessor (processor, 48000.0, blockSize, juce::AudioChannelSet::mono(), juce::AudioChannelSet::stereo());
+
+        setParameter (processor, "bpm", 137.0f);
+        setParameter (processor, "subdivision", static_cast<float> (static_cast<int> (Subdivision::Triplet)));
+        setParameter (processor, "restSound", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::RestSoundType::RestSound)));
+        setParameter (processor, "inputMode", static_cast<float> (static_cast<int> (inputMode)));
+        setParameter (processor, "play", 1.0f);
+
+        juce::AudioBuffer<SampleType> buffer (2, blockSize);
+        juce::MidiBuffer midi;
+        std::vector<SampleType> output;
+
+        for (int64_t position = 0; position < 4 * 48000; position += blockSize)
+        {
+            buffer.clear();
+            for (int i = 0; i < blockSize; ++i)
+                if ((position + i) % 10000 < 32)
+                    buffer.setSample (0, i, static_cast<SampleType> (((position + i) % 2 == 0) ? 0.8 : -0.8));
+
+            processor.processBlock (buffer, midi);
+            output.insert (output.end(), buffer.getReadPointer (1), buffer.getReadPointer (1) + blockSize);
+        }
+
+        return output;
+    }
+}
+
+TEST_CASE ("Double precision renders the same clicks as single precision", "[precision]")
+{
+    MetronomeAudioProcessor processor;
+    CHECK (processor.supportsDoublePrecisionProcessing());
+
+    for (const auto inputMode : { MetronomeAudioProcessor::InputMode::Off,
+             MetronomeAudioProcessor::InputMode::AudioTap,
+             MetronomeAudioProcessor::InputMode::Practice })
+    {
+        const auto single = render<float> (inputMode);
+        const auto dual = render<double> (inputMode);
+
+        INFO ("input mode " << static_cast<int> (inputMode));
+        REQUIRE (single.size() == dual.size());
+
+        size_t numDifferences = 0;
+        for (size_t i = 0; i < single.size(); ++i)
+            if (static_cast<double> (single[i]) != dual[i])
+                ++numDifferences;
+
+        CHECK (numDifferences == 0);
+    }
+}
@@ -0,0 +1,74 @@
+#include "helpers/test_helpers.h"
+#include <DspLoadMonitor.h>
+#include <PluginProcessor.h>
+#include <catch2/catch_test_macros.hpp>
+#include <numeric>
+
+TEST_CASE ("DSP load histogram bins are octaves of the deadline", "[dspload]")
+{
+    CHECK (DspLoadStatistics::getBin (0.0f) == 0);
+    CHECK (DspLoadStatistics::getBin (1.0f / 1024.0f) == 0);
+    CHECK (DspLoadStatistics::getBin (1.0f / 512.0f) == 1);
+    CHECK (DspLoadStatistics::getBin (0.3f) == 8);
+    CHECK (DspLoadStatistics::getBin (0.99f) == 9);
+    CHECK (DspLoadStatistics::getBin (1.0f) == 10);
+    CHECK (DspLoadStatistics::getBin (50.0f) == 10);
+
+    for (int bin = 1; bin < DspLoadStatistics::numBins; ++bin)
+        CHECK (DspLoadStatistics::getBin (DspLoadStatistics::getBinLowerBound (bin)) == bin);
+}
+
+TEST_CASE ("DSP load monitor accumulates blocks", "[dspload]")
+{
+    DspLoadMonitor monitor;
+    monitor.prepare (48000.0);
+
+    const auto ticksPerSample = static_cast<double> (juce::Time::getHighResolutionTicksPerSecond()) / 48000.0;
+    auto ticksForLoad = [&] (double load) { return static_cast<int64_t> (load * 512.0 * ticksPerSample); };
+
+    monitor.addBlock (ticksForLoad (0.1), 512);
+    monitor.addBlock (ticksForLoad (0.1), 512);
+    monitor.addBlock (ticksForLoad (1.5), 512);
+
+    auto statistics = monitor.getStatistics();
+    CHECK (statistics.numBlocks == 3);
+    CHECK (statistics.numOverruns == 1);
+    CHECK (statistics.peakLoad > 1.4f);
+    CHECK (statistics.lastLoad > 1.4f);
+    CHECK (statistics.averageLoad > 0.5f);
+    CHECK (statistics.averageLoad < 0.6f);
+    CHECK (statistics.histogram[static_cast<size_t> (DspLoadStatistics::getBin (0.1f))] == 2);
+    CHECK (statistics.histogram[DspLoadStatistics::numBins - 1] == 1);
+
+    // A reset takes effect at the next block
+    monitor.reset();
+    monitor.addBlock (ticksForLoad (0.1), 512);
+
+    statistics = monitor.getStatistics();
+    CHECK (statistics.numBlocks == 1);
+    CHECK (statistics.numOverruns == 0);
+    CHECK (statistics.peakLoad < 0.2f);
+}
+
+TEST_CASE ("processBlock reports its DSP load", "[dspload]")
+{
+    MetronomeAudioProcessor processor;
+    prepareProcessor (processor, 48000.0, 512, juce::AudioChannelSet::disabled(), juce::AudioChannelSet::stereo());
+    setParameter (processor, "play", 1.0f);
+
+    juce::AudioBuffer<float> buffer (2, 512);
+    juce::MidiBuffer midi;
+
+    for (int block = 0; block < 100; ++block)
+        processor.processBlock (buffer, midi);
+
+    const auto statistics = processor.getDspLoadStatistics();
+    CHECK (statistics.numBlocks == 100);
+    CHECK (std::accumulate (statistics.histogram.begin(), statistics.histogram.end(), int64_t { 0 }) == 100);
+    CHECK (statistics.peakLoad >= statistics.averageLoad);
+    CHECK (statistics.peakBlockMicroseconds > 0.0);
+
+    processor.resetDspLoadStatistics();
+    processor.processBlock (buffer, midi);
+    CHECK (processor.getDspLoadStatistics().numBlocks == 1);
+}
@@ -0,0 +1,123 @@
+#include "helpers/test_helpers.h"
+#include <PluginProcessor.h>
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 480;
+    constexpr int64_t samplesPerBeat = 24000; // 120 BPM at 48 kHz
+
+    void setClickType (MetronomeAudioProcessor& processor, MetronomeAudioProcessor::ClickType type)
+    {
+        setParameter (processor, "firstBeatSound", static_cast<float> (static_cast<int> (type)));
+        setParameter (processor, "otherBeatsSound", static_cast<float> (static_cast<int> (type)));
+    }
+
+    /**
+     * Plays one bar of 4/4 at 120 BPM on a stereo output and returns both channels
+     */
+    std::array<std::vector<float>, 2> renderBar (MetronomeAudioProcessor& processor)
+    {
+        processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+        processor.prepareToPlay (sampleRate, blockSize);
+        setParameter (processor, "bpm", 120.0f);
+        setParameter (processor, "play", 1.0f);
+
+        juce::AudioBuffer<float> buffer (2, blockSize);
+        juce::MidiBuffer midi;
+        std::array<std::vector<float>, 2> output;
+
+        for (int64_t position = 0; position < 4 * samplesPerBeat; position += blockSize)
+        {
+            processor.processBlock (buffer, midi);
+
+            for (int channel = 0; channel < 2; ++channel)
+                output[static_cast<size_t> (channel)].insert (output[static_cast<size_t> (channel)].end(),
+                    buffer.getReadPointer (channel),
+                    buffer.getReadPointer (channel) + blockSize);
+        }
+
+        return output;
+    }
+
+    float getPeak (const std::vector<float>& samples, int64_t start, int64_t length)
+    {
+        auto peak = 0.0f;
+        for (auto i = start; i < start + length && i < static_cast<int64_t> (samples.size()); ++i)
+            peak = std::max (peak, std::abs (samples[static_cast<size_t> (i)]));
+
+        return peak;
+    }
+}
+
+TEST_CASE ("A centred track at unity gain sounds like the main click", "[ensemble]")
+{
+    MetronomeAudioProcessor mainClick;
+    setClickType (mainClick, MetronomeAudioProcessor::ClickType::Low);
+    const auto expected = renderBar (mainClick);
+
+    MetronomeAudioProcessor track;
+    setClickType (track, MetronomeAudioProcessor::ClickType::Mute);
+    setParameter (track, "track1Enabled", 1.0f);
+    setParameter (track, "track1Sound", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::ClickType::Low)));
+    const auto output = renderBar (track);
+
+    CHECK (output[0] == expected[0]);
+    CHECK (output[1] == expected[1]);
+}
+
+TEST_CASE ("Tracks play their own subdivisions on the shared grid", "[ensemble]")
+{
+    MetronomeAudioProcessor processor;
+    setClickType (processor, MetronomeAudioProcessor::ClickType::Mute);
+
+    // Sixteenths hard left, quarters hard right
+    setParameter (processor, "track1Enabled", 1.0f);
+    setParameter (processor, "track1Subdivision", static_cast<float> (static_cast<int> (Subdivision::Quarter)));
+    setParameter (processor, "track1Pan", -1.0f);
+
+    setParameter (processor, "track3Enabled", 1.0f);
+    setParameter (processor, "track3Pan", 1.0f);
+
+    const auto output = renderBar (processor);
+    const auto left = findOnsets (output[0]);
+    const auto right = findOnsets (output[1]);
+
+    REQUIRE (left.size() == 16);
+    for (size_t i = 0; i < left.size(); ++i)
+        CHECK (left[i] == static_cast<int64_t> (i) * samplesPerBeat / 4);
+
+    REQUIRE (right.size() == 4);
+    for (size_t i = 0; i < right.size(); ++i)
+        CHECK (right[i] == static_cast<int64_t> (i) * samplesPerBeat);
+}
+
+TEST_CASE ("Track accents, gain and the main click mix together", "[ensemble]")
+{
+    MetronomeAudioProcessor mainOnly;
+    const auto mainClick = renderBar (mainOnly);
+
+    MetronomeAudioProcessor processor;
+    setParameter (processor, "track2Enabled", 1.0f);
+    setParameter (processor, "track2Subdivision", static_cast<float> (static_cast<int> (Subdivision::Half)));
+    setParameter (processor, "track2Accent", static_cast<float> (static_cast<int> (EnsembleTracks::Accent::Bar)));
+    setParameter (processor, "track2Gain", -6.0f);
+    const auto output = renderBar (processor);
+
+    // The track alone: what the main click does not account for
+    std::vector<float> track (output[0].size());
+    for (size_t i = 0; i < track.size(); ++i)
+        track[i] = output[0][i] - mainClick[0][i];
+
+    const auto gain = juce::Decibels::decibelsToGain (-6.0f);
+    const auto accented = getPeak (track, 0, samplesPerBeat / 2);
+    CHECK (accented > 0.4f * gain);
+
+    for (int64_t click = 1; click < 8; ++click)
+    {
+        INFO ("click " << click);
+        const auto peak = getPeak (track, click * samplesPerBeat / 2, samplesPerBeat / 2);
+        CHECK (std::abs (peak - accented * EnsembleTracks::unaccentedLevel) < 1.0e-4f);
+    }
+}
@@ -0,0 +1,182 @@
+#include "helpers/test_helpers.h"
+#include <PluginProcessor.h>
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 480;
+    constexpr double samplesPerBeat = 24000.0; // 120 BPM at 48 kHz
+
+    std::vector<int64_t> renderOnsets (MetronomeAudioProcessor& processor, int64_t length)
+    {
+        processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+        processor.prepareToPlay (sampleRate, blockSize);
+        setParameter (processor, "bpm", 120.0f);
+        setParameter (processor, "play", 1.0f);
+
+        juce::AudioBuffer<float> buffer (2, blockSize);
+        juce::MidiBuffer midi;
+        OnsetFinder onsetFinder;
+
+        for (int64_t position = 0; position < length; position += blockSize)
+        {
+            processor.processBlock (buffer, midi);
+            onsetFinder.process (buffer.getReadPointer (0), blockSize, position);
+        }
+
+        return onsetFinder.getOnsets();
+    }
+}
+
+TEST_CASE ("Swing moves the off-beat subdivisions and keeps the beats", "[groove]")
+{
+    GrooveTable table;
+    table.compile (GrooveTemplate::swing (66.7f, 2), samplesPerBeat);
+
+    for (int beat = 0; beat < 4; ++beat)
+    {
+        INFO ("beat " << beat);
+
+        // Second eighth at two thirds of the beat instead of half-way
+        CHECK (std::abs (table.getOffset (beat, 1, 2) - 4000) <= 10);
+
+        // Sixteenths move in proportion with the eighths around them
+        CHECK (std::abs (table.getOffset (beat, 1, 4) - 2000) <= 10);
+        CHECK (std::abs (table.getOffset (beat, 3, 4) - 2000) <= 10);
+    }
+
+    table.compile (GrooveTemplate::swing (50.0f, 2), samplesPerBeat);
+    CHECK (table.getOffset (0, 1, 2) == 0);
+    CHECK (table.getOffset (0, 2, 3) == 0);
+}
+
+TEST_CASE ("Grooves are defined per quarter note, whatever the beat unit", "[groove]")
+{
+    // In 6/8 at 120 BPM, an eighth-note beat is half as long
+    constexpr double samplesPerEighth = samplesPerBeat / 2.0;
+    GrooveTable table;
+
+    // Swung sixteenths: the second sixteenth of each eighth-note beat is late
+    table.compile (GrooveTemplate::swing (66.7f, 4), samplesPerEighth, 8);
+    for (int beat = 0; beat < 6; ++beat)
+    {
+        INFO ("beat " << beat);
+        CHECK (std::abs (table.getOffset (beat, 1, 2) - 2000) <= 10);
+    }
+
+    // Swung eighths move the beats themselves, which stay on the grid: nothing moves inside them
+    table.compile (GrooveTemplate::swing (66.7f, 2), samplesPerEighth, 8);
+    for (int beat = 0; beat < 6; ++beat)
+    {
+        INFO ("beat " << beat);
+        CHECK (table.getOffset (beat, 1, 2) == 0);
+        CHECK (std::abs (table.getOffset (beat, 1, 3)) <= 1);
+    }
+
+    // In x/2, the half of a beat is a quarter note and the eighths swing between them
+    table.compile (GrooveTemplate::swing (66.7f, 2), 2.0 * samplesPerBeat, 2);
+    CHECK (table.getOffset (0, 1, 2) == 0);
+    CHECK (std::abs (table.getOffset (0, 1, 4) - 4000) <= 10);
+}
+
+TEST_CASE ("The engine plays the subdivisions where the groove puts them", "[groove]")
+{
+    MetronomeAudioProcessor processor;
+    setParameter (processor, "subdivision", static_cast<float> (static_cast<int> (Subdivision::Half)));
+    setParameter (processor, "groove", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::GrooveMode::SwingEighths)));
+    setParameter (processor, "swing", 75.0f);
+
+    const auto onsets = renderOnsets (processor, 2 * static_cast<int64_t> (samplesPerBeat));
+
+    REQUIRE (onsets.size() == 4);
+    CHECK (onsets[0] == 0);
+    CHECK (onsets[1] == 18000);
+    CHECK (onsets[2] == 24000);
+    CHECK (onsets[3] == 42000);
+}
+
+TEST_CASE ("A groove is extracted from the timing of a MIDI file", "[groove]")
+{
+    // One bar of sixteenths, the odd ones a quarter of a sixteenth late
+    constexpr int ticksPerQuarterNote = 96;
+    constexpr int ticksPerSixteenth = ticksPerQuarterNote / 4;
+
+    juce::MidiMessageSequence sequence;
+    for (int step = 0; step < 16; ++step)
+    {
+        const auto time = step * ticksPerSixteenth + (step % 2 == 1 ? ticksPerSixteenth / 4 : 0);
+        sequence.addEvent (juce::MidiMessage::noteOn (10, 38, static_cast<juce::uint8> (100)), time);
+        sequence.addEvent (juce::MidiMessage::noteOff (10, 38), time + 6);
+    }
+
+    juce::MidiFile file;
+    file.setTicksPerQuarterNote (ticksPerQuarterNote);
+    file.addTrack (sequence);
+
+    const auto groove = GrooveTemplate::fromMidiFile (file);
+    REQUIRE (groove.numSteps == 16);
+    CHECK (groove.stepsPerBeat == 4);
+
+    for (int step = 0; step < 16; ++step)
+    {
+        INFO ("step " << step);
+        CHECK (std::abs (groove.getOffset (step) - (step % 2 == 1 ? 0.25f : 0.0f)) < 1.0e-6f);
+    }
+
+    // Late sixteenths, straight eighths
+    GrooveTable table;
+    table.compile (groove, samplesPerBeat);
+    CHECK (table.getOffset (0, 1, 4) == 1500);
+    CHECK (table.getOffset (0, 1, 2) == 0);
+    CHECK (table.getOffset (0, 3, 4) == 1500);
+}
+
+TEST_CASE ("The imported groove is saved with the state", "[groove]")
+{
+    GrooveTemplate groove;
+    groove.stepsPerBeat = 4;
+    groove.numSteps = 16;
+    for (size_t step = 0; step < 16; ++step)
+        groove.offsets[step] = step % 4 == 0 ? 0.0f : 0.1f * static_cast<float> (step % 4);
+
+    MetronomeAudioProcessor processor;
+    processor.setImportedGroove (groove);
+
+    juce::MemoryBlock state;
+    processor.getStateInformation (state);
+
+    MetronomeAudioProcessor restored;
+    restored.setStateInformation (state.getData(), static_cast<int> (state.getSize()));
+
+    const auto& imported = restored.getImportedGroove();
+    CHECK (imported.stepsPerBeat == groove.stepsPerBeat);
+    REQUIRE (imported.numSteps == groove.numSteps);
+    CHECK (imported.offsets == groove.offsets);
+}
+
+TEST_CASE ("A damaged groove is read within its limits", "[groove]")
+{
+    for (const auto stepsPerBeat : { -3, 0, 1 << 30 })
+    {
+        INFO ("steps per beat " << stepsPerBeat);
+
+        juce::MemoryOutputStream stream;
+        stream.writeInt (stepsPerBeat);
+        stream.writeInt (1000);
+        for (int step = 0; step < 4; ++step)
+            stream.writeFloat (0.1f);
+
+        GrooveTemplate groove;
+        juce::MemoryInputStream input (stream.getData(), stream.getDataSize(), false);
+        groove.readFrom (input);
+
+        CHECK (groove.stepsPerBeat >= 1);
+        CHECK (groove.stepsPerBeat <= GrooveTemplate::maxSteps);
+        CHECK (groove.numSteps <= GrooveTemplate::maxSteps);
+
+        // Still usable by the engine
+        GrooveTable table;
+        table.compile (groove, samplesPerBeat);
+    }
+}
@@ -0,0 +1,58 @@
+#include "helpers/test_helpers.h"
+#include <PluginProcessor.h>
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE ("Stopped processor outputs flagged silence", "[idle]")
+{
+    MetronomeAudioProcessor processor;
+    processor.setRateAndBufferSizeDetails (48000.0, 512);
+    processor.prepareToPlay (48000.0, 512);
+
+    juce::AudioBuffer<float> buffer (2, 512);
+    juce::MidiBuffer midi;
+
+    for (int block = 0; block < 4; ++block)
+    {
+        // Whatever the host left in the buffer
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            juce::FloatVectorOperations::fill (buffer.getWritePointer (channel), 0.25f, buffer.getNumSamples());
+
+        processor.processBlock (buffer, midi);
+
+        CHECK (buffer.hasBeenCleared());
+        CHECK (buffer.getMagnitude (0, buffer.getNumSamples()) == 0.0f);
+    }
+}
+
+TEST_CASE ("Settings changed while parked apply from the first played sample", "[idle]")
+{
+    MetronomeAudioProcessor processor;
+
+    prepareProcessor (processor, 48000.0, 512);
+
+    juce::AudioBuffer<float> buffer (1, 512);
+    juce::MidiBuffer midi;
+    processor.processBlock (buffer, midi);
+
+    // Changed while idle: only picked up when playback starts
+    setParameter (processor, "bpm", 240.0f);
+    setParameter (processor, "otherBeatsSound", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::ClickType::High)));
+    processor.processBlock (buffer, midi);
+
+    setParameter (processor, "play", 1.0f);
+
+    // 240 BPM at 48 kHz: a beat every 12000 samples, the first one at once
+    OnsetFinder onsetFinder;
+    for (int64_t position = 0; position < 48000; position += 512)
+    {
+        processor.processBlock (buffer, midi);
+        onsetFinder.process (buffer.getReadPointer (0), 512, position);
+    }
+
+    const auto& onsets = onsetFinder.getOnsets();
+
+    REQUIRE (onsets.size() >= 4);
+    CHECK (onsets[0] == 0);
+    CHECK (onsets[1] == 12000);
+    CHECK (onsets[3] == 36000);
+}
@@ -0,0 +1,108 @@
+#include "helpers/test_helpers.h"
+#include <PluginProcessor.h>
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+    constexpr int64_t samplesPerBeat = 24000; // 120 BPM at 48 kHz
+
+    void prepare (MetronomeAudioProcessor& processor)
+    {
+        prepareProcessor (processor, sampleRate, blockSize);
+
+        setParameter (processor, "bpm", 120.0f);
+        setParameter (processor, "firstBeatSound", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::ClickType::High)));
+        setParameter (processor, "otherBeatsSound", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::ClickType::High)));
+    }
+
+    /**
+     * Plays for the given number of beats and returns the click onsets, from the first played sample.
+     * The callback runs before each block with the position of its first sample.
+     */
+    template <typename BeforeBlock>
+    std::vector<int64_t> renderOnsets (MetronomeAudioProcessor& processor, int numBeats, BeforeBlock&& beforeBlock)
+    {
+        juce::AudioBuffer<float> buffer (1, blockSize);
+        juce::MidiBuffer midi;
+
+        processor.processBlock (buffer, midi);
+        setParameter (processor, "play", 1.0f);
+
+        OnsetFinder finder;
+
+        for (int64_t position = 0; position < numBeats * samplesPerBeat; position += blockSize)
+        {
+            beforeBlock (position);
+            processor.processBlock (buffer, midi);
+            finder.process (buffer.getReadPointer (0), blockSize, position);
+        }
+
+        return finder.getOnsets();
+    }
+}
+
+TEST_CASE ("Host latency mode reports the click offset to the host", "[latency]")
+{
+    MetronomeAudioProcessor processor;
+    setParameter (processor, "clickOffset", -10.0f);
+
+    setParameter (processor, "latencyMode", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::LatencyMode::Host)));
+    prepare (processor);
+    CHECK (processor.getLatencySamples() == 480);
+
+    // The host moves the output: the engine itself does not lead
+    juce::AudioBuffer<float> buffer (1, blockSize);
+    juce::MidiBuffer midi;
+    processor.processBlock (buffer, midi);
+    CHECK (processor.getTimelineLead() == 0);
+
+    setParameter (processor, "latencyMode", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::LatencyMode::Manual)));
+    processor.prepareToPlay (sampleRate, blockSize);
+    CHECK (processor.getLatencySamples() == 0);
+}
+
+TEST_CASE ("Click offset renders the click ahead of the grid", "[latency]")
+{
+    MetronomeAudioProcessor processor;
+    prepare (processor);
+
+    // Ten milliseconds earlier from the middle of the third beat
+    const auto changeAt = 2 * samplesPerBeat + samplesPerBeat / 2;
+    const auto onsets = renderOnsets (processor, 8, [&] (int64_t position) {
+        if (position <= changeAt && changeAt < position + blockSize)
+            setParameter (processor, "clickOffset", -10.0f);
+    });
+
+    REQUIRE (onsets.size() >= 8);
+    for (size_t beat = 0; beat < 8; ++beat)
+    {
+        INFO ("beat " << beat);
+        const auto ideal = static_cast<int64_t> (beat) * samplesPerBeat;
+        CHECK (onsets[beat] == (ideal > changeAt ? ideal - 480 : ideal));
+    }
+
+    CHECK (processor.getTimelineLead() == 480);
+}
+
+TEST_CASE ("Device latency mode adds the device output latency", "[latency]")
+{
+    MetronomeAudioProcessor processor;
+    prepare (processor);
+    processor.setDeviceOutputLatency (256);
+    setParameter (processor, "clickOffset", -1.0f);
+
+    const auto changeAt = samplesPerBeat / 2;
+    const auto onsets = renderOnsets (processor, 4, [&] (int64_t position) {
+        if (position <= changeAt && changeAt < position + blockSize)
+            setParameter (processor, "latencyMode", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::LatencyMode::Device)));
+    });
+
+    // The offset alone was already applied before playback started
+    REQUIRE (onsets.size() >= 4);
+    CHECK (onsets[0] == 0);
+    CHECK (onsets[1] == samplesPerBeat - 256);
+    CHECK (onsets[3] == 3 * samplesPerBeat - 256);
+    CHECK (processor.getTimelineLead() == 48 + 256);
+}
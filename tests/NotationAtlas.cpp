@@ -0,0 +1,81 @@
+#include <NotationAtlas.h>
+#include <NotationManager.h>
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    int countInkedPixels (const juce::Image& image, juce::Rectangle<int> area)
+    {
+        const juce::Image::BitmapData pixels (image, juce::Image::BitmapData::readOnly);
+        int count = 0;
+
+        for (int y = area.getY(); y < area.getBottom(); ++y)
+            for (int x = area.getX(); x < area.getRight(); ++x)
+                if (pixels.getPixelColour (x, y).getAlpha() > 0)
+                    ++count;
+
+        return count;
+    }
+}
+
+TEST_CASE ("Patterns are written with the symbols of the atlas", "[notationAtlas]")
+{
+    for (const auto denominator : { 1, 2, 4, 8 })
+    {
+        for (const auto& pattern : NotationManager::getPatternsForDenominator (denominator))
+        {
+            INFO (pattern.first);
+            CHECK (NotationAtlas::startsWithNotation (pattern.first));
+        }
+    }
+
+    CHECK_FALSE (NotationAtlas::startsWithNotation ("Straight"));
+    CHECK_FALSE (NotationAtlas::startsWithNotation ({}));
+}
+
+TEST_CASE ("Symbols are rasterized once per pixel size", "[notationAtlas]")
+{
+    juce::SharedResourcePointer<NotationAtlas> atlas;
+    const auto pattern = NotationManager::getPatternsForDenominator (4)[0].first;
+    const auto initialAtlases = atlas->getNumAtlases();
+
+    juce::Image image (juce::Image::ARGB, 400, 40, true);
+
+    {
+        juce::Graphics g (image);
+        g.setColour (juce::Colours::white);
+        atlas->draw (g, pattern, { 0.0f, 0.0f, 400.0f, 40.0f }, 19.0f);
+        atlas->draw (g, pattern, { 0.0f, 0.0f, 400.0f, 40.0f }, 19.0f);
+    }
+
+    CHECK (atlas->getNumAtlases() == initialAtlases + 1);
+
+    // The same size on a display at twice the density is another atlas
+    juce::Image doubleDensity (juce::Image::ARGB, 800, 80, true);
+
+    {
+        juce::Graphics g (doubleDensity);
+        g.addTransform (juce::AffineTransform::scale (2.0f));
+        g.setColour (juce::Colours::white);
+        atlas->draw (g, pattern, { 0.0f, 0.0f, 400.0f, 40.0f }, 19.0f);
+    }
+
+    CHECK (atlas->getNumAtlases() == initialAtlases + 2);
+}
+
+TEST_CASE ("A pattern is drawn as its symbols followed by its name", "[notationAtlas]")
+{
+    juce::SharedResourcePointer<NotationAtlas> atlas;
+
+    // Symbols only, then a name only: the symbols are blitted in the current colour on the left
+    juce::Image image (juce::Image::ARGB, 300, 40, true);
+
+    {
+        juce::Graphics g (image);
+        g.setColour (juce::Colours::white);
+        atlas->draw (g, NotationManager::getPatternsForDenominator (4)[0].first, { 0.0f, 0.0f, 300.0f, 40.0f }, 20.0f);
+    }
+
+    CHECK (countInkedPixels (image, { 0, 0, 40, 40 }) > 0);
+    CHECK (countInkedPixels (image, image.getBounds()) > countInkedPixels (image, { 0, 0, 40, 40 }));
+}
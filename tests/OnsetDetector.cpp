@@ -0,0 +1,138 @@
+#include <OnsetDetector.h>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+
+    // The noise floor starting is an onset itself: clicks come once the threshold has settled on it
+    constexpr int64_t warmUp = 9600;
+
+    /** A click train over quiet noise: decaying 1.5 kHz bursts at the given positions */
+    std::vector<float> renderClickTrain (const std::vector<int64_t>& clicks, int64_t length)
+    {
+        std::vector<float> signal (static_cast<size_t> (length));
+        std::minstd_rand random (1234);
+        std::uniform_real_distribution<float> noise (-0.001f, 0.001f);
+
+        for (auto& sample : signal)
+            sample = noise (random);
+
+        for (const auto click : clicks)
+        {
+            for (int64_t i = 0; i < 1440 && click + i < length; ++i)
+            {
+                const auto time = static_cast<double> (i) / sampleRate;
+                signal[static_cast<size_t> (click + i)] += static_cast<float> (0.8 * std::exp (-time / 0.008) * std::sin (2.0 * 3.14159265358979 * 1500.0 * time));
+            }
+        }
+
+        return signal;
+    }
+
+    std::vector<int64_t> detectOnsets (OnsetDetector& detector, const std::vector<float>& signal, int blockSize)
+    {
+        std::vector<int64_t> onsets;
+        const auto length = static_cast<int64_t> (signal.size());
+
+        for (int64_t position = 0; position < length; position += blockSize)
+        {
+            const auto numSamples = static_cast<int> (std::min<int64_t> (blockSize, length - position));
+            detector.process (signal.data() + position, numSamples, position, [&onsets] (int64_t onset) {
+                if (onset >= warmUp)
+                    onsets.push_back (onset);
+            });
+        }
+
+        return onsets;
+    }
+}
+
+TEST_CASE ("Every click of a click train is detected at its attack", "[onset]")
+{
+    // 100 BPM, with a few clicks pushed off the grid
+    std::vector<int64_t> clicks;
+    for (int64_t beat = 0; beat < 12; ++beat)
+        clicks.push_back (warmUp + 4800 + beat * 28800 + (beat % 3 == 2 ? 1234 : 0));
+
+    const auto signal = renderClickTrain (clicks, clicks.back() + 24000);
+
+    OnsetDetector detector;
+    detector.prepare (sampleRate);
+    const auto onsets = detectOnsets (detector, signal, 512);
+
+    REQUIRE (onsets.size() == clicks.size());
+    for (size_t i = 0; i < clicks.size(); ++i)
+    {
+        INFO ("click " << i);
+
+        // Within a millisecond of the attack
+        CHECK (std::abs (onsets[i] - clicks[i]) <= 48);
+    }
+}
+
+TEST_CASE ("Onsets do not depend on the block size", "[onset]")
+{
+    std::vector<int64_t> clicks;
+    for (int64_t beat = 0; beat < 8; ++beat)
+        clicks.push_back (warmUp + 2000 + beat * 21000);
+
+    const auto signal = renderClickTrain (clicks, clicks.back() + 24000);
+
+    OnsetDetector detector;
+    detector.prepare (sampleRate);
+    const auto reference = detectOnsets (detector, signal, 480);
+
+    for (const auto blockSize : { 1, 37, 64, 1024, 4096 })
+    {
+        INFO ("block size " << blockSize);
+
+        detector.reset();
+        CHECK (detectOnsets (detector, signal, blockSize) == reference);
+    }
+}
+
+TEST_CASE ("Silence, noise and bounces give no extra onsets", "[onset]")
+{
+    OnsetDetector detector;
+    detector.prepare (sampleRate);
+
+    // Two seconds of quiet noise
+    CHECK (detectOnsets (detector, renderClickTrain ({}, 96000), 512).empty());
+
+    // A flam 30 ms after a click falls in the refractory period
+    detector.reset();
+    const auto onsets = detectOnsets (detector, renderClickTrain ({ 20000, 21440, 50000 }, 72000), 512);
+
+    REQUIRE (onsets.size() == 2);
+    CHECK (std::abs (onsets[0] - 20000) <= 48);
+    CHECK (std::abs (onsets[1] - 50000) <= 48);
+}
+
+TEST_CASE ("Higher sample rates keep the timing accuracy", "[onset]")
+{
+    constexpr double highRate = 96000.0;
+
+    std::vector<float> signal (192000);
+    for (const int64_t click : { 19200, 67200, 115200, 163200 })
+    {
+        for (int64_t i = 0; i < 2880; ++i)
+        {
+            const auto time = static_cast<double> (i) / highRate;
+            signal[static_cast<size_t> (click + i)] = static_cast<float> (0.8 * std::exp (-time / 0.008) * std::sin (2.0 * 3.14159265358979 * 1500.0 * time));
+        }
+    }
+
+    OnsetDetector detector;
+    detector.prepare (highRate);
+    CHECK (detector.getHopSize() == 512); // Twice the samples, the same 5 ms hops
+
+    const auto onsets = detectOnsets (detector, signal, 512);
+
+    REQUIRE (onsets.size() == 4);
+    CHECK (std::abs (onsets[0] - 19200) <= 96);
+    CHECK (std::abs (onsets[3] - 163200) <= 96);
+}
@@ -10,12 +10,28 @@ TEST_CASE ("one is equal to one", "[dummy]")
 
 TEST_CASE ("Plugin instance", "[instance]")
 {
-    PluginProcessor testPlugin;
+    MetronomeAudioProcessor testPlugin;
 
     SECTION ("name")
     {
         CHECK_THAT (testPlugin.getName().toStdString(),
-            Catch::Matchers::Equals ("Pamplejuce Demo"));
+            Catch::Matchers::Equals ("BeatIt"));
+    }
+
+    SECTION ("parameters")
+    {
+        juce::StringArray parameterIDs;
+        for (auto* parameter : testPlugin.getParameters())
+        {
+            const auto parameterID = static_cast<juce::RangedAudioParameter*> (parameter)->getParameterID();
+            CHECK_FALSE (parameterIDs.contains (parameterID));
+            parameterIDs.add (parameterID);
+        }
+
+        // Rests are silent unless asked otherwise
+        auto* restSound = testPlugin.getState().getParameter ("restSound");
+        REQUIRE (restSound != nullptr);
+        CHECK (static_cast<int> (restSound->convertFrom0to1 (restSound->getDefaultValue())) == 2);
     }
 }
 
@@ -0,0 +1,91 @@
+#include "helpers/test_helpers.h"
+#include <PluginProcessor.h>
+#include <StateFormat.h>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    float getParameter (MetronomeAudioProcessor& processor, const juce::String& parameterID)
+    {
+        auto* parameter = processor.getState().getParameter (parameterID);
+        return parameter->convertFrom0to1 (parameter->getValue());
+    }
+}
+
+TEST_CASE ("The binary state restores parameters, mutes and presets", "[state]")
+{
+    MetronomeAudioProcessor processor;
+    processor.setCurrentProgram (2);
+    setParameter (processor, "bpm", 97.0f);
+    setParameter (processor, "beatsPerBar", 4.0f); // 5 beats
+    setParameter (processor, "subdivision", static_cast<float> (static_cast<int> (Subdivision::Triplet)));
+    setParameter (processor, "swing", 62.5f);
+    processor.setMutedBeats ({ false, true, false, true, false });
+
+    juce::MemoryBlock state;
+    processor.getStateInformation (state);
+    REQUIRE (StateFormat::isBinaryState (state.getData(), static_cast<int> (state.getSize())));
+
+    MetronomeAudioProcessor restored;
+    restored.setStateInformation (state.getData(), static_cast<int> (state.getSize()));
+
+    CHECK (getParameter (restored, "bpm") == 97.0f);
+    CHECK (restored.getBeatsPerBar() == 5);
+    CHECK (getParameter (restored, "subdivision") == static_cast<float> (static_cast<int> (Subdivision::Triplet)));
+    CHECK (std::abs (getParameter (restored, "swing") - 62.5f) < 0.05f);
+    CHECK (restored.getMutedBeats() == std::vector<bool> { false, true, false, true, false });
+    CHECK (restored.getCurrentProgram() == 2);
+}
+
+TEST_CASE ("States saved as XML by earlier versions are still read", "[state]")
+{
+    MetronomeAudioProcessor original;
+    setParameter (original, "bpm", 143.0f);
+    setParameter (original, "beatsPerBar", 2.0f); // 3 beats
+
+    // The format of earlier versions: the parameter tree, with the mutes as a property
+    auto tree = original.getState().copyState();
+    tree.setProperty ("mutedBeats", "1,0,1", nullptr);
+
+    juce::MemoryBlock state;
+    juce::AudioProcessor::copyXmlToBinary (*tree.createXml(), state);
+    REQUIRE_FALSE (StateFormat::isBinaryState (state.getData(), static_cast<int> (state.getSize())));
+
+    MetronomeAudioProcessor restored;
+    restored.setStateInformation (state.getData(), static_cast<int> (state.getSize()));
+
+    CHECK (getParameter (restored, "bpm") == 143.0f);
+    CHECK (restored.getBeatsPerBar() == 3);
+    CHECK (restored.getMutedBeats() == std::vector<bool> { true, false, true });
+}
+
+TEST_CASE ("A state from a newer format version leaves the current one untouched", "[state]")
+{
+    MetronomeAudioProcessor processor;
+    setParameter (processor, "bpm", 97.0f);
+    setParameter (processor, "swing", 62.5f);
+
+    // A parameter chunk the current reader could parse, behind an unsupported version
+    juce::MemoryBlock state;
+    {
+        juce::MemoryOutputStream payload;
+        payload.writeInt (1);
+        payload.writeString ("bpm");
+        payload.writeFloat (200.0f);
+
+        juce::MemoryOutputStream stream (state, false);
+        stream.writeInt (StateFormat::magic);
+        stream.writeInt (StateFormat::version + 1);
+        stream.writeInt (StateFormat::parametersTag);
+        stream.writeInt (static_cast<int> (payload.getDataSize()));
+        stream.write (payload.getData(), payload.getDataSize());
+    }
+
+    processor.setStateInformation (state.getData(), static_cast<int> (state.getSize()));
+
+    // Neither read nor reset to the defaults
+    CHECK (getParameter (processor, "bpm") == 97.0f);
+    CHECK (std::abs (getParameter (processor, "swing") - 62.5f) < 0.05f);
+}
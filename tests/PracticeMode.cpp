@@ -0,0 +1,93 @@
+#include "helpers/test_helpers.h"
+#include <PluginProcessor.h>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 480;
+    constexpr int64_t samplesPerBeat = 24000; // 120 BPM at 48 kHz
+
+    /** A hit of the player: a decaying 1.5 kHz burst */
+    float hitSample (int64_t sinceHit)
+    {
+        if (sinceHit < 0 || sinceHit >= 1440)
+            return 0.0f;
+
+        const auto time = static_cast<double> (sinceHit) / sampleRate;
+        return static_cast<float> (0.8 * std::exp (-time / 0.008) * std::sin (2.0 * 3.14159265358979 * 1500.0 * time));
+    }
+
+    /**
+     * Plays in Practice mode with a hit at the same position of beats 1 to 6, and returns the statistics
+     */
+    TimingStatistics practice (MetronomeAudioProcessor& processor, int64_t positionInBeat)
+    {
+        prepareProcessor (processor, sampleRate, blockSize, juce::AudioChannelSet::mono(), juce::AudioChannelSet::stereo());
+
+        setParameter (processor, "bpm", 120.0f);
+        setParameter (processor, "inputMode", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::InputMode::Practice)));
+
+        juce::AudioBuffer<float> buffer (2, blockSize);
+        juce::MidiBuffer midi;
+
+        buffer.clear();
+        processor.processBlock (buffer, midi);
+        setParameter (processor, "play", 1.0f);
+
+        for (int64_t position = 0; position < 8 * samplesPerBeat; position += blockSize)
+        {
+            buffer.clear();
+
+            auto* input = buffer.getWritePointer (0);
+            for (int i = 0; i < blockSize; ++i)
+                for (int64_t beat = 1; beat <= 6; ++beat)
+                    input[i] += hitSample (position + i - beat * samplesPerBeat - positionInBeat);
+
+            processor.processBlock (buffer, midi);
+        }
+
+        return processor.getTimingStatistics();
+    }
+}
+
+TEST_CASE ("Practice hits are matched with the subdivision they aim at", "[practice]")
+{
+    MetronomeAudioProcessor processor;
+    setParameter (processor, "subdivision", static_cast<float> (static_cast<int> (Subdivision::Half)));
+
+    // 20 ms early on the off-beat, half a beat away from both beats
+    const auto statistics = practice (processor, samplesPerBeat / 2 - 960);
+
+    CHECK (statistics.numHits == 6);
+    CHECK (std::abs (statistics.lastDeviationMs + 20.0f) < 1.5f);
+    CHECK (std::abs (statistics.meanMs + 20.0f) < 1.5f);
+}
+
+TEST_CASE ("Practice hits are matched with the swung subdivision", "[practice]")
+{
+    MetronomeAudioProcessor processor;
+    setParameter (processor, "subdivision", static_cast<float> (static_cast<int> (Subdivision::Half)));
+    setParameter (processor, "groove", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::GrooveMode::SwingEighths)));
+    setParameter (processor, "swing", 66.7f);
+
+    // 10 ms before the swung "and", two thirds of the way through the beat
+    const auto statistics = practice (processor, 16000 - 480);
+
+    CHECK (statistics.numHits == 6);
+    CHECK (std::abs (statistics.lastDeviationMs + 10.0f) < 1.5f);
+    CHECK (std::abs (statistics.meanMs + 10.0f) < 1.5f);
+}
+
+TEST_CASE ("Practice hits are matched with the notes of the pattern, not its rests", "[practice]")
+{
+    MetronomeAudioProcessor processor;
+    setParameter (processor, "subdivision", static_cast<float> (static_cast<int> (Subdivision::RestEighthPattern)));
+
+    // The pattern rests on the beat and plays the second and fourth sixteenths: 5 ms before the fourth
+    const auto statistics = practice (processor, samplesPerBeat * 3 / 4 - 240);
+
+    CHECK (statistics.numHits == 6);
+    CHECK (std::abs (statistics.meanMs + 5.0f) < 1.5f);
+}
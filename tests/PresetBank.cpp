@@ -0,0 +1,172 @@
+#include "helpers/test_helpers.h"
+#include <PluginProcessor.h>
+#include <PresetBank.h>
+#include <catch2/catch_test_macros.hpp>
+#include <vector>
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 480;
+}
+
+TEST_CASE ("Replaced snapshots live until released, unless still in use", "[presets]")
+{
+    PresetBank bank;
+
+    EngineSnapshot snapshot;
+    snapshot.bpm = 90.0f;
+    bank.store (3, "Verse", snapshot);
+
+    const auto* original = bank.getSnapshot (3);
+    REQUIRE (original != nullptr);
+    CHECK (bank.getName (3) == "Verse");
+    CHECK (bank.getSnapshot (4) == nullptr);
+    CHECK (bank.getSnapshot (PresetBank::numPresets) == nullptr);
+
+    // Replacing a slot publishes a new snapshot and keeps the old one for readers
+    snapshot.bpm = 100.0f;
+    bank.store (3, "Verse", snapshot);
+
+    CHECK (bank.getSnapshot (3) != original);
+    CHECK (bank.getSnapshot (3)->bpm == 100.0f);
+    CHECK (bank.getNumRetiredSnapshots() == 1);
+
+    // A snapshot the engine still points to survives the release
+    bank.releaseRetiredSnapshots ({ original, nullptr });
+    REQUIRE (bank.getNumRetiredSnapshots() == 1);
+    CHECK (original->bpm == 90.0f);
+
+    bank.releaseRetiredSnapshots();
+    CHECK (bank.getNumRetiredSnapshots() == 0);
+}
+
+TEST_CASE ("Replaced snapshots are freed once a block has started after them", "[presets]")
+{
+    PresetBank bank;
+
+    EngineSnapshot snapshot;
+    bank.store (0, "Intro", snapshot);
+    const auto* first = bank.getSnapshot (0);
+    bank.store (0, "Intro", snapshot);
+
+    // The block in progress may have read the first snapshot
+    bank.releaseStaleSnapshots ({});
+    CHECK (bank.getNumRetiredSnapshots() == 1);
+
+    bank.startBlock();
+    bank.releaseStaleSnapshots ({ first });
+    CHECK (bank.getNumRetiredSnapshots() == 1);
+
+    bank.releaseStaleSnapshots ({});
+    CHECK (bank.getNumRetiredSnapshots() == 0);
+
+    // Reading a whole bank retires every slot the same way
+    bank.store (1, "Verse", snapshot);
+    juce::MemoryOutputStream stream;
+    bank.writeTo (stream);
+
+    juce::MemoryInputStream input (stream.getData(), stream.getDataSize(), false);
+    bank.readFrom (input);
+    CHECK (bank.getNumRetiredSnapshots() == 2);
+
+    bank.startBlock();
+    bank.releaseStaleSnapshots ({});
+    CHECK (bank.getNumRetiredSnapshots() == 0);
+}
+
+TEST_CASE ("Presets are saved and restored with their names", "[presets]")
+{
+    PresetBank bank;
+
+    EngineSnapshot snapshot;
+    snapshot.bpm = 133.0f;
+    snapshot.beatsPerBar = 7;
+    snapshot.subdivision = Subdivision::Triplet;
+    snapshot.mutedBeats = 0b0100100u;
+    bank.store (5, "Chorus", snapshot);
+
+    juce::MemoryOutputStream stream;
+    bank.writeTo (stream);
+
+    PresetBank restored;
+    juce::MemoryInputStream input (stream.getData(), stream.getDataSize(), false);
+    restored.readFrom (input);
+
+    REQUIRE (restored.getSnapshot (5) != nullptr);
+    CHECK (*restored.getSnapshot (5) == snapshot);
+    CHECK (restored.getName (5) == "Chorus");
+    CHECK (restored.getSnapshot (0) == nullptr);
+}
+
+TEST_CASE ("Damaged presets are read within the ranges of the parameters", "[presets]")
+{
+    juce::MemoryOutputStream stream;
+    stream.writeInt (1);
+    stream.writeInt (2);
+    stream.writeString ("Damaged");
+    stream.writeFloat (100.0f);
+    stream.writeInt (40); // Beats per bar
+    stream.writeInt (3); // Beat unit
+    stream.writeInt (-5); // Subdivision
+    stream.writeInt (7); // First beat sound
+    stream.writeInt (-1); // Other beats sound
+    stream.writeInt (12); // Rest sound
+    stream.writeInt (0);
+
+    PresetBank bank;
+    juce::MemoryInputStream input (stream.getData(), stream.getDataSize(), false);
+    bank.readFrom (input);
+
+    const auto* snapshot = bank.getSnapshot (2);
+    REQUIRE (snapshot != nullptr);
+    CHECK (snapshot->beatsPerBar == 16);
+    CHECK (snapshot->beatDenominator == 4);
+    CHECK (snapshot->subdivision == Subdivision::NoSubdivision);
+    CHECK (snapshot->firstBeatSound == 2);
+    CHECK (snapshot->otherBeatsSound == 0);
+    CHECK (snapshot->restSound == 2);
+}
+
+TEST_CASE ("A preset picked while playing switches at the next bar, across a release of resources", "[presets]")
+{
+    MetronomeAudioProcessor processor;
+    prepareProcessor (processor, sampleRate, blockSize);
+
+    // Preset 3 plays at 90 BPM, the parameters at 120 BPM (4/4, 96000 samples per bar)
+    setParameter (processor, "bpm", 90.0f);
+    processor.storePreset (3);
+    setParameter (processor, "bpm", 120.0f);
+
+    juce::AudioBuffer<float> buffer (1, blockSize);
+    juce::MidiBuffer midi;
+    OnsetFinder onsetFinder;
+
+    processor.processBlock (buffer, midi);
+    setParameter (processor, "play", 1.0f);
+
+    int64_t position = 0;
+    auto render = [&] (int64_t end) {
+        for (; position < end; position += blockSize)
+        {
+            processor.processBlock (buffer, midi);
+            onsetFinder.process (buffer.getReadPointer (0), blockSize, position);
+        }
+    };
+
+    render (30000);
+
+    // Picked during the second beat, then the slot is stored again: the picked snapshot is retired
+    processor.setCurrentProgram (3);
+    processor.storePreset (3);
+
+    // The host stops the audio: the preset waiting for its bar must survive
+    processor.releaseResources();
+    prepareProcessor (processor, sampleRate, blockSize);
+
+    render (170000);
+
+    const std::vector<int64_t> expected { 0, 24000, 48000, 72000, 96000, 128000, 160000 };
+    CHECK (onsetFinder.getOnsets() == expected);
+    CHECK (processor.getCurrentProgram() == 3);
+}
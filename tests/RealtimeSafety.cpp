@@ -0,0 +1,444 @@
+#include "helpers/test_helpers.h"
+#include <PluginProcessor.h>
+#include <RealtimeSafety.h>
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+
+/*
+ * Real-time safety of processBlock.
+ *
+ * The Tests target is built with BEATIT_REALTIME_CHECKS, so every allocation,
+ * deallocation or mutex acquisition made inside processBlock is recorded here,
+ * with its call stack, instead of asserting.
+ */
+namespace
+{
+    std::vector<RealtimeSafety::Violation> violations;
+
+    void recordViolation (const RealtimeSafety::Violation& violation)
+    {
+        violations.push_back (violation);
+    }
+
+    /**
+     * Records violations for its lifetime
+     */
+    struct ScopedViolationRecorder
+    {
+        ScopedViolationRecorder()
+        {
+            violations.clear();
+            violations.reserve (16);
+            RealtimeSafety::setViolationHandler (recordViolation);
+        }
+
+        ~ScopedViolationRecorder()
+        {
+            RealtimeSafety::setViolationHandler (nullptr);
+        }
+    };
+
+    juce::String describeViolations()
+    {
+        juce::String description;
+        for (const auto& violation : violations)
+        {
+            const auto* type = violation.type == RealtimeSafety::ViolationType::Lock ? "lock"
+                               : violation.type == RealtimeSafety::ViolationType::Allocation ? "allocation"
+                                                                                              : "deallocation";
+            description << type << " in " << violation.scope << ":\n"
+                        << violation.callStack << "\n";
+        }
+
+        return description;
+    }
+
+    /**
+     * Stereo output and a mono input, so that every input mode analyses audio
+     */
+    void prepare (MetronomeAudioProcessor& processor, double sampleRate, int blockSize)
+    {
+        prepareProcessor (processor, sampleRate, blockSize, juce::AudioChannelSet::mono(), juce::AudioChannelSet::stereo());
+    }
+
+    /**
+     * A few loud hits on the input channel, enough to trigger the onset detector
+     */
+    void writeInputBurst (juce::AudioBuffer<float>& buffer)
+    {
+        buffer.clear();
+        auto* input = buffer.getWritePointer (0);
+        for (int hit = 0; hit < buffer.getNumSamples(); hit += 512)
+        {
+            for (int i = hit; i < std::min (hit + 64, buffer.getNumSamples()); ++i)
+                input[i] = (i % 2 == 0) ? 0.9f : -0.9f;
+        }
+    }
+
+    float toValue (Subdivision subdivision)
+    {
+        return static_cast<float> (static_cast<int> (subdivision));
+    }
+
+    /**
+     * Sets a parameter the way hosts automate it from their audio thread: the value, then the listeners.
+     * JUCE's own listener lists lock; the processor checks its listener as a real-time scope.
+     */
+    void automate (juce::RangedAudioParameter& parameter, float value)
+    {
+        parameter.setValue (parameter.convertTo0to1 (value));
+        parameter.sendValueChangedMessageToListeners (parameter.getValue());
+    }
+
+    /** Values taken by one parameter in a sweep */
+    struct SweptParameter
+    {
+        juce::String parameterID;
+        std::vector<float> values;
+    };
+
+    /**
+     * Plays a block for every combination of the values, the first parameter changing fastest,
+     * and requires that none of them allocates or locks
+     */
+    void sweepCombinations (MetronomeAudioProcessor& processor, juce::AudioBuffer<float>& buffer, const std::vector<SweptParameter>& parameters)
+    {
+        juce::MidiBuffer midi;
+        std::vector<size_t> indices (parameters.size());
+
+        ScopedViolationRecorder recorder;
+
+        for (;;)
+        {
+            juce::String combination;
+            for (size_t i = 0; i < parameters.size(); ++i)
+            {
+                const auto value = parameters[i].values[indices[i]];
+                setParameter (processor, parameters[i].parameterID, value);
+                combination << parameters[i].parameterID << " " << value << " ";
+            }
+
+            writeInputBurst (buffer);
+            processor.processBlock (buffer, midi);
+
+            INFO (combination);
+            INFO (describeViolations());
+            REQUIRE (violations.empty());
+
+            // Next combination
+            size_t digit = 0;
+            while (digit < indices.size() && ++indices[digit] == parameters[digit].values.size())
+                indices[digit++] = 0;
+
+            if (digit == indices.size())
+                break;
+        }
+    }
+}
+
+TEST_CASE ("Real-time safety detector reports allocations", "[realtime]")
+{
+    static std::vector<int>* sink = nullptr;
+
+    ScopedViolationRecorder recorder;
+
+    {
+        const RealtimeSafety::ScopedRealtime scope ("test");
+        REQUIRE (RealtimeSafety::isInRealtimeScope());
+        sink = new std::vector<int> (100);
+    }
+
+    REQUIRE_FALSE (RealtimeSafety::isInRealtimeScope());
+    delete sink;
+
+    REQUIRE (violations.size() >= 1);
+    CHECK (violations.front().type == RealtimeSafety::ViolationType::Allocation);
+    CHECK (juce::String (violations.front().scope) == "test");
+}
+
+TEST_CASE ("processBlock neither allocates nor locks", "[realtime]")
+{
+    constexpr double sampleRate = 44100.0;
+    constexpr int blockSize = 2048;
+
+    MetronomeAudioProcessor processor;
+    prepare (processor, sampleRate, blockSize);
+
+    juce::AudioBuffer<float> buffer (2, blockSize);
+    juce::MidiBuffer midi;
+
+    SECTION ("every combination of parameters")
+    {
+        // Fast tempo: several beats and every subdivision within a block
+        setParameter (processor, "bpm", 500.0f);
+
+        const std::array<int, 8> numValues { 2, 3, 4, SubdivisionCount, 3, 3, 3, 4 };
+        const std::array<int, 3> beatsPerBar { 1, 2, 16 };
+        std::array<int, 8> indices {};
+
+        ScopedViolationRecorder recorder;
+
+        for (;;)
+        {
+            setParameter (processor, "play", static_cast<float> (indices[0]));
+            setParameter (processor, "beatsPerBar", static_cast<float> (beatsPerBar[static_cast<size_t> (indices[1])] - 1));
+            setParameter (processor, "beatDenominator", static_cast<float> (indices[2]));
+            setParameter (processor, "subdivision", static_cast<float> (indices[3]));
+            setParameter (processor, "firstBeatSound", static_cast<float> (indices[4]));
+            setParameter (processor, "otherBeatsSound", static_cast<float> (indices[5]));
+            setParameter (processor, "restSound", static_cast<float> (indices[6]));
+            setParameter (processor, "inputMode", static_cast<float> (indices[7]));
+
+            writeInputBurst (buffer);
+            processor.processBlock (buffer, midi);
+
+            INFO ("play " << indices[0] << ", beats per bar " << beatsPerBar[static_cast<size_t> (indices[1])]
+                          << ", denominator index " << indices[2] << ", subdivision " << indices[3]
+                          << ", sounds " << indices[4] << "/" << indices[5] << "/" << indices[6]
+                          << ", input mode " << indices[7]);
+            INFO (describeViolations());
+            REQUIRE (violations.empty());
+
+            // Next combination
+            size_t digit = 0;
+            while (digit < indices.size() && ++indices[digit] == numValues[digit])
+                indices[digit++] = 0;
+
+            if (digit == indices.size())
+                break;
+        }
+    }
+
+    SECTION ("every latency setting")
+    {
+        // The offset moves the clicks to come while playing, the device latency counts in Device mode
+        setParameter (processor, "bpm", 500.0f);
+        processor.setDeviceOutputLatency (256);
+
+        sweepCombinations (processor,
+            buffer,
+            { { "clickOffset", { 0.0f, -12.5f, -250.0f } },
+                { "latencyMode", { 0.0f, 1.0f, 2.0f } },
+                { "subdivision", { toValue (Subdivision::NoSubdivision), toValue (Subdivision::Quarter), toValue (Subdivision::RestEighthPattern) } },
+                { "inputMode", { 0.0f, 3.0f } },
+                { "play", { 0.0f, 1.0f } } });
+    }
+
+    SECTION ("every track setting")
+    {
+        // The first track swept, the last one playing along or not
+        setParameter (processor, "bpm", 500.0f);
+        setParameter (processor, "track4Subdivision", toValue (Subdivision::RestEighthPattern));
+
+        sweepCombinations (processor,
+            buffer,
+            { { "track1Subdivision", { toValue (Subdivision::NoSubdivision), toValue (Subdivision::Triplet), toValue (Subdivision::Quarter), toValue (Subdivision::EighthQuarterEighth) } },
+                { "track1Accent", { 0.0f, 1.0f, 2.0f } },
+                { "track1Sound", { 0.0f, 1.0f } },
+                { "track1Pan", { -1.0f, 0.0f, 1.0f } },
+                { "track1Gain", { -60.0f, 6.0f } },
+                { "track1Enabled", { 0.0f, 1.0f } },
+                { "track4Enabled", { 0.0f, 1.0f } },
+                { "play", { 0.0f, 1.0f } } });
+    }
+
+    SECTION ("every groove")
+    {
+        // Late sixteenths for the imported groove
+        GrooveTemplate groove;
+        groove.stepsPerBeat = 4;
+        groove.numSteps = 16;
+        for (size_t step = 0; step < 16; ++step)
+            groove.offsets[step] = step % 2 == 1 ? 0.25f : 0.0f;
+
+        processor.setImportedGroove (groove);
+        setParameter (processor, "bpm", 500.0f);
+
+        sweepCombinations (processor,
+            buffer,
+            { { "swing", { 50.0f, 62.5f, 75.0f } },
+                { "groove", { 0.0f, 1.0f, 2.0f } },
+                { "subdivision", { toValue (Subdivision::Half), toValue (Subdivision::Triplet), toValue (Subdivision::Quarter), toValue (Subdivision::RestEighthPattern) } },
+                { "beatsPerBar", { 0.0f, 6.0f } },
+                { "inputMode", { 0.0f, 3.0f } },
+                { "play", { 0.0f, 1.0f } } });
+    }
+
+    SECTION ("every tempo while playing")
+    {
+        setParameter (processor, "subdivision", static_cast<float> (static_cast<int> (Subdivision::Quarter)));
+        setParameter (processor, "play", 1.0f);
+
+        ScopedViolationRecorder recorder;
+
+        for (int bpm = 1; bpm <= 500; ++bpm)
+        {
+            setParameter (processor, "bpm", static_cast<float> (bpm));
+
+            // A tempo change stops the current click, the next block plays again
+            for (int block = 0; block < 2; ++block)
+            {
+                writeInputBurst (buffer);
+                processor.processBlock (buffer, midi);
+            }
+
+            INFO (bpm << " BPM");
+            INFO (describeViolations());
+            REQUIRE (violations.empty());
+        }
+    }
+}
+
+TEST_CASE ("Meter automation from the audio thread only raises flags", "[realtime]")
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+
+    MetronomeAudioProcessor processor;
+    prepare (processor, sampleRate, blockSize);
+    setParameter (processor, "bpm", 500.0f);
+    setParameter (processor, "play", 1.0f);
+
+    juce::AudioBuffer<float> buffer (2, blockSize);
+    juce::MidiBuffer midi;
+
+    auto* beatsPerBar = processor.getState().getParameter ("beatsPerBar");
+    auto* beatDenominator = processor.getState().getParameter ("beatDenominator");
+    setParameter (processor, "beatsPerBar", 15.0f); // 16 beats
+    setParameter (processor, "beatDenominator", 3.0f);
+
+    // Well into the bar before the meter shrinks
+    for (int block = 0; block < 100; ++block)
+        processor.processBlock (buffer, midi);
+    REQUIRE (processor.getCurrentBeat() > 2);
+
+    ScopedViolationRecorder recorder;
+    std::thread audioThread ([&] {
+        automate (*beatsPerBar, 2.0f); // 3 beats
+        automate (*beatDenominator, 2.0f);
+    });
+    audioThread.join();
+
+    INFO (describeViolations());
+    CHECK (violations.empty());
+
+    // Applied at the next block: the beat in progress starts the shorter bar
+    processor.processBlock (buffer, midi);
+    CHECK (processor.getBeatsPerBar() == 3);
+    CHECK (processor.getCurrentBeat() < 3);
+}
+
+TEST_CASE ("Remote commands are applied without allocating or locking", "[realtime]")
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+
+    MetronomeAudioProcessor processor;
+    prepare (processor, sampleRate, blockSize);
+    REQUIRE (processor.startRemoteControl (0));
+
+    juce::OSCSender sender;
+    REQUIRE (sender.connect ("127.0.0.1", processor.getRemoteControlPort()));
+
+    // A subscriber, so that the beats are queued for the broadcast thread as well
+    juce::DatagramSocket subscriber (false);
+    REQUIRE (subscriber.bindToPort (0, "127.0.0.1"));
+    REQUIRE (sender.send (juce::OSCMessage (juce::OSCAddressPattern ("/beatit/subscribe"), subscriber.getBoundPort())));
+
+    auto sendEveryCommand = [&sender] (float bpm) {
+        REQUIRE (sender.send (juce::OSCMessage (juce::OSCAddressPattern ("/beatit/tempo"), bpm)));
+        REQUIRE (sender.send (juce::OSCMessage (juce::OSCAddressPattern ("/beatit/meter"), 7, 8)));
+        REQUIRE (sender.send (juce::OSCMessage (juce::OSCAddressPattern ("/beatit/meter"), 3)));
+        REQUIRE (sender.send (juce::OSCMessage (juce::OSCAddressPattern ("/beatit/subdivision"), static_cast<int> (Subdivision::Quarter))));
+        REQUIRE (sender.send (juce::OSCMessage (juce::OSCAddressPattern ("/beatit/mute"), 1)));
+        REQUIRE (sender.send (juce::OSCMessage (juce::OSCAddressPattern ("/beatit/mute"), 2, 1)));
+        REQUIRE (sender.send (juce::OSCMessage (juce::OSCAddressPattern ("/beatit/mute"), 2, 0)));
+        REQUIRE (sender.send (juce::OSCMessage (juce::OSCAddressPattern ("/beatit/tap"))));
+        REQUIRE (sender.send (juce::OSCMessage (juce::OSCAddressPattern ("/beatit/stop"))));
+        REQUIRE (sender.send (juce::OSCMessage (juce::OSCAddressPattern ("/beatit/tap"))));
+
+        // Bundled commands apply together
+        juce::OSCBundle bundle;
+        bundle.addElement (juce::OSCMessage (juce::OSCAddressPattern ("/beatit/subdivision"), static_cast<int> (Subdivision::Triplet)));
+        bundle.addElement (juce::OSCMessage (juce::OSCAddressPattern ("/beatit/play"), 1));
+        REQUIRE (sender.send (bundle));
+    };
+
+    juce::AudioBuffer<float> buffer (2, blockSize);
+    juce::MidiBuffer midi;
+
+    ScopedViolationRecorder recorder;
+
+    // The commands arrive on the network thread: play until the output is silent, or clicks again
+    auto playUntil = [&] (bool clicking) {
+        const auto deadline = juce::Time::getMillisecondCounterHiRes() + 5000.0;
+
+        for (;;)
+        {
+            writeInputBurst (buffer);
+            processor.processBlock (buffer, midi);
+
+            INFO (describeViolations());
+            REQUIRE (violations.empty());
+
+            if ((buffer.getMagnitude (1, 0, blockSize) > 0.0f) == clicking)
+                return true;
+
+            if (juce::Time::getMillisecondCounterHiRes() > deadline)
+                return false;
+
+            juce::Thread::sleep (1);
+        }
+    };
+
+    for (const auto bpm : { 500.0f, 137.0f })
+    {
+        INFO (bpm << " BPM");
+
+        // The last command starts the click again
+        sendEveryCommand (bpm);
+        CHECK (playUntil (true));
+
+        REQUIRE (sender.send (juce::OSCMessage (juce::OSCAddressPattern ("/beatit/stop"))));
+        CHECK (playUntil (false));
+    }
+}
+
+TEST_CASE ("Automation and playback with the editor open neither allocate nor lock", "[realtime]")
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+
+    runWithinPluginEditor ([&] (MetronomeAudioProcessor& processor) {
+        prepare (processor, sampleRate, blockSize);
+        setParameter (processor, "play", 1.0f);
+
+        auto& state = processor.getState();
+        auto* bpm = state.getParameter ("bpm");
+        auto* subdivision = state.getParameter ("subdivision");
+        auto* beatsPerBar = state.getParameter ("beatsPerBar");
+
+        juce::AudioBuffer<float> buffer (2, blockSize);
+        juce::MidiBuffer midi;
+
+        // The editor refreshes from its timer: nothing the host does on its audio thread reaches it
+        ScopedViolationRecorder recorder;
+        std::thread audioThread ([&] {
+            for (int block = 0; block < 200; ++block)
+            {
+                if (block % 10 == 0)
+                {
+                    automate (*bpm, 90.0f + static_cast<float> (block));
+                    automate (*subdivision, toValue (block % 20 == 0 ? Subdivision::Triplet : Subdivision::Half));
+                    automate (*beatsPerBar, static_cast<float> (block % 4));
+                }
+
+                processor.processBlock (buffer, midi);
+            }
+        });
+        audioThread.join();
+
+        INFO (describeViolations());
+        CHECK (violations.empty());
+    });
+}
@@ -0,0 +1,163 @@
+#include "helpers/test_helpers.h"
+#include <PluginProcessor.h>
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+
+    void prepare (MetronomeAudioProcessor& processor)
+    {
+        prepareProcessor (processor, sampleRate, blockSize);
+    }
+
+    void send (juce::OSCSender& sender, const juce::String& address, float value)
+    {
+        REQUIRE (sender.send (juce::OSCMessage (juce::OSCAddressPattern (address), value)));
+    }
+
+    /**
+     * Collects the beats broadcast by the server
+     */
+    class BeatListener : private juce::OSCReceiver::Listener<juce::OSCReceiver::RealtimeCallback>
+    {
+    public:
+        struct Beat
+        {
+            int beat = 0;
+            int beatsPerBar = 0;
+            float bpm = 0.0f;
+            juce::uint64 timeTag = 0;
+        };
+
+        BeatListener()
+        {
+            REQUIRE (socket.bindToPort (0, "127.0.0.1"));
+            REQUIRE (receiver.connectToSocket (socket));
+            receiver.addListener (this);
+        }
+
+        ~BeatListener() override
+        {
+            receiver.removeListener (this);
+            receiver.disconnect();
+        }
+
+        int getPort() const { return socket.getBoundPort(); }
+
+        std::vector<Beat> getBeats() const
+        {
+            const juce::ScopedLock lock (beatLock);
+            return beats;
+        }
+
+    private:
+        void oscMessageReceived (const juce::OSCMessage&) override {}
+
+        void oscBundleReceived (const juce::OSCBundle& bundle) override
+        {
+            for (const auto& element : bundle)
+            {
+                if (!element.isMessage())
+                    continue;
+
+                const auto& message = element.getMessage();
+                if (message.getAddressPattern().toString() != "/beatit/beat" || message.size() != 3)
+                    continue;
+
+                const juce::ScopedLock lock (beatLock);
+                beats.push_back ({ message[0].getInt32(), message[1].getInt32(), message[2].getFloat32(), bundle.getTimeTag().getRawTimeTag() });
+            }
+        }
+
+        juce::DatagramSocket socket { false };
+        juce::OSCReceiver receiver;
+        juce::CriticalSection beatLock;
+        std::vector<Beat> beats;
+    };
+}
+
+TEST_CASE ("OSC commands reach the engine", "[osc]")
+{
+    MetronomeAudioProcessor processor;
+    prepare (processor);
+    CHECK (processor.getRemoteControlPort() == -1);
+
+    REQUIRE (processor.startRemoteControl (0));
+    REQUIRE (processor.getRemoteControlPort() > 0);
+
+    juce::OSCSender sender;
+    REQUIRE (sender.connect ("127.0.0.1", processor.getRemoteControlPort()));
+
+    // Three beats per bar with the second muted, at 240 BPM: clicks on beats 0 and 2, 12000 samples apart
+    send (sender, "/beatit/tempo", 240.0f);
+    REQUIRE (sender.send (juce::OSCMessage (juce::OSCAddressPattern ("/beatit/meter"), 3)));
+    REQUIRE (sender.send (juce::OSCMessage (juce::OSCAddressPattern ("/beatit/mute"), 1, 1)));
+    send (sender, "/beatit/play", 1.0f);
+
+    juce::AudioBuffer<float> buffer (1, blockSize);
+    juce::MidiBuffer midi;
+
+    OnsetFinder finder;
+    const auto& onsets = finder.getOnsets();
+    const auto deadline = juce::Time::getMillisecondCounterHiRes() + 5000.0;
+
+    for (int64_t position = 0; onsets.size() < 5 && juce::Time::getMillisecondCounterHiRes() < deadline; position += blockSize)
+    {
+        processor.processBlock (buffer, midi);
+        finder.process (buffer.getReadPointer (0), blockSize, position);
+
+        // The commands arrive on the network thread
+        if (onsets.empty())
+            juce::Thread::sleep (1);
+    }
+
+    REQUIRE (onsets.size() >= 5);
+    CHECK (onsets[1] - onsets[0] == 24000);
+    CHECK (onsets[2] - onsets[0] == 36000);
+    CHECK (onsets[3] - onsets[0] == 60000);
+    CHECK (onsets[4] - onsets[0] == 72000);
+}
+
+TEST_CASE ("Rendered beats are broadcast to subscribers", "[osc]")
+{
+    MetronomeAudioProcessor processor;
+    prepare (processor);
+    REQUIRE (processor.startRemoteControl (0));
+
+    BeatListener listener;
+
+    juce::OSCSender sender;
+    REQUIRE (sender.connect ("127.0.0.1", processor.getRemoteControlPort()));
+    REQUIRE (sender.send (juce::OSCMessage (juce::OSCAddressPattern ("/beatit/subscribe"), listener.getPort())));
+    REQUIRE (sender.send (juce::OSCMessage (juce::OSCAddressPattern ("/beatit/meter"), 3)));
+    send (sender, "/beatit/tempo", 240.0f);
+    send (sender, "/beatit/play", 1.0f);
+
+    juce::AudioBuffer<float> buffer (1, blockSize);
+    juce::MidiBuffer midi;
+    const auto deadline = juce::Time::getMillisecondCounterHiRes() + 5000.0;
+
+    while (listener.getBeats().size() < 7 && juce::Time::getMillisecondCounterHiRes() < deadline)
+    {
+        processor.processBlock (buffer, midi);
+        juce::Thread::sleep (1);
+    }
+
+    const auto beats = listener.getBeats();
+    REQUIRE (beats.size() >= 7);
+
+    for (size_t i = 0; i < beats.size(); ++i)
+    {
+        INFO ("beat " << i);
+        CHECK (beats[i].beatsPerBar == 3);
+        CHECK (beats[i].bpm == 240.0f);
+
+        if (i > 0)
+        {
+            CHECK (beats[i].beat == (beats[i - 1].beat + 1) % 3);
+            CHECK (beats[i].timeTag > beats[i - 1].timeTag);
+        }
+    }
+}
@@ -0,0 +1,200 @@
+#include "helpers/test_helpers.h"
+#include <PluginProcessor.h>
+#include <SessionReplay.h>
+#include <array>
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    SessionReplay::Result replay (const juce::File& log)
+    {
+        MetronomeAudioProcessor processor;
+        SessionReplay sessionReplay (processor);
+
+        juce::FileInputStream stream (log);
+        REQUIRE (stream.openedOk());
+        return sessionReplay.replay (stream);
+    }
+
+    /**
+     * Plays a few seconds with the UI, the host and the input all changing the engine between blocks of odd sizes
+     */
+    int recordBusySession (const juce::File& log)
+    {
+        constexpr std::array<int, 6> blockSizes { 512, 37, 1024, 256, 1, 700 };
+        constexpr int numBlocks = 240;
+
+        MetronomeAudioProcessor processor;
+        REQUIRE (processor.startSessionRecording (log));
+
+        prepareProcessor (processor, 48000.0, 1024, juce::AudioChannelSet::mono(), juce::AudioChannelSet::stereo());
+
+        setParameter (processor, "bpm", 133.0f);
+        setParameter (processor, "subdivision", static_cast<float> (static_cast<int> (Subdivision::Triplet)));
+        setParameter (processor, "play", 1.0f);
+
+        juce::AudioBuffer<float> buffer (2, 1024);
+        juce::MidiBuffer midi;
+        int64_t position = 0;
+        float peak = 0.0f;
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            const auto numSamples = blockSizes[static_cast<size_t> (block) % blockSizes.size()];
+            buffer.setSize (2, numSamples, false, false, true);
+            buffer.clear();
+            midi.clear();
+
+            // The input: a hit every 20000 samples
+            for (int i = 0; i < numSamples; ++i)
+                if ((position + i) % 20000 == 0)
+                    buffer.setSample (0, i, 0.9f);
+
+            switch (block)
+            {
+                case 20: processor.toggleBeatMute (2); break;
+                case 30: processor.processTapTempo(); break;
+                case 33: processor.processTapTempo(); break;
+                case 50: setParameter (processor, "beatsPerBar", 6.0f); break; // 7 beats
+                case 70: setParameter (processor, "inputMode", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::InputMode::AudioTap))); break;
+                case 100:
+                    processor.storePreset (3);
+                    setParameter (processor, "bpm", 90.0f);
+                    setParameter (processor, "swing", 62.5f);
+                    break;
+                case 120: processor.setCurrentProgram (3); break;
+                case 150:
+                    processor.setDeviceOutputLatency (256);
+                    setParameter (processor, "latencyMode", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::LatencyMode::Device)));
+                    break;
+                case 160:
+                case 161:
+                case 163:
+                    midi.addEvent (juce::MidiMessage::noteOn (1, 60, 1.0f), numSamples / 2);
+                    break;
+                case 200: setParameter (processor, "track1Enabled", 1.0f); break;
+                default: break;
+            }
+
+            processor.processBlock (buffer, midi);
+            peak = juce::jmax (peak, buffer.getMagnitude (0, 0, numSamples));
+            position += numSamples;
+        }
+
+        processor.stopSessionRecording();
+        CHECK (peak > 0.0f);
+        return numBlocks;
+    }
+}
+
+TEST_CASE ("Session logs replay bit for bit", "[session]")
+{
+    const juce::TemporaryFile log (".bisl");
+    const auto numBlocks = recordBusySession (log.getFile());
+
+    const auto result = replay (log.getFile());
+
+    CHECK (result.error.isEmpty());
+    CHECK (result.complete);
+    CHECK (result.numBlocks == numBlocks);
+    CHECK (result.firstMismatch == -1);
+    CHECK (result.reproduced());
+}
+
+TEST_CASE ("Sample rate changes and double precision replay bit for bit", "[session]")
+{
+    const juce::TemporaryFile log (".bisl");
+    int numBlocks = 0;
+
+    {
+        MetronomeAudioProcessor processor;
+        REQUIRE (processor.startSessionRecording (log.getFile()));
+
+        processor.setProcessingPrecision (juce::AudioProcessor::doublePrecision);
+        setParameter (processor, "play", 1.0f);
+
+        juce::AudioBuffer<double> buffer (1, 480);
+        juce::MidiBuffer midi;
+
+        for (const auto sampleRate : { 44100.0, 96000.0 })
+        {
+            prepareProcessor (processor, sampleRate, 480);
+
+            for (int block = 0; block < 200; ++block, ++numBlocks)
+            {
+                if (block == 100)
+                    setParameter (processor, "bpm", 171.0f);
+
+                processor.processBlock (buffer, midi);
+            }
+        }
+
+        processor.stopSessionRecording();
+    }
+
+    const auto result = replay (log.getFile());
+
+    CHECK (result.numBlocks == numBlocks);
+    CHECK (result.reproduced());
+}
+
+TEST_CASE ("A log cut short replays the blocks it holds", "[session]")
+{
+    const juce::TemporaryFile log (".bisl");
+    const auto numBlocks = recordBusySession (log.getFile());
+
+    juce::MemoryBlock data;
+    REQUIRE (log.getFile().loadFileAsData (data));
+
+    juce::MemoryInputStream stream (data.getData(), data.getSize() / 2, false);
+    MetronomeAudioProcessor processor;
+    SessionReplay sessionReplay (processor);
+    const auto result = sessionReplay.replay (stream);
+
+    CHECK (result.numBlocks > 0);
+    CHECK (result.numBlocks < numBlocks);
+    CHECK (result.numMismatches == 0);
+    CHECK_FALSE (result.complete);
+    CHECK_FALSE (result.reproduced());
+}
+
+TEST_CASE ("Presets replay on the samples that adopted them", "[session]")
+{
+    const juce::TemporaryFile log (".bisl");
+    int numBlocks = 0;
+
+    {
+        MetronomeAudioProcessor processor;
+        REQUIRE (processor.startSessionRecording (log.getFile()));
+
+        prepareProcessor (processor, 48000.0, 1000);
+
+        // Bars of 3 beats at 97 and 151 BPM: their starts fall anywhere in the blocks
+        setParameter (processor, "beatsPerBar", 2.0f);
+        setParameter (processor, "bpm", 97.0f);
+        processor.storePreset (3);
+        setParameter (processor, "bpm", 151.0f);
+        processor.storePreset (4);
+        setParameter (processor, "play", 1.0f);
+
+        juce::AudioBuffer<float> buffer (1, 1000);
+        juce::MidiBuffer midi;
+
+        for (; numBlocks < 400; ++numBlocks)
+        {
+            // Picked in the middle of bars, and again before the previous pick was adopted
+            if (numBlocks % 50 == 17 || numBlocks % 50 == 18)
+                processor.setCurrentProgram (3 + (numBlocks / 50) % 2);
+
+            buffer.setSize (1, 331 + (numBlocks * 97) % 670, false, false, true);
+            processor.processBlock (buffer, midi);
+        }
+
+        processor.stopSessionRecording();
+    }
+
+    const auto result = replay (log.getFile());
+
+    CHECK (result.numBlocks == numBlocks);
+    CHECK (result.reproduced());
+}
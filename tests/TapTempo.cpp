@@ -0,0 +1,153 @@
+#include <TapTempoCalculator.h>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <initializer_list>
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+
+    int64_t samplesPerBeat (double bpm)
+    {
+        return static_cast<int64_t> (std::llround (60.0 * sampleRate / bpm));
+    }
+
+    /** Taps a steady pulse, returning the position of the next beat */
+    int64_t tapSteadily (TapTempoCalculator& calculator, int64_t position, double bpm, int numTaps)
+    {
+        for (int i = 0; i < numTaps; ++i, position += samplesPerBeat (bpm))
+            calculator.tap (position);
+
+        return position;
+    }
+}
+
+TEST_CASE ("Steady taps give their tempo and the beat they landed on", "[taptempo]")
+{
+    TapTempoCalculator calculator;
+    calculator.setSampleRate (sampleRate);
+
+    CHECK (calculator.calculateBPM() == 120.0);
+    CHECK_FALSE (calculator.getLastBeatPosition().has_value());
+
+    const auto next = tapSteadily (calculator, 1000, 100.0, 6);
+
+    CHECK (std::abs (calculator.calculateBPM() - 100.0) < 1e-9);
+    REQUIRE (calculator.getLastBeatPosition().has_value());
+    CHECK (std::abs (*calculator.getLastBeatPosition() - static_cast<double> (next - samplesPerBeat (100.0))) < 1e-6);
+}
+
+TEST_CASE ("The least-squares fit averages out jittery taps", "[taptempo]")
+{
+    TapTempoCalculator calculator;
+    calculator.setSampleRate (sampleRate);
+
+    // 120 BPM, each tap up to 8 ms early or late
+    const int64_t period = samplesPerBeat (120.0);
+    int64_t beat = 0;
+    for (const auto jitter : { 0, 384, -240, 96, -384, 192, -96, 288 })
+        calculator.tap (period * beat++ + jitter);
+
+    CHECK (std::abs (calculator.calculateBPM() - 120.0) < 0.5);
+
+    // The fitted phase is closer to the grid than the last tap (8 ms late)
+    REQUIRE (calculator.getLastBeatPosition().has_value());
+    CHECK (std::abs (*calculator.getLastBeatPosition() - static_cast<double> (period * 7)) < 288.0);
+}
+
+TEST_CASE ("Bounces, outliers and missed taps do not break the pulse", "[taptempo]")
+{
+    TapTempoCalculator calculator;
+    calculator.setSampleRate (sampleRate);
+
+    const int64_t period = samplesPerBeat (120.0);
+    auto position = tapSteadily (calculator, 0, 120.0, 4);
+
+    // A bounce 50 ms after a tap
+    CHECK_FALSE (calculator.tap (position - period + 2400));
+
+    // A stray tap a third of the way to the next beat
+    CHECK_FALSE (calculator.tap (position - period + period / 3));
+
+    // The pulse goes on; the next tap skips a beat
+    CHECK (calculator.tap (position));
+    CHECK (calculator.tap (position + 2 * period));
+    CHECK (calculator.tap (position + 3 * period));
+
+    CHECK (std::abs (calculator.calculateBPM() - 120.0) < 1e-9);
+}
+
+TEST_CASE ("The median period resists a mistimed tap", "[taptempo]")
+{
+    TapTempoCalculator calculator;
+    calculator.setSampleRate (sampleRate);
+
+    const int64_t period = samplesPerBeat (120.0);
+    auto position = tapSteadily (calculator, 0, 120.0, 4);
+
+    // 15% late: still the next beat, and the pulse judging later taps is unchanged
+    CHECK (calculator.tap (position + period * 15 / 100));
+    CHECK (calculator.tap (position + period));
+    CHECK (calculator.tap (position + 2 * period));
+    CHECK_FALSE (calculator.tap (position + 2 * period + period * 6 / 10));
+
+    CHECK (std::abs (calculator.calculateBPM() - 120.0) < 1.0);
+}
+
+TEST_CASE ("Two agreeing outliers start a new tempo", "[taptempo]")
+{
+    TapTempoCalculator calculator;
+    calculator.setSampleRate (sampleRate);
+
+    auto position = tapSteadily (calculator, 0, 120.0, 5) - samplesPerBeat (120.0);
+
+    // 90 BPM: the intervals fall between one and two periods of 120 BPM
+    position += samplesPerBeat (90.0);
+    CHECK_FALSE (calculator.tap (position));
+    position += samplesPerBeat (90.0);
+    CHECK (calculator.tap (position));
+
+    tapSteadily (calculator, position + samplesPerBeat (90.0), 90.0, 3);
+    CHECK (std::abs (calculator.calculateBPM() - 90.0) < 1e-6);
+}
+
+TEST_CASE ("Tapping twice as fast switches to the double tempo", "[taptempo]")
+{
+    TapTempoCalculator calculator;
+    calculator.setSampleRate (sampleRate);
+
+    auto position = tapSteadily (calculator, 0, 100.0, 6) - samplesPerBeat (100.0);
+
+    // Every other tap lands on the old pulse
+    for (int i = 0; i < 6; ++i)
+    {
+        position += samplesPerBeat (200.0);
+        calculator.tap (position);
+    }
+
+    CHECK (std::abs (calculator.calculateBPM() - 200.0) < 1e-6);
+
+    // A single tap half-way does not double the tempo
+    TapTempoCalculator steady;
+    steady.setSampleRate (sampleRate);
+    position = tapSteadily (steady, 0, 100.0, 6);
+
+    CHECK_FALSE (steady.tap (position - samplesPerBeat (200.0)));
+    CHECK (steady.tap (position));
+    CHECK (steady.tap (position + samplesPerBeat (100.0)));
+    CHECK (std::abs (steady.calculateBPM() - 100.0) < 1e-6);
+}
+
+TEST_CASE ("A pause starts a new sequence", "[taptempo]")
+{
+    TapTempoCalculator calculator;
+    calculator.setSampleRate (sampleRate);
+
+    auto position = tapSteadily (calculator, 0, 60.0, 4);
+
+    // Over two seconds without a tap
+    position += 2 * samplesPerBeat (60.0);
+    CHECK_FALSE (calculator.tap (position));
+    CHECK (calculator.tap (position + samplesPerBeat (150.0)));
+    CHECK (std::abs (calculator.calculateBPM() - 150.0) < 1e-6);
+}
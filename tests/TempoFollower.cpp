@@ -0,0 +1,128 @@
+#include <OnsetDetector.h>
+#include <TempoFollower.h>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    constexpr double frameRate = 187.5; // 256-sample hops at 48 kHz
+
+    /** Feeds an onset strength with a pulse every beat (and a weaker one in between if asked) */
+    float followPulse (TempoFollower& follower, double bpm, double seconds, bool eighths = false)
+    {
+        const auto framesPerBeat = 60.0 * frameRate / bpm;
+        const auto numFrames = static_cast<int> (seconds * frameRate);
+        auto nextBeat = 0.0;
+        auto beat = 0;
+
+        for (int frame = 0; frame < numFrames; ++frame)
+        {
+            auto strength = 1.0f;
+            if (frame == static_cast<int> (std::lround (nextBeat)))
+            {
+                strength += eighths && beat % 2 == 1 ? 6.0f : 10.0f;
+                nextBeat += eighths ? framesPerBeat / 2.0 : framesPerBeat;
+                ++beat;
+            }
+
+            follower.pushOnsetStrength (strength);
+        }
+
+        return follower.getTempo();
+    }
+}
+
+TEST_CASE ("The follower converges on the tempo of a steady pulse", "[tempo]")
+{
+    TempoFollower follower;
+    follower.prepare (frameRate);
+
+    for (const auto bpm : { 72.0, 97.0, 120.0, 143.0, 180.0 })
+    {
+        INFO ("bpm " << bpm);
+
+        follower.reset();
+        follower.setExpectedTempo (static_cast<float> (bpm) + 8.0f);
+        CHECK (std::abs (followPulse (follower, bpm, 15.0) - bpm) < 1.0);
+    }
+}
+
+TEST_CASE ("A steady onset strength has no tempo", "[tempo]")
+{
+    TempoFollower follower;
+    follower.prepare (frameRate);
+
+    for (int frame = 0; frame < static_cast<int> (10.0 * frameRate); ++frame)
+        follower.pushOnsetStrength (1.0f);
+
+    CHECK (follower.getTempo() == 0.0f);
+}
+
+TEST_CASE ("Half and double tempo inputs resolve to the octave of the click", "[tempo]")
+{
+    TempoFollower follower;
+    follower.prepare (frameRate);
+
+    // Eighth notes at 110 BPM, accented on the beat: a 220 BPM pulse
+    follower.setExpectedTempo (110.0f);
+    CHECK (std::abs (followPulse (follower, 110.0, 15.0, true) - 110.0) < 1.0);
+
+    // The same band, followed against a click twice as fast
+    follower.reset();
+    follower.setExpectedTempo (220.0f);
+    CHECK (std::abs (followPulse (follower, 110.0, 15.0, true) - 220.0) < 2.0);
+
+    // Half notes under a click at 140 BPM: every other beat, still the tempo of the click
+    follower.reset();
+    follower.setExpectedTempo (140.0f);
+    CHECK (std::abs (followPulse (follower, 70.0, 15.0) - 140.0) < 2.0);
+}
+
+TEST_CASE ("The follower moves with the band", "[tempo]")
+{
+    TempoFollower follower;
+    follower.prepare (frameRate);
+    follower.setExpectedTempo (100.0f);
+
+    CHECK (std::abs (followPulse (follower, 100.0, 10.0) - 100.0) < 1.0);
+
+    // The band pushes by 6 BPM: the forgetting factor lets the estimate follow within seconds
+    CHECK (std::abs (followPulse (follower, 106.0, 20.0) - 106.0) < 1.0);
+}
+
+TEST_CASE ("Onsets detected in a click train give its tempo", "[tempo]")
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr double bpm = 132.0;
+    constexpr int blockSize = 512;
+
+    // Twelve seconds of decaying 1.5 kHz bursts
+    const auto samplesPerBeat = 60.0 * sampleRate / bpm;
+    std::vector<float> signal (static_cast<size_t> (12.0 * sampleRate));
+    for (auto click = 0.0; click + 1440.0 < static_cast<double> (signal.size()); click += samplesPerBeat)
+    {
+        const auto start = static_cast<size_t> (std::lround (click));
+        for (size_t i = 0; i < 1440; ++i)
+        {
+            const auto time = static_cast<double> (i) / sampleRate;
+            signal[start + i] = static_cast<float> (0.8 * std::exp (-time / 0.008) * std::sin (2.0 * 3.14159265358979 * 1500.0 * time));
+        }
+    }
+
+    OnsetDetector detector;
+    detector.prepare (sampleRate);
+
+    TempoFollower follower;
+    follower.prepare (detector.getFrameRate());
+    follower.setExpectedTempo (120.0f);
+
+    for (size_t position = 0; position + blockSize <= signal.size(); position += blockSize)
+    {
+        detector.process (signal.data() + position, blockSize, static_cast<int64_t> (position), [] (int64_t) {}, [&follower] (float flux) {
+            follower.pushOnsetStrength (flux);
+        });
+    }
+
+    CHECK (std::abs (follower.getTempo() - bpm) < 1.0);
+}
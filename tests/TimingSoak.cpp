@@ -0,0 +1,301 @@
+#include "helpers/test_helpers.h"
+#include <BeatClock.h>
+#include <PluginProcessor.h>
+#include <catch2/catch_test_macros.hpp>
+
+/*
+ * Timing accuracy and drift soak harness.
+ *
+ * Long stretches of audio are rendered through the processor; every click
+ * onset in the output is compared with the ideal grid of the tempo, meter and
+ * subdivision. The default cases render a few minutes per configuration; the
+ * hidden [soak] case renders hours (run it with `./Tests "[soak]"`).
+ */
+namespace
+{
+    struct SoakConfiguration
+    {
+        double sampleRate = 48000.0;
+        int bpm = 120;
+        int beatsPerBar = 4;
+        int denominator = 4;
+        Subdivision subdivision = Subdivision::NoSubdivision;
+    };
+
+    struct SoakReport
+    {
+        int64_t numExpected = 0;
+        int64_t numDetected = 0;
+        int64_t numMissed = 0;
+        int64_t numDuplicated = 0;
+        double maxDriftSamples = 0.0; ///< Largest distance between an onset and its ideal position
+        double jitterSamples = 0.0; ///< Standard deviation of the onset errors
+    };
+
+    /**
+     * Positions of the clicks of each subdivision with silent rests, in fractions of a beat: its notes,
+     * and the beat itself, which always clicks
+     */
+    std::vector<double> getNoteFractions (Subdivision subdivision)
+    {
+        switch (subdivision)
+        {
+            case Subdivision::NoSubdivision: return { 0.0 };
+            case Subdivision::Half: return { 0.0, 1.0 / 2.0 };
+            case Subdivision::HalfAndRest: return { 0.0 };
+            case Subdivision::RestHalf: return { 0.0, 1.0 / 2.0 };
+            case Subdivision::Triplet: return { 0.0, 1.0 / 3.0, 2.0 / 3.0 };
+            case Subdivision::RestHalfHalfTriplet: return { 0.0, 1.0 / 3.0, 2.0 / 3.0 };
+            case Subdivision::HalfRestHalfTriplet: return { 0.0, 2.0 / 3.0 };
+            case Subdivision::HalfHalfRestTriplet: return { 0.0, 1.0 / 3.0 };
+            case Subdivision::RestHalfRestTriplet: return { 0.0, 1.0 / 3.0 };
+            case Subdivision::Quarter: return { 0.0, 1.0 / 4.0, 2.0 / 4.0, 3.0 / 4.0 };
+            case Subdivision::RestEighthPattern: return { 0.0, 1.0 / 4.0, 3.0 / 4.0 };
+            case Subdivision::EighthEighthQuarter: return { 0.0, 1.0 / 4.0 };
+            case Subdivision::QuarterEighthEighth: return { 0.0, 2.0 / 4.0, 3.0 / 4.0 };
+            case Subdivision::EighthQuarterEighth: return { 0.0, 1.0 / 4.0, 3.0 / 4.0 };
+            case Subdivision::Count:
+            default: return {};
+        }
+    }
+
+    /**
+     * Renders the given duration and matches the output onsets with the ideal grid
+     */
+    SoakReport runSoak (const SoakConfiguration& configuration, double seconds, int blockSize = 512)
+    {
+        MetronomeAudioProcessor processor;
+
+        prepareProcessor (processor, configuration.sampleRate, blockSize);
+
+        // Same sound on every beat, silent rests: only the beats and the notes produce onsets
+        setParameter (processor, "bpm", static_cast<float> (configuration.bpm));
+        setParameter (processor, "beatsPerBar", static_cast<float> (configuration.beatsPerBar - 1));
+        setParameter (processor, "beatDenominator", static_cast<float> (juce::findHighestSetBit (static_cast<uint32_t> (configuration.denominator))));
+        setParameter (processor, "subdivision", static_cast<float> (static_cast<int> (configuration.subdivision)));
+        setParameter (processor, "firstBeatSound", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::ClickType::High)));
+        setParameter (processor, "otherBeatsSound", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::ClickType::High)));
+        setParameter (processor, "restSound", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::RestSoundType::Mute)));
+
+        juce::AudioBuffer<float> buffer (1, blockSize);
+        juce::MidiBuffer midi;
+
+        // Let the stopped engine pick up the settings, then start on the next block
+        processor.processBlock (buffer, midi);
+        setParameter (processor, "play", 1.0f);
+
+        // Ideal grid, in samples from the first played sample
+        const auto samplesPerBeat = configuration.sampleRate * 60.0 / (configuration.bpm * 4.0 / configuration.denominator);
+        const auto fractions = getNoteFractions (configuration.subdivision);
+        const auto tolerance = samplesPerBeat / 8.0;
+
+        int64_t beat = 0;
+        size_t note = 0;
+        auto expected = [&] { return (static_cast<double> (beat) + fractions[note]) * samplesPerBeat; };
+        auto nextExpected = [&] {
+            if (++note == fractions.size())
+            {
+                note = 0;
+                ++beat;
+            }
+        };
+
+        SoakReport report;
+        double sumOfErrors = 0.0;
+        double sumOfSquaredErrors = 0.0;
+
+        auto onOnset = [&] (int64_t onset) {
+            ++report.numDetected;
+
+            while (expected() < static_cast<double> (onset) - tolerance)
+            {
+                ++report.numMissed;
+                ++report.numExpected;
+                nextExpected();
+            }
+
+            const auto error = static_cast<double> (onset) - expected();
+            if (std::abs (error) > tolerance)
+            {
+                ++report.numDuplicated;
+                return;
+            }
+
+            ++report.numExpected;
+            report.maxDriftSamples = std::max (report.maxDriftSamples, std::abs (error));
+            sumOfErrors += error;
+            sumOfSquaredErrors += error * error;
+            nextExpected();
+        };
+
+        const auto numSamples = static_cast<int64_t> (seconds * configuration.sampleRate);
+        int64_t position = 0;
+        OnsetFinder onsetFinder;
+
+        while (position < numSamples)
+        {
+            processor.processBlock (buffer, midi);
+            onsetFinder.process (buffer.getReadPointer (0), blockSize, position, onOnset);
+            position += blockSize;
+        }
+
+        // Notes that should have started well before the end of the rendering
+        while (expected() < static_cast<double> (position) - tolerance)
+        {
+            ++report.numMissed;
+            ++report.numExpected;
+            nextExpected();
+        }
+
+        const auto numMatched = static_cast<double> (report.numExpected - report.numMissed);
+        if (numMatched > 0.0)
+        {
+            const auto mean = sumOfErrors / numMatched;
+            report.jitterSamples = std::sqrt (std::max (0.0, sumOfSquaredErrors / numMatched - mean * mean));
+        }
+
+        return report;
+    }
+
+    void checkReport (const SoakConfiguration& configuration, const SoakReport& report)
+    {
+        INFO ("sample rate " << configuration.sampleRate << ", " << configuration.bpm << " BPM, "
+                             << configuration.beatsPerBar << "/" << configuration.denominator
+                             << ", subdivision " << static_cast<int> (configuration.subdivision));
+        INFO ("expected " << report.numExpected << ", detected " << report.numDetected
+                          << ", max drift " << report.maxDriftSamples << " samples, jitter " << report.jitterSamples << " samples");
+
+        CHECK (report.numExpected > 0);
+        CHECK (report.numMissed == 0);
+        CHECK (report.numDuplicated == 0);
+
+        // Every onset is the ideal position rounded to the nearest sample
+        CHECK (report.maxDriftSamples <= 0.5 + 1.0e-6);
+    }
+}
+
+TEST_CASE ("Beat clock rounds every position from the exact grid", "[timing]")
+{
+    BeatClock clock;
+    const auto samplesPerBeat = 44100.0 * 60.0 / 97.0;
+    clock.setSamplesPerBeat (samplesPerBeat);
+
+    int64_t beatStart = 0;
+    for (int beat = 0; beat < 1000000; ++beat)
+    {
+        const auto idealStart = beat * samplesPerBeat;
+        REQUIRE (std::abs (static_cast<double> (beatStart) - idealStart) <= 0.5);
+
+        const auto idealTriplet = (beat + 2.0 / 3.0) * samplesPerBeat;
+        REQUIRE (std::abs (static_cast<double> (beatStart + clock.getPosition (2, 3)) - idealTriplet) <= 0.5);
+
+        beatStart += clock.getBeatLength();
+        clock.nextBeat();
+    }
+}
+
+TEST_CASE ("Click onsets stay on the grid", "[timing]")
+{
+    SECTION ("every subdivision")
+    {
+        for (int subdivision = 0; subdivision < SubdivisionCount; ++subdivision)
+        {
+            SoakConfiguration configuration;
+            configuration.sampleRate = 44100.0;
+            configuration.bpm = 97;
+            configuration.subdivision = static_cast<Subdivision> (subdivision);
+            checkReport (configuration, runSoak (configuration, 60.0));
+        }
+    }
+
+    SECTION ("sample rates and tempi")
+    {
+        for (const auto sampleRate : { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 })
+        {
+            for (const auto bpm : { 1, 61, 137, 500 })
+            {
+                SoakConfiguration configuration;
+                configuration.sampleRate = sampleRate;
+                configuration.bpm = bpm;
+                configuration.subdivision = Subdivision::Quarter;
+                checkReport (configuration, runSoak (configuration, bpm == 1 ? 240.0 : 60.0));
+            }
+        }
+    }
+
+    SECTION ("meters")
+    {
+        for (const auto denominator : { 1, 2, 4, 8 })
+        {
+            for (const auto beatsPerBar : { 3, 7 })
+            {
+                SoakConfiguration configuration;
+                configuration.sampleRate = 48000.0;
+                configuration.bpm = 113;
+                configuration.beatsPerBar = beatsPerBar;
+                configuration.denominator = denominator;
+                configuration.subdivision = Subdivision::Triplet;
+                checkReport (configuration, runSoak (configuration, 120.0));
+            }
+        }
+    }
+}
+
+TEST_CASE ("Click onsets stay on the grid for hours", "[.][soak]")
+{
+    for (const auto sampleRate : { 44100.0, 96000.0 })
+    {
+        for (const auto bpm : { 73, 97, 211 })
+        {
+            for (int subdivision = 0; subdivision < SubdivisionCount; ++subdivision)
+            {
+                SoakConfiguration configuration;
+                configuration.sampleRate = sampleRate;
+                configuration.bpm = bpm;
+                configuration.beatsPerBar = 7;
+                configuration.denominator = 8;
+                configuration.subdivision = static_cast<Subdivision> (subdivision);
+                checkReport (configuration, runSoak (configuration, 3.0 * 3600.0, 1024));
+            }
+        }
+    }
+}
+
+TEST_CASE ("The beat clicks with the beat sound, even for patterns starting with a rest", "[timing]")
+{
+    constexpr int blockSize = 480;
+
+    // 120 BPM at 48 kHz, two beats
+    auto render = [] (Subdivision subdivision, MetronomeAudioProcessor::RestSoundType restSound) {
+        MetronomeAudioProcessor processor;
+        prepareProcessor (processor, 48000.0, blockSize);
+
+        setParameter (processor, "subdivision", static_cast<float> (static_cast<int> (subdivision)));
+        setParameter (processor, "firstBeatSound", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::ClickType::High)));
+        setParameter (processor, "otherBeatsSound", static_cast<float> (static_cast<int> (MetronomeAudioProcessor::ClickType::High)));
+        setParameter (processor, "restSound", static_cast<float> (static_cast<int> (restSound)));
+
+        juce::AudioBuffer<float> buffer (1, blockSize);
+        juce::MidiBuffer midi;
+        processor.processBlock (buffer, midi);
+        setParameter (processor, "play", 1.0f);
+
+        OnsetFinder onsetFinder;
+        for (int64_t position = 0; position < 48000; position += blockSize)
+        {
+            processor.processBlock (buffer, midi);
+            onsetFinder.process (buffer.getReadPointer (0), blockSize, position);
+        }
+
+        return onsetFinder.getOnsets();
+    };
+
+    using RestSound = MetronomeAudioProcessor::RestSoundType;
+
+    // Muted rests: the beat and the notes of the pattern are heard
+    CHECK (render (Subdivision::RestHalf, RestSound::Mute) == std::vector<int64_t> { 0, 12000, 24000, 36000 });
+    CHECK (render (Subdivision::HalfAndRest, RestSound::Mute) == std::vector<int64_t> { 0, 24000 });
+
+    // The rest sound only plays off the beat
+    CHECK (render (Subdivision::HalfAndRest, RestSound::SameAsBeat) == std::vector<int64_t> { 0, 12000, 24000, 36000 });
+}
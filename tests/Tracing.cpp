@@ -0,0 +1,64 @@
+#include <Tracing.h>
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+
+namespace
+{
+    const juce::var* findEvent (const juce::Array<juce::var>& events, const juce::String& name, const juce::String& phase)
+    {
+        for (const auto& event : events)
+            if (event["name"].toString() == name && event["ph"].toString() == phase)
+                return &event;
+
+        return nullptr;
+    }
+}
+
+TEST_CASE ("Spans and instants of every thread end up in the trace file", "[tracing]")
+{
+    const juce::TemporaryFile file (".json");
+    REQUIRE (Tracing::start (file.getFile()));
+    CHECK (Tracing::isRecording());
+
+    {
+        const Tracing::ScopedSpan span ("message span");
+        Tracing::instant ("message instant", 42);
+    }
+
+    std::thread worker ([] {
+        const Tracing::ScopedSpan span ("worker span");
+    });
+    worker.join();
+
+    Tracing::stop();
+    CHECK_FALSE (Tracing::isRecording());
+
+    // Not recording: dropped
+    Tracing::instant ("after stop");
+
+    const auto trace = juce::JSON::parse (file.getFile());
+    REQUIRE (trace.isArray());
+    const auto& events = *trace.getArray();
+
+    const auto* messageSpan = findEvent (events, "message span", "X");
+    const auto* messageInstant = findEvent (events, "message instant", "i");
+    const auto* workerSpan = findEvent (events, "worker span", "X");
+
+    REQUIRE (messageSpan != nullptr);
+    REQUIRE (messageInstant != nullptr);
+    REQUIRE (workerSpan != nullptr);
+    CHECK (findEvent (events, "after stop", "i") == nullptr);
+
+    CHECK (static_cast<double> ((*messageSpan)["dur"]) >= 0.0);
+    CHECK (static_cast<int> ((*messageInstant)["args"]["value"]) == 42);
+    CHECK ((*messageSpan)["tid"] == (*messageInstant)["tid"]);
+    CHECK ((*messageSpan)["tid"] != (*workerSpan)["tid"]);
+
+    // Each thread is named once
+    int threadNames = 0;
+    for (const auto& event : events)
+        if (event["name"].toString() == "thread_name")
+            ++threadNames;
+
+    CHECK (threadNames >= 2);
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <PluginProcessor.h>
+#include <vector>
 
 /* This is a helper function to run tests within the context of a plugin editor.
  *
@@ -7,7 +8,7 @@
  *
  * Example usage (screenshots the plugin)
  *
-  runWithinPluginEditor ([&] (PluginProcessor& plugin) {
+  runWithinPluginEditor ([&] (MetronomeAudioProcessor& plugin) {
     auto snapshot = plugin.getActiveEditor()->createComponentSnapshot (plugin.getActiveEditor()->getLocalBounds(), true, 2.0f);
     auto file = juce::File::getSpecialLocation (juce::File::SpecialLocationType::userDocumentsDirectory).getChildFile ("snapshot.jpeg");
     file.deleteFile();
@@ -19,9 +20,9 @@
    });
 
  */
-[[maybe_unused]] static void runWithinPluginEditor (const std::function<void (PluginProcessor& plugin)>& testCode)
+[[maybe_unused]] static void runWithinPluginEditor (const std::function<void (MetronomeAudioProcessor& plugin)>& testCode)
 {
-    PluginProcessor plugin;
+    MetronomeAudioProcessor plugin;
     const auto editor = plugin.createEditorIfNeeded();
 
     testCode (plugin);
@@ -29,3 +30,66 @@
     plugin.editorBeingDeleted (editor);
     delete editor;
 }
+
+/* Sets a parameter the way a host does, from its plain (denormalised) value */
+[[maybe_unused]] static void setParameter (MetronomeAudioProcessor& processor, const juce::String& parameterID, float value)
+{
+    auto* parameter = processor.getState().getParameter (parameterID);
+    parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+}
+
+/* Sets the main buses, a mono output without input by default, and prepares the processor */
+[[maybe_unused]] static void prepareProcessor (MetronomeAudioProcessor& processor,
+    double sampleRate,
+    int blockSize,
+    const juce::AudioChannelSet& input = juce::AudioChannelSet::disabled(),
+    const juce::AudioChannelSet& output = juce::AudioChannelSet::mono())
+{
+    auto layout = processor.getBusesLayout();
+    layout.getChannelSet (true, 0) = input;
+    layout.getChannelSet (false, 0) = output;
+    processor.setBusesLayout (layout);
+    processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+    processor.prepareToPlay (sampleRate, blockSize);
+}
+
+/* Finds the clicks in rendered output, block after block.
+ *
+ * A click starts with an exact zero (zero phase, zero envelope) followed by
+ * its first non-zero sample; the onset is the position of that zero.
+ */
+class OnsetFinder
+{
+public:
+    template <typename SampleType, typename Callback>
+    void process (const SampleType* samples, int numSamples, int64_t firstSample, Callback&& onOnset)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            if (previousSample == 0.0 && samples[i] != SampleType (0))
+                onOnset (firstSample + i - 1);
+
+            previousSample = static_cast<double> (samples[i]);
+        }
+    }
+
+    template <typename SampleType>
+    void process (const SampleType* samples, int numSamples, int64_t firstSample)
+    {
+        process (samples, numSamples, firstSample, [this] (int64_t onset) { onsets.push_back (onset); });
+    }
+
+    const std::vector<int64_t>& getOnsets() const { return onsets; }
+
+private:
+    std::vector<int64_t> onsets;
+    double previousSample = 1.0; // Nothing before the first sample: it cannot be an onset
+};
+
+/* Finds the clicks in a whole rendered channel */
+[[maybe_unused]] static std::vector<int64_t> findOnsets (const std::vector<float>& samples)
+{
+    OnsetFinder finder;
+    finder.process (samples.data(), static_cast<int> (samples.size()), 0);
+    return finder.getOnsets();
+}